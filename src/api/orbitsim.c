@@ -0,0 +1,234 @@
+#include "orbitsim.h"
+#include "../types.h"
+#include "../sim/bodies.h"
+#include "../sim/spacecraft.h"
+#include "../sim/simulation.h"
+#include "../sim/gravity.h"
+#include "../sim/craft_propagator.h"
+#include "../sim/hermite.h"
+#include "../sim/swarm.h"
+#include "../utility/json_loader.h"
+#include "../utility/commands.h"
+#include "../utility/command_queue.h"
+#include "../utility/error_hook.h"
+#include "../utility/telemetry_export.h"
+#include "../utility/autosave.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the world is the same sim_properties_t the GUI and the headless runner use, only hidden behind the API
+struct orbitsim_world {
+    sim_properties_t sim;
+};
+
+// element i of a column, 0 if the caller left the column out
+static double orbitsim_at(const double* column, const int i) {
+    return column != NULL ? column[i] : 0.0;
+}
+
+static void orbitsim_copyColumn(double* out, const double* in, const int count) {
+    if (out != NULL) memcpy(out, in, (size_t)count * sizeof(double));
+}
+
+// number of objects in [first, first + count) that exist
+static int orbitsim_clip(const int first, const int count, const int available) {
+    if (first < 0 || count <= 0 || first >= available) return 0;
+    return count < available - first ? count : available - first;
+}
+
+int orbitsim_apiVersion(void) {
+    return ORBITSIM_API_VERSION;
+}
+
+void orbitsim_setErrorHandler(const orbitsim_error_fn handler, void* user) {
+    error_setHandler(handler, user);
+}
+
+orbitsim_world_t* orbitsim_create(void) {
+    orbitsim_world_t* world = (orbitsim_world_t*)calloc(1, sizeof(orbitsim_world_t));
+    if (world == NULL) {
+        displayError("ERROR", "Failed to allocate memory for the world");
+        return NULL;
+    }
+    sim_properties_t* sim = &world->sim;
+    sim->gp = gravity_defaultParams();
+    sim->cp = craft_defaultPropagation();
+    sim->hermite = hermite_defaultState();
+    sim->telemetry = telemetry_defaultParams();
+    sim->autosave = autosave_defaultParams();
+    sim->batch = (physics_batch_t){.fixed_steps = 0, .steps = 1};
+    sim->wp.time_step = 0.01;
+    return world;
+}
+
+void orbitsim_destroy(orbitsim_world_t* world) {
+    if (world == NULL) return;
+    cleanup(&world->sim);
+    free(world);
+}
+
+bool orbitsim_loadScenario(orbitsim_world_t* world, const char* path) {
+    const int bodies_before = world->sim.gb.count;
+    readSimulationJSON(path, &world->sim);
+    return world->sim.gb.count > bodies_before;
+}
+
+void orbitsim_command(orbitsim_world_t* world, const char* command, char* log, const size_t log_size) {
+    sim_properties_t* sim = &world->sim;
+    char reply[COMMAND_TEXT_LENGTH] = "";
+    sim_command_t line;
+
+    // through the queue like the console, so "at <t> <command>" is scheduled and runs inside orbitsim_step.
+    // log lines of scheduled commands that ran since the last call are dropped, the first new one is this command's
+    while (cmdq_pop(&sim->replies, &line)) {}
+    if (command_enqueue(sim, command, reply)) {
+        command_processQueue(sim);
+        if (cmdq_pop(&sim->replies, &line)) snprintf(reply, sizeof(reply), "%s", line.text);
+    }
+
+    // the GUI resets between frames, here it happens before the command returns
+    if (world->sim.wp.reset_sim) resetSim(&world->sim);
+    if (log != NULL && log_size > 0) snprintf(log, log_size, "%s", reply);
+}
+
+int orbitsim_addBodies(orbitsim_world_t* world, const int count, const char* const* names, const double* mass,
+                       const double* radius, const orbitsim_const_columns_t state) {
+    body_properties_t* gb = &world->sim.gb;
+    int added = 0;
+    for (int i = 0; i < count; i++) {
+        char default_name[32];
+        snprintf(default_name, sizeof(default_name), "body_%d", gb->count);
+        const vec3 pos = {orbitsim_at(state.x, i), orbitsim_at(state.y, i), orbitsim_at(state.z, i)};
+        const vec3 vel = {orbitsim_at(state.vx, i), orbitsim_at(state.vy, i), orbitsim_at(state.vz, i)};
+
+        const int before = gb->count;
+        body_addOrbitalBody(gb, names != NULL ? names[i] : default_name, mass[i], orbitsim_at(radius, i), pos, vel);
+        if (gb->count == before) break;
+        added++;
+    }
+    body_calculateSOI(gb);
+    return added;
+}
+
+int orbitsim_addCraft(orbitsim_world_t* world, const int count, const char* const* names, const double* mass,
+                      const orbitsim_const_columns_t state) {
+    spacecraft_properties_t* sc = &world->sim.gs;
+    int added = 0;
+    for (int i = 0; i < count; i++) {
+        char default_name[32];
+        snprintf(default_name, sizeof(default_name), "craft_%d", sc->count);
+        const vec3 pos = {orbitsim_at(state.x, i), orbitsim_at(state.y, i), orbitsim_at(state.z, i)};
+        const vec3 vel = {orbitsim_at(state.vx, i), orbitsim_at(state.vy, i), orbitsim_at(state.vz, i)};
+
+        const int before = sc->count;
+        craft_addSpacecraft(sc, names != NULL ? names[i] : default_name, pos, vel,
+                            mass[i], 0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, NULL, 0);
+        if (sc->count == before) break;
+        added++;
+    }
+    return added;
+}
+
+int orbitsim_addParticles(orbitsim_world_t* world, const int count, const orbitsim_const_columns_t state) {
+    int added = 0;
+    for (int i = 0; i < count; i++) {
+        const vec3 pos = {orbitsim_at(state.x, i), orbitsim_at(state.y, i), orbitsim_at(state.z, i)};
+        const vec3 vel = {orbitsim_at(state.vx, i), orbitsim_at(state.vy, i), orbitsim_at(state.vz, i)};
+        if (!swarm_addParticle(&world->sim.swarm, pos, vel)) break;
+        added++;
+    }
+    return added;
+}
+
+void orbitsim_setTimeStep(orbitsim_world_t* world, const double time_step) {
+    if (time_step > 0.0) world->sim.wp.time_step = time_step;
+}
+
+double orbitsim_timeStep(const orbitsim_world_t* world) {
+    return world->sim.wp.time_step;
+}
+
+double orbitsim_time(const orbitsim_world_t* world) {
+    return world->sim.wp.sim_time;
+}
+
+int orbitsim_step(orbitsim_world_t* world, const int steps) {
+    sim_properties_t* sim = &world->sim;
+    if (sim->gb.count == 0) return 0; // nothing to integrate (sim time would not move)
+
+    sim->wp.sim_running = true;
+    int taken = 0;
+    while (taken < steps && !sim->wp.reset_sim) {
+        // scheduled commands run between the steps, a step that would pass one is shortened to end on it
+        command_processQueue(sim);
+        if (!sim->wp.sim_running || sim->wp.reset_sim) break;
+
+        const double step = sim->wp.time_step;
+        const double until_command = command_nextTime(sim) - sim->wp.sim_time;
+        if (until_command > 0.0 && until_command < step) sim->wp.time_step = until_command;
+        runCalculations(sim);
+        sim->wp.time_step = step;
+        taken++;
+    }
+    craft_publishAdaptive(sim); // orbitsim_getCraft returns adaptive craft at the sim time
+    sim->wp.sim_running = false;
+    return taken;
+}
+
+bool orbitsim_isStopped(const orbitsim_world_t* world) {
+    return world->sim.wp.reset_sim;
+}
+
+int orbitsim_bodyCount(const orbitsim_world_t* world) {
+    return world->sim.gb.count;
+}
+
+int orbitsim_craftCount(const orbitsim_world_t* world) {
+    return world->sim.gs.count;
+}
+
+int orbitsim_particleCount(const orbitsim_world_t* world) {
+    return world->sim.swarm.count;
+}
+
+int orbitsim_getBodies(const orbitsim_world_t* world, const int first, const int count, const orbitsim_columns_t out) {
+    const body_soa_t* soa = &world->sim.gb.soa;
+    const int n = orbitsim_clip(first, count, world->sim.gb.count);
+    if (n == 0) return 0;
+    orbitsim_copyColumn(out.x, soa->pos_x + first, n);
+    orbitsim_copyColumn(out.y, soa->pos_y + first, n);
+    orbitsim_copyColumn(out.z, soa->pos_z + first, n);
+    orbitsim_copyColumn(out.vx, soa->vel_x + first, n);
+    orbitsim_copyColumn(out.vy, soa->vel_y + first, n);
+    orbitsim_copyColumn(out.vz, soa->vel_z + first, n);
+    return n;
+}
+
+int orbitsim_getCraft(const orbitsim_world_t* world, const int first, const int count, const orbitsim_columns_t out) {
+    const spacecraft_t* craft = world->sim.gs.spacecraft;
+    const int n = orbitsim_clip(first, count, world->sim.gs.count);
+    for (int i = 0; i < n; i++) {
+        const spacecraft_t* c = &craft[first + i];
+        if (out.x != NULL) out.x[i] = c->pos.x;
+        if (out.y != NULL) out.y[i] = c->pos.y;
+        if (out.z != NULL) out.z[i] = c->pos.z;
+        if (out.vx != NULL) out.vx[i] = c->vel.x;
+        if (out.vy != NULL) out.vy[i] = c->vel.y;
+        if (out.vz != NULL) out.vz[i] = c->vel.z;
+    }
+    return n;
+}
+
+int orbitsim_getParticles(const orbitsim_world_t* world, const int first, const int count, const orbitsim_columns_t out) {
+    const swarm_t* swarm = &world->sim.swarm;
+    const int n = orbitsim_clip(first, count, swarm->count);
+    if (n == 0) return 0;
+    orbitsim_copyColumn(out.x, swarm->pos_x + first, n);
+    orbitsim_copyColumn(out.y, swarm->pos_y + first, n);
+    orbitsim_copyColumn(out.z, swarm->pos_z + first, n);
+    orbitsim_copyColumn(out.vx, swarm->vel_x + first, n);
+    orbitsim_copyColumn(out.vy, swarm->vel_y + first, n);
+    orbitsim_copyColumn(out.vz, swarm->vel_z + first, n);
+    return n;
+}
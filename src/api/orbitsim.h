@@ -0,0 +1,85 @@
+#ifndef ORBITSIM_H
+#define ORBITSIM_H
+
+// C API of the orbitsim_core library: drive the physics from other programs without the GUI
+//
+// everything is in base SI units (m, kg, s), positions and velocities are inertial
+// a world is not thread safe: call into one world from one thread at a time (different worlds are independent,
+// each one uses its own worker threads for the force calculation)
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORBITSIM_API_VERSION 1 // bumped whenever a declaration below changes
+
+typedef struct orbitsim_world orbitsim_world_t;
+
+// column buffers owned by the caller, element i of every column belongs to object i
+// any column may be NULL to skip it
+typedef struct {
+    double *x, *y, *z;
+    double *vx, *vy, *vz;
+} orbitsim_columns_t;
+
+typedef struct {
+    const double *x, *y, *z;
+    const double *vx, *vy, *vz;
+} orbitsim_const_columns_t;
+
+// called for every error the physics reports (collisions, allocation failures, bad scenario files)
+typedef void (*orbitsim_error_fn)(const char* title, const char* message, void* user);
+
+int orbitsim_apiVersion(void);
+
+// process wide, set it before creating worlds (NULL prints to stderr, the default)
+void orbitsim_setErrorHandler(orbitsim_error_fn handler, void* user);
+
+orbitsim_world_t* orbitsim_create(void);
+void orbitsim_destroy(orbitsim_world_t* world);
+
+// loads a scenario file in the simulation_data.json format, returns false if it added no bodies
+bool orbitsim_loadScenario(orbitsim_world_t* world, const char* path);
+
+// runs any console command (e.g. "solver fmm", "threads 8", "step method hermite", "reset"),
+// its log line is written to log if log is not NULL. "at <sim time> <command>" schedules a command,
+// which then runs inside orbitsim_step once the sim reaches that time
+void orbitsim_command(orbitsim_world_t* world, const char* command, char* log, size_t log_size);
+
+// bulk adds, each returns the number added (less than count only when out of memory)
+// names may be NULL (bodies are then called body_<index>), radius may be NULL for point masses
+// a column that is NULL in state counts as zeros
+int orbitsim_addBodies(orbitsim_world_t* world, int count, const char* const* names, const double* mass,
+                       const double* radius, orbitsim_const_columns_t state);
+int orbitsim_addCraft(orbitsim_world_t* world, int count, const char* const* names, const double* mass,
+                      orbitsim_const_columns_t state); // coasting craft (no engine, no burns)
+int orbitsim_addParticles(orbitsim_world_t* world, int count, orbitsim_const_columns_t state); // massless test particles
+
+void orbitsim_setTimeStep(orbitsim_world_t* world, double time_step);
+double orbitsim_timeStep(const orbitsim_world_t* world);
+double orbitsim_time(const orbitsim_world_t* world);
+
+// takes up to steps steps and returns how many it took
+// fewer means a scheduled "pause" ran, or the physics stopped (collision, out of memory): then it takes no
+// further steps until "reset"
+int orbitsim_step(orbitsim_world_t* world, int steps);
+bool orbitsim_isStopped(const orbitsim_world_t* world);
+
+int orbitsim_bodyCount(const orbitsim_world_t* world);
+int orbitsim_craftCount(const orbitsim_world_t* world);
+int orbitsim_particleCount(const orbitsim_world_t* world); // particles that hit a body are removed (indices shift)
+
+// copy objects [first, first + count) straight from the world into the caller's columns,
+// returns the number copied (clipped to the objects that exist)
+int orbitsim_getBodies(const orbitsim_world_t* world, int first, int count, orbitsim_columns_t out);
+int orbitsim_getCraft(const orbitsim_world_t* world, int first, int count, orbitsim_columns_t out);
+int orbitsim_getParticles(const orbitsim_world_t* world, int first, int count, orbitsim_columns_t out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
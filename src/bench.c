@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <string.h>
+#include "utility/benchmark.h"
+#include "types.h"
+
+// runs the console benchmarks without a window or a scenario: tables go to stdout, the summary line last
+
+static void printUsage(const char* program) {
+    printf("usage: %s [solvers | threads | simd | swarm]...\n"
+           "  solvers    time every gravity solver on synthetic clusters (default)\n"
+           "  threads    time the force calculation with 1, 2, 4, ... threads up to the core count\n"
+           "  simd       check every supported force kernel against the scalar reference and time it\n"
+           "  swarm      check every supported swarm kernel against the scalar reference and time a swarm step\n",
+           program);
+}
+
+int main(int argc, char *argv[]) {
+    char summary[COMMAND_TEXT_LENGTH];
+    const char* fallback[] = {"solvers"};
+    const char** runs = argc > 1 ? (const char**)(argv + 1) : fallback;
+    const int run_count = argc > 1 ? argc - 1 : 1;
+
+    for (int i = 0; i < run_count; i++) {
+        summary[0] = '\0';
+        if (strcmp(runs[i], "solvers") == 0) benchmarkGravitySolvers(summary, sizeof(summary));
+        else if (strcmp(runs[i], "threads") == 0) benchmarkThreadScaling(summary, sizeof(summary));
+        else if (strcmp(runs[i], "simd") == 0) benchmarkSimdKernels(summary, sizeof(summary));
+        else if (strcmp(runs[i], "swarm") == 0) benchmarkSwarmKernels(summary, sizeof(summary));
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+        printf("%s\n", summary);
+    }
+    return 0;
+}
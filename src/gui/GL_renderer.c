@@ -8,6 +8,10 @@
 #include <math.h>
 #include "../globals.h"
 #include "../math/matrix.h"
+#include "../sim/gravity.h"
+#include "../sim/gravity_simd.h"
+#include "../sim/integrator.h"
+#include "../utility/telemetry_replay.h"
 
 char* loadShaderSource(const char* filepath) {
     FILE* file = fopen(filepath, "rb");
@@ -620,13 +624,33 @@ void renderStats(const sim_properties_t sim, font_t* font) {
     char text_buffer[64];
 
     // paused indication
-    if (sim.wp.sim_running) snprintf(text_buffer, sizeof(text_buffer), "Sim running");
+    if (sim.replay != NULL) snprintf(text_buffer, sizeof(text_buffer), "Replay %s (%.4g s/s)", sim.wp.sim_running ? "playing" : "paused", sim.replay->speed);
+    else if (sim.wp.sim_running) snprintf(text_buffer, sizeof(text_buffer), "Sim running");
     else snprintf(text_buffer, sizeof(text_buffer), "Sim paused");
     addText(font, cursor_pos[0], cursor_pos[1], text_buffer, 0.8f);
     cursor_pos[1] += line_height;
 
     // write time step
-    snprintf(text_buffer, sizeof(text_buffer), "Step: %.4g", sim.wp.time_step);
+    if (sim.wp.integrator == INTEGRATOR_HERMITE && sim.hermite.block_count > 0 && sim.hermite.count > 0) {
+        snprintf(text_buffer, sizeof(text_buffer), "Step: %.4g (%s, %.2f evals/body)", sim.wp.time_step, integrator_name(sim.wp.integrator),
+            (double)sim.hermite.force_evaluations / ((double)sim.hermite.block_count * sim.hermite.count));
+    }
+    else snprintf(text_buffer, sizeof(text_buffer), "Step: %.4g (%s)", sim.wp.time_step, integrator_name(sim.wp.integrator));
+    addText(font, cursor_pos[0], cursor_pos[1], text_buffer, 0.8f);
+    cursor_pos[1] += line_height;
+
+    // measured physics speed
+    if (sim.wp.sim_running && sim.batch.steps_per_second > 0.0) {
+        if (sim.batch.realtime_factor > 0.0) snprintf(text_buffer, sizeof(text_buffer), "Steps/s: %.4g (paced %gx real time)", sim.batch.steps_per_second, sim.batch.realtime_factor);
+        else snprintf(text_buffer, sizeof(text_buffer), "Steps/s: %.4g (%d per batch)", sim.batch.steps_per_second, sim.batch.steps);
+        addText(font, cursor_pos[0], cursor_pos[1], text_buffer, 0.8f);
+        cursor_pos[1] += line_height;
+    }
+
+    // gravity solver
+    if (sim.gp.solver == GRAVITY_BARNES_HUT) snprintf(text_buffer, sizeof(text_buffer), "Solver: %s (theta %.2f)", gravity_solverName(sim.gp.solver), sim.gp.theta);
+    else if (sim.gp.solver == GRAVITY_FMM) snprintf(text_buffer, sizeof(text_buffer), "Solver: %s (order %d, theta %.2f)", gravity_solverName(sim.gp.solver), sim.gp.fmm_order, sim.gp.theta);
+    else snprintf(text_buffer, sizeof(text_buffer), "Solver: %s (%s)", gravity_solverName(sim.gp.solver), simd_levelName(sim.gp.simd_level));
     addText(font, cursor_pos[0], cursor_pos[1], text_buffer, 0.8f);
     cursor_pos[1] += line_height;
 
@@ -637,6 +661,13 @@ void renderStats(const sim_properties_t sim, font_t* font) {
     addText(font, cursor_pos[0], cursor_pos[1], text_buffer, 0.8f);
     cursor_pos[1] += line_height;
 
+    // test particles
+    if (sim.swarm.count > 0 || sim.swarm.removed > 0) {
+        snprintf(text_buffer, sizeof(text_buffer), "Swarm: %d particles (%lld removed)", sim.swarm.count, sim.swarm.removed);
+        addText(font, cursor_pos[0], cursor_pos[1], text_buffer, 0.8f);
+        cursor_pos[1] += line_height;
+    }
+
     // spacer
     cursor_pos[1] += line_height;
 
@@ -656,7 +687,7 @@ void renderStats(const sim_properties_t sim, font_t* font) {
         addText(font, cursor_pos[0], cursor_pos[1], text_buffer, 0.7f);
         cursor_pos[1] += line_height;
 
-        snprintf(text_buffer, sizeof(text_buffer), "In SOI of: %s", sim.gb.bodies[soi_id].name);
+        snprintf(text_buffer, sizeof(text_buffer), "In SOI of: %s%s", sim.gb.bodies[soi_id].name, sim.gs.spacecraft[i].on_rails ? " (on rails)" : "");
         addText(font, cursor_pos[0], cursor_pos[1], text_buffer, 0.7f);
         cursor_pos[1] += line_height;
 
@@ -683,6 +714,17 @@ void renderStats(const sim_properties_t sim, font_t* font) {
     }
 }
 
+// draws the swarm particles copied into the snapshot as short dashes
+void renderSwarm(const render_snapshot_t* snapshot, line_batch_t* line_batch) {
+    const float half_length = 0.002f;
+    for (int k = 0; k < snapshot->swarm_drawn; k++) {
+        const float x = snapshot->swarm_pos[3 * k + 0];
+        const float y = snapshot->swarm_pos[3 * k + 1];
+        const float z = snapshot->swarm_pos[3 * k + 2];
+        addLine(line_batch, x - half_length, y, z, x + half_length, y, z, 0.6f, 0.8f, 1.0f);
+    }
+}
+
 void renderPlanetPaths(sim_properties_t* sim, line_batch_t* line_batch, object_path_storage_t* planet_paths) {
     // initialize or resize planet paths if needed
     if (sim->gb.count > 0 && planet_paths->num_objects != sim->gb.count) {
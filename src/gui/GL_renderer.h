@@ -11,7 +11,7 @@
 #else
 #include <GL/gl.h>
 #endif
-#include "../types.h"
+#include "gui_types.h"
 
 char* loadShaderSource(const char* filepath);
 GLuint createShaderProgram(const char* vertexPath, const char* fragmentPath);
@@ -45,6 +45,7 @@ void renderCoordinatePlane(sim_properties_t sim, line_batch_t* line_batch);
 void renderPlanets(sim_properties_t sim, GLuint shader_program, VBO_t planet_shape_buffer);
 void renderCrafts(sim_properties_t sim, GLuint shader_program, VBO_t craft_shape_buffer);
 void renderStats(sim_properties_t sim, font_t* font);
+void renderSwarm(const render_snapshot_t* snapshot, line_batch_t* line_batch);
 void renderVisuals(sim_properties_t sim, line_batch_t* line_batch, object_path_storage_t* planet_paths, object_path_storage_t* craft_paths);
 
 #endif //ORBITSIMULATION_GL_RENDERER_H
\ No newline at end of file
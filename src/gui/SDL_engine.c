@@ -6,7 +6,9 @@
 #include <SDL3/SDL.h>
 #include <GL/glew.h>
 
-#include "../utility/json_loader.h"
+#include "../utility/command_queue.h"
+#include "../utility/commands.h"
+#include "../utility/telemetry_replay.h"
 #ifdef __APPLE__
 #include <OpenGL/gl.h>
 #else
@@ -15,8 +17,9 @@
 #include "../math/matrix.h"
 #include <string.h>
 
-// display error message using SDL dialog
-void displayError(const char* title, const char* message) {
+// display error message using SDL dialog (registered as the error handler of the sim code)
+void showErrorBox(const char* title, const char* message, void* user) {
+    (void)user;
     SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, title, message, NULL);
 }
 // initialize the window parameters
@@ -30,6 +33,7 @@ window_params_t init_window_params(void) {
     // sets the default window size scaled based on the user's screen size
     wp.window_size_x = (float)mode->w * (2.0f/3.0f);
     wp.window_size_y = (float)mode->h * (2.0f/3.0f);
+    wp.refresh_rate = mode->refresh_rate > 0.0f ? mode->refresh_rate : 60.0f;
 
     // initialize 3D camera
     wp.camera_pos.x = 2.0f; wp.camera_pos.y = 2.0f; wp.camera_pos.z = 3.0f;
@@ -39,7 +43,6 @@ window_params_t init_window_params(void) {
 
     wp.window_open = true;
     wp.sim_running = false;  // start paused until setup is complete
-    wp.data_logging_enabled = false;
     wp.sim_time = 0;
 
     wp.is_dragging = false;
@@ -190,55 +193,78 @@ static void handleMouseWheelEvent(const SDL_Event* event, sim_properties_t* sim)
     }
 }
 
-static void parseRunCommands(char* cmd, sim_properties_t* sim) {
+// replay commands (the replay belongs to the render thread, the physics thread never sees them)
+static void parseReplayCommand(const char* argument, sim_properties_t* sim) {
     console_t* console = &sim->console;
+    telemetry_replay_t* replay = sim->replay;
 
-    if (strncmp(cmd, "step ", 4) == 0) {
-        char* argument = cmd + 4;
-        sim->wp.time_step = strtod(argument, &argument);
-
-        sprintf(console->log, "step set to %f", sim->wp.time_step);
+    if (strcmp(argument, "off") == 0) {
+        telemetry_closeReplay(replay);
+        sim->replay = NULL;
+        sprintf(console->log, "replay closed, \"resume\" continues the live sim");
     }
-    else if (strcmp(cmd, "pause") == 0 || strcmp(cmd, "p") == 0) {
-        sim->wp.sim_running = false;
-        sprintf(console->log, "sim paused");
+    else if (replay == NULL && (strcmp(argument, "play") == 0 || strcmp(argument, "pause") == 0 ||
+                                strncmp(argument, "seek ", 5) == 0 || strncmp(argument, "speed ", 6) == 0)) {
+        sprintf(console->log, "no replay open, use \"replay <file>\"");
     }
-    else if (strcmp(cmd, "resume") == 0 || strcmp(cmd, "r") == 0) {
-        sim->wp.sim_running = true;
-        sprintf(console->log, "sim resumed");
+    else if (strcmp(argument, "play") == 0) {
+        // playing again from the end starts over
+        if (replay->time >= replay->t_last) telemetry_replaySeek(replay, replay->t_first);
+        replay->playing = true;
+        sprintf(console->log, "replay playing");
     }
-    else if (strcmp(cmd, "load") == 0) {
-        if (sim->gb.count == 0) {
-            sim->wp.sim_running = false; // pauses before loading
-            readSimulationJSON("simulation_data.json", &sim->gb, &sim->gs);
-            sprintf(console->log, "%d planets and %d craft loaded from json file", sim->gb.count, sim->gs.count);
-        }
-        else sprintf(console->log, "Warning: system already loaded, reset before loading another");
+    else if (strcmp(argument, "pause") == 0) {
+        replay->playing = false;
+        sprintf(console->log, "replay paused");
     }
-    else if (strcmp(cmd, "reset") == 0) {
-        sim->wp.reset_sim = true;
-        sprintf(console->log, "sim reset");
+    else if (strncmp(argument, "seek ", 5) == 0) {
+        telemetry_replaySeek(replay, strtod(argument + 5, NULL));
+        sprintf(console->log, "replay at t = %.6g s", replay->time);
     }
-    else if (strncmp(cmd, "enable ", 7) == 0) {
-        char* argument = cmd + 7;
-        if (strcmp(argument, "guidance-lines") == 0) {
-            sim->wp.draw_lines_between_bodies = true;
-            sprintf(console->log, "enabled guidance lines");
+    else if (strncmp(argument, "speed ", 6) == 0) {
+        const double speed = strtod(argument + 6, NULL);
+        if (speed > 0.0) {
+            replay->speed = speed;
+            sprintf(console->log, "replay speed %g sim seconds per second", speed);
         }
-        else sprintf(console->log, "unknown argument after command: %s", argument);
+        else sprintf(console->log, "replay speed must be positive");
     }
-    else if (strncmp(cmd, "disable ", 8) == 0) {
-        char* argument = cmd + 8;
-        if (strcmp(argument, "guidance-lines") == 0) {
-            sim->wp.draw_lines_between_bodies = false;
-            sprintf(console->log, "disabled guidance lines");
+    else {
+        telemetry_replay_t* opened = telemetry_openReplay(argument);
+        if (opened == NULL) {
+            sprintf(console->log, "could not replay %.200s", argument);
+            return;
         }
-        else sprintf(console->log, "unknown argument after disable: %s", argument);
+        telemetry_closeReplay(replay);
+        sim->replay = opened;
+        opened->playing = true;
+
+        // the live sim stops so no core is spent on it while the file plays
+        cmdq_push(&sim->commands, "pause", -1.0);
+        snprintf(console->log, sizeof(console->log), "replaying %s, t = %.6g .. %.6g s", argument, opened->t_first, opened->t_last);
+    }
+}
+
+// commands that only touch the render thread run right away, everything else is queued for the physics
+// thread, which applies it between two steps and sends its log line back (shown by runEventCheck)
+static void parseRunCommands(char* cmd, sim_properties_t* sim) {
+    console_t* console = &sim->console;
+
+    if (strcmp(cmd, "enable guidance-lines") == 0) {
+        sim->wp.draw_lines_between_bodies = true;
+        sprintf(console->log, "enabled guidance lines");
+    }
+    else if (strcmp(cmd, "disable guidance-lines") == 0) {
+        sim->wp.draw_lines_between_bodies = false;
+        sprintf(console->log, "disabled guidance lines");
+    }
+    else if (strncmp(cmd, "replay ", 7) == 0) {
+        parseReplayCommand(cmd + 7, sim);
     }
     else {
-        sprintf(console->log, "unknown command: %s", cmd);
+        // "at <sim time in s> <command>" is scheduled, anything else applied at the next step
+        command_enqueue(sim, cmd, console->log);
     }
-
 }
 
 // handles keyboard events
@@ -258,6 +284,18 @@ static void handleKeyboardEvent(const SDL_Event* event, sim_properties_t* sim) {
         console->cmd_text_box[0] = '\0';
         console->cmd_text_box_length = 0;
     }
+    // replay scrubbing: left/right jump by 1% of the file, up/down double or halve the speed
+    else if (sim->replay != NULL && (event->key.key == SDLK_LEFT || event->key.key == SDLK_RIGHT)) {
+        telemetry_replay_t* replay = sim->replay;
+        const double jump = 0.01 * (replay->t_last - replay->t_first);
+        telemetry_replaySeek(replay, replay->time + (event->key.key == SDLK_RIGHT ? jump : -jump));
+    }
+    else if (sim->replay != NULL && event->key.key == SDLK_UP) {
+        sim->replay->speed *= 2.0;
+    }
+    else if (sim->replay != NULL && event->key.key == SDLK_DOWN) {
+        sim->replay->speed *= 0.5;
+    }
 }
 
 // handles text input events
@@ -294,12 +332,16 @@ void runEventCheck(SDL_Event* event, sim_properties_t* sim) {
     wp->is_zooming_in = false;
     wp->is_zooming_out = false;
 
+    // log lines of the commands the physics thread applied since the last frame (the newest one stays)
+    sim_command_t reply;
+    while (cmdq_pop(&sim->replies, &reply)) {
+        snprintf(sim->console.log, sizeof(sim->console.log), "%s", reply.text);
+    }
+
     while (SDL_PollEvent(event)) {
         // check if x button is pressed to quit
         if (event->type == SDL_EVENT_QUIT) {
-            wp->reset_sim = true;
             wp->window_open = false;
-            wp->sim_running = false;
         }
         // check if mouse is moving to update hover state
         else if (event->type == SDL_EVENT_MOUSE_MOTION && event->window.windowID == wp->main_window_ID) {
@@ -0,0 +1,82 @@
+#ifndef GUI_TYPES_H
+#define GUI_TYPES_H
+
+#include "../types.h"
+#include <SDL3/SDL.h>
+#include <GL/glew.h>
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+static const SDL_Color TEXT_COLOR = {210, 210, 210, 255};
+static const SDL_Color BUTTON_COLOR = {30,30,30, 255};
+static const SDL_Color BUTTON_HOVER_COLOR = {20,20,20, 255};
+static const SDL_Color ACCENT_COLOR = {80, 150, 220, 255};
+
+typedef struct {
+    int frame_counter;
+    bool is_shown;
+    double initial_total_energy;
+    bool measured_initial_energy;
+    double previous_total_energy;
+
+    int cached_body_count;
+} stats_window_t;
+
+typedef struct {
+    float x, y, width, height;
+    bool is_hovered;
+    SDL_Color normal_color;
+    SDL_Color hover_color;
+} button_t;
+
+typedef struct {
+    button_t sc_button;
+    button_t csv_load_button;
+    button_t craft_view_button;
+    button_t show_stats_button;
+} button_storage_t;
+
+
+typedef struct {
+    SDL_Window* window;
+    SDL_GLContext glContext;
+} SDL_GL_init_t;
+
+typedef struct {
+    GLuint VAO;
+    GLuint VBO;
+} VBO_t;
+
+typedef struct {
+    VBO_t vbo;
+    float* vertices;
+    size_t capacity;  // max number of lines
+    size_t count;     // current number of lines
+} line_batch_t;
+
+typedef struct {
+    float* vertices;
+    size_t vertex_count;
+    size_t data_size;
+} sphere_mesh_t;
+
+// text rendering
+typedef struct {
+    GLuint tex, shader, vao, vbo;
+    float* verts;
+    int count;
+} font_t;
+
+// planet path tracking
+typedef struct {
+    vec3* positions;
+    int* counts;
+    int capacity;
+    int num_objects;
+} object_path_storage_t;
+
+#endif
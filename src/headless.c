@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "globals.h"
+#include "types.h"
+#include "sim/simulation.h"
+#include "sim/gravity.h"
+#include "sim/gravity_simd.h"
+#include "sim/integrator.h"
+#include "sim/craft_propagator.h"
+#include "sim/hermite.h"
+#include "utility/json_loader.h"
+#include "utility/checkpoint.h"
+#include "utility/autosave.h"
+#include "utility/telemetry_export.h"
+#include "utility/commands.h"
+#include "utility/command_queue.h"
+#include "utility/thread_pool.h"
+
+// batch runner without a window: loads a scenario, runs it to an end time as fast as the cpu allows
+// and writes the same telemetry file as the GUI (through the same writer thread)
+
+#define HEADLESS_MAX_COMMANDS 64
+#define HEADLESS_DEFAULT_RECORDS 1000 // telemetry records over the run unless --every is given
+
+static double headless_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// prints the log lines of the commands applied since the last call
+static void printReplies(sim_properties_t* sim) {
+    sim_command_t reply;
+    while (cmdq_pop(&sim->replies, &reply)) {
+        printf("t = %.6g s: %s\n", reply.time, reply.text);
+    }
+}
+
+static void printUsage(const char* program) {
+    printf("usage: %s [scenario.json | checkpoint] --end <sim seconds> [options]\n"
+           "  --end <seconds>        sim time to run to (required)\n"
+           "  --telemetry <file>     telemetry output (default " TELEMETRY_DEFAULT_FILENAME ", \"none\" to disable)\n"
+           "  --every <seconds>      sim time between telemetry records (default end / %d, or what\n"
+           "                         a \"telemetry every\" or \"telemetry steps\" command sets)\n"
+           "  --command \"<command>\"  console command applied after loading, may be repeated\n"
+           "                         (e.g. --command \"solver fmm\" --command \"step 60\" --command \"at 86400 save day1.bin\")\n"
+           "  --resume [prefix]      continue from the newest automatic checkpoint instead of the scenario\n"
+           "                         (prefix of the autosave files, default " AUTOSAVE_DEFAULT_PREFIX ")\n",
+           program, HEADLESS_DEFAULT_RECORDS);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// MAIN :)
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[]) {
+    ////////////////////////////////////////
+    // ARGUMENTS                          //
+    ////////////////////////////////////////
+    const char* scenario = SIMULATION_FILENAME;
+    const char* telemetry = TELEMETRY_DEFAULT_FILENAME;
+    const char* commands[HEADLESS_MAX_COMMANDS];
+    int command_count = 0;
+    double end_time = -1.0;
+    double every = 0.0;
+    const char* resume = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--end") == 0 && has_value) end_time = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "--telemetry") == 0 && has_value) telemetry = argv[++i];
+        else if (strcmp(argv[i], "--every") == 0 && has_value) every = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "--command") == 0 && has_value && command_count < HEADLESS_MAX_COMMANDS) commands[command_count++] = argv[++i];
+        else if (strcmp(argv[i], "--resume") == 0) resume = has_value && argv[i + 1][0] != '-' ? argv[++i] : AUTOSAVE_DEFAULT_PREFIX;
+        else if (argv[i][0] != '-') scenario = argv[i];
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (end_time <= 0.0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ////////////////////////////////////////
+    // INIT                               //
+    ////////////////////////////////////////
+    sim_properties_t sim = {
+        .gb = {0},
+        .gs = {0},
+        .wp = {0}
+    };
+    sim.gp = gravity_defaultParams();
+    sim.cp = craft_defaultPropagation();
+    sim.hermite = hermite_defaultState();
+    sim.telemetry = telemetry_defaultParams();
+    sim.autosave = autosave_defaultParams();
+    sim.telemetry.policy = TELEMETRY_BLOCK; // a batch run should not lose records, "telemetry policy" can still change it
+    sim.batch = (physics_batch_t){.fixed_steps = 0, .steps = 1};
+    sim.wp.time_step = 0.01;
+
+    // a checkpoint written by "save" or autosave starts exactly where it was taken (its settings included)
+    char checkpoint[COMMAND_TEXT_LENGTH + 32];
+    if (resume != NULL) {
+        snprintf(sim.autosave.prefix, sizeof(sim.autosave.prefix), "%s", resume); // keeps numbering the same files
+        if (!autosave_latest(resume, checkpoint, sizeof(checkpoint))) {
+            fprintf(stderr, "no checkpoint to resume from (%s.latest not found)\n", resume);
+            cleanup(&sim);
+            return 1;
+        }
+        scenario = checkpoint;
+    }
+    if (checkpoint_isFile(scenario)) checkpoint_restore(&sim, scenario);
+    else readSimulationJSON(scenario, &sim);
+    if (sim.gb.count == 0) {
+        fprintf(stderr, "no bodies loaded from %s\n", scenario);
+        cleanup(&sim);
+        return 1;
+    }
+
+    // the cadence is set before the commands, so "telemetry every" and "telemetry steps" can still change it
+    const bool every_given = every > 0.0;
+    if (!every_given) every = end_time / HEADLESS_DEFAULT_RECORDS;
+    sim.telemetry.interval = every;
+    sim.telemetry.every_steps = 0;
+
+    // same queue as the console, so every console setting works here too and "at <t> <command>" runs
+    // between the steps once the sim reaches t
+    for (int i = 0; i < command_count; i++) {
+        char log[COMMAND_TEXT_LENGTH] = "";
+        if (!command_enqueue(&sim, commands[i], log)) printf("%s: %s\n", commands[i], log);
+    }
+    command_processQueue(&sim);
+    printReplies(&sim);
+    if (sim.wp.time_step <= 0.0) {
+        fprintf(stderr, "time step must be positive\n");
+        cleanup(&sim);
+        return 1;
+    }
+
+    if (every_given && (sim.telemetry.interval != every || sim.telemetry.every_steps != 0)) {
+        fprintf(stderr, "--every and a \"telemetry every/steps\" command both set the telemetry cadence, use one of them\n");
+        cleanup(&sim);
+        return 1;
+    }
+    if (strcmp(telemetry, "none") != 0 && !telemetry_start(&sim, telemetry)) {
+        cleanup(&sim);
+        return 1;
+    }
+
+    printf("%s: %d bodies, %d craft, %d test particles, %s integrator, %s solver, step %g s, running to t = %g s\n",
+        scenario, sim.gb.count, sim.gs.count, sim.swarm.count, integrator_name(sim.wp.integrator),
+        gravity_solverName(sim.gp.solver), sim.wp.time_step, end_time);
+
+    ////////////////////////////////////////
+    // RUN                                //
+    ////////////////////////////////////////
+    sim.wp.sim_running = true;
+    const double start = headless_now();
+    double last_report = start;
+    long long steps = 0;
+    const long long evaluations_before = sim.gp.force_evaluations;
+    const long long pairs_before = sim.gp.direct_pairs;
+    const long long craft_evaluations_before = sim.cp.force_evaluations;
+
+    // telemetry samples are taken inside runCalculations and written by the writer thread
+    while (sim.wp.sim_time < end_time && !sim.wp.reset_sim) {
+        command_processQueue(&sim);
+        printReplies(&sim);
+        if (!sim.wp.sim_running || sim.wp.reset_sim || sim.wp.time_step <= 0.0) break;
+
+        // the last step is shortened to end exactly on the end time, a step that would pass the time of a
+        // scheduled command to end exactly on it
+        const double step = sim.wp.time_step;
+        const double until_command = command_nextTime(&sim) - sim.wp.sim_time;
+        sim.wp.time_step = fmin(step, end_time - sim.wp.sim_time);
+        if (until_command > 0.0 && until_command < sim.wp.time_step) sim.wp.time_step = until_command;
+        runCalculations(&sim);
+        sim.wp.time_step = step;
+        steps++;
+
+        if ((steps & 63) == 0) {
+            const double now = headless_now();
+            if (now - last_report >= 1.0) {
+                last_report = now;
+                printf("t = %.6g s (%.1f%%), %.4g steps/s\n", sim.wp.sim_time, 100.0 * sim.wp.sim_time / end_time,
+                    (double)steps / (now - start));
+                fflush(stdout);
+            }
+        }
+    }
+    const double elapsed = headless_now() - start;
+
+    // commands scheduled for the end time itself still run
+    if (!sim.wp.reset_sim && sim.wp.sim_time >= end_time) {
+        command_processQueue(&sim);
+        printReplies(&sim);
+    }
+
+    // the final state is always recorded, even when the end time is off the cadence
+    telemetry_params_t* tp = &sim.telemetry;
+    if (tp->writer != NULL && !sim.wp.reset_sim && tp->last_time < sim.wp.sim_time) {
+        telemetry_sampleNow(&sim);
+    }
+
+    ////////////////////////////////////////
+    // STATS                              //
+    ////////////////////////////////////////
+    const int threads = sim.pool != NULL ? sim.pool->thread_count : 1;
+    printf("%lld steps in %.3f s: %.4g steps/s, %.4g sim seconds per second (%d threads, %s kernel)\n",
+        steps, elapsed, (double)steps / elapsed, sim.wp.sim_time / elapsed, threads, simd_levelName(sim.gp.simd_level));
+
+    // pairs are only counted where they were summed exactly, the tree solvers report evaluations alone
+    const long long evaluations = sim.gp.force_evaluations - evaluations_before;
+    const long long pairs = sim.gp.direct_pairs - pairs_before;
+    if (pairs > 0) {
+        printf("forces: %lld body force evaluations, %.4g exact body pairs/s\n", evaluations, (double)pairs / elapsed);
+    }
+    else if (evaluations > 0) {
+        printf("forces: %lld body force evaluations, %.4g per second\n", evaluations, (double)evaluations / elapsed);
+    }
+    if (sim.wp.integrator == INTEGRATOR_HERMITE && sim.hermite.block_count > 0 && sim.hermite.count > 0) {
+        printf("hermite: %.2f force evaluations per body per step\n",
+            (double)sim.hermite.force_evaluations / ((double)sim.hermite.block_count * sim.hermite.count));
+    }
+    if (sim.cp.force_evaluations > craft_evaluations_before) {
+        printf("craft: %lld force evaluations (%s)\n", sim.cp.force_evaluations - craft_evaluations_before,
+            sim.cp.adaptive ? "adaptive" : "fixed step");
+    }
+    if (sim.swarm.count > 0 || sim.swarm.removed > 0) {
+        printf("swarm: %d test particles left, %lld removed\n", sim.swarm.count, sim.swarm.removed);
+    }
+
+    if (tp->writer != NULL) {
+        printf("telemetry: %lld samples to %s, %lld dropped, %lld decimated, waited for the disk %lld times (%s policy)\n",
+            tp->samples, telemetry, tp->dropped, tp->decimated, tp->blocked, telemetry_policyName(tp->policy));
+    }
+
+    const bool stopped_early = sim.wp.reset_sim || sim.wp.sim_time < end_time; // collision, or paused by a command
+    if (stopped_early) {
+        fprintf(stderr, "sim stopped at t = %.6g s before reaching the end time\n", sim.wp.sim_time);
+    }
+
+    ////////////////////////////////////////
+    // CLEAN UP                           //
+    ////////////////////////////////////////
+    cleanup(&sim); // also drains the telemetry ring and closes the file
+    return stopped_early ? 1 : 0;
+}
@@ -4,11 +4,20 @@
 #include "globals.h"
 #include "types.h"
 #include "sim/simulation.h"
+#include "sim/gravity.h"
+#include "sim/craft_propagator.h"
+#include "sim/hermite.h"
 #include "gui/SDL_engine.h"
 #include "gui/GL_renderer.h"
 #include "gui/models.h"
 #include "utility/telemetry_export.h"
+#include "utility/telemetry_replay.h"
+#include "utility/autosave.h"
 #include "utility/sim_thread.h"
+#include "utility/snapshot.h"
+#include "utility/command_queue.h"
+#include "utility/commands.h"
+#include "utility/error_hook.h"
 
 #ifdef _WIN32
     #include <windows.h>
@@ -34,6 +43,8 @@
 
 // Global mutex definition
 mutex_t sim_mutex;
+cond_t physics_wake;       // signaled (under sim_mutex) when the physics thread has something new to do
+volatile int physics_idle; // set while the physics thread sleeps (paused or ahead of the pace)
 // this is purposely made a global var in this file
 // as it is expected that mutex locks should not be
 // hidden within other files
@@ -50,16 +61,43 @@ void* physicsSim(void* args) {
 #endif
     sim_properties_t* sim = (sim_properties_t*)args;
     while (sim->wp.window_open) {
-        while (sim->wp.sim_running) {
-            // lock mutex before accessing data
-            mutex_lock(&sim_mutex);
+        // lock mutex before accessing data
+        mutex_lock(&sim_mutex);
 
-            // DOES ALL BODY AND CRAFT CALCULATIONS:
-            runCalculations(sim);
+        // console commands only ever change the sim here, between two steps
+        command_processQueue(sim);
 
-            // unlock mutex when done :)
-            mutex_unlock(&sim_mutex);
+        // paced runs wait out the time they are ahead of the wall clock
+        const double delay = sim->wp.sim_running ? calculatePacingDelay(sim) : 0.0;
+        if (sim->wp.sim_running && delay <= 0.0 && !sim->wp.reset_sim) {
+            // DOES ALL BODY AND CRAFT CALCULATIONS (as many steps as fit half a display frame):
+            runCalculationsBatch(sim);
+        }
+
+        // resets requested by a command or by the sim itself (collisions, out of memory) happen on this thread too
+        if (sim->wp.reset_sim) {
+            resetSim(sim);
         }
+
+        // hand the renderer a copy of the new state (it never waits on this mutex)
+        craft_publishAdaptive(sim);
+        snapshot_publish(&sim->snapshots, sim);
+
+        // sleep while paused or ahead of the pace instead of spinning (the main thread wakes us when a command
+        // is queued or the window closes, and a command queued just before physics_idle was set is caught on
+        // its next frame)
+        if ((!sim->wp.sim_running || delay > 0.0) && sim->wp.window_open) {
+            atomic_storeInt(&physics_idle, 1);
+            if (cmdq_isEmpty(&sim->commands)) {
+                if (sim->wp.sim_running) cond_timedwait(&physics_wake, &sim_mutex, delay);
+                else cond_wait(&physics_wake, &sim_mutex);
+            }
+            atomic_storeInt(&physics_idle, 0);
+            if (!sim->wp.sim_running) sim->batch.last_batch_end = 0.0; // the pause does not count against the measured steps/s
+        }
+
+        // unlock mutex when done :)
+        mutex_unlock(&sim_mutex);
     }
 #ifdef _WIN32
     return 0;
@@ -84,11 +122,6 @@ int main(int argc, char *argv[]) {
         .wp = {0}
     };
 
-    // binary file creation
-    binary_filenames_t filenames = {
-        .global_data_FILE = fopen("global_data.bin", "wb")
-    };
-
 #ifdef __linux__
     // force X11 on Linux (fixes SDL text input issues on wayland)
     SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "x11");
@@ -97,8 +130,18 @@ int main(int argc, char *argv[]) {
     // initialize SDL
     SDL_Init(SDL_INIT_VIDEO);
 
+    // errors from the sim code are shown as message boxes
+    error_setHandler(showErrorBox, NULL);
+
     // window parameters & command prompt init
     sim.wp = init_window_params();
+    sim.gp = gravity_defaultParams();
+    sim.cp = craft_defaultPropagation();
+    sim.hermite = hermite_defaultState();
+    sim.telemetry = telemetry_defaultParams();
+    sim.autosave = autosave_defaultParams();
+    sim.batch = (physics_batch_t){.fixed_steps = 0, .steps = 1};
+    snapshot_init(&sim.snapshots);
     sim.console = init_console(sim.wp);
 
     // SDL and OpenGL window
@@ -137,7 +180,7 @@ int main(int argc, char *argv[]) {
     sim.wp.planet_model_vertex_count = (int)sphere_mesh.vertex_count; // I couldn't think of a better way to do this ngl
 
     // create batch to hold all the line geometries we would ever want to draw!
-    line_batch_t line_batch = createLineBatch(PATH_CAPACITY * MAX_PLANETS + 100);
+    line_batch_t line_batch = createLineBatch(PATH_CAPACITY * MAX_PLANETS + SWARM_MAX_DRAWN + 100);
 
     // planet path tracking
     object_path_storage_t planet_paths = {0};
@@ -155,6 +198,10 @@ int main(int argc, char *argv[]) {
     ////////////////////////////////////////
     // Initialize mutex
     mutex_init(&sim_mutex);
+    cond_init(&physics_wake);
+
+    // default time step (set before the physics thread starts, only it changes the step afterwards)
+    sim.wp.time_step = 0.01;
 
 #ifdef _WIN32
     HANDLE sim_thread = CreateThread(NULL, 0, physicsSim, &sim, 0, NULL);
@@ -166,25 +213,37 @@ int main(int argc, char *argv[]) {
     ////////////////////////////////////////////////////////
     // simulation loop                                    //
     ////////////////////////////////////////////////////////
-    // default time step
-    sim.wp.time_step = 0.01;
-
+    int last_reset_count = 0;
+    int last_replay_jumps = -1; // -1 while no replay is open
+    Uint64 last_frame = SDL_GetTicksNS();
     while (sim.wp.window_open) {
         // clears previous frame from the screen
         glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // user input event checking logic (modifies UI state, no lock needed)
+        // user input event checking logic (modifies UI state and queues commands, no lock needed)
         SDL_Event event;
         runEventCheck(&event, &sim);
 
-        // lock mutex and quickly snapshot simulation data for rendering
-        mutex_lock(&sim_mutex);
+        // wake the physics thread when it sleeps with commands waiting (checked every frame, so a command
+        // that races the thread going to sleep is caught on the next one)
+        if (!cmdq_isEmpty(&sim.commands) && atomic_loadInt(&physics_idle)) {
+            mutex_lock(&sim_mutex);
+            cond_broadcast(&physics_wake);
+            mutex_unlock(&sim_mutex);
+        }
 
-        // make a quick copy for rendering
-        sim_properties_t sim_copy = sim;
+        // newest state the physics thread published (lock free, never torn)
+        const render_snapshot_t* snapshot = snapshot_acquire(&sim.snapshots);
+        sim_properties_t sim_copy = snapshot_view(snapshot, &sim);
 
-        mutex_unlock(&sim_mutex);
+        // replay mode: bodies and craft come from the telemetry file at the replay clock instead
+        const Uint64 frame_start = SDL_GetTicksNS();
+        if (sim.replay != NULL) {
+            telemetry_replayAdvance(sim.replay, (double)(frame_start - last_frame) * 1e-9);
+            if (telemetry_replayView(sim.replay, &sim_copy)) sim_copy.replay = sim.replay;
+        }
+        last_frame = frame_start;
 
         ////////////////////////////////////////////////////////
         // OPENGL RENDERER
@@ -213,6 +272,9 @@ int main(int argc, char *argv[]) {
         // renders visuals things if they are enabled
         renderVisuals(sim_copy, &line_batch, &planet_paths, &craft_paths);
 
+        // draw test particles (not recorded in telemetry)
+        if (sim_copy.replay == NULL) renderSwarm(snapshot, &line_batch);
+
         // command window display
         renderCMDWindow(&sim_copy, &font);
 
@@ -225,22 +287,11 @@ int main(int argc, char *argv[]) {
         // END OPENGL RENDERER
         ////////////////////////////////////////////////////////
 
-        // log data
-        if (sim.wp.data_logging_enabled) {
-            mutex_lock(&sim_mutex);
-
-            exportTelemetryBinary(filenames, &sim);
-
-            mutex_unlock(&sim_mutex);
-        }
-
-        // check if sim needs to be reset
-        if (sim.wp.reset_sim) {
-            mutex_lock(&sim_mutex);
-
-            resetSim(&sim);
-
-            mutex_unlock(&sim_mutex);
+        // the physics thread reset the sim, or the replay started, stopped or jumped since the last frame
+        const int replay_jumps = sim.replay != NULL ? sim.replay->jumps : -1;
+        if (snapshot->reset_count != last_reset_count || replay_jumps != last_replay_jumps) {
+            last_reset_count = snapshot->reset_count;
+            last_replay_jumps = replay_jumps;
 
             // reset paths
             for (int i = 0; i < planet_paths.num_objects; i++) {
@@ -269,7 +320,10 @@ int main(int argc, char *argv[]) {
     // CLEAN UP                                       //
     ////////////////////////////////////////////////////
 
-    // wait for simulation thread
+    // wait for simulation thread (wake it first in case it is sleeping)
+    mutex_lock(&sim_mutex);
+    cond_broadcast(&physics_wake);
+    mutex_unlock(&sim_mutex);
 #ifdef _WIN32
     WaitForSingleObject(sim_thread, INFINITE);
     CloseHandle(sim_thread);
@@ -279,9 +333,12 @@ int main(int argc, char *argv[]) {
 
     // destroy mutex (cross-platform)
     mutex_destroy(&sim_mutex);
+    cond_destroy(&physics_wake);
 
     // cleanup all allocated sim memory
+    telemetry_closeReplay(sim.replay);
     cleanup(&sim);
+    snapshot_free(&sim.snapshots);
 
     // cleanup planet paths
     free(planet_paths.positions);
@@ -295,7 +352,6 @@ int main(int argc, char *argv[]) {
     freeFont(&font);
     glDeleteProgram(shaderProgram);
 
-    fclose(filenames.global_data_FILE);
     SDL_GL_DestroyContext(glctx);
     SDL_DestroyWindow(window);
     SDL_Quit();
@@ -0,0 +1,235 @@
+#include "barnes_hut.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BH_LEAF_SIZE 8   // max bodies in a leaf cell
+#define BH_MAX_DEPTH 48  // stops subdividing coincident bodies forever
+
+// returns the index of a new empty cell (grows the node pool if needed)
+static int bh_newNode(bh_tree_t* tree) {
+    if (tree->node_count >= tree->node_capacity) {
+        const int new_capacity = tree->node_capacity == 0 ? 64 : tree->node_capacity * 2;
+        bh_node_t* temp = (bh_node_t*)realloc(tree->nodes, new_capacity * sizeof(bh_node_t));
+        if (temp == NULL) {
+            return -1;
+        }
+        tree->nodes = temp;
+        tree->node_capacity = new_capacity;
+    }
+
+    bh_node_t* node = &tree->nodes[tree->node_count];
+    memset(node, 0, sizeof(*node));
+    for (int c = 0; c < 8; c++) {
+        node->child[c] = -1;
+    }
+    return tree->node_count++;
+}
+
+// octant of body b relative to a cell center (bit 0 = +x, bit 1 = +y, bit 2 = +z)
+static inline int bh_octant(const body_soa_t* soa, const int b, const double cx, const double cy, const double cz) {
+    return (soa->pos_x[b] >= cx ? 1 : 0) | (soa->pos_y[b] >= cy ? 2 : 0) | (soa->pos_z[b] >= cz ? 4 : 0);
+}
+
+// fills in the mass, center of mass and opening radius of a cell, then subdivides it
+// (the node pool can be reallocated while recursing, so cells are always accessed by index)
+static void bh_buildNode(bh_tree_t* tree, const body_soa_t* soa, const int node_idx, const double theta, const int depth) {
+    bh_node_t* node = &tree->nodes[node_idx];
+    const int begin = node->begin;
+    const int end = node->end;
+
+    // mass and center of mass of everything inside the cell
+    double mu = 0.0, mx = 0.0, my = 0.0, mz = 0.0;
+    for (int k = begin; k < end; k++) {
+        const int b = tree->index[k];
+        mu += soa->mu[b];
+        mx += soa->mu[b] * soa->pos_x[b];
+        my += soa->mu[b] * soa->pos_y[b];
+        mz += soa->mu[b] * soa->pos_z[b];
+    }
+    node->mu = mu;
+    if (mu > 0.0) {
+        node->com_x = mx / mu;
+        node->com_y = my / mu;
+        node->com_z = mz / mu;
+    } else {
+        node->com_x = node->center_x;
+        node->com_y = node->center_y;
+        node->com_z = node->center_z;
+    }
+
+    // opening criterion with the center of mass offset correction (Barnes 1994):
+    // the cell may be used as a point mass when d > size / theta + |com - center|
+    const double ox = node->com_x - node->center_x;
+    const double oy = node->com_y - node->center_y;
+    const double oz = node->com_z - node->center_z;
+    const double open_radius = 2.0 * node->half_size / theta + sqrt(ox * ox + oy * oy + oz * oz);
+    node->open_radius_sq = open_radius * open_radius;
+
+    if (end - begin <= BH_LEAF_SIZE || depth >= BH_MAX_DEPTH) {
+        node->is_leaf = true;
+        return;
+    }
+    node->is_leaf = false;
+
+    // sort the bodies of this cell into its 8 octants (counting sort through the scratch buffer)
+    const double cx = node->center_x, cy = node->center_y, cz = node->center_z;
+    int octant_count[8] = {0};
+    for (int k = begin; k < end; k++) {
+        const int b = tree->index[k];
+        octant_count[bh_octant(soa, b, cx, cy, cz)]++;
+    }
+    int octant_start[8];
+    int fill[8];
+    int offset = begin;
+    for (int c = 0; c < 8; c++) {
+        octant_start[c] = offset;
+        fill[c] = offset;
+        offset += octant_count[c];
+    }
+    for (int k = begin; k < end; k++) {
+        const int b = tree->index[k];
+        tree->scratch[fill[bh_octant(soa, b, cx, cy, cz)]++] = b;
+    }
+    memcpy(&tree->index[begin], &tree->scratch[begin], (end - begin) * sizeof(int));
+
+    // create and build the non-empty children
+    const double child_half = 0.5 * node->half_size;
+    for (int c = 0; c < 8; c++) {
+        if (octant_count[c] == 0) continue;
+
+        const int child_idx = bh_newNode(tree);
+        if (child_idx < 0) {
+            tree->nodes[node_idx].is_leaf = true;
+            return;
+        }
+        bh_node_t* child = &tree->nodes[child_idx];
+        child->center_x = cx + ((c & 1) ? child_half : -child_half);
+        child->center_y = cy + ((c & 2) ? child_half : -child_half);
+        child->center_z = cz + ((c & 4) ? child_half : -child_half);
+        child->half_size = child_half;
+        child->begin = octant_start[c];
+        child->end = octant_start[c] + octant_count[c];
+        tree->nodes[node_idx].child[c] = child_idx;
+
+        bh_buildNode(tree, soa, child_idx, theta, depth + 1);
+    }
+}
+
+// rebuilds the octree around the current body positions
+bool bh_buildTree(bh_tree_t* tree, const body_soa_t* soa, const int count, const double theta) {
+    tree->node_count = 0;
+    if (count <= 0) return true;
+
+    // grow the index buffers if needed
+    if (count > tree->index_capacity) {
+        int* index = (int*)realloc(tree->index, count * sizeof(int));
+        if (index == NULL) return false;
+        tree->index = index;
+        int* scratch = (int*)realloc(tree->scratch, count * sizeof(int));
+        if (scratch == NULL) return false;
+        tree->scratch = scratch;
+        tree->index_capacity = count;
+    }
+    for (int i = 0; i < count; i++) {
+        tree->index[i] = i;
+    }
+
+    // bounding cube of all bodies
+    double min_x = soa->pos_x[0], max_x = soa->pos_x[0];
+    double min_y = soa->pos_y[0], max_y = soa->pos_y[0];
+    double min_z = soa->pos_z[0], max_z = soa->pos_z[0];
+    for (int i = 1; i < count; i++) {
+        min_x = fmin(min_x, soa->pos_x[i]); max_x = fmax(max_x, soa->pos_x[i]);
+        min_y = fmin(min_y, soa->pos_y[i]); max_y = fmax(max_y, soa->pos_y[i]);
+        min_z = fmin(min_z, soa->pos_z[i]); max_z = fmax(max_z, soa->pos_z[i]);
+    }
+    const double half = 0.5 * fmax(max_x - min_x, fmax(max_y - min_y, max_z - min_z)) * 1.0001 + 1.0;
+
+    const int root = bh_newNode(tree);
+    if (root < 0) return false;
+    tree->nodes[root].center_x = 0.5 * (min_x + max_x);
+    tree->nodes[root].center_y = 0.5 * (min_y + max_y);
+    tree->nodes[root].center_z = 0.5 * (min_z + max_z);
+    tree->nodes[root].half_size = half;
+    tree->nodes[root].begin = 0;
+    tree->nodes[root].end = count;
+
+    bh_buildNode(tree, soa, root, theta, 0);
+    return true;
+}
+
+// calculates the gravitational acceleration on body i by walking the tree
+// returns false (and the other body in collided_with) if body i is inside another body
+bool bh_calculateAcceleration(const bh_tree_t* tree, const body_soa_t* soa, const int i,
+                              const double softening, vec3* acc, int* collided_with) {
+    const double px = soa->pos_x[i], py = soa->pos_y[i], pz = soa->pos_z[i];
+    const double radius_sq = soa->radius[i] * soa->radius[i];
+    const double eps_sq = softening * softening;
+    double ax = 0.0, ay = 0.0, az = 0.0;
+
+    *acc = vec3_zero();
+    if (tree->node_count == 0) return true;
+
+    int stack[8 * BH_MAX_DEPTH + 8];
+    int sp = 0;
+    stack[sp++] = 0;
+
+    while (sp > 0) {
+        const bh_node_t* node = &tree->nodes[stack[--sp]];
+
+        if (node->is_leaf) {
+            // nearby bodies are summed exactly
+            for (int k = node->begin; k < node->end; k++) {
+                const int j = tree->index[k];
+                if (j == i) continue;
+                const double dx = soa->pos_x[j] - px;
+                const double dy = soa->pos_y[j] - py;
+                const double dz = soa->pos_z[j] - pz;
+                const double r_sq = dx * dx + dy * dy + dz * dz;
+                if (r_sq < radius_sq) {
+                    *collided_with = j;
+                    return false;
+                }
+                const double s_sq = r_sq + eps_sq;
+                if (s_sq == 0.0) continue;
+                const double inv_r3 = 1.0 / (s_sq * sqrt(s_sq));
+                ax += soa->mu[j] * dx * inv_r3;
+                ay += soa->mu[j] * dy * inv_r3;
+                az += soa->mu[j] * dz * inv_r3;
+            }
+            continue;
+        }
+
+        const double dx = node->com_x - px;
+        const double dy = node->com_y - py;
+        const double dz = node->com_z - pz;
+        const double r_sq = dx * dx + dy * dy + dz * dz;
+
+        if (r_sq > node->open_radius_sq) {
+            // far enough away -- treat the whole cell as a point mass
+            const double s_sq = r_sq + eps_sq;
+            const double inv_r3 = 1.0 / (s_sq * sqrt(s_sq));
+            ax += node->mu * dx * inv_r3;
+            ay += node->mu * dy * inv_r3;
+            az += node->mu * dz * inv_r3;
+        } else {
+            for (int c = 0; c < 8; c++) {
+                if (node->child[c] >= 0) {
+                    stack[sp++] = node->child[c];
+                }
+            }
+        }
+    }
+
+    *acc = (vec3){ax, ay, az};
+    return true;
+}
+
+// frees the tree workspace
+void bh_freeTree(bh_tree_t* tree) {
+    free(tree->nodes);
+    free(tree->index);
+    free(tree->scratch);
+    *tree = (bh_tree_t){0};
+}
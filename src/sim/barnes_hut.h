@@ -0,0 +1,12 @@
+#ifndef BARNES_HUT_H
+#define BARNES_HUT_H
+
+#include "../types.h"
+#include "../math/matrix.h"
+
+bool bh_buildTree(bh_tree_t* tree, const body_soa_t* soa, int count, double theta);
+bool bh_calculateAcceleration(const bh_tree_t* tree, const body_soa_t* soa, int i,
+                              double softening, vec3* acc, int* collided_with);
+void bh_freeTree(bh_tree_t* tree);
+
+#endif
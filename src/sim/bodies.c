@@ -5,26 +5,26 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-
-void displayError(const char* title, const char* message);
+#include "../utility/error_hook.h"
 
 // calculates gravitational force between two bodies and applies it to both
 // i is the body that has the force applied to it, whilst j is the body applying force to i
 void body_calculateGravForce(sim_properties_t* sim, const int i, const int j) {
-    body_t* bi = &sim->gb.bodies[i];
-    body_t* bj = &sim->gb.bodies[j];
+    body_soa_t* soa = &sim->gb.soa;
 
     // calculate the distance between the two bodies
-    const vec3 delta_pos = vec3_sub(bj->pos, bi->pos);
-    const double r_squared = vec3_mag_sq(delta_pos);
+    const double dx = soa->pos_x[j] - soa->pos_x[i];
+    const double dy = soa->pos_y[j] - soa->pos_y[i];
+    const double dz = soa->pos_z[j] - soa->pos_z[i];
+    const double r_squared = dx * dx + dy * dy + dz * dz;
 
     // planet collision logic -- checks if planets are too close
-    const double radius_squared = bi->radius * bi->radius;
+    const double radius_squared = soa->radius[i] * soa->radius[i];
     if (r_squared < radius_squared) {
         sim->wp.sim_running = false;
         sim->wp.reset_sim = true;
         char err_txt[128];
-        snprintf(err_txt, sizeof(err_txt), "Warning: %s has collided with %s\n\nResetting Simulation...", bi->name, bj->name);
+        snprintf(err_txt, sizeof(err_txt), "Warning: %s has collided with %s\n\nResetting Simulation...", sim->gb.bodies[i].name, sim->gb.bodies[j].name);
         displayError("PLANET COLLISION", err_txt);
         return;
     }
@@ -32,39 +32,129 @@ void body_calculateGravForce(sim_properties_t* sim, const int i, const int j) {
     // force = (G * m1 * m2) * delta / r^3
     const double r = sqrt(r_squared);
     const double r_cubed = r_squared * r;
-    const double force_factor = (G * bi->mass * bj->mass) / r_cubed;
+    const double force_factor = (soa->mu[i] * soa->mass[j]) / r_cubed;
 
-    const vec3 force = vec3_scale(delta_pos, force_factor);
+    const double fx = dx * force_factor;
+    const double fy = dy * force_factor;
+    const double fz = dz * force_factor;
 
     // applies force to both bodies (Newton's third law)
-    bi->force = vec3_add(bi->force, force);
-    bj->force = vec3_sub(bj->force, force);
+    soa->force_x[i] += fx; soa->force_y[i] += fy; soa->force_z[i] += fz;
+    soa->force_x[j] -= fx; soa->force_y[j] -= fy; soa->force_z[j] -= fz;
+}
+
+// calculates the forces of every pair (i, j > i) for the rows i in [row_begin, row_end)
+// and accumulates them into the given arrays (this is body_calculateGravForce split into tiles for the worker pool)
+// returns false and the colliding pair if two bodies are touching
+bool body_calculateGravForceRows(const body_soa_t* soa, const int count, const int row_begin, const int row_end,
+                                 double* fx, double* fy, double* fz, int* collided_i, int* collided_j) {
+    for (int i = row_begin; i < row_end; i++) {
+        if (!body_calculateGravForceColumns(soa, i, i + 1, count, fx, fy, fz, collided_j)) {
+            *collided_i = i;
+            return false;
+        }
+    }
+    return true;
 }
 
-// calculates changes of velocity and position based on force values
+// forces between body i and bodies [col_begin, col_end) of one row of the pair triangle
+// (also used by the vector kernels for the columns left over after the last full vector)
+bool body_calculateGravForceColumns(const body_soa_t* soa, const int i, const int col_begin, const int col_end,
+                                    double* fx, double* fy, double* fz, int* collided_j) {
+    const double px = soa->pos_x[i], py = soa->pos_y[i], pz = soa->pos_z[i];
+    const double mu_i = soa->mu[i];
+    const double radius_squared = soa->radius[i] * soa->radius[i];
+    double fxi = 0.0, fyi = 0.0, fzi = 0.0;
+
+    for (int j = col_begin; j < col_end; j++) {
+        const double dx = soa->pos_x[j] - px;
+        const double dy = soa->pos_y[j] - py;
+        const double dz = soa->pos_z[j] - pz;
+        const double r_squared = dx * dx + dy * dy + dz * dz;
+        if (r_squared < radius_squared) {
+            *collided_j = j;
+            return false;
+        }
+
+        const double r = sqrt(r_squared);
+        const double force_factor = (mu_i * soa->mass[j]) / (r_squared * r);
+        const double fxp = dx * force_factor;
+        const double fyp = dy * force_factor;
+        const double fzp = dz * force_factor;
+
+        fxi += fxp; fyi += fyp; fzi += fzp;
+        fx[j] -= fxp; fy[j] -= fyp; fz[j] -= fzp;
+    }
+
+    fx[i] += fxi;
+    fy[i] += fyi;
+    fz[i] += fzi;
+    return true;
+}
+
+// zeroes the force accumulators of every body
+void body_resetForces(body_properties_t* gb) {
+    body_soa_t* soa = &gb->soa;
+    for (int i = 0; i < gb->count; i++) {
+        soa->force_x[i] = 0.0;
+        soa->force_y[i] = 0.0;
+        soa->force_z[i] = 0.0;
+    }
+}
+
+// calculates changes of velocity and position based on force values for every body
 // uses velocity verlet integration
-void body_updateMotion(body_t* body, const double dt) {
-    // calculate the current acceleration from the force on the object
-    body->acc = vec3_scale(body->force, 1.0 / body->mass);
+void body_updateMotion(body_properties_t* gb, const double dt) {
+    body_soa_t* soa = &gb->soa;
+    const double half_dt_sq = 0.5 * dt * dt;
+
+    for (int i = 0; i < gb->count; i++) {
+        // calculate the current acceleration from the force on the object
+        const double inv_mass = 1.0 / soa->mass[i];
+        soa->acc_x[i] = soa->force_x[i] * inv_mass;
+        soa->acc_y[i] = soa->force_y[i] * inv_mass;
+        soa->acc_z[i] = soa->force_z[i] * inv_mass;
 
-    // update position using current velocity and acceleration
-    const vec3 vel_term = vec3_scale(body->vel, dt);
-    const vec3 acc_term = vec3_scale(body->acc, 0.5 * dt * dt);
-    body->pos = vec3_add(body->pos, vec3_add(vel_term, acc_term));
+        // update position using current velocity and acceleration
+        soa->pos_x[i] += soa->vel_x[i] * dt + soa->acc_x[i] * half_dt_sq;
+        soa->pos_y[i] += soa->vel_y[i] * dt + soa->acc_y[i] * half_dt_sq;
+        soa->pos_z[i] += soa->vel_z[i] * dt + soa->acc_z[i] * half_dt_sq;
 
-    // update velocity using average of current and previous acceleration
-    const vec3 avg_acc = vec3_scale(vec3_add(body->acc, body->acc_prev), 0.5);
-    body->vel = vec3_add(body->vel, vec3_scale(avg_acc, dt));
-    body->vel_mag = vec3_mag(body->vel);
+        // update velocity using average of current and previous acceleration
+        soa->vel_x[i] += 0.5 * (soa->acc_x[i] + soa->acc_prev_x[i]) * dt;
+        soa->vel_y[i] += 0.5 * (soa->acc_y[i] + soa->acc_prev_y[i]) * dt;
+        soa->vel_z[i] += 0.5 * (soa->acc_z[i] + soa->acc_prev_z[i]) * dt;
 
-    // store current acceleration for next iteration
-    body->acc_prev = body->acc;
+        // store current acceleration for next iteration
+        soa->acc_prev_x[i] = soa->acc_x[i];
+        soa->acc_prev_y[i] = soa->acc_y[i];
+        soa->acc_prev_z[i] = soa->acc_z[i];
+    }
 }
 
-// calculates the kinetic energy of a target body
-void body_calculateKineticEnergy(body_t* body) {
-    // calculate kinetic energy (0.5mv^2)
-    body->kinetic_energy = 0.5 * body->mass * body->vel_mag * body->vel_mag;
+// calculates the kinetic energy of every body (stored in the side table)
+void body_calculateKineticEnergy(body_properties_t* gb) {
+    const body_soa_t* soa = &gb->soa;
+    for (int i = 0; i < gb->count; i++) {
+        // calculate kinetic energy (0.5mv^2)
+        const double v_sq = soa->vel_x[i] * soa->vel_x[i] + soa->vel_y[i] * soa->vel_y[i] + soa->vel_z[i] * soa->vel_z[i];
+        gb->bodies[i].kinetic_energy = 0.5 * soa->mass[i] * v_sq;
+    }
+}
+
+// copies the hot SoA state back into the body_t side table
+// (done once per step so the renderer, spacecraft code and telemetry can keep using body_t)
+void body_syncSideTable(body_properties_t* gb) {
+    const body_soa_t* soa = &gb->soa;
+    for (int i = 0; i < gb->count; i++) {
+        body_t* body = &gb->bodies[i];
+        body->pos = (vec3){soa->pos_x[i], soa->pos_y[i], soa->pos_z[i]};
+        body->vel = (vec3){soa->vel_x[i], soa->vel_y[i], soa->vel_z[i]};
+        body->vel_mag = vec3_mag(body->vel);
+        body->acc = (vec3){soa->acc_x[i], soa->acc_y[i], soa->acc_z[i]};
+        body->acc_prev = (vec3){soa->acc_prev_x[i], soa->acc_prev_y[i], soa->acc_prev_z[i]};
+        body->force = (vec3){soa->force_x[i], soa->force_y[i], soa->force_z[i]};
+    }
 }
 
 // updates the rotational attitude of a body based on its rotational velocity
@@ -108,19 +198,72 @@ void body_calculateSOI(body_properties_t* gb) {
     }
 }
 
+// grows every SoA array to the new capacity
+static bool body_growSoA(body_soa_t* soa, const int new_capacity) {
+    double** fields[] = {
+        &soa->pos_x, &soa->pos_y, &soa->pos_z,
+        &soa->vel_x, &soa->vel_y, &soa->vel_z,
+        &soa->acc_x, &soa->acc_y, &soa->acc_z,
+        &soa->acc_prev_x, &soa->acc_prev_y, &soa->acc_prev_z,
+        &soa->force_x, &soa->force_y, &soa->force_z,
+        &soa->mass, &soa->mu, &soa->radius
+    };
+    for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+        double* temp = (double*)realloc(*fields[f], new_capacity * sizeof(double));
+        if (temp == NULL) {
+            return false;
+        }
+        *fields[f] = temp;
+    }
+    return true;
+}
+
+// frees the SoA arrays and the side table (names included)
+void body_freeStorage(body_properties_t* gb) {
+    if (gb->bodies != NULL) {
+        for (int i = 0; i < gb->count; i++) {
+            free(gb->bodies[i].name);
+        }
+        free(gb->bodies);
+    }
+
+    body_soa_t* soa = &gb->soa;
+    double* fields[] = {
+        soa->pos_x, soa->pos_y, soa->pos_z,
+        soa->vel_x, soa->vel_y, soa->vel_z,
+        soa->acc_x, soa->acc_y, soa->acc_z,
+        soa->acc_prev_x, soa->acc_prev_y, soa->acc_prev_z,
+        soa->force_x, soa->force_y, soa->force_z,
+        soa->mass, soa->mu, soa->radius
+    };
+    for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+        free(fields[f]);
+    }
+
+    gb->bodies = NULL;
+    gb->soa = (body_soa_t){0};
+    gb->count = 0;
+    gb->capacity = 0;
+}
+
+// grows the side table and every SoA array to hold at least capacity bodies (bulk loaders reserve once up front)
+bool body_reserve(body_properties_t* gb, const int capacity) {
+    if (capacity <= gb->capacity) return true;
+    body_t* temp = (body_t*)realloc(gb->bodies, capacity * sizeof(body_t));
+    if (temp == NULL) return false;
+    gb->bodies = temp;
+    if (!body_growSoA(&gb->soa, capacity)) return false;
+    gb->capacity = capacity;
+    return true;
+}
+
 // function to add a new body to the system
 void body_addOrbitalBody(body_properties_t* gb, const char* name, const double mass,
                          const double radius, const vec3 pos, const vec3 vel) {
     // grow capacity if needed (amortized growth)
-    if (gb->count >= gb->capacity) {
-        const int new_capacity = gb->capacity == 0 ? 4 : gb->capacity * 2;
-        body_t* temp = (body_t*)realloc(gb->bodies, new_capacity * sizeof(body_t));
-        if (temp == NULL) {
-            displayError("ERROR", "Failed to allocate memory for body");
-            return;
-        }
-        gb->bodies = temp;
-        gb->capacity = new_capacity;
+    if (gb->count >= gb->capacity && !body_reserve(gb, gb->capacity == 0 ? 4 : gb->capacity * 2)) {
+        displayError("ERROR", "Failed to allocate memory for body");
+        return;
     }
 
     const int idx = gb->count;
@@ -155,5 +298,129 @@ void body_addOrbitalBody(body_properties_t* gb, const char* name, const double m
     body->rotational_v = 0.0;
     body->attitude = (quaternion_t){1.0, 0.0, 0.0, 0.0};
 
+    // hot copy used by the physics loops
+    body_soa_t* soa = &gb->soa;
+    soa->pos_x[idx] = pos.x; soa->pos_y[idx] = pos.y; soa->pos_z[idx] = pos.z;
+    soa->vel_x[idx] = vel.x; soa->vel_y[idx] = vel.y; soa->vel_z[idx] = vel.z;
+    soa->acc_x[idx] = 0.0; soa->acc_y[idx] = 0.0; soa->acc_z[idx] = 0.0;
+    soa->acc_prev_x[idx] = 0.0; soa->acc_prev_y[idx] = 0.0; soa->acc_prev_z[idx] = 0.0;
+    soa->force_x[idx] = 0.0; soa->force_y[idx] = 0.0; soa->force_z[idx] = 0.0;
+    soa->mass[idx] = mass;
+    soa->mu[idx] = G * mass;
+    soa->radius[idx] = radius;
+
     gb->count++;
 }
+
+// appends the current body state to the history ring (the ring is reset whenever the body count changes)
+void body_recordHistory(const body_properties_t* gb, body_history_t* history, const int capacity, const double time) {
+    if (history->body_count != gb->count || history->capacity != capacity || history->time == NULL) {
+        body_freeHistory(history);
+        if (gb->count == 0) return;
+        history->time = (double*)malloc(capacity * sizeof(double));
+        history->state = (double*)malloc((size_t)capacity * 6 * gb->count * sizeof(double));
+        if (history->time == NULL || history->state == NULL) {
+            body_freeHistory(history);
+            displayError("ERROR", "Failed to allocate memory for the body history");
+            return;
+        }
+        history->capacity = capacity;
+        history->body_count = gb->count;
+    }
+
+    // the same time twice (e.g. while paused) just refreshes the newest frame
+    int frame = history->head;
+    if (history->count > 0) {
+        const int newest = (history->head + history->capacity - 1) % history->capacity;
+        if (history->time[newest] == time) frame = newest;
+    }
+
+    const body_soa_t* soa = &gb->soa;
+    const size_t n = (size_t)gb->count;
+    double* state = history->state + (size_t)frame * 6 * n;
+    memcpy(state, soa->pos_x, n * sizeof(double));
+    memcpy(state + n, soa->pos_y, n * sizeof(double));
+    memcpy(state + 2 * n, soa->pos_z, n * sizeof(double));
+    memcpy(state + 3 * n, soa->vel_x, n * sizeof(double));
+    memcpy(state + 4 * n, soa->vel_y, n * sizeof(double));
+    memcpy(state + 5 * n, soa->vel_z, n * sizeof(double));
+    history->time[frame] = time;
+
+    if (frame == history->head) {
+        history->head = (history->head + 1) % history->capacity;
+        if (history->count < history->capacity) history->count++;
+    }
+}
+
+// time of the k-th stored frame (0 is the oldest)
+double body_historyTime(const body_history_t* history, const int k) {
+    const int frame = (history->head - history->count + k + history->capacity) % history->capacity;
+    return history->time[frame];
+}
+
+// finds the two frames around time t (t outside the stored span is clamped to the oldest/newest frame)
+body_history_cursor_t body_historyLookup(const body_history_t* history, const double t) {
+    const size_t n = (size_t)history->body_count;
+
+    // binary search for the last frame at or before t
+    int lo = 0, hi = history->count - 1;
+    if (t <= body_historyTime(history, 0)) hi = 0;
+    while (lo < hi) {
+        const int mid = (lo + hi + 1) / 2;
+        if (body_historyTime(history, mid) <= t) lo = mid;
+        else hi = mid - 1;
+    }
+    const int k1 = lo + 1 < history->count ? lo + 1 : lo;
+    const int f0 = (history->head - history->count + lo + history->capacity) % history->capacity;
+    const int f1 = (history->head - history->count + k1 + history->capacity) % history->capacity;
+
+    body_history_cursor_t cursor = {
+        .before = history->state + (size_t)f0 * 6 * n,
+        .after = history->state + (size_t)f1 * 6 * n,
+        .u = 0.0,
+        .h = history->time[f1] - history->time[f0]
+    };
+    if (cursor.h > 0.0) cursor.u = fmin(fmax((t - history->time[f0]) / cursor.h, 0.0), 1.0);
+    return cursor;
+}
+
+// position and velocity of body i at the cursor time, cubic hermite interpolation between the two frames
+void body_interpolateHistory(const body_history_t* history, const body_history_cursor_t* cursor, const int i, vec3* pos, vec3* vel) {
+    const size_t n = (size_t)history->body_count;
+    const double* s0 = cursor->before;
+    const double* s1 = cursor->after;
+    const double h = cursor->h;
+    if (h <= 0.0) {
+        *pos = (vec3){s0[i], s0[n + i], s0[2 * n + i]};
+        *vel = (vec3){s0[3 * n + i], s0[4 * n + i], s0[5 * n + i]};
+        return;
+    }
+
+    // hermite basis and its derivative on u in [0, 1]
+    const double u = cursor->u;
+    const double u2 = u * u, u3 = u2 * u;
+    const double h00 = 2.0 * u3 - 3.0 * u2 + 1.0;
+    const double h10 = u3 - 2.0 * u2 + u;
+    const double h01 = -2.0 * u3 + 3.0 * u2;
+    const double h11 = u3 - u2;
+    const double d00 = (6.0 * u2 - 6.0 * u) / h;
+    const double d10 = 3.0 * u2 - 4.0 * u + 1.0;
+    const double d01 = (-6.0 * u2 + 6.0 * u) / h;
+    const double d11 = 3.0 * u2 - 2.0 * u;
+
+    double p[3], v[3];
+    for (int c = 0; c < 3; c++) {
+        const double p0 = s0[c * n + i], p1 = s1[c * n + i];
+        const double v0 = s0[(3 + c) * n + i], v1 = s1[(3 + c) * n + i];
+        p[c] = h00 * p0 + h10 * h * v0 + h01 * p1 + h11 * h * v1;
+        v[c] = d00 * p0 + d10 * v0 + d01 * p1 + d11 * v1;
+    }
+    *pos = (vec3){p[0], p[1], p[2]};
+    *vel = (vec3){v[0], v[1], v[2]};
+}
+
+void body_freeHistory(body_history_t* history) {
+    free(history->time);
+    free(history->state);
+    *history = (body_history_t){0};
+}
@@ -4,10 +4,23 @@
 #include "../types.h"
 
 void body_calculateGravForce(sim_properties_t* sim, int i, int j);
-void body_updateMotion(body_t* body, double dt);
+bool body_calculateGravForceRows(const body_soa_t* soa, int count, int row_begin, int row_end,
+                                 double* fx, double* fy, double* fz, int* collided_i, int* collided_j);
+bool body_calculateGravForceColumns(const body_soa_t* soa, int i, int col_begin, int col_end,
+                                    double* fx, double* fy, double* fz, int* collided_j);
+void body_resetForces(body_properties_t* gb);
+void body_updateMotion(body_properties_t* gb, double dt);
 void body_updateRotation(body_t* body, double dt);
-void body_calculateKineticEnergy(body_t* body);
+void body_calculateKineticEnergy(body_properties_t* gb);
+void body_syncSideTable(body_properties_t* gb);
 void body_calculateSOI(body_properties_t* gb);
+bool body_reserve(body_properties_t* gb, int capacity);
 void body_addOrbitalBody(body_properties_t* gb, const char* name, double mass, double radius, vec3 pos, vec3 vel);
+void body_freeStorage(body_properties_t* gb);
+void body_recordHistory(const body_properties_t* gb, body_history_t* history, int capacity, double time);
+double body_historyTime(const body_history_t* history, int k);
+body_history_cursor_t body_historyLookup(const body_history_t* history, double t);
+void body_interpolateHistory(const body_history_t* history, const body_history_cursor_t* cursor, int i, vec3* pos, vec3* vel);
+void body_freeHistory(body_history_t* history);
 
 #endif
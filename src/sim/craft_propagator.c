@@ -0,0 +1,503 @@
+#include "craft_propagator.h"
+#include "bodies.h"
+#include "spacecraft.h"
+#include "kepler.h"
+#include "../math/matrix.h"
+#include <math.h>
+#include <stdio.h>
+#include "../utility/error_hook.h"
+
+#define CRAFT_MIN_STEP 1e-3   // seconds, steps are accepted at this size even if the error test fails
+#define CRAFT_FIRST_STEP 1.0  // seconds, the controller finds the right size within a few steps
+#define CRAFT_SAFETY 0.9
+#define CRAFT_MIN_SCALE 0.2
+#define CRAFT_MAX_SCALE 5.0
+
+// Dormand-Prince 5(4) tableau (the 5th order solution is propagated, the 4th order one only estimates the error)
+static const double DP_C[7] = {0.0, 1.0 / 5.0, 3.0 / 10.0, 4.0 / 5.0, 8.0 / 9.0, 1.0, 1.0};
+static const double DP_A[7][6] = {
+    {0},
+    {1.0 / 5.0},
+    {3.0 / 40.0, 9.0 / 40.0},
+    {44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0},
+    {19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0},
+    {9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0},
+    {35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0}
+};
+static const double DP_E[7] = {
+    71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0, -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0
+};
+
+typedef struct {
+    vec3 pos;
+    vec3 vel;
+    double mass;
+} craft_state_t;
+
+// time derivative of a craft state plus what the error scaling needs to know about the nearest body
+typedef struct {
+    vec3 dpos;
+    vec3 dvel;
+    double dmass;
+    double nearest_r;     // distance to the nearest body
+    double nearest_speed; // speed relative to the nearest body
+} craft_deriv_t;
+
+craft_propagation_t craft_defaultPropagation(void) {
+    return (craft_propagation_t){
+        .adaptive = false,
+        .tolerance = 1e-10,
+        .max_step = 3600.0,
+        .force_evaluations = 0,
+        .rails = false,
+        .rails_threshold = 1e-6
+    };
+}
+
+// gravity from every body at time t (body positions interpolated from the history) plus engine thrust
+// returns false and the body index in collided_with if the craft is inside a body
+static bool craft_derivative(sim_properties_t* sim, const spacecraft_t* craft, const double t,
+                             const craft_state_t* y, craft_deriv_t* dy, int* collided_with) {
+    const body_soa_t* soa = &sim->gb.soa;
+    const body_history_cursor_t cursor = body_historyLookup(&sim->history, t);
+    sim->cp.force_evaluations++;
+
+    vec3 acc = vec3_zero();
+    dy->nearest_r = INFINITY;
+    dy->nearest_speed = 0.0;
+    for (int j = 0; j < sim->gb.count; j++) {
+        vec3 body_pos, body_vel;
+        body_interpolateHistory(&sim->history, &cursor, j, &body_pos, &body_vel);
+
+        const vec3 delta = vec3_sub(body_pos, y->pos);
+        const double r_squared = vec3_mag_sq(delta);
+        const double r = sqrt(r_squared);
+        if (r < soa->radius[j]) {
+            *collided_with = j;
+            return false;
+        }
+        acc = vec3_add(acc, vec3_scale(delta, soa->mu[j] / (r_squared * r)));
+
+        if (r < dy->nearest_r) {
+            dy->nearest_r = r;
+            dy->nearest_speed = vec3_mag(vec3_sub(y->vel, body_vel));
+        }
+    }
+
+    dy->dmass = 0.0;
+    if (craft->engine_on && y->mass > craft->dry_mass) {
+        const double current_thrust = craft->thrust * craft->throttle;
+        const vec3 engine_thrust_direction = {0.0, 1.0, 0.0};
+        const vec3 world_thrust = quaternionRotate(craft->attitude, engine_thrust_direction);
+        acc = vec3_add(acc, vec3_scale(world_thrust, current_thrust / y->mass));
+        dy->dmass = -craft->mass_flow_rate * craft->throttle;
+    }
+
+    dy->dpos = y->vel;
+    dy->dvel = acc;
+    return true;
+}
+
+// y + h * sum(weights[s] * k[s])
+static craft_state_t craft_combine(const craft_state_t* y, const double h, const double* weights,
+                                   const craft_deriv_t* k, const int stage_count) {
+    craft_state_t out = *y;
+    for (int s = 0; s < stage_count; s++) {
+        if (weights[s] == 0.0) continue;
+        out.pos = vec3_add(out.pos, vec3_scale(k[s].dpos, h * weights[s]));
+        out.vel = vec3_add(out.vel, vec3_scale(k[s].dvel, h * weights[s]));
+        out.mass += h * weights[s] * k[s].dmass;
+    }
+    return out;
+}
+
+// one Dormand-Prince step, error is the scaled error norm (<= 1 means the step meets the tolerance)
+// positions are measured against the distance to the nearest body and velocities against the speed relative to it,
+// so the tolerance means the same thing in low orbit and in interplanetary cruise
+static bool craft_dopriStep(sim_properties_t* sim, const spacecraft_t* craft, const double t, const double h,
+                            const craft_state_t* y, craft_state_t* y_new, double* error, int* collided_with) {
+    craft_deriv_t k[7];
+    if (!craft_derivative(sim, craft, t, y, &k[0], collided_with)) return false;
+    for (int s = 1; s < 7; s++) {
+        const craft_state_t stage = craft_combine(y, h, DP_A[s], k, s);
+        if (!craft_derivative(sim, craft, t + DP_C[s] * h, &stage, &k[s], collided_with)) return false;
+    }
+    *y_new = craft_combine(y, h, DP_A[6], k, 6);
+
+    const craft_state_t zero = {0};
+    const craft_state_t err = craft_combine(&zero, h, DP_E, k, 7);
+    const double tolerance = sim->cp.tolerance;
+    const double pos_scale = tolerance * fmax(k[0].nearest_r, 1.0);
+    const double vel_scale = tolerance * fmax(k[0].nearest_speed, 1.0);
+    const double pos_error = vec3_mag(err.pos) / pos_scale;
+    const double vel_error = vec3_mag(err.vel) / vel_scale;
+    *error = sqrt(0.5 * (pos_error * pos_error + vel_error * vel_error));
+    return true;
+}
+
+// start or end of the next burn after time t (steps end there so thrust never switches mid step)
+static double craft_nextBurnEvent(const spacecraft_t* craft, const double t) {
+    double next = INFINITY;
+    for (int b = 0; b < craft->num_burns; b++) {
+        const burn_properties_t* burn = &craft->burn_properties[b];
+        if (burn->burn_start_time > t && burn->burn_start_time < next) next = burn->burn_start_time;
+        if (burn->burn_end_time > t && burn->burn_end_time < next) next = burn->burn_end_time;
+    }
+    return next;
+}
+
+// closest body, SOI, forces and orbital elements for pos/vel at time t
+static void craft_updateBookkeeping(sim_properties_t* sim, spacecraft_t* craft, const double t) {
+    body_properties_t* gb = &sim->gb;
+    const body_history_cursor_t cursor = body_historyLookup(&sim->history, t);
+
+    craft->grav_force = vec3_zero();
+    craft->closest_r_squared = INFINITY;
+    for (int j = 0; j < gb->count; j++) {
+        vec3 body_pos, body_vel;
+        body_interpolateHistory(&sim->history, &cursor, j, &body_pos, &body_vel);
+        const vec3 delta = vec3_sub(body_pos, craft->pos);
+        const double r_squared = vec3_mag_sq(delta);
+        const double r = sqrt(r_squared);
+        craft->grav_force = vec3_add(craft->grav_force, vec3_scale(delta, craft->current_total_mass * gb->soa.mu[j] / (r_squared * r)));
+
+        if (r_squared < craft->closest_r_squared) {
+            craft->closest_r_squared = r_squared;
+            craft->closest_planet_id = j;
+            if (r <= gb->bodies[j].SOI_radius) {
+                craft->SOI_planet_id = j;
+            }
+        }
+    }
+    craft_applyThrust(craft);
+    craft->acc = vec3_scale(craft->grav_force, 1.0 / craft->current_total_mass);
+    craft->acc_prev = craft->acc;
+    craft->vel_mag = vec3_mag(craft->vel);
+
+    // elements against the SOI body as it was at the craft's time
+    if (craft->SOI_planet_id >= 0 && craft->SOI_planet_id < gb->count) {
+        body_t soi_body = gb->bodies[craft->SOI_planet_id];
+        body_interpolateHistory(&sim->history, &cursor, craft->SOI_planet_id, &soi_body.pos, &soi_body.vel);
+        craft_calculateOrbitalElements(craft, &soi_body);
+    }
+}
+
+// advances every craft with its own adaptive step as far as the recorded body history allows
+// a craft only takes a step once the bodies have been integrated past its end, so it trails the sim time
+// by less than one of its own steps (long cruise steps no longer cost one force evaluation per body step).
+// pos/vel are left at the craft's own time, craft_publishAdaptive brings them to the sim time when they are needed
+void craft_propagateAdaptive(sim_properties_t* sim) {
+    const body_history_t* history = &sim->history;
+    spacecraft_properties_t* sc = &sim->gs;
+    if (history->count == 0 || history->body_count != sim->gb.count) return;
+
+    const double newest = body_historyTime(history, history->count - 1);
+    const double oldest = body_historyTime(history, 0);
+
+    // a craft must never fall behind the oldest stored frame
+    double history_limit = INFINITY;
+    if (history->count == history->capacity) history_limit = 0.5 * (newest - oldest);
+
+    for (int i = 0; i < sc->count; i++) {
+        spacecraft_t* craft = &sc->spacecraft[i];
+        if (craft->on_rails) continue;
+
+        // new craft start at the beginning of the step that was just taken
+        if (craft->prop_step <= 0.0) {
+            craft->prop_time = history->count >= 2 ? body_historyTime(history, history->count - 2) : newest;
+            craft->prop_step = CRAFT_FIRST_STEP;
+            craft->prop_pos = craft->pos;
+            craft->prop_vel = craft->vel;
+        }
+
+        craft_state_t y = {craft->prop_pos, craft->prop_vel, craft->dry_mass + craft->fuel_mass};
+        while (true) {
+            double h = fmin(fmin(craft->prop_step, sim->cp.max_step), history_limit);
+            bool clamped = false;
+            const double event = craft_nextBurnEvent(craft, craft->prop_time);
+            if (craft->prop_time + h > event) {
+                h = event - craft->prop_time;
+                clamped = true;
+            }
+            if (craft->prop_time + h > newest || h <= 0.0) break; // wait for the bodies
+
+            // the burn attitude follows the state at the start of the step
+            craft->pos = y.pos;
+            craft->vel = y.vel;
+            craft->fuel_mass = fmax(y.mass - craft->dry_mass, 0.0);
+            craft_checkBurnSchedule(craft, &sim->gb, craft->prop_time);
+
+            // the burn attitude is held for a whole step, so steering is updated at least as often as with the fixed step
+            if (craft->engine_on && h > sim->wp.time_step) {
+                h = sim->wp.time_step;
+                clamped = true;
+            }
+
+            craft_state_t y_new;
+            double error = 0.0;
+            int collided_with = -1;
+            if (!craft_dopriStep(sim, craft, craft->prop_time, h, &y, &y_new, &error, &collided_with)) {
+                sim->wp.sim_running = false;
+                sim->wp.reset_sim = true;
+                char err_txt[128];
+                snprintf(err_txt, sizeof(err_txt), "Warning: %s has collided with %s\n\nResetting Simulation...", craft->name, sim->gb.bodies[collided_with].name);
+                displayError("PLANET COLLISION", err_txt);
+                return;
+            }
+
+            const double scale = error > 0.0 ? fmin(fmax(CRAFT_SAFETY * pow(error, -0.2), CRAFT_MIN_SCALE), CRAFT_MAX_SCALE) : CRAFT_MAX_SCALE;
+            const bool accepted = error <= 1.0 || h <= CRAFT_MIN_STEP;
+            if (accepted) {
+                y = y_new;
+                craft->prop_time += h;
+            }
+            // a step cut short by a burn event says nothing about the step size the orbit needs
+            if (!(accepted && clamped)) craft->prop_step = fmax(h * scale, CRAFT_MIN_STEP);
+        }
+
+        craft->prop_pos = y.pos;
+        craft->prop_vel = y.vel;
+        craft->pos = y.pos;
+        craft->vel = y.vel;
+        craft->fuel_mass = fmax(y.mass - craft->dry_mass, 0.0);
+        craft->current_total_mass = craft->dry_mass + craft->fuel_mass;
+        if (craft->fuel_mass <= 0.0) craft->engine_on = false;
+        craft_updateBookkeeping(sim, craft, craft->prop_time);
+        craft->prop_published = craft->prop_time >= newest;
+    }
+}
+
+// integrates a copy of the craft from its integration state to time t, ending steps on burn events like the real ones.
+// the steps are not checked against the tolerance: together they are shorter than the step the controller picked
+// next, which it expects to meet it. false if the craft would hit a body on the way (the next real step reports it)
+static bool craft_closeGap(sim_properties_t* sim, const spacecraft_t* craft, const double t, craft_state_t* y) {
+    spacecraft_t probe = *craft;
+    double time = craft->prop_time;
+    while (time < t) {
+        const double h = fmin(t, craft_nextBurnEvent(&probe, time)) - time;
+        probe.pos = y->pos;
+        probe.vel = y->vel;
+        probe.fuel_mass = fmax(y->mass - probe.dry_mass, 0.0);
+        craft_checkBurnSchedule(&probe, &sim->gb, time);
+
+        craft_state_t y_new;
+        double error = 0.0;
+        int collided_with = -1;
+        if (!craft_dopriStep(sim, &probe, time, h, y, &y_new, &error, &collided_with)) return false;
+        *y = y_new;
+        time += h;
+    }
+    return true;
+}
+
+// brings pos/vel (and the orbital elements) of adaptive craft from their own time to the sim time, for everything that
+// shows or records them: telemetry, the render snapshot and the library API. the integration state is left alone, so the
+// craft steps (and their cost) do not depend on how often this runs
+void craft_publishAdaptive(sim_properties_t* sim) {
+    const body_history_t* history = &sim->history;
+    spacecraft_properties_t* sc = &sim->gs;
+    if (!sim->cp.adaptive || history->count == 0 || history->body_count != sim->gb.count) return;
+    const double newest = body_historyTime(history, history->count - 1);
+
+    for (int i = 0; i < sc->count; i++) {
+        spacecraft_t* craft = &sc->spacecraft[i];
+        if (craft->on_rails || craft->prop_step <= 0.0 || craft->prop_published) continue;
+        craft->prop_published = true;
+
+        craft_state_t y = {craft->prop_pos, craft->prop_vel, craft->dry_mass + craft->fuel_mass};
+        if (!craft_closeGap(sim, craft, newest, &y)) continue;
+        craft->pos = y.pos;
+        craft->vel = y.vel;
+        craft_updateBookkeeping(sim, craft, newest);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// ON RAILS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    double perturbation;      // third body (tidal) acceleration relative to the pull of the central body
+    int closest;
+    double closest_r_squared;
+    int soi_body;             // the closest body if the craft is inside its SOI, else the central body if still inside its SOI, else -1
+    vec3 acc;                 // full gravitational acceleration
+} craft_rails_check_t;
+
+// state of body j, interpolated at the cursor time (adaptive craft trail the bodies) or the current one if cursor is NULL
+static void craft_bodyState(const sim_properties_t* sim, const body_history_cursor_t* cursor, const int j, vec3* pos, vec3* vel) {
+    if (cursor != NULL) {
+        body_interpolateHistory(&sim->history, cursor, j, pos, vel);
+        return;
+    }
+    const body_soa_t* soa = &sim->gb.soa;
+    *pos = (vec3){soa->pos_x[j], soa->pos_y[j], soa->pos_z[j]};
+    *vel = (vec3){soa->vel_x[j], soa->vel_y[j], soa->vel_z[j]};
+}
+
+// how well a two body orbit around body b describes a craft at pos
+static craft_rails_check_t craft_railsCheck(const sim_properties_t* sim, const body_history_cursor_t* cursor, const vec3 pos, const int b) {
+    const body_properties_t* gb = &sim->gb;
+    craft_rails_check_t check = {.closest = b, .closest_r_squared = INFINITY, .soi_body = -1, .acc = vec3_zero()};
+
+    vec3 central_pos, central_vel;
+    craft_bodyState(sim, cursor, b, &central_pos, &central_vel);
+    const double central_r = vec3_mag(vec3_sub(central_pos, pos));
+
+    vec3 tidal = vec3_zero();
+    for (int k = 0; k < gb->count; k++) {
+        vec3 body_pos, body_vel;
+        craft_bodyState(sim, cursor, k, &body_pos, &body_vel);
+        const vec3 to_body = vec3_sub(body_pos, pos);
+        const double r_squared = vec3_mag_sq(to_body);
+        const vec3 acc = vec3_scale(to_body, gb->soa.mu[k] / (r_squared * sqrt(r_squared)));
+        check.acc = vec3_add(check.acc, acc);
+        if (r_squared < check.closest_r_squared) {
+            check.closest_r_squared = r_squared;
+            check.closest = k;
+        }
+        if (k == b) continue;
+
+        // the central body is pulled by body k too, only the difference bends the orbit around it
+        const vec3 central_to_body = vec3_sub(body_pos, central_pos);
+        const double d_squared = vec3_mag_sq(central_to_body);
+        tidal = vec3_add(tidal, vec3_sub(acc, vec3_scale(central_to_body, gb->soa.mu[k] / (d_squared * sqrt(d_squared)))));
+    }
+    check.perturbation = vec3_mag(tidal) * central_r * central_r / gb->soa.mu[b];
+
+    const double closest_soi = gb->bodies[check.closest].SOI_radius;
+    if (check.closest_r_squared <= closest_soi * closest_soi) check.soi_body = check.closest;
+    else if (gb->bodies[b].SOI_radius == 0.0 || central_r <= gb->bodies[b].SOI_radius) check.soi_body = b;
+    return check;
+}
+
+// true if any burn window overlaps [t_begin, t_end)
+static bool craft_burnDue(const spacecraft_t* craft, const double t_begin, const double t_end) {
+    for (int b = 0; b < craft->num_burns; b++) {
+        const burn_properties_t* burn = &craft->burn_properties[b];
+        if (burn->burn_start_time < t_end && burn->burn_end_time > t_begin) return true;
+    }
+    return false;
+}
+
+// moves a craft on rails to time t along its orbit, around the current position of its rails body
+// (always propagated from the entry state, so round off does not pile up over a long coast)
+static bool craft_placeOnRails(sim_properties_t* sim, spacecraft_t* craft, const double t) {
+    const body_soa_t* soa = &sim->gb.soa;
+    const int b = craft->rails_body;
+    vec3 rel_pos = craft->rails_pos;
+    vec3 rel_vel = craft->rails_vel;
+    if (!kepler_drift(soa->mu[b], &rel_pos, &rel_vel, t - craft->rails_epoch)) return false;
+
+    craft->pos = vec3_add((vec3){soa->pos_x[b], soa->pos_y[b], soa->pos_z[b]}, rel_pos);
+    craft->vel = vec3_add((vec3){soa->vel_x[b], soa->vel_y[b], soa->vel_z[b]}, rel_vel);
+    return true;
+}
+
+// periapsis distance of the two body orbit around a body with gravitational parameter mu
+static double craft_periapsis(const double mu, const vec3 rel_pos, const vec3 rel_vel) {
+    const vec3 h = vec3_cross(rel_pos, rel_vel);
+    const double r = vec3_mag(rel_pos);
+    const vec3 e_vec = vec3_sub(vec3_scale(vec3_cross(rel_vel, h), 1.0 / mu), vec3_scale(rel_pos, 1.0 / r));
+    return vec3_mag_sq(h) / (mu * (1.0 + vec3_mag(e_vec)));
+}
+
+// decides before each step which craft coast on rails through it. a craft goes on rails when its engine is off, no burn is
+// due in the step, its periapsis is above the surface and the third body pull is below the threshold; it then follows its
+// Kepler orbit around its SOI body exactly, at any step size. it drops back to the numerical integration when it changes SOI,
+// the perturbation grows past the threshold or a burn is due in the step
+void craft_updateRails(sim_properties_t* sim) {
+    body_properties_t* gb = &sim->gb;
+    spacecraft_properties_t* sc = &sim->gs;
+    const double now = sim->wp.sim_time;
+    const double next = now + sim->wp.time_step;
+
+    for (int i = 0; i < sc->count; i++) {
+        spacecraft_t* craft = &sc->spacecraft[i];
+
+        if (craft->on_rails) {
+            const int b = craft->rails_body;
+            bool keep = b >= 0 && b < gb->count && sim->cp.rails && !craft_burnDue(craft, now, next);
+            if (keep) {
+                const craft_rails_check_t check = craft_railsCheck(sim, NULL, craft->pos, b);
+                keep = check.soi_body == b && check.perturbation <= sim->cp.rails_threshold;
+            }
+            if (!keep) {
+                craft->on_rails = false;
+                craft->acc_prev = craft->acc;  // velocity verlet continues from here
+                craft->prop_time = now;        // and so does the adaptive propagator
+                craft->prop_step = sim->wp.time_step;
+                craft->prop_pos = craft->pos;
+                craft->prop_vel = craft->vel;
+                craft->prop_published = true;
+            }
+            continue;
+        }
+
+        if (!sim->cp.rails || craft->engine_on) continue;
+        const int b = craft->SOI_planet_id;
+        if (b < 0 || b >= gb->count) continue;
+
+        // adaptive craft are checked at their own time, with their integration state
+        const body_history_cursor_t* cursor = NULL;
+        body_history_cursor_t adaptive_cursor;
+        double t = now;
+        vec3 pos = craft->pos, vel = craft->vel;
+        if (sim->cp.adaptive) {
+            if (craft->prop_step <= 0.0 || sim->history.count == 0) continue;
+            t = craft->prop_time;
+            adaptive_cursor = body_historyLookup(&sim->history, t);
+            cursor = &adaptive_cursor;
+            pos = craft->prop_pos;
+            vel = craft->prop_vel;
+        }
+        if (craft_burnDue(craft, t, next)) continue;
+
+        vec3 body_pos, body_vel;
+        craft_bodyState(sim, cursor, b, &body_pos, &body_vel);
+        const vec3 rel_pos = vec3_sub(pos, body_pos);
+        const vec3 rel_vel = vec3_sub(vel, body_vel);
+        if (craft_periapsis(gb->soa.mu[b], rel_pos, rel_vel) <= gb->soa.radius[b]) continue; // would hit the surface
+
+        const craft_rails_check_t check = craft_railsCheck(sim, cursor, pos, b);
+        if (check.soi_body != b || check.perturbation > sim->cp.rails_threshold) continue;
+
+        craft->rails_body = b;
+        craft->rails_epoch = t;
+        craft->rails_pos = rel_pos;
+        craft->rails_vel = rel_vel;
+        craft->on_rails = true;
+        if (t != now) craft_placeOnRails(sim, craft, now);
+    }
+}
+
+// moves the craft on rails to the end of the step just taken and refreshes what the numerical path would have computed
+void craft_advanceRails(sim_properties_t* sim) {
+    body_properties_t* gb = &sim->gb;
+    spacecraft_properties_t* sc = &sim->gs;
+
+    for (int i = 0; i < sc->count; i++) {
+        spacecraft_t* craft = &sc->spacecraft[i];
+        if (!craft->on_rails) continue;
+        const int b = craft->rails_body;
+        if (b < 0 || b >= gb->count) continue;
+        craft_placeOnRails(sim, craft, sim->wp.sim_time);
+
+        const craft_rails_check_t check = craft_railsCheck(sim, NULL, craft->pos, b);
+        if (check.closest_r_squared < gb->soa.radius[check.closest] * gb->soa.radius[check.closest]) {
+            sim->wp.sim_running = false;
+            sim->wp.reset_sim = true;
+            char err_txt[128];
+            snprintf(err_txt, sizeof(err_txt), "Warning: %s has collided with %s\n\nResetting Simulation...", craft->name, gb->bodies[check.closest].name);
+            displayError("PLANET COLLISION", err_txt);
+            return;
+        }
+
+        craft->closest_planet_id = check.closest;
+        craft->closest_r_squared = check.closest_r_squared;
+        craft->SOI_planet_id = check.soi_body >= 0 ? check.soi_body : b;
+        craft->acc = check.acc;
+        craft->grav_force = vec3_scale(check.acc, craft->current_total_mass);
+        craft->vel_mag = vec3_mag(craft->vel);
+        craft_calculateOrbitalElements(craft, &gb->bodies[b]);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef CRAFT_PROPAGATOR_H
+#define CRAFT_PROPAGATOR_H
+
+#include "../types.h"
+
+#define CRAFT_HISTORY_FRAMES 4096 // body states kept for interpolation (limits how far a craft step may reach back)
+
+craft_propagation_t craft_defaultPropagation(void);
+void craft_propagateAdaptive(sim_properties_t* sim);
+void craft_publishAdaptive(sim_properties_t* sim);
+void craft_updateRails(sim_properties_t* sim);
+void craft_advanceRails(sim_properties_t* sim);
+
+#endif
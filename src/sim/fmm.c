@@ -0,0 +1,691 @@
+#include "fmm.h"
+#include "../utility/thread_pool.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// spherical harmonic expansions of the Laplace kernel (same formulation as exafmm)
+// multipole/local coefficients are stored for m >= 0 only, index n*(n+1)/2 + m
+
+typedef struct {
+    double re, im;
+} cplx_t;
+
+static inline cplx_t c_make(const double re, const double im) { return (cplx_t){re, im}; }
+static inline cplx_t c_add(const cplx_t a, const cplx_t b) { return (cplx_t){a.re + b.re, a.im + b.im}; }
+static inline cplx_t c_mul(const cplx_t a, const cplx_t b) { return (cplx_t){a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re}; }
+static inline cplx_t c_scale(const cplx_t a, const double s) { return (cplx_t){a.re * s, a.im * s}; }
+static inline cplx_t c_conj(const cplx_t a) { return (cplx_t){a.re, -a.im}; }
+
+static inline double oddOrEven(const int n) { return (n & 1) ? -1.0 : 1.0; }
+static inline double ipow2n(const int n) { return n >= 0 ? 1.0 : oddOrEven(n); }
+
+static inline int fmm_termCount(const int order) { return order * (order + 1) / 2; }
+
+// converts a cartesian offset to spherical coordinates (nudged off the z axis so 1/sin(theta) stays finite)
+static void fmm_cart2sph(double dx, const double dy, const double dz, double* r, double* theta, double* phi) {
+    const double r_sq = dx * dx + dy * dy + dz * dz;
+    if (dx * dx + dy * dy < 1e-24 * r_sq) {
+        dx += 1e-12 * sqrt(r_sq);
+    }
+    *r = sqrt(dx * dx + dy * dy + dz * dz);
+    *theta = *r == 0.0 ? 0.0 : acos(dz / *r);
+    *phi = atan2(dy, dx);
+}
+
+// regular solid harmonics r^n Y_n^m (and their theta derivative)
+static void fmm_evalMultipole(const int order, const double rho, const double alpha, const double beta, cplx_t* Ynm, cplx_t* YnmTheta) {
+    const double x = cos(alpha);
+    const double y = sin(alpha);
+    const double invY = y == 0.0 ? 0.0 : 1.0 / y;
+    double fact = 1.0;
+    double pn = 1.0;
+    double rhom = 1.0;
+    const cplx_t ei = c_make(cos(beta), sin(beta));
+    cplx_t eim = c_make(1.0, 0.0);
+
+    for (int m = 0; m < order; m++) {
+        double p = pn;
+        const int npn = m * m + 2 * m;
+        const int nmn = m * m;
+        Ynm[npn] = c_scale(eim, rhom * p);
+        Ynm[nmn] = c_conj(Ynm[npn]);
+        double p1 = p;
+        p = x * (2 * m + 1) * p1;
+        YnmTheta[npn] = c_scale(eim, rhom * (p - (m + 1) * x * p1) * invY);
+        rhom *= rho;
+        double rhon = rhom;
+        for (int n = m + 1; n < order; n++) {
+            const int npm = n * n + n + m;
+            const int nmm = n * n + n - m;
+            rhon /= -(n + m);
+            Ynm[npm] = c_scale(eim, rhon * p);
+            Ynm[nmm] = c_conj(Ynm[npm]);
+            const double p2 = p1;
+            p1 = p;
+            p = (x * (2 * n + 1) * p1 - (n + m) * p2) / (n - m + 1);
+            YnmTheta[npm] = c_scale(eim, rhon * ((n - m + 1) * p - (n + 1) * x * p1) * invY);
+            rhon *= rho;
+        }
+        rhom /= -(2 * m + 2) * (2 * m + 1);
+        pn = -pn * fact * y;
+        fact += 2.0;
+        eim = c_mul(eim, ei);
+    }
+}
+
+// singular solid harmonics r^(-n-1) Y_n^m
+static void fmm_evalLocal(const int order, const double rho, const double alpha, const double beta, cplx_t* Ynm) {
+    const double x = cos(alpha);
+    const double y = sin(alpha);
+    double fact = 1.0;
+    double pn = 1.0;
+    const double invR = -1.0 / rho;
+    double rhom = -invR;
+    const cplx_t ei = c_make(cos(beta), sin(beta));
+    cplx_t eim = c_make(1.0, 0.0);
+
+    for (int m = 0; m < order; m++) {
+        double p = pn;
+        const int npn = m * m + 2 * m;
+        const int nmn = m * m;
+        Ynm[npn] = c_scale(eim, rhom * p);
+        Ynm[nmn] = c_conj(Ynm[npn]);
+        double p1 = p;
+        p = x * (2 * m + 1) * p1;
+        rhom *= invR;
+        double rhon = rhom;
+        for (int n = m + 1; n < order; n++) {
+            const int npm = n * n + n + m;
+            const int nmm = n * n + n - m;
+            Ynm[npm] = c_scale(eim, rhon * p);
+            Ynm[nmm] = c_conj(Ynm[npm]);
+            const double p2 = p1;
+            p1 = p;
+            p = (x * (2 * n + 1) * p1 - (n + m) * p2) / (n - m + 1);
+            rhon *= invR * (n - m + 1);
+        }
+        pn = -pn * fact * y;
+        fact += 2.0;
+        eim = c_mul(eim, ei);
+    }
+}
+
+static inline cplx_t* fmm_multipole(const fmm_tree_t* tree, const int cell) {
+    return (cplx_t*)&tree->multipole[(size_t)cell * 2 * fmm_termCount(tree->order)];
+}
+
+static inline cplx_t* fmm_local(const fmm_tree_t* tree, const int cell) {
+    return (cplx_t*)&tree->local[(size_t)cell * 2 * fmm_termCount(tree->order)];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// TREE CONSTRUCTION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int fmm_newCell(fmm_tree_t* tree) {
+    if (tree->cell_count >= tree->cell_capacity) {
+        const int new_capacity = tree->cell_capacity == 0 ? 64 : tree->cell_capacity * 2;
+        fmm_cell_t* temp = (fmm_cell_t*)realloc(tree->cells, new_capacity * sizeof(fmm_cell_t));
+        if (temp == NULL) {
+            return -1;
+        }
+        tree->cells = temp;
+        tree->cell_capacity = new_capacity;
+    }
+    fmm_cell_t* cell = &tree->cells[tree->cell_count];
+    memset(cell, 0, sizeof(*cell));
+    cell->first_child = -1;
+    return tree->cell_count++;
+}
+
+static inline int fmm_octant(const body_soa_t* soa, const int b, const double cx, const double cy, const double cz) {
+    return (soa->pos_x[b] >= cx ? 1 : 0) | (soa->pos_y[b] >= cy ? 2 : 0) | (soa->pos_z[b] >= cz ? 4 : 0);
+}
+
+// splits a cell into its non-empty octants -- children of a cell are stored next to each other
+// so the traversal can walk them as [first_child, first_child + child_count)
+static bool fmm_splitCell(fmm_tree_t* tree, const body_soa_t* soa, const int cell_idx, const int depth) {
+    const fmm_cell_t cell = tree->cells[cell_idx];
+    if (cell.end - cell.begin <= tree->leaf_size || depth >= 48) {
+        return true;
+    }
+
+    int octant_count[8] = {0};
+    for (int k = cell.begin; k < cell.end; k++) {
+        octant_count[fmm_octant(soa, tree->index[k], cell.x, cell.y, cell.z)]++;
+    }
+    int octant_start[8];
+    int fill[8];
+    int offset = cell.begin;
+    for (int c = 0; c < 8; c++) {
+        octant_start[c] = offset;
+        fill[c] = offset;
+        offset += octant_count[c];
+    }
+    for (int k = cell.begin; k < cell.end; k++) {
+        const int b = tree->index[k];
+        tree->scratch[fill[fmm_octant(soa, b, cell.x, cell.y, cell.z)]++] = b;
+    }
+    memcpy(&tree->index[cell.begin], &tree->scratch[cell.begin], (cell.end - cell.begin) * sizeof(int));
+
+    // allocate all children first so they are contiguous
+    int first_child = -1;
+    int child_count = 0;
+    const double child_half = 0.5 * cell.half_size;
+    for (int c = 0; c < 8; c++) {
+        if (octant_count[c] == 0) continue;
+        const int child_idx = fmm_newCell(tree);
+        if (child_idx < 0) return false;
+        if (first_child < 0) first_child = child_idx;
+        child_count++;
+
+        fmm_cell_t* child = &tree->cells[child_idx];
+        child->x = cell.x + ((c & 1) ? child_half : -child_half);
+        child->y = cell.y + ((c & 2) ? child_half : -child_half);
+        child->z = cell.z + ((c & 4) ? child_half : -child_half);
+        child->half_size = child_half;
+        child->radius = child_half * sqrt(3.0);
+        child->begin = octant_start[c];
+        child->end = octant_start[c] + octant_count[c];
+        child->parent = cell_idx;
+    }
+    tree->cells[cell_idx].first_child = first_child;
+    tree->cells[cell_idx].child_count = child_count;
+
+    for (int c = 0; c < child_count; c++) {
+        if (!fmm_splitCell(tree, soa, first_child + c, depth + 1)) return false;
+    }
+    return true;
+}
+
+static bool fmm_buildTree(fmm_tree_t* tree, const body_soa_t* soa, const int count) {
+    tree->cell_count = 0;
+
+    if (count > tree->index_capacity) {
+        int* index = (int*)realloc(tree->index, count * sizeof(int));
+        if (index == NULL) return false;
+        tree->index = index;
+        int* scratch = (int*)realloc(tree->scratch, count * sizeof(int));
+        if (scratch == NULL) return false;
+        tree->scratch = scratch;
+        tree->index_capacity = count;
+    }
+    for (int i = 0; i < count; i++) {
+        tree->index[i] = i;
+    }
+
+    double min_x = soa->pos_x[0], max_x = soa->pos_x[0];
+    double min_y = soa->pos_y[0], max_y = soa->pos_y[0];
+    double min_z = soa->pos_z[0], max_z = soa->pos_z[0];
+    for (int i = 1; i < count; i++) {
+        min_x = fmin(min_x, soa->pos_x[i]); max_x = fmax(max_x, soa->pos_x[i]);
+        min_y = fmin(min_y, soa->pos_y[i]); max_y = fmax(max_y, soa->pos_y[i]);
+        min_z = fmin(min_z, soa->pos_z[i]); max_z = fmax(max_z, soa->pos_z[i]);
+    }
+    const double half = 0.5 * fmax(max_x - min_x, fmax(max_y - min_y, max_z - min_z)) * 1.0001 + 1.0;
+
+    const int root = fmm_newCell(tree);
+    if (root < 0) return false;
+    fmm_cell_t* cell = &tree->cells[root];
+    cell->x = 0.5 * (min_x + max_x);
+    cell->y = 0.5 * (min_y + max_y);
+    cell->z = 0.5 * (min_z + max_z);
+    cell->half_size = half;
+    cell->radius = half * sqrt(3.0);
+    cell->begin = 0;
+    cell->end = count;
+    cell->parent = -1;
+
+    if (!fmm_splitCell(tree, soa, root, 0)) return false;
+
+    // expansion storage for every cell
+    const size_t coeffs = (size_t)tree->cell_count * 2 * fmm_termCount(tree->order);
+    if (coeffs > tree->coeff_capacity) {
+        double* multipole = (double*)realloc(tree->multipole, coeffs * sizeof(double));
+        if (multipole == NULL) return false;
+        tree->multipole = multipole;
+        double* local = (double*)realloc(tree->local, coeffs * sizeof(double));
+        if (local == NULL) return false;
+        tree->local = local;
+        tree->coeff_capacity = coeffs;
+    }
+    memset(tree->multipole, 0, coeffs * sizeof(double));
+    memset(tree->local, 0, coeffs * sizeof(double));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// KERNELS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// bodies -> multipole of a leaf
+static void fmm_P2M(fmm_tree_t* tree, const body_soa_t* soa, const int cell_idx) {
+    const int P = tree->order;
+    const fmm_cell_t* cell = &tree->cells[cell_idx];
+    cplx_t* M = fmm_multipole(tree, cell_idx);
+    cplx_t Ynm[FMM_MAX_ORDER * FMM_MAX_ORDER], YnmTheta[FMM_MAX_ORDER * FMM_MAX_ORDER];
+
+    for (int k = cell->begin; k < cell->end; k++) {
+        const int b = tree->index[k];
+        double rho, alpha, beta;
+        fmm_cart2sph(soa->pos_x[b] - cell->x, soa->pos_y[b] - cell->y, soa->pos_z[b] - cell->z, &rho, &alpha, &beta);
+        fmm_evalMultipole(P, rho, alpha, -beta, Ynm, YnmTheta);
+        for (int n = 0; n < P; n++) {
+            for (int m = 0; m <= n; m++) {
+                const int nm = n * n + n + m;
+                const int nms = n * (n + 1) / 2 + m;
+                M[nms] = c_add(M[nms], c_scale(Ynm[nm], soa->mu[b]));
+            }
+        }
+    }
+}
+
+// children multipoles -> parent multipole
+static void fmm_M2M(fmm_tree_t* tree, const int cell_idx) {
+    const int P = tree->order;
+    const fmm_cell_t* ci = &tree->cells[cell_idx];
+    cplx_t* Mi = fmm_multipole(tree, cell_idx);
+    cplx_t Ynm[FMM_MAX_ORDER * FMM_MAX_ORDER], YnmTheta[FMM_MAX_ORDER * FMM_MAX_ORDER];
+
+    for (int c = 0; c < ci->child_count; c++) {
+        const int child_idx = ci->first_child + c;
+        const fmm_cell_t* cj = &tree->cells[child_idx];
+        const cplx_t* Mj = fmm_multipole(tree, child_idx);
+        double rho, alpha, beta;
+        fmm_cart2sph(ci->x - cj->x, ci->y - cj->y, ci->z - cj->z, &rho, &alpha, &beta);
+        fmm_evalMultipole(P, rho, alpha, beta, Ynm, YnmTheta);
+
+        for (int j = 0; j < P; j++) {
+            for (int k = 0; k <= j; k++) {
+                const int jks = j * (j + 1) / 2 + k;
+                cplx_t M = c_make(0.0, 0.0);
+                for (int n = 0; n <= j; n++) {
+                    const int m_lo = (-n > -j + k + n) ? -n : -j + k + n;
+                    const int m_hi = (k - 1 < n) ? k - 1 : n;
+                    for (int m = m_lo; m <= m_hi; m++) {
+                        const int jnkms = (j - n) * (j - n + 1) / 2 + k - m;
+                        const int nm = n * n + n - m;
+                        M = c_add(M, c_scale(c_mul(Mj[jnkms], Ynm[nm]), ipow2n(m) * oddOrEven(n)));
+                    }
+                    const int m_top = (n < j + k - n) ? n : j + k - n;
+                    for (int m = k; m <= m_top; m++) {
+                        const int jnkms = (j - n) * (j - n + 1) / 2 - k + m;
+                        const int nm = n * n + n - m;
+                        M = c_add(M, c_scale(c_mul(c_conj(Mj[jnkms]), Ynm[nm]), oddOrEven(k + n + m)));
+                    }
+                }
+                Mi[jks] = c_add(Mi[jks], M);
+            }
+        }
+    }
+}
+
+// source multipole -> target local expansion
+static void fmm_M2L(fmm_tree_t* tree, const int target_idx, const int source_idx) {
+    const int P = tree->order;
+    const fmm_cell_t* ci = &tree->cells[target_idx];
+    const fmm_cell_t* cj = &tree->cells[source_idx];
+    const cplx_t* Mj = fmm_multipole(tree, source_idx);
+    cplx_t* Li = fmm_local(tree, target_idx);
+    cplx_t Ynm[FMM_MAX_ORDER * FMM_MAX_ORDER];
+
+    double rho, alpha, beta;
+    fmm_cart2sph(ci->x - cj->x, ci->y - cj->y, ci->z - cj->z, &rho, &alpha, &beta);
+    fmm_evalLocal(P, rho, alpha, beta, Ynm);
+
+    for (int j = 0; j < P; j++) {
+        const double Cnm = oddOrEven(j);
+        for (int k = 0; k <= j; k++) {
+            const int jks = j * (j + 1) / 2 + k;
+            cplx_t L = c_make(0.0, 0.0);
+            for (int n = 0; n < P - j; n++) {
+                for (int m = -n; m < 0; m++) {
+                    const int nms = n * (n + 1) / 2 - m;
+                    const int jnkm = (j + n) * (j + n) + j + n + m - k;
+                    L = c_add(L, c_scale(c_mul(c_conj(Mj[nms]), Ynm[jnkm]), Cnm));
+                }
+                for (int m = 0; m <= n; m++) {
+                    const int nms = n * (n + 1) / 2 + m;
+                    const int jnkm = (j + n) * (j + n) + j + n + m - k;
+                    const double Cnm2 = Cnm * oddOrEven((k - m) * (k < m) + m);
+                    L = c_add(L, c_scale(c_mul(Mj[nms], Ynm[jnkm]), Cnm2));
+                }
+            }
+            Li[jks] = c_add(Li[jks], L);
+        }
+    }
+}
+
+// parent local expansion -> children local expansions
+static void fmm_L2L(fmm_tree_t* tree, const int cell_idx) {
+    const int P = tree->order;
+    const fmm_cell_t* cj = &tree->cells[cell_idx];
+    const cplx_t* Lj = fmm_local(tree, cell_idx);
+    cplx_t Ynm[FMM_MAX_ORDER * FMM_MAX_ORDER], YnmTheta[FMM_MAX_ORDER * FMM_MAX_ORDER];
+
+    for (int c = 0; c < cj->child_count; c++) {
+        const int child_idx = cj->first_child + c;
+        const fmm_cell_t* ci = &tree->cells[child_idx];
+        cplx_t* Li = fmm_local(tree, child_idx);
+        double rho, alpha, beta;
+        fmm_cart2sph(ci->x - cj->x, ci->y - cj->y, ci->z - cj->z, &rho, &alpha, &beta);
+        fmm_evalMultipole(P, rho, alpha, beta, Ynm, YnmTheta);
+
+        for (int j = 0; j < P; j++) {
+            for (int k = 0; k <= j; k++) {
+                const int jks = j * (j + 1) / 2 + k;
+                cplx_t L = c_make(0.0, 0.0);
+                for (int n = j; n < P; n++) {
+                    for (int m = j + k - n; m < 0; m++) {
+                        const int jnkm = (n - j) * (n - j) + n - j + m - k;
+                        const int nms = n * (n + 1) / 2 - m;
+                        L = c_add(L, c_scale(c_mul(c_conj(Lj[nms]), Ynm[jnkm]), oddOrEven(k)));
+                    }
+                    for (int m = 0; m <= n; m++) {
+                        if (n - j >= abs(m - k)) {
+                            const int jnkm = (n - j) * (n - j) + n - j + m - k;
+                            const int nms = n * (n + 1) / 2 + m;
+                            L = c_add(L, c_scale(c_mul(Lj[nms], Ynm[jnkm]), oddOrEven((m - k) * (m < k))));
+                        }
+                    }
+                }
+                Li[jks] = c_add(Li[jks], L);
+            }
+        }
+    }
+}
+
+// local expansion of a leaf -> accelerations of its bodies
+static void fmm_L2P(const fmm_tree_t* tree, const body_soa_t* soa, const int cell_idx, double* acc_x, double* acc_y, double* acc_z) {
+    const int P = tree->order;
+    const fmm_cell_t* cell = &tree->cells[cell_idx];
+    const cplx_t* L = fmm_local(tree, cell_idx);
+    cplx_t Ynm[FMM_MAX_ORDER * FMM_MAX_ORDER], YnmTheta[FMM_MAX_ORDER * FMM_MAX_ORDER];
+
+    for (int k = cell->begin; k < cell->end; k++) {
+        const int b = tree->index[k];
+        double r, theta, phi;
+        double dx = soa->pos_x[b] - cell->x;
+        const double dy = soa->pos_y[b] - cell->y, dz = soa->pos_z[b] - cell->z;
+
+        // a body on the expansion center is nudged off it (the gradient below divides by r), the local
+        // expansion is smooth there so the nudge changes nothing measurable
+        const double nudge = 1e-12 * (cell->half_size > 0.0 ? cell->half_size : 1.0);
+        if (dx * dx + dy * dy + dz * dz < nudge * nudge) dx += dx < 0.0 ? -nudge : nudge;
+        fmm_cart2sph(dx, dy, dz, &r, &theta, &phi);
+        fmm_evalMultipole(P, r, theta, phi, Ynm, YnmTheta);
+
+        // gradient of the potential in spherical coordinates
+        double sph_r = 0.0, sph_theta = 0.0, sph_phi = 0.0;
+        for (int n = 0; n < P; n++) {
+            int nm = n * n + n;
+            int nms = n * (n + 1) / 2;
+            sph_r += c_mul(L[nms], Ynm[nm]).re / r * n;
+            sph_theta += c_mul(L[nms], YnmTheta[nm]).re;
+            for (int m = 1; m <= n; m++) {
+                nm = n * n + n + m;
+                nms = n * (n + 1) / 2 + m;
+                const cplx_t LY = c_mul(L[nms], Ynm[nm]);
+                sph_r += 2.0 * LY.re / r * n;
+                sph_theta += 2.0 * c_mul(L[nms], YnmTheta[nm]).re;
+                sph_phi += 2.0 * -LY.im * m; // Re(L * Y * i)
+            }
+        }
+
+        // spherical -> cartesian gradient
+        const double st = sin(theta), ct = cos(theta), sp = sin(phi), cp = cos(phi);
+        acc_x[b] += st * cp * sph_r + ct * cp / r * sph_theta - sp / r / st * sph_phi;
+        acc_y[b] += st * sp * sph_r + ct * sp / r * sph_theta + cp / r / st * sph_phi;
+        acc_z[b] += ct * sph_r - st / r * sph_theta;
+    }
+}
+
+// direct interaction between the bodies of two leaves (targets only)
+static bool fmm_P2P(const fmm_tree_t* tree, const body_soa_t* soa, const int target_idx, const int source_idx,
+                    const double eps_sq, double* acc_x, double* acc_y, double* acc_z, int* collided_i, int* collided_j) {
+    const fmm_cell_t* ci = &tree->cells[target_idx];
+    const fmm_cell_t* cj = &tree->cells[source_idx];
+
+    for (int a = ci->begin; a < ci->end; a++) {
+        const int i = tree->index[a];
+        const double px = soa->pos_x[i], py = soa->pos_y[i], pz = soa->pos_z[i];
+        const double radius_sq = soa->radius[i] * soa->radius[i];
+        double ax = 0.0, ay = 0.0, az = 0.0;
+        for (int b = cj->begin; b < cj->end; b++) {
+            const int j = tree->index[b];
+            if (j == i) continue;
+            const double dx = soa->pos_x[j] - px;
+            const double dy = soa->pos_y[j] - py;
+            const double dz = soa->pos_z[j] - pz;
+            const double r_sq = dx * dx + dy * dy + dz * dz;
+            if (r_sq < radius_sq) {
+                *collided_i = i;
+                *collided_j = j;
+                return false;
+            }
+            const double s_sq = r_sq + eps_sq;
+            if (s_sq == 0.0) continue;
+            const double inv_r3 = 1.0 / (s_sq * sqrt(s_sq));
+            ax += soa->mu[j] * dx * inv_r3;
+            ay += soa->mu[j] * dy * inv_r3;
+            az += soa->mu[j] * dz * inv_r3;
+        }
+        acc_x[i] += ax;
+        acc_y[i] += ay;
+        acc_z[i] += az;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// PASSES
+////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    fmm_tree_t* tree;
+    double theta_sq;
+    bool failed; // out of memory for the interaction list
+} fmm_traversal_t;
+
+// work shared by the pool threads (thread_index 0 is the calling thread)
+typedef struct {
+    fmm_tree_t* tree;
+    const body_soa_t* soa;
+    double eps_sq;
+    double* acc_x;
+    double* acc_y;
+    double* acc_z;
+    int collided_i[POOL_MAX_THREADS];
+    int collided_j[POOL_MAX_THREADS];
+} fmm_task_t;
+
+static void fmm_addInteraction(fmm_traversal_t* t, const int target_idx, const int source_idx, const bool direct) {
+    fmm_tree_t* tree = t->tree;
+    if (tree->interaction_count == tree->interaction_capacity) {
+        const int capacity = tree->interaction_capacity > 0 ? 2 * tree->interaction_capacity : 1024;
+        fmm_interaction_t* temp = (fmm_interaction_t*)realloc(tree->interactions, (size_t)capacity * sizeof(fmm_interaction_t));
+        if (temp == NULL) {
+            t->failed = true;
+            return;
+        }
+        tree->interactions = temp;
+        tree->interaction_capacity = capacity;
+    }
+    tree->interactions[tree->interaction_count++] = (fmm_interaction_t){target_idx, source_idx, direct};
+}
+
+// dual tree traversal: well separated cell pairs use M2L, touching leaves use P2P
+// only the pairs are listed here, the kernels run afterwards on the pool
+static void fmm_traverse(fmm_traversal_t* t, const int target_idx, const int source_idx) {
+    if (t->failed) return;
+
+    const fmm_cell_t* ci = &t->tree->cells[target_idx];
+    const fmm_cell_t* cj = &t->tree->cells[source_idx];
+    const double dx = ci->x - cj->x;
+    const double dy = ci->y - cj->y;
+    const double dz = ci->z - cj->z;
+    const double r_sq = dx * dx + dy * dy + dz * dz;
+    const double reach = ci->radius + cj->radius;
+
+    if (r_sq * t->theta_sq > reach * reach) {
+        fmm_addInteraction(t, target_idx, source_idx, false);
+    } else if (ci->child_count == 0 && cj->child_count == 0) {
+        fmm_addInteraction(t, target_idx, source_idx, true);
+    } else if (cj->child_count == 0 || (ci->child_count > 0 && ci->radius >= cj->radius)) {
+        const int first = ci->first_child, count = ci->child_count;
+        for (int c = 0; c < count; c++) {
+            fmm_traverse(t, first + c, source_idx);
+        }
+    } else {
+        const int first = cj->first_child, count = cj->child_count;
+        for (int c = 0; c < count; c++) {
+            fmm_traverse(t, target_idx, first + c);
+        }
+    }
+}
+
+// stable counting sort of the interactions by target cell, so every target keeps its traversal order
+// (and the sums come out the same for any number of threads)
+static bool fmm_groupInteractions(fmm_tree_t* tree) {
+    if (tree->cell_count + 1 > tree->target_capacity) {
+        int* start = (int*)realloc(tree->target_start, (size_t)(tree->cell_count + 1) * sizeof(int));
+        if (start == NULL) return false;
+        tree->target_start = start;
+        tree->target_capacity = tree->cell_count + 1;
+    }
+    fmm_interaction_t* grouped = (fmm_interaction_t*)realloc(tree->grouped, (size_t)tree->interaction_capacity * sizeof(fmm_interaction_t));
+    if (grouped == NULL && tree->interaction_capacity > 0) return false;
+    tree->grouped = grouped;
+
+    int* start = tree->target_start;
+    memset(start, 0, (size_t)(tree->cell_count + 1) * sizeof(int));
+    for (int k = 0; k < tree->interaction_count; k++) {
+        start[tree->interactions[k].target + 1]++;
+    }
+    for (int c = 0; c < tree->cell_count; c++) {
+        start[c + 1] += start[c];
+    }
+    // start[c] is used as the fill position of cell c and ends up at the beginning of cell c + 1, shifted back after
+    for (int k = 0; k < tree->interaction_count; k++) {
+        tree->grouped[start[tree->interactions[k].target]++] = tree->interactions[k];
+    }
+    for (int c = tree->cell_count; c > 0; c--) {
+        start[c] = start[c - 1];
+    }
+    start[0] = 0;
+    return true;
+}
+
+// multipoles of the leaves, each thread takes every thread_count-th cell
+static void fmm_P2MTask(void* ctx, const int thread_index, const int thread_count) {
+    fmm_task_t* task = (fmm_task_t*)ctx;
+    for (int c = thread_index; c < task->tree->cell_count; c += thread_count) {
+        if (task->tree->cells[c].child_count == 0) fmm_P2M(task->tree, task->soa, c);
+    }
+}
+
+// M2L and P2P: a target cell (its local expansion and its bodies) belongs to exactly one thread
+static void fmm_interactionTask(void* ctx, const int thread_index, const int thread_count) {
+    fmm_task_t* task = (fmm_task_t*)ctx;
+    fmm_tree_t* tree = task->tree;
+    for (int c = thread_index; c < tree->cell_count; c += thread_count) {
+        for (int k = tree->target_start[c]; k < tree->target_start[c + 1]; k++) {
+            const fmm_interaction_t* pair = &tree->grouped[k];
+            if (!pair->direct) {
+                fmm_M2L(tree, c, pair->source);
+            }
+            else if (!fmm_P2P(tree, task->soa, c, pair->source, task->eps_sq, task->acc_x, task->acc_y, task->acc_z,
+                              &task->collided_i[thread_index], &task->collided_j[thread_index])) {
+                return;
+            }
+        }
+    }
+}
+
+// local expansions of the leaves -> accelerations of their bodies
+static void fmm_L2PTask(void* ctx, const int thread_index, const int thread_count) {
+    fmm_task_t* task = (fmm_task_t*)ctx;
+    for (int c = thread_index; c < task->tree->cell_count; c += thread_count) {
+        if (task->tree->cells[c].child_count == 0) fmm_L2P(task->tree, task->soa, c, task->acc_x, task->acc_y, task->acc_z);
+    }
+}
+
+static void fmm_run(worker_pool_t* pool, const pool_task_fn fn, fmm_task_t* task) {
+    if (pool != NULL) pool_run(pool, fn, task);
+    else fn(task, 0, 1);
+}
+
+// calculates the gravitational acceleration of every body with the fast multipole method
+// acc arrays must hold count entries; returns false if two bodies collided (reported in collided_i/j)
+// or the tree could not be allocated. the kernels run on pool when it is not NULL
+bool fmm_calculateAccelerations(fmm_tree_t* tree, const body_soa_t* soa, const int count,
+                                const gravity_params_t* gp, worker_pool_t* pool, double* acc_x, double* acc_y, double* acc_z,
+                                int* collided_i, int* collided_j) {
+    for (int i = 0; i < count; i++) {
+        acc_x[i] = 0.0;
+        acc_y[i] = 0.0;
+        acc_z[i] = 0.0;
+    }
+    if (count <= 0) return true;
+
+    tree->order = gp->fmm_order < 2 ? 2 : (gp->fmm_order > FMM_MAX_ORDER ? FMM_MAX_ORDER : gp->fmm_order);
+    tree->leaf_size = gp->fmm_leaf_size < 1 ? 1 : gp->fmm_leaf_size;
+    if (!fmm_buildTree(tree, soa, count)) {
+        return false;
+    }
+
+    const int thread_count = pool != NULL ? pool->thread_count : 1;
+    fmm_task_t task = {
+        .tree = tree,
+        .soa = soa,
+        .eps_sq = gp->softening * gp->softening,
+        .acc_x = acc_x, .acc_y = acc_y, .acc_z = acc_z
+    };
+    for (int t = 0; t < thread_count; t++) {
+        task.collided_i[t] = -1;
+        task.collided_j[t] = -1;
+    }
+
+    // upward pass -- cells are created parent first, so walking backwards visits children before parents
+    fmm_run(pool, fmm_P2MTask, &task);
+    for (int c = tree->cell_count - 1; c >= 0; c--) {
+        if (tree->cells[c].child_count > 0) fmm_M2M(tree, c);
+    }
+
+    // interaction lists
+    fmm_traversal_t t = {
+        .tree = tree,
+        .theta_sq = gp->theta * gp->theta,
+        .failed = false
+    };
+    tree->interaction_count = 0;
+    fmm_traverse(&t, 0, 0);
+    if (t.failed || !fmm_groupInteractions(tree)) return false;
+
+    fmm_run(pool, fmm_interactionTask, &task);
+    for (int th = 0; th < thread_count; th++) {
+        if (task.collided_i[th] >= 0) {
+            *collided_i = task.collided_i[th];
+            *collided_j = task.collided_j[th];
+            return false;
+        }
+    }
+
+    // downward pass -- every parent hands its local expansion down before the leaves are evaluated
+    for (int c = 0; c < tree->cell_count; c++) {
+        if (tree->cells[c].child_count > 0) fmm_L2L(tree, c);
+    }
+    fmm_run(pool, fmm_L2PTask, &task);
+    return true;
+}
+
+// frees the tree workspace
+void fmm_freeTree(fmm_tree_t* tree) {
+    free(tree->cells);
+    free(tree->index);
+    free(tree->scratch);
+    free(tree->multipole);
+    free(tree->local);
+    free(tree->interactions);
+    free(tree->grouped);
+    free(tree->target_start);
+    *tree = (fmm_tree_t){0};
+}
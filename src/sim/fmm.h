@@ -0,0 +1,13 @@
+#ifndef FMM_H
+#define FMM_H
+
+#include "../types.h"
+
+#define FMM_MAX_ORDER 16
+
+bool fmm_calculateAccelerations(fmm_tree_t* tree, const body_soa_t* soa, int count,
+                                const gravity_params_t* gp, worker_pool_t* pool, double* acc_x, double* acc_y, double* acc_z,
+                                int* collided_i, int* collided_j);
+void fmm_freeTree(fmm_tree_t* tree);
+
+#endif
@@ -0,0 +1,370 @@
+#include "gravity.h"
+#include "bodies.h"
+#include "barnes_hut.h"
+#include "fmm.h"
+#include "gravity_simd.h"
+#include "../utility/thread_pool.h"
+#include "../globals.h"
+#include "../math/matrix.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../utility/error_hook.h"
+
+#define GRAVITY_PARALLEL_MIN_BODIES 512 // below this the pool costs more than it saves
+#define GRAVITY_TILE_ROWS 32             // rows of the pair loop handed out at a time
+
+// default solver settings (direct summation until a scenario or the console asks otherwise)
+gravity_params_t gravity_defaultParams(void) {
+    return (gravity_params_t){
+        .solver = GRAVITY_DIRECT,
+        .simd_level = simd_detectLevel(),
+        .theta = 0.5,
+        .softening = 0.0,
+        .fmm_order = 6,
+        .fmm_leaf_size = 64
+    };
+}
+
+const char* gravity_solverName(const gravity_solver_t solver) {
+    switch (solver) {
+        case GRAVITY_BARNES_HUT: return "barnes-hut";
+        case GRAVITY_FMM: return "fmm";
+        case GRAVITY_DIRECT:
+        default: return "direct";
+    }
+}
+
+// accepts the names used by the console and the scenario json
+bool gravity_parseSolverName(const char* name, gravity_solver_t* solver) {
+    if (strcmp(name, "direct") == 0) {
+        *solver = GRAVITY_DIRECT;
+        return true;
+    }
+    if (strcmp(name, "barnes-hut") == 0 || strcmp(name, "barnes_hut") == 0 || strcmp(name, "bh") == 0) {
+        *solver = GRAVITY_BARNES_HUT;
+        return true;
+    }
+    if (strcmp(name, "fmm") == 0) {
+        *solver = GRAVITY_FMM;
+        return true;
+    }
+    return false;
+}
+
+// stops the sim and tells the user that body i ran into body j
+void gravity_reportCollision(sim_properties_t* sim, const int i, const int j) {
+    sim->wp.sim_running = false;
+    sim->wp.reset_sim = true;
+    char err_txt[128];
+    snprintf(err_txt, sizeof(err_txt), "Warning: %s has collided with %s\n\nResetting Simulation...", sim->gb.bodies[i].name, sim->gb.bodies[j].name);
+    displayError("PLANET COLLISION", err_txt);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// PARALLEL FORCE LOOPS
+////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    body_soa_t* soa;
+    int count;
+    simd_pair_kernel_t kernel;
+    double* buffers;       // one 3 * count force buffer per thread
+    const bh_tree_t* tree;
+    double softening;
+    int collided_i[POOL_MAX_THREADS];
+    int collided_j[POOL_MAX_THREADS];
+} gravity_task_t;
+
+// (re)creates the worker pool when the requested thread count changes
+// must only be called from the thread that runs the physics
+void gravity_updateThreadPool(sim_properties_t* sim) {
+    int wanted = sim->thread_count > 0 ? sim->thread_count : pool_hardwareThreads();
+    if (wanted > POOL_MAX_THREADS) wanted = POOL_MAX_THREADS;
+
+    if (sim->pool != NULL && sim->pool->thread_count == wanted) return;
+
+    pool_destroy(sim->pool);
+    sim->pool = wanted > 1 ? pool_create(wanted) : NULL;
+}
+
+// pair loop tiles: every thread takes every thread_count-th tile of rows and accumulates into its own buffer
+static void gravity_pairTask(void* ctx, const int thread_index, const int thread_count) {
+    gravity_task_t* task = (gravity_task_t*)ctx;
+    const int n = task->count;
+    double* fx = task->buffers + (size_t)thread_index * 3 * n;
+    double* fy = fx + n;
+    double* fz = fy + n;
+    memset(fx, 0, 3 * (size_t)n * sizeof(double));
+
+    const int tile_count = (n + GRAVITY_TILE_ROWS - 1) / GRAVITY_TILE_ROWS;
+    for (int tile = thread_index; tile < tile_count; tile += thread_count) {
+        const int row_begin = tile * GRAVITY_TILE_ROWS;
+        const int row_end = row_begin + GRAVITY_TILE_ROWS < n ? row_begin + GRAVITY_TILE_ROWS : n;
+        if (!task->kernel(task->soa, n, row_begin, row_end, fx, fy, fz,
+                          &task->collided_i[thread_index], &task->collided_j[thread_index])) {
+            return;
+        }
+    }
+}
+
+// sums the per-thread buffers into the body forces (every thread reduces its own slice of bodies)
+static void gravity_reduceTask(void* ctx, const int thread_index, const int thread_count) {
+    gravity_task_t* task = (gravity_task_t*)ctx;
+    body_soa_t* soa = task->soa;
+    const int n = task->count;
+    const int begin = (int)((long long)n * thread_index / thread_count);
+    const int end = (int)((long long)n * (thread_index + 1) / thread_count);
+
+    for (int i = begin; i < end; i++) {
+        double fx = 0.0, fy = 0.0, fz = 0.0;
+        for (int t = 0; t < thread_count; t++) {
+            const double* buffer = task->buffers + (size_t)t * 3 * n;
+            fx += buffer[i];
+            fy += buffer[n + i];
+            fz += buffer[2 * n + i];
+        }
+        soa->force_x[i] = fx;
+        soa->force_y[i] = fy;
+        soa->force_z[i] = fz;
+    }
+}
+
+// Barnes-Hut tree walks: bodies are independent, so each thread writes the forces of its own tiles
+static void gravity_treeTask(void* ctx, const int thread_index, const int thread_count) {
+    gravity_task_t* task = (gravity_task_t*)ctx;
+    body_soa_t* soa = task->soa;
+    const int n = task->count;
+
+    const int tile_count = (n + GRAVITY_TILE_ROWS - 1) / GRAVITY_TILE_ROWS;
+    for (int tile = thread_index; tile < tile_count; tile += thread_count) {
+        const int begin = tile * GRAVITY_TILE_ROWS;
+        const int end = begin + GRAVITY_TILE_ROWS < n ? begin + GRAVITY_TILE_ROWS : n;
+        for (int i = begin; i < end; i++) {
+            vec3 acc;
+            int other = -1;
+            if (!bh_calculateAcceleration(task->tree, soa, i, task->softening, &acc, &other)) {
+                task->collided_i[thread_index] = i;
+                task->collided_j[thread_index] = other;
+                return;
+            }
+            soa->force_x[i] = acc.x * soa->mass[i];
+            soa->force_y[i] = acc.y * soa->mass[i];
+            soa->force_z[i] = acc.z * soa->mass[i];
+        }
+    }
+}
+
+// runs a force task on the pool, returns false and reports the first collision any thread found
+static bool gravity_runTask(sim_properties_t* sim, gravity_task_t* task, const pool_task_fn fn) {
+    const int thread_count = sim->pool->thread_count;
+    for (int t = 0; t < thread_count; t++) {
+        task->collided_i[t] = -1;
+        task->collided_j[t] = -1;
+    }
+
+    pool_run(sim->pool, fn, task);
+
+    for (int t = 0; t < thread_count; t++) {
+        if (task->collided_i[t] >= 0) {
+            gravity_reportCollision(sim, task->collided_i[t], task->collided_j[t]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// makes sure every thread has a 3 * count force buffer
+static bool gravity_reserveForceBuffers(sim_properties_t* sim, const int thread_count, const int count) {
+    const size_t needed = (size_t)thread_count * 3 * count;
+    if (needed <= sim->force_buffers.capacity) return true;
+
+    double* temp = (double*)realloc(sim->force_buffers.data, needed * sizeof(double));
+    if (temp == NULL) return false;
+    sim->force_buffers.data = temp;
+    sim->force_buffers.capacity = needed;
+    return true;
+}
+
+// frees the pool and its buffers
+void gravity_freeWorkspace(sim_properties_t* sim) {
+    pool_destroy(sim->pool);
+    sim->pool = NULL;
+    free(sim->force_buffers.data);
+    sim->force_buffers = (thread_force_buffer_t){0};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// SOLVER DISPATCH
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// calculates the gravitational force on every body with the selected solver
+void gravity_calculateForces(sim_properties_t* sim) {
+    body_properties_t* gb = &sim->gb;
+    body_soa_t* soa = &gb->soa;
+
+    gravity_updateThreadPool(sim);
+    const bool parallel = sim->pool != NULL && gb->count >= GRAVITY_PARALLEL_MIN_BODIES;
+    gravity_task_t task = {
+        .soa = soa,
+        .count = gb->count,
+        .kernel = simd_pairKernel(sim->gp.simd_level),
+        .softening = sim->gp.softening
+    };
+
+    // reset forces to zero
+    body_resetForces(gb);
+    sim->gp.force_evaluations++;
+
+    if (sim->gp.solver == GRAVITY_BARNES_HUT) {
+        if (bh_buildTree(&sim->bh_tree, soa, gb->count, sim->gp.theta)) {
+            if (parallel) {
+                task.tree = &sim->bh_tree;
+                gravity_runTask(sim, &task, gravity_treeTask);
+                return;
+            }
+            for (int i = 0; i < gb->count; i++) {
+                vec3 acc;
+                int other = -1;
+                if (!bh_calculateAcceleration(&sim->bh_tree, soa, i, sim->gp.softening, &acc, &other)) {
+                    gravity_reportCollision(sim, i, other);
+                    return;
+                }
+                soa->force_x[i] = acc.x * soa->mass[i];
+                soa->force_y[i] = acc.y * soa->mass[i];
+                soa->force_z[i] = acc.z * soa->mass[i];
+            }
+            return;
+        }
+        displayError("ERROR", "Failed to allocate memory for the Barnes-Hut tree, falling back to direct summation");
+        sim->gp.solver = GRAVITY_DIRECT;
+    }
+
+    if (sim->gp.solver == GRAVITY_FMM) {
+        // the accelerations are written straight into the force arrays, then scaled by mass
+        int ci = -1, cj = -1;
+        if (fmm_calculateAccelerations(&sim->fmm_tree, soa, gb->count, &sim->gp, parallel ? sim->pool : NULL,
+                                       soa->force_x, soa->force_y, soa->force_z, &ci, &cj)) {
+            for (int i = 0; i < gb->count; i++) {
+                soa->force_x[i] *= soa->mass[i];
+                soa->force_y[i] *= soa->mass[i];
+                soa->force_z[i] *= soa->mass[i];
+            }
+            return;
+        }
+        if (ci >= 0) {
+            body_resetForces(gb);
+            gravity_reportCollision(sim, ci, cj);
+            return;
+        }
+        displayError("ERROR", "Failed to allocate memory for the FMM tree, falling back to direct summation");
+        sim->gp.solver = GRAVITY_DIRECT;
+        body_resetForces(gb);
+    }
+
+    // exact gravitational forces between all body pairs, split into tiles across the pool
+    sim->gp.direct_pairs += (long long)gb->count * (gb->count - 1) / 2;
+    if (parallel && gravity_reserveForceBuffers(sim, sim->pool->thread_count, gb->count)) {
+        task.buffers = sim->force_buffers.data;
+        if (gravity_runTask(sim, &task, gravity_pairTask)) {
+            pool_run(sim->pool, gravity_reduceTask, &task);
+        }
+        return;
+    }
+
+    // single threaded: the whole pair triangle in one kernel call
+    int collided_i = -1, collided_j = -1;
+    if (!task.kernel(soa, gb->count, 0, gb->count, soa->force_x, soa->force_y, soa->force_z, &collided_i, &collided_j)) {
+        gravity_reportCollision(sim, collided_i, collided_j);
+    }
+}
+
+// exact acceleration on body i (used as the reference when measuring solver error)
+static vec3 gravity_directAcceleration(const body_soa_t* soa, const int count, const int i) {
+    double ax = 0.0, ay = 0.0, az = 0.0;
+    for (int j = 0; j < count; j++) {
+        if (j == i) continue;
+        const double dx = soa->pos_x[j] - soa->pos_x[i];
+        const double dy = soa->pos_y[j] - soa->pos_y[i];
+        const double dz = soa->pos_z[j] - soa->pos_z[i];
+        const double r_sq = dx * dx + dy * dy + dz * dz;
+        if (r_sq == 0.0) continue;
+        const double inv_r3 = 1.0 / (r_sq * sqrt(r_sq));
+        ax += soa->mu[j] * dx * inv_r3;
+        ay += soa->mu[j] * dy * inv_r3;
+        az += soa->mu[j] * dz * inv_r3;
+    }
+    return (vec3){ax, ay, az};
+}
+
+// measures the relative force error of the selected solver against direct summation
+// on an evenly spaced sample of bodies (uses its own tree so the sim's workspace is untouched)
+gravity_error_t gravity_measureForceError(const sim_properties_t* sim, int sample_count) {
+    const body_properties_t* gb = &sim->gb;
+    const body_soa_t* soa = &gb->soa;
+    gravity_error_t result = {0};
+
+    if (gb->count < 2 || sample_count <= 0) return result;
+    if (sample_count > gb->count) sample_count = gb->count;
+
+    bh_tree_t tree = {0};
+    const bool use_tree = sim->gp.solver == GRAVITY_BARNES_HUT;
+    if (use_tree && !bh_buildTree(&tree, soa, gb->count, sim->gp.theta)) {
+        bh_freeTree(&tree);
+        return result;
+    }
+
+    // the FMM has no per-body evaluation, so every body is evaluated once up front
+    double* fmm_acc = NULL;
+    if (sim->gp.solver == GRAVITY_FMM) {
+        fmm_acc = (double*)malloc(3 * (size_t)gb->count * sizeof(double));
+        fmm_tree_t fmm_tree = {0};
+        int ci = -1, cj = -1;
+        const bool ok = fmm_acc != NULL && fmm_calculateAccelerations(&fmm_tree, soa, gb->count, &sim->gp, sim->pool,
+            fmm_acc, fmm_acc + gb->count, fmm_acc + 2 * gb->count, &ci, &cj);
+        fmm_freeTree(&fmm_tree);
+        if (!ok) {
+            free(fmm_acc);
+            return result;
+        }
+    }
+
+    double sum_sq = 0.0;
+    for (int s = 0; s < sample_count; s++) {
+        const int i = (int)((long long)s * gb->count / sample_count);
+        const vec3 exact = gravity_directAcceleration(soa, gb->count, i);
+
+        vec3 approx = exact;
+        if (use_tree) {
+            int other = -1;
+            bh_calculateAcceleration(&tree, soa, i, sim->gp.softening, &approx, &other);
+        }
+        if (fmm_acc != NULL) {
+            approx = (vec3){fmm_acc[i], fmm_acc[gb->count + i], fmm_acc[2 * gb->count + i]};
+        }
+
+        const double exact_mag = vec3_mag(exact);
+        if (exact_mag == 0.0) continue;
+
+        // fmax would drop a nan and make a broken solve look exact
+        if (!isfinite(approx.x) || !isfinite(approx.y) || !isfinite(approx.z)) {
+            result.non_finite++;
+            result.sample_count++;
+            continue;
+        }
+        const double rel_error = vec3_mag(vec3_sub(approx, exact)) / exact_mag;
+        result.max_rel_error = fmax(result.max_rel_error, rel_error);
+        sum_sq += rel_error * rel_error;
+        result.sample_count++;
+    }
+    if (result.non_finite > 0) {
+        result.max_rel_error = INFINITY;
+        result.rms_rel_error = INFINITY;
+    }
+    else if (result.sample_count > 0) {
+        result.rms_rel_error = sqrt(sum_sq / result.sample_count);
+    }
+
+    bh_freeTree(&tree);
+    free(fmm_acc);
+    return result;
+}
@@ -0,0 +1,15 @@
+#ifndef GRAVITY_H
+#define GRAVITY_H
+
+#include "../types.h"
+
+gravity_params_t gravity_defaultParams(void);
+const char* gravity_solverName(gravity_solver_t solver);
+bool gravity_parseSolverName(const char* name, gravity_solver_t* solver);
+void gravity_reportCollision(sim_properties_t* sim, int i, int j);
+void gravity_updateThreadPool(sim_properties_t* sim);
+void gravity_calculateForces(sim_properties_t* sim);
+void gravity_freeWorkspace(sim_properties_t* sim);
+gravity_error_t gravity_measureForceError(const sim_properties_t* sim, int sample_count);
+
+#endif
@@ -0,0 +1,577 @@
+#include "gravity_simd.h"
+#include "bodies.h"
+#include "swarm.h"
+#include "kepler.h"
+#include "../globals.h"
+#include <math.h>
+#include <string.h>
+
+// the vector kernels are compiled with per-function target attributes, so the rest of the program
+// can be built for a baseline cpu (packaged builds) and the fastest kernel is still picked at runtime
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SIMD_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define SIMD_TARGET_AVX2
+        #define SIMD_TARGET_AVX512
+    #else
+        #define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+        #define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+    #endif
+#else
+    #define SIMD_X86 0
+#endif
+
+#if SIMD_X86
+
+// index of the first set bit of a lane mask (mask is never zero)
+static inline int simd_firstLane(unsigned int mask) {
+    int lane = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        lane++;
+    }
+    return lane;
+}
+
+// 4 interactions per iteration, the row sum is kept in registers and the j side is updated in place
+SIMD_TARGET_AVX2
+static bool simd_pairKernelAVX2(const body_soa_t* soa, const int count, const int row_begin, const int row_end,
+                                double* fx, double* fy, double* fz, int* collided_i, int* collided_j) {
+    for (int i = row_begin; i < row_end; i++) {
+        const double radius_squared = soa->radius[i] * soa->radius[i];
+        const __m256d px = _mm256_set1_pd(soa->pos_x[i]);
+        const __m256d py = _mm256_set1_pd(soa->pos_y[i]);
+        const __m256d pz = _mm256_set1_pd(soa->pos_z[i]);
+        const __m256d mu_i = _mm256_set1_pd(soa->mu[i]);
+        const __m256d radius_sq = _mm256_set1_pd(radius_squared);
+        __m256d fxi = _mm256_setzero_pd();
+        __m256d fyi = _mm256_setzero_pd();
+        __m256d fzi = _mm256_setzero_pd();
+
+        int j = i + 1;
+        for (; j + 4 <= count; j += 4) {
+            const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(&soa->pos_x[j]), px);
+            const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(&soa->pos_y[j]), py);
+            const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(&soa->pos_z[j]), pz);
+            const __m256d r_squared = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+
+            const int hit = _mm256_movemask_pd(_mm256_cmp_pd(r_squared, radius_sq, _CMP_LT_OQ));
+            if (hit) {
+                *collided_i = i;
+                *collided_j = j + simd_firstLane((unsigned int)hit);
+                return false;
+            }
+
+            const __m256d r = _mm256_sqrt_pd(r_squared);
+            const __m256d force_factor = _mm256_div_pd(_mm256_mul_pd(mu_i, _mm256_loadu_pd(&soa->mass[j])),
+                                                       _mm256_mul_pd(r_squared, r));
+            const __m256d fxp = _mm256_mul_pd(dx, force_factor);
+            const __m256d fyp = _mm256_mul_pd(dy, force_factor);
+            const __m256d fzp = _mm256_mul_pd(dz, force_factor);
+
+            fxi = _mm256_add_pd(fxi, fxp);
+            fyi = _mm256_add_pd(fyi, fyp);
+            fzi = _mm256_add_pd(fzi, fzp);
+            _mm256_storeu_pd(&fx[j], _mm256_sub_pd(_mm256_loadu_pd(&fx[j]), fxp));
+            _mm256_storeu_pd(&fy[j], _mm256_sub_pd(_mm256_loadu_pd(&fy[j]), fyp));
+            _mm256_storeu_pd(&fz[j], _mm256_sub_pd(_mm256_loadu_pd(&fz[j]), fzp));
+        }
+
+        double sum[4];
+        _mm256_storeu_pd(sum, fxi);
+        fx[i] += (sum[0] + sum[1]) + (sum[2] + sum[3]);
+        _mm256_storeu_pd(sum, fyi);
+        fy[i] += (sum[0] + sum[1]) + (sum[2] + sum[3]);
+        _mm256_storeu_pd(sum, fzi);
+        fz[i] += (sum[0] + sum[1]) + (sum[2] + sum[3]);
+
+        // leftover columns of this row
+        if (j < count && !body_calculateGravForceColumns(soa, i, j, count, fx, fy, fz, collided_j)) {
+            *collided_i = i;
+            return false;
+        }
+    }
+    return true;
+}
+
+// same as the AVX2 kernel with 8 interactions per iteration
+SIMD_TARGET_AVX512
+static bool simd_pairKernelAVX512(const body_soa_t* soa, const int count, const int row_begin, const int row_end,
+                                  double* fx, double* fy, double* fz, int* collided_i, int* collided_j) {
+    for (int i = row_begin; i < row_end; i++) {
+        const double radius_squared = soa->radius[i] * soa->radius[i];
+        const __m512d px = _mm512_set1_pd(soa->pos_x[i]);
+        const __m512d py = _mm512_set1_pd(soa->pos_y[i]);
+        const __m512d pz = _mm512_set1_pd(soa->pos_z[i]);
+        const __m512d mu_i = _mm512_set1_pd(soa->mu[i]);
+        const __m512d radius_sq = _mm512_set1_pd(radius_squared);
+        __m512d fxi = _mm512_setzero_pd();
+        __m512d fyi = _mm512_setzero_pd();
+        __m512d fzi = _mm512_setzero_pd();
+
+        int j = i + 1;
+        for (; j + 8 <= count; j += 8) {
+            const __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(&soa->pos_x[j]), px);
+            const __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(&soa->pos_y[j]), py);
+            const __m512d dz = _mm512_sub_pd(_mm512_loadu_pd(&soa->pos_z[j]), pz);
+            const __m512d r_squared = _mm512_fmadd_pd(dz, dz, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx)));
+
+            const __mmask8 hit = _mm512_cmp_pd_mask(r_squared, radius_sq, _CMP_LT_OQ);
+            if (hit) {
+                *collided_i = i;
+                *collided_j = j + simd_firstLane((unsigned int)hit);
+                return false;
+            }
+
+            const __m512d r = _mm512_sqrt_pd(r_squared);
+            const __m512d force_factor = _mm512_div_pd(_mm512_mul_pd(mu_i, _mm512_loadu_pd(&soa->mass[j])),
+                                                       _mm512_mul_pd(r_squared, r));
+            const __m512d fxp = _mm512_mul_pd(dx, force_factor);
+            const __m512d fyp = _mm512_mul_pd(dy, force_factor);
+            const __m512d fzp = _mm512_mul_pd(dz, force_factor);
+
+            fxi = _mm512_add_pd(fxi, fxp);
+            fyi = _mm512_add_pd(fyi, fyp);
+            fzi = _mm512_add_pd(fzi, fzp);
+            _mm512_storeu_pd(&fx[j], _mm512_sub_pd(_mm512_loadu_pd(&fx[j]), fxp));
+            _mm512_storeu_pd(&fy[j], _mm512_sub_pd(_mm512_loadu_pd(&fy[j]), fyp));
+            _mm512_storeu_pd(&fz[j], _mm512_sub_pd(_mm512_loadu_pd(&fz[j]), fzp));
+        }
+
+        fx[i] += _mm512_reduce_add_pd(fxi);
+        fy[i] += _mm512_reduce_add_pd(fyi);
+        fz[i] += _mm512_reduce_add_pd(fzi);
+
+        if (j < count && !body_calculateGravForceColumns(soa, i, j, count, fx, fy, fz, collided_j)) {
+            *collided_i = i;
+            return false;
+        }
+    }
+    return true;
+}
+
+// swarm kernel: 4 particles per iteration against one body at a time, leftover particles go to the scalar kernel
+SIMD_TARGET_AVX2
+static void simd_swarmKernelAVX2(const body_soa_t* soa, const int body_count, swarm_t* swarm, const int begin, const int end,
+                                 const double kick, const double drift) {
+    const __m256d kick_v = _mm256_set1_pd(kick);
+    const __m256d drift_v = _mm256_set1_pd(drift);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        const __m256d px = _mm256_loadu_pd(&swarm->pos_x[i]);
+        const __m256d py = _mm256_loadu_pd(&swarm->pos_y[i]);
+        const __m256d pz = _mm256_loadu_pd(&swarm->pos_z[i]);
+        __m256d ax = _mm256_setzero_pd();
+        __m256d ay = _mm256_setzero_pd();
+        __m256d az = _mm256_setzero_pd();
+
+        for (int j = 0; j < body_count; j++) {
+            const __m256d dx = _mm256_sub_pd(_mm256_set1_pd(soa->pos_x[j]), px);
+            const __m256d dy = _mm256_sub_pd(_mm256_set1_pd(soa->pos_y[j]), py);
+            const __m256d dz = _mm256_sub_pd(_mm256_set1_pd(soa->pos_z[j]), pz);
+            const __m256d r_squared = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+
+            const int hit = _mm256_movemask_pd(_mm256_cmp_pd(r_squared, _mm256_set1_pd(soa->radius[j] * soa->radius[j]), _CMP_LT_OQ));
+            for (int lane = 0; lane < 4; lane++) {
+                if (hit & (1 << lane)) swarm->hit_body[i + lane] = j;
+            }
+
+            const __m256d factor = _mm256_div_pd(_mm256_set1_pd(soa->mu[j]), _mm256_mul_pd(r_squared, _mm256_sqrt_pd(r_squared)));
+            ax = _mm256_fmadd_pd(dx, factor, ax);
+            ay = _mm256_fmadd_pd(dy, factor, ay);
+            az = _mm256_fmadd_pd(dz, factor, az);
+        }
+
+        const __m256d vx = _mm256_fmadd_pd(ax, kick_v, _mm256_loadu_pd(&swarm->vel_x[i]));
+        const __m256d vy = _mm256_fmadd_pd(ay, kick_v, _mm256_loadu_pd(&swarm->vel_y[i]));
+        const __m256d vz = _mm256_fmadd_pd(az, kick_v, _mm256_loadu_pd(&swarm->vel_z[i]));
+        _mm256_storeu_pd(&swarm->vel_x[i], vx);
+        _mm256_storeu_pd(&swarm->vel_y[i], vy);
+        _mm256_storeu_pd(&swarm->vel_z[i], vz);
+        _mm256_storeu_pd(&swarm->pos_x[i], _mm256_fmadd_pd(vx, drift_v, px));
+        _mm256_storeu_pd(&swarm->pos_y[i], _mm256_fmadd_pd(vy, drift_v, py));
+        _mm256_storeu_pd(&swarm->pos_z[i], _mm256_fmadd_pd(vz, drift_v, pz));
+    }
+    if (i < end) swarm_kickDriftRange(soa, body_count, swarm, i, end, kick, drift);
+}
+
+// same as the AVX2 swarm kernel with 8 particles per iteration
+SIMD_TARGET_AVX512
+static void simd_swarmKernelAVX512(const body_soa_t* soa, const int body_count, swarm_t* swarm, const int begin, const int end,
+                                   const double kick, const double drift) {
+    const __m512d kick_v = _mm512_set1_pd(kick);
+    const __m512d drift_v = _mm512_set1_pd(drift);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        const __m512d px = _mm512_loadu_pd(&swarm->pos_x[i]);
+        const __m512d py = _mm512_loadu_pd(&swarm->pos_y[i]);
+        const __m512d pz = _mm512_loadu_pd(&swarm->pos_z[i]);
+        __m512d ax = _mm512_setzero_pd();
+        __m512d ay = _mm512_setzero_pd();
+        __m512d az = _mm512_setzero_pd();
+
+        for (int j = 0; j < body_count; j++) {
+            const __m512d dx = _mm512_sub_pd(_mm512_set1_pd(soa->pos_x[j]), px);
+            const __m512d dy = _mm512_sub_pd(_mm512_set1_pd(soa->pos_y[j]), py);
+            const __m512d dz = _mm512_sub_pd(_mm512_set1_pd(soa->pos_z[j]), pz);
+            const __m512d r_squared = _mm512_fmadd_pd(dz, dz, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx)));
+
+            const __mmask8 hit = _mm512_cmp_pd_mask(r_squared, _mm512_set1_pd(soa->radius[j] * soa->radius[j]), _CMP_LT_OQ);
+            for (int lane = 0; lane < 8; lane++) {
+                if (hit & (1u << lane)) swarm->hit_body[i + lane] = j;
+            }
+
+            const __m512d factor = _mm512_div_pd(_mm512_set1_pd(soa->mu[j]), _mm512_mul_pd(r_squared, _mm512_sqrt_pd(r_squared)));
+            ax = _mm512_fmadd_pd(dx, factor, ax);
+            ay = _mm512_fmadd_pd(dy, factor, ay);
+            az = _mm512_fmadd_pd(dz, factor, az);
+        }
+
+        const __m512d vx = _mm512_fmadd_pd(ax, kick_v, _mm512_loadu_pd(&swarm->vel_x[i]));
+        const __m512d vy = _mm512_fmadd_pd(ay, kick_v, _mm512_loadu_pd(&swarm->vel_y[i]));
+        const __m512d vz = _mm512_fmadd_pd(az, kick_v, _mm512_loadu_pd(&swarm->vel_z[i]));
+        _mm512_storeu_pd(&swarm->vel_x[i], vx);
+        _mm512_storeu_pd(&swarm->vel_y[i], vy);
+        _mm512_storeu_pd(&swarm->vel_z[i], vz);
+        _mm512_storeu_pd(&swarm->pos_x[i], _mm512_fmadd_pd(vx, drift_v, px));
+        _mm512_storeu_pd(&swarm->pos_y[i], _mm512_fmadd_pd(vy, drift_v, py));
+        _mm512_storeu_pd(&swarm->pos_z[i], _mm512_fmadd_pd(vz, drift_v, pz));
+    }
+    if (i < end) swarm_kickDriftRange(soa, body_count, swarm, i, end, kick, drift);
+}
+
+// sin and cos for the kepler kernels: the angle is reduced by the nearest multiple of pi / 2 (two part constant,
+// exact for the small multiples of wrapped angles and newton iterates) and the fdlibm polynomials are evaluated
+// on [-pi / 4, pi / 4], which keeps the error within an ulp or so of libm
+#define SIMD_PIO2_HI 1.57079632673412561417e+00
+#define SIMD_PIO2_LO 6.07710050650619224932e-11
+#define SIMD_SIN_1 -1.66666666666666324348e-01
+#define SIMD_SIN_2 8.33333333332248946124e-03
+#define SIMD_SIN_3 -1.98412698298579493134e-04
+#define SIMD_SIN_4 2.75573137070700676789e-06
+#define SIMD_SIN_5 -2.50507602534068634195e-08
+#define SIMD_SIN_6 1.58969099521155010221e-10
+#define SIMD_COS_1 4.16666666666666019037e-02
+#define SIMD_COS_2 -1.38888888888741095749e-03
+#define SIMD_COS_3 2.48015872894767294178e-05
+#define SIMD_COS_4 -2.75573143513906633035e-07
+#define SIMD_COS_5 2.08757232129817482790e-09
+#define SIMD_COS_6 -1.13596475577881948265e-11
+
+SIMD_TARGET_AVX2
+static inline void simd_sincosAVX2(const __m256d x, __m256d* sin_x, __m256d* cos_x) {
+    const __m256d q = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(2.0 / PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    const __m256d r = _mm256_fnmadd_pd(q, _mm256_set1_pd(SIMD_PIO2_LO), _mm256_fnmadd_pd(q, _mm256_set1_pd(SIMD_PIO2_HI), x));
+    const __m256d z = _mm256_mul_pd(r, r);
+
+    __m256d s = _mm256_fmadd_pd(z, _mm256_set1_pd(SIMD_SIN_6), _mm256_set1_pd(SIMD_SIN_5));
+    s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(SIMD_SIN_4));
+    s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(SIMD_SIN_3));
+    s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(SIMD_SIN_2));
+    s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(SIMD_SIN_1));
+    s = _mm256_fmadd_pd(_mm256_mul_pd(z, r), s, r);
+
+    __m256d c = _mm256_fmadd_pd(z, _mm256_set1_pd(SIMD_COS_6), _mm256_set1_pd(SIMD_COS_5));
+    c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(SIMD_COS_4));
+    c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(SIMD_COS_3));
+    c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(SIMD_COS_2));
+    c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(SIMD_COS_1));
+    c = _mm256_fmadd_pd(_mm256_mul_pd(z, z), c, _mm256_fnmadd_pd(_mm256_set1_pd(0.5), z, _mm256_set1_pd(1.0)));
+
+    // an odd quadrant swaps sin and cos, bit 1 of the quadrant (and of quadrant + 1) flips the sign
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i two = _mm256_set1_epi64x(2);
+    const __m256i quadrant = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(q));
+    const __m256d swap = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(quadrant, one), one));
+    const __m256d sin_sign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(quadrant, two), 62));
+    const __m256d cos_sign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(quadrant, one), two), 62));
+    *sin_x = _mm256_xor_pd(_mm256_blendv_pd(s, c, swap), sin_sign);
+    *cos_x = _mm256_xor_pd(_mm256_blendv_pd(c, s, swap), cos_sign);
+}
+
+// same as kepler_wrapAngle
+SIMD_TARGET_AVX2
+static inline __m256d simd_wrapAngleAVX2(const __m256d x) {
+    const __m256d q = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.0 / (2.0 * PI))), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    return _mm256_fnmadd_pd(q, _mm256_set1_pd(KEPLER_TWO_PI_LO), _mm256_fnmadd_pd(q, _mm256_set1_pd(KEPLER_TWO_PI_HI), x));
+}
+
+// kepler kernel: 4 elliptic orbits per iteration, newton runs until every lane has converged (converged lanes are
+// held still, so each lane stops where the scalar solver would). groups with a hyperbolic orbit and the leftovers
+// go to the scalar kernel
+SIMD_TARGET_AVX2
+static void simd_keplerKernelAVX2(const kepler_batch_t* batch, const int begin, const int end) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d sign_bit = _mm256_set1_pd(-0.0);
+    const __m256d tolerance = _mm256_set1_pd(KEPLER_TOLERANCE);
+    const __m256d mu = _mm256_set1_pd(batch->mu);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        const __m256d e = _mm256_loadu_pd(&batch->e[i]);
+        if (_mm256_movemask_pd(_mm256_cmp_pd(e, one, _CMP_LT_OQ)) != 0xF) {
+            kepler_elementsToStateRange(batch, i, i + 4);
+            continue;
+        }
+        const __m256d a = _mm256_andnot_pd(sign_bit, _mm256_loadu_pd(&batch->a[i]));
+        const __m256d mean_anomaly = simd_wrapAngleAVX2(_mm256_loadu_pd(&batch->mean_anomaly[i]));
+
+        // danby's starting guess, M + 0.85 e with the sign of M
+        __m256d E = _mm256_add_pd(mean_anomaly, _mm256_or_pd(_mm256_and_pd(mean_anomaly, sign_bit), _mm256_mul_pd(_mm256_set1_pd(0.85), e)));
+        __m256d sin_E, cos_E;
+        __m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        for (int k = 0; k < KEPLER_MAX_ITERATIONS && _mm256_movemask_pd(active) != 0; k++) {
+            simd_sincosAVX2(E, &sin_E, &cos_E);
+            const __m256d f = _mm256_sub_pd(_mm256_fnmadd_pd(e, sin_E, E), mean_anomaly);
+            const __m256d delta = _mm256_and_pd(_mm256_div_pd(f, _mm256_fnmadd_pd(e, cos_E, one)), active);
+            E = _mm256_sub_pd(E, delta);
+            active = _mm256_and_pd(active, _mm256_cmp_pd(_mm256_andnot_pd(sign_bit, delta), tolerance, _CMP_GT_OQ));
+        }
+        simd_sincosAVX2(E, &sin_E, &cos_E);
+
+        // perifocal state
+        const __m256d b = _mm256_sqrt_pd(_mm256_fnmadd_pd(e, e, one));
+        const __m256d v = _mm256_div_pd(_mm256_sqrt_pd(_mm256_mul_pd(mu, a)), _mm256_mul_pd(a, _mm256_fnmadd_pd(e, cos_E, one)));
+        const __m256d x = _mm256_mul_pd(a, _mm256_sub_pd(cos_E, e));
+        const __m256d y = _mm256_mul_pd(_mm256_mul_pd(a, b), sin_E);
+        const __m256d vx = _mm256_xor_pd(_mm256_mul_pd(v, sin_E), sign_bit);
+        const __m256d vy = _mm256_mul_pd(_mm256_mul_pd(v, b), cos_E);
+
+        // rotation into the frame of the parent
+        __m256d sin_O, cos_O, sin_w, cos_w, sin_i, cos_i;
+        simd_sincosAVX2(simd_wrapAngleAVX2(_mm256_loadu_pd(&batch->raan[i])), &sin_O, &cos_O);
+        simd_sincosAVX2(simd_wrapAngleAVX2(_mm256_loadu_pd(&batch->argp[i])), &sin_w, &cos_w);
+        simd_sincosAVX2(simd_wrapAngleAVX2(_mm256_loadu_pd(&batch->inc[i])), &sin_i, &cos_i);
+        const __m256d sin_w_cos_i = _mm256_mul_pd(sin_w, cos_i);
+        const __m256d cos_w_cos_i = _mm256_mul_pd(cos_w, cos_i);
+        const __m256d px = _mm256_fnmadd_pd(sin_O, sin_w_cos_i, _mm256_mul_pd(cos_O, cos_w));
+        const __m256d py = _mm256_fmadd_pd(cos_O, sin_w_cos_i, _mm256_mul_pd(sin_O, cos_w));
+        const __m256d pz = _mm256_mul_pd(sin_w, sin_i);
+        const __m256d qx = _mm256_fnmadd_pd(sin_O, cos_w_cos_i, _mm256_xor_pd(_mm256_mul_pd(cos_O, sin_w), sign_bit));
+        const __m256d qy = _mm256_fmadd_pd(cos_O, cos_w_cos_i, _mm256_xor_pd(_mm256_mul_pd(sin_O, sin_w), sign_bit));
+        const __m256d qz = _mm256_mul_pd(cos_w, sin_i);
+
+        _mm256_storeu_pd(&batch->pos_x[i], _mm256_fmadd_pd(y, qx, _mm256_mul_pd(x, px)));
+        _mm256_storeu_pd(&batch->pos_y[i], _mm256_fmadd_pd(y, qy, _mm256_mul_pd(x, py)));
+        _mm256_storeu_pd(&batch->pos_z[i], _mm256_fmadd_pd(y, qz, _mm256_mul_pd(x, pz)));
+        _mm256_storeu_pd(&batch->vel_x[i], _mm256_fmadd_pd(vy, qx, _mm256_mul_pd(vx, px)));
+        _mm256_storeu_pd(&batch->vel_y[i], _mm256_fmadd_pd(vy, qy, _mm256_mul_pd(vx, py)));
+        _mm256_storeu_pd(&batch->vel_z[i], _mm256_fmadd_pd(vy, qz, _mm256_mul_pd(vx, pz)));
+    }
+    if (i < end) kepler_elementsToStateRange(batch, i, end);
+}
+
+SIMD_TARGET_AVX512
+static inline __m512d simd_flipSignAVX512(const __m512d x, const __m512i sign) {
+    return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(x), sign));
+}
+
+// 8 wide version of simd_sincosAVX2
+SIMD_TARGET_AVX512
+static inline void simd_sincosAVX512(const __m512d x, __m512d* sin_x, __m512d* cos_x) {
+    const __m512d q = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(2.0 / PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    const __m512d r = _mm512_fnmadd_pd(q, _mm512_set1_pd(SIMD_PIO2_LO), _mm512_fnmadd_pd(q, _mm512_set1_pd(SIMD_PIO2_HI), x));
+    const __m512d z = _mm512_mul_pd(r, r);
+
+    __m512d s = _mm512_fmadd_pd(z, _mm512_set1_pd(SIMD_SIN_6), _mm512_set1_pd(SIMD_SIN_5));
+    s = _mm512_fmadd_pd(z, s, _mm512_set1_pd(SIMD_SIN_4));
+    s = _mm512_fmadd_pd(z, s, _mm512_set1_pd(SIMD_SIN_3));
+    s = _mm512_fmadd_pd(z, s, _mm512_set1_pd(SIMD_SIN_2));
+    s = _mm512_fmadd_pd(z, s, _mm512_set1_pd(SIMD_SIN_1));
+    s = _mm512_fmadd_pd(_mm512_mul_pd(z, r), s, r);
+
+    __m512d c = _mm512_fmadd_pd(z, _mm512_set1_pd(SIMD_COS_6), _mm512_set1_pd(SIMD_COS_5));
+    c = _mm512_fmadd_pd(z, c, _mm512_set1_pd(SIMD_COS_4));
+    c = _mm512_fmadd_pd(z, c, _mm512_set1_pd(SIMD_COS_3));
+    c = _mm512_fmadd_pd(z, c, _mm512_set1_pd(SIMD_COS_2));
+    c = _mm512_fmadd_pd(z, c, _mm512_set1_pd(SIMD_COS_1));
+    c = _mm512_fmadd_pd(_mm512_mul_pd(z, z), c, _mm512_fnmadd_pd(_mm512_set1_pd(0.5), z, _mm512_set1_pd(1.0)));
+
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i two = _mm512_set1_epi64(2);
+    const __m512i quadrant = _mm512_cvtepi32_epi64(_mm512_cvtpd_epi32(q));
+    const __mmask8 swap = _mm512_test_epi64_mask(quadrant, one);
+    const __m512i sin_sign = _mm512_slli_epi64(_mm512_and_si512(quadrant, two), 62);
+    const __m512i cos_sign = _mm512_slli_epi64(_mm512_and_si512(_mm512_add_epi64(quadrant, one), two), 62);
+    *sin_x = simd_flipSignAVX512(_mm512_mask_blend_pd(swap, s, c), sin_sign);
+    *cos_x = simd_flipSignAVX512(_mm512_mask_blend_pd(swap, c, s), cos_sign);
+}
+
+SIMD_TARGET_AVX512
+static inline __m512d simd_wrapAngleAVX512(const __m512d x) {
+    const __m512d q = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(1.0 / (2.0 * PI))), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    return _mm512_fnmadd_pd(q, _mm512_set1_pd(KEPLER_TWO_PI_LO), _mm512_fnmadd_pd(q, _mm512_set1_pd(KEPLER_TWO_PI_HI), x));
+}
+
+// same as the AVX2 kepler kernel with 8 orbits per iteration
+SIMD_TARGET_AVX512
+static void simd_keplerKernelAVX512(const kepler_batch_t* batch, const int begin, const int end) {
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512i sign_bit = _mm512_set1_epi64((long long)0x8000000000000000ull);
+    const __m512d tolerance = _mm512_set1_pd(KEPLER_TOLERANCE);
+    const __m512d mu = _mm512_set1_pd(batch->mu);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        const __m512d e = _mm512_loadu_pd(&batch->e[i]);
+        if (_mm512_cmp_pd_mask(e, one, _CMP_LT_OQ) != 0xFF) {
+            kepler_elementsToStateRange(batch, i, i + 8);
+            continue;
+        }
+        const __m512d a = _mm512_abs_pd(_mm512_loadu_pd(&batch->a[i]));
+        const __m512d mean_anomaly = simd_wrapAngleAVX512(_mm512_loadu_pd(&batch->mean_anomaly[i]));
+
+        const __m512i start_sign = _mm512_and_si512(_mm512_castpd_si512(mean_anomaly), sign_bit);
+        __m512d E = _mm512_add_pd(mean_anomaly, simd_flipSignAVX512(_mm512_mul_pd(_mm512_set1_pd(0.85), e), start_sign));
+        __m512d sin_E, cos_E;
+        __mmask8 active = 0xFF;
+        for (int k = 0; k < KEPLER_MAX_ITERATIONS && active != 0; k++) {
+            simd_sincosAVX512(E, &sin_E, &cos_E);
+            const __m512d f = _mm512_sub_pd(_mm512_fnmadd_pd(e, sin_E, E), mean_anomaly);
+            const __m512d delta = _mm512_div_pd(f, _mm512_fnmadd_pd(e, cos_E, one));
+            E = _mm512_mask_sub_pd(E, active, E, delta);
+            active = _mm512_mask_cmp_pd_mask(active, _mm512_abs_pd(delta), tolerance, _CMP_GT_OQ);
+        }
+        simd_sincosAVX512(E, &sin_E, &cos_E);
+
+        const __m512d b = _mm512_sqrt_pd(_mm512_fnmadd_pd(e, e, one));
+        const __m512d v = _mm512_div_pd(_mm512_sqrt_pd(_mm512_mul_pd(mu, a)), _mm512_mul_pd(a, _mm512_fnmadd_pd(e, cos_E, one)));
+        const __m512d x = _mm512_mul_pd(a, _mm512_sub_pd(cos_E, e));
+        const __m512d y = _mm512_mul_pd(_mm512_mul_pd(a, b), sin_E);
+        const __m512d vx = simd_flipSignAVX512(_mm512_mul_pd(v, sin_E), sign_bit);
+        const __m512d vy = _mm512_mul_pd(_mm512_mul_pd(v, b), cos_E);
+
+        __m512d sin_O, cos_O, sin_w, cos_w, sin_i, cos_i;
+        simd_sincosAVX512(simd_wrapAngleAVX512(_mm512_loadu_pd(&batch->raan[i])), &sin_O, &cos_O);
+        simd_sincosAVX512(simd_wrapAngleAVX512(_mm512_loadu_pd(&batch->argp[i])), &sin_w, &cos_w);
+        simd_sincosAVX512(simd_wrapAngleAVX512(_mm512_loadu_pd(&batch->inc[i])), &sin_i, &cos_i);
+        const __m512d sin_w_cos_i = _mm512_mul_pd(sin_w, cos_i);
+        const __m512d cos_w_cos_i = _mm512_mul_pd(cos_w, cos_i);
+        const __m512d px = _mm512_fnmadd_pd(sin_O, sin_w_cos_i, _mm512_mul_pd(cos_O, cos_w));
+        const __m512d py = _mm512_fmadd_pd(cos_O, sin_w_cos_i, _mm512_mul_pd(sin_O, cos_w));
+        const __m512d pz = _mm512_mul_pd(sin_w, sin_i);
+        const __m512d qx = _mm512_fnmadd_pd(sin_O, cos_w_cos_i, simd_flipSignAVX512(_mm512_mul_pd(cos_O, sin_w), sign_bit));
+        const __m512d qy = _mm512_fmadd_pd(cos_O, cos_w_cos_i, simd_flipSignAVX512(_mm512_mul_pd(sin_O, sin_w), sign_bit));
+        const __m512d qz = _mm512_mul_pd(cos_w, sin_i);
+
+        _mm512_storeu_pd(&batch->pos_x[i], _mm512_fmadd_pd(y, qx, _mm512_mul_pd(x, px)));
+        _mm512_storeu_pd(&batch->pos_y[i], _mm512_fmadd_pd(y, qy, _mm512_mul_pd(x, py)));
+        _mm512_storeu_pd(&batch->pos_z[i], _mm512_fmadd_pd(y, qz, _mm512_mul_pd(x, pz)));
+        _mm512_storeu_pd(&batch->vel_x[i], _mm512_fmadd_pd(vy, qx, _mm512_mul_pd(vx, px)));
+        _mm512_storeu_pd(&batch->vel_y[i], _mm512_fmadd_pd(vy, qy, _mm512_mul_pd(vx, py)));
+        _mm512_storeu_pd(&batch->vel_z[i], _mm512_fmadd_pd(vy, qz, _mm512_mul_pd(vx, pz)));
+    }
+    if (i < end) kepler_elementsToStateRange(batch, i, end);
+}
+
+// cpuid feature bits, including the check that the os saves the wide registers on context switches
+static void simd_cpuFeatures(bool* avx2, bool* avx512) {
+    *avx2 = false;
+    *avx512 = false;
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return;
+
+    __cpuid(info, 1);
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave) return;
+    const unsigned long long xcr0 = _xgetbv(0);
+    const bool os_avx = (xcr0 & 0x6) == 0x6;      // xmm and ymm state
+    const bool os_avx512 = (xcr0 & 0xe6) == 0xe6; // plus opmask and zmm state
+
+    __cpuidex(info, 7, 0);
+    *avx2 = os_avx && fma && (info[1] & (1 << 5)) != 0;
+    *avx512 = *avx2 && os_avx512 && (info[1] & (1 << 16)) != 0;
+#else
+    // gcc and clang check the os support for the register state themselves
+    __builtin_cpu_init();
+    *avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    *avx512 = *avx2 && __builtin_cpu_supports("avx512f");
+#endif
+}
+
+#endif // SIMD_X86
+
+// fastest kernel this cpu can run (cpuid is only queried once)
+simd_level_t simd_detectLevel(void) {
+    static int detected = -1;
+    if (detected < 0) {
+        simd_level_t level = SIMD_SCALAR;
+#if SIMD_X86
+        bool avx2, avx512;
+        simd_cpuFeatures(&avx2, &avx512);
+        if (avx512) level = SIMD_AVX512;
+        else if (avx2) level = SIMD_AVX2;
+#endif
+        detected = (int)level;
+    }
+    return (simd_level_t)detected;
+}
+
+bool simd_isSupported(const simd_level_t level) {
+    return level <= simd_detectLevel();
+}
+
+// returns the kernel for a level (falls back to the scalar kernel if the cpu lacks the instructions)
+simd_pair_kernel_t simd_pairKernel(const simd_level_t level) {
+#if SIMD_X86
+    if (simd_isSupported(level)) {
+        if (level == SIMD_AVX512) return simd_pairKernelAVX512;
+        if (level == SIMD_AVX2) return simd_pairKernelAVX2;
+    }
+#endif
+    return body_calculateGravForceRows;
+}
+
+// returns the swarm kernel for a level (same fallback as the pair kernels)
+simd_swarm_kernel_t simd_swarmKernel(const simd_level_t level) {
+#if SIMD_X86
+    if (simd_isSupported(level)) {
+        if (level == SIMD_AVX512) return simd_swarmKernelAVX512;
+        if (level == SIMD_AVX2) return simd_swarmKernelAVX2;
+    }
+#endif
+    return swarm_kickDriftRange;
+}
+
+// returns the kepler kernel for a level (same fallback as the pair kernels)
+simd_kepler_kernel_t simd_keplerKernel(const simd_level_t level) {
+#if SIMD_X86
+    if (simd_isSupported(level)) {
+        if (level == SIMD_AVX512) return simd_keplerKernelAVX512;
+        if (level == SIMD_AVX2) return simd_keplerKernelAVX2;
+    }
+#endif
+    return kepler_elementsToStateRange;
+}
+
+const char* simd_levelName(const simd_level_t level) {
+    switch (level) {
+        case SIMD_AVX2: return "avx2";
+        case SIMD_AVX512: return "avx512";
+        case SIMD_SCALAR:
+        default: return "scalar";
+    }
+}
+
+bool simd_parseLevelName(const char* name, simd_level_t* level) {
+    if (strcmp(name, "scalar") == 0) {
+        *level = SIMD_SCALAR;
+        return true;
+    }
+    if (strcmp(name, "avx2") == 0) {
+        *level = SIMD_AVX2;
+        return true;
+    }
+    if (strcmp(name, "avx512") == 0 || strcmp(name, "avx-512") == 0) {
+        *level = SIMD_AVX512;
+        return true;
+    }
+    if (strcmp(name, "auto") == 0) {
+        *level = simd_detectLevel();
+        return true;
+    }
+    return false;
+}
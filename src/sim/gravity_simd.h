@@ -0,0 +1,25 @@
+#ifndef GRAVITY_SIMD_H
+#define GRAVITY_SIMD_H
+
+#include "../types.h"
+
+// pair kernel: exact forces for rows [row_begin, row_end) of the i < j triangle (see body_calculateGravForceRows)
+typedef bool (*simd_pair_kernel_t)(const body_soa_t* soa, int count, int row_begin, int row_end,
+                                   double* fx, double* fy, double* fz, int* collided_i, int* collided_j);
+
+// swarm kernel: kick then drift for test particles [begin, end) against every body (see swarm_kickDriftRange)
+typedef void (*simd_swarm_kernel_t)(const body_soa_t* soa, int body_count, swarm_t* swarm, int begin, int end,
+                                    double kick, double drift);
+
+// kepler kernel: state vectors for elements [begin, end) of a batch (see kepler_elementsToStateRange)
+typedef void (*simd_kepler_kernel_t)(const kepler_batch_t* batch, int begin, int end);
+
+simd_level_t simd_detectLevel(void);
+bool simd_isSupported(simd_level_t level);
+simd_pair_kernel_t simd_pairKernel(simd_level_t level);
+simd_swarm_kernel_t simd_swarmKernel(simd_level_t level);
+simd_kepler_kernel_t simd_keplerKernel(simd_level_t level);
+const char* simd_levelName(simd_level_t level);
+bool simd_parseLevelName(const char* name, simd_level_t* level);
+
+#endif
@@ -0,0 +1,323 @@
+#include "hermite.h"
+#include "gravity.h"
+#include "../math/matrix.h"
+#include "../utility/thread_pool.h"
+#include <math.h>
+#include <stdlib.h>
+#include "../utility/error_hook.h"
+
+#define HERMITE_INITIAL_ETA 0.01          // first steps are this fraction of |a| / |j|
+#define HERMITE_PARALLEL_MIN_PAIRS 131072 // active bodies * all bodies below which the pool costs more than it saves
+#define HERMITE_TILE_ROWS 32              // active bodies handed out at a time
+
+hermite_state_t hermite_defaultState(void) {
+    return (hermite_state_t){
+        .eta = 0.01,
+        .max_level = 20
+    };
+}
+
+// grows every per body array to the new capacity
+static bool hermite_reserve(hermite_state_t* hs, const int count) {
+    if (count <= hs->capacity) return true;
+
+    double** fields[] = {
+        &hs->jerk_x, &hs->jerk_y, &hs->jerk_z,
+        &hs->pred_pos_x, &hs->pred_pos_y, &hs->pred_pos_z,
+        &hs->pred_vel_x, &hs->pred_vel_y, &hs->pred_vel_z,
+        &hs->acc_new_x, &hs->acc_new_y, &hs->acc_new_z,
+        &hs->jerk_new_x, &hs->jerk_new_y, &hs->jerk_new_z
+    };
+    for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+        double* temp = (double*)realloc(*fields[f], count * sizeof(double));
+        if (temp == NULL) return false;
+        *fields[f] = temp;
+    }
+    long long* tick = (long long*)realloc(hs->tick, count * sizeof(long long));
+    if (tick == NULL) return false;
+    hs->tick = tick;
+    int* level = (int*)realloc(hs->level, count * sizeof(int));
+    if (level == NULL) return false;
+    hs->level = level;
+    int* active = (int*)realloc(hs->active, count * sizeof(int));
+    if (active == NULL) return false;
+    hs->active = active;
+
+    hs->capacity = count;
+    hs->initialized = false;
+    return true;
+}
+
+// frees the per body arrays (the settings are kept)
+void hermite_freeState(hermite_state_t* hs) {
+    double* fields[] = {
+        hs->jerk_x, hs->jerk_y, hs->jerk_z,
+        hs->pred_pos_x, hs->pred_pos_y, hs->pred_pos_z,
+        hs->pred_vel_x, hs->pred_vel_y, hs->pred_vel_z,
+        hs->acc_new_x, hs->acc_new_y, hs->acc_new_z,
+        hs->jerk_new_x, hs->jerk_new_y, hs->jerk_new_z
+    };
+    for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+        free(fields[f]);
+    }
+    free(hs->tick);
+    free(hs->level);
+    free(hs->active);
+
+    const double eta = hs->eta;
+    const int max_level = hs->max_level;
+    *hs = (hermite_state_t){.eta = eta, .max_level = max_level};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// FORCE AND JERK
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// acceleration and jerk on body i from every other body, all at their predicted state
+// returns false (and the other body in collided_j) if body i is inside another body
+static bool hermite_evaluate(hermite_state_t* hs, const body_soa_t* soa, const int count, const int i, int* collided_j) {
+    const double px = hs->pred_pos_x[i], py = hs->pred_pos_y[i], pz = hs->pred_pos_z[i];
+    const double vx = hs->pred_vel_x[i], vy = hs->pred_vel_y[i], vz = hs->pred_vel_z[i];
+    const double radius_squared = soa->radius[i] * soa->radius[i];
+    double ax = 0.0, ay = 0.0, az = 0.0;
+    double jx = 0.0, jy = 0.0, jz = 0.0;
+
+    for (int j = 0; j < count; j++) {
+        if (j == i) continue;
+        const double dx = hs->pred_pos_x[j] - px;
+        const double dy = hs->pred_pos_y[j] - py;
+        const double dz = hs->pred_pos_z[j] - pz;
+        const double r_squared = dx * dx + dy * dy + dz * dz;
+        if (r_squared < radius_squared) {
+            *collided_j = j;
+            return false;
+        }
+        const double dvx = hs->pred_vel_x[j] - vx;
+        const double dvy = hs->pred_vel_y[j] - vy;
+        const double dvz = hs->pred_vel_z[j] - vz;
+
+        const double mu_inv_r3 = soa->mu[j] / (r_squared * sqrt(r_squared));
+        const double rv = 3.0 * (dx * dvx + dy * dvy + dz * dvz) / r_squared;
+        ax += dx * mu_inv_r3;
+        ay += dy * mu_inv_r3;
+        az += dz * mu_inv_r3;
+        jx += (dvx - rv * dx) * mu_inv_r3;
+        jy += (dvy - rv * dy) * mu_inv_r3;
+        jz += (dvz - rv * dz) * mu_inv_r3;
+    }
+
+    hs->acc_new_x[i] = ax; hs->acc_new_y[i] = ay; hs->acc_new_z[i] = az;
+    hs->jerk_new_x[i] = jx; hs->jerk_new_y[i] = jy; hs->jerk_new_z[i] = jz;
+    return true;
+}
+
+typedef struct {
+    hermite_state_t* hs;
+    const body_soa_t* soa;
+    int count;
+    int active_count;
+    int collided_i[POOL_MAX_THREADS];
+    int collided_j[POOL_MAX_THREADS];
+} hermite_task_t;
+
+// active bodies are independent, so each thread writes the results of its own tiles
+static void hermite_evaluateTask(void* ctx, const int thread_index, const int thread_count) {
+    hermite_task_t* task = (hermite_task_t*)ctx;
+    const int tile_count = (task->active_count + HERMITE_TILE_ROWS - 1) / HERMITE_TILE_ROWS;
+
+    for (int tile = thread_index; tile < tile_count; tile += thread_count) {
+        const int begin = tile * HERMITE_TILE_ROWS;
+        const int end = begin + HERMITE_TILE_ROWS < task->active_count ? begin + HERMITE_TILE_ROWS : task->active_count;
+        for (int k = begin; k < end; k++) {
+            const int i = task->hs->active[k];
+            int other = -1;
+            if (!hermite_evaluate(task->hs, task->soa, task->count, i, &other)) {
+                task->collided_i[thread_index] = i;
+                task->collided_j[thread_index] = other;
+                return;
+            }
+        }
+    }
+}
+
+// evaluates every active body, on the worker pool when there is enough work
+static bool hermite_evaluateActive(sim_properties_t* sim, const int active_count) {
+    hermite_state_t* hs = &sim->hermite;
+    const int n = sim->gb.count;
+    hs->force_evaluations += active_count;
+
+    if ((long long)active_count * n >= HERMITE_PARALLEL_MIN_PAIRS) {
+        gravity_updateThreadPool(sim);
+    }
+    if (sim->pool != NULL && (long long)active_count * n >= HERMITE_PARALLEL_MIN_PAIRS) {
+        hermite_task_t task = {.hs = hs, .soa = &sim->gb.soa, .count = n, .active_count = active_count};
+        for (int t = 0; t < sim->pool->thread_count; t++) {
+            task.collided_i[t] = -1;
+            task.collided_j[t] = -1;
+        }
+        pool_run(sim->pool, hermite_evaluateTask, &task);
+        for (int t = 0; t < sim->pool->thread_count; t++) {
+            if (task.collided_i[t] >= 0) {
+                gravity_reportCollision(sim, task.collided_i[t], task.collided_j[t]);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    for (int k = 0; k < active_count; k++) {
+        int other = -1;
+        if (!hermite_evaluate(hs, &sim->gb.soa, n, hs->active[k], &other)) {
+            gravity_reportCollision(sim, hs->active[k], other);
+            return false;
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// STEP SIZES
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// level of the first step from |a| / |j| (jerk free bodies start on the block step)
+static int hermite_initialLevel(const double dt, const int max_level, const vec3 acc, const vec3 jerk) {
+    const double jerk_mag = vec3_mag(jerk);
+    const double wanted = jerk_mag > 0.0 ? HERMITE_INITIAL_ETA * vec3_mag(acc) / jerk_mag : INFINITY;
+    int level = 0;
+    while (level < max_level && ldexp(dt, -level) > wanted) level++;
+    return level;
+}
+
+// next level from the Aarseth (1985) criterion, with snap and crackle from the Hermite interpolant of the step just taken.
+// steps are halved as often as needed but only doubled one level at a time, and only where the coarser step lines up with the block grid
+static int hermite_nextLevel(const hermite_state_t* hs, const int max_level, const int level, const long long tick, const long long block_ticks,
+                             const double h, const vec3 a0, const vec3 a1, const vec3 j0, const vec3 j1) {
+    const vec3 da = vec3_sub(a0, a1);
+    const vec3 snap0 = vec3_scale(vec3_add(vec3_scale(da, -6.0), vec3_scale(vec3_add(vec3_scale(j0, 4.0), vec3_scale(j1, 2.0)), -h)), 1.0 / (h * h));
+    const vec3 crackle = vec3_scale(vec3_add(vec3_scale(da, 12.0), vec3_scale(vec3_add(j0, j1), 6.0 * h)), 1.0 / (h * h * h));
+    const vec3 snap1 = vec3_add(snap0, vec3_scale(crackle, h));
+
+    const double jerk_mag = vec3_mag(j1);
+    const double snap_mag = vec3_mag(snap1);
+    const double numerator = vec3_mag(a1) * snap_mag + jerk_mag * jerk_mag;
+    const double denominator = jerk_mag * vec3_mag(crackle) + snap_mag * snap_mag;
+    const double wanted = denominator > 0.0 ? sqrt(hs->eta * numerator / denominator) : INFINITY;
+
+    int next = level;
+    while (next < max_level && h * ldexp(1.0, level - next) > wanted) next++;
+    if (next == level && level > 0 && wanted >= 2.0 * h && tick % (block_ticks >> (level - 1)) == 0) next--;
+    return next;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// STEP
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// advances every body by one block of dt with 4th order Hermite predictor-corrector steps (Makino & Aarseth 1992).
+// each body has its own step of dt / 2^level, and only the bodies due at a sub step get their force and jerk evaluated,
+// so a tightly bound moon no longer drags the outer planets down to its step size
+void hermite_step(sim_properties_t* sim, const double dt) {
+    body_soa_t* soa = &sim->gb.soa;
+    hermite_state_t* hs = &sim->hermite;
+    const int n = sim->gb.count;
+    if (n == 0 || dt <= 0.0) return;
+
+    if (!hermite_reserve(hs, n)) {
+        sim->wp.sim_running = false;
+        displayError("ERROR", "Failed to allocate the Hermite integrator state");
+        return;
+    }
+
+    int max_level = hs->max_level;
+    if (max_level < 0) max_level = 0;
+    if (max_level > HERMITE_MAX_LEVELS) max_level = HERMITE_MAX_LEVELS;
+    const long long block_ticks = 1LL << max_level;
+    const double tick_length = dt / (double)block_ticks;
+
+    // every block starts with all bodies in sync
+    for (int i = 0; i < n; i++) {
+        hs->tick[i] = 0;
+        if (hs->level[i] > max_level) hs->level[i] = max_level;
+    }
+
+    // (re)start from the current state if the bodies were changed or moved by another integrator since the last block
+    if (!hs->initialized || hs->count != n || hs->block_step != dt || hs->sync_time != sim->wp.sim_time) {
+        for (int i = 0; i < n; i++) {
+            hs->pred_pos_x[i] = soa->pos_x[i]; hs->pred_pos_y[i] = soa->pos_y[i]; hs->pred_pos_z[i] = soa->pos_z[i];
+            hs->pred_vel_x[i] = soa->vel_x[i]; hs->pred_vel_y[i] = soa->vel_y[i]; hs->pred_vel_z[i] = soa->vel_z[i];
+            hs->active[i] = i;
+        }
+        if (!hermite_evaluateActive(sim, n)) {
+            hs->initialized = false;
+            return;
+        }
+        for (int i = 0; i < n; i++) {
+            soa->acc_x[i] = hs->acc_new_x[i]; soa->acc_y[i] = hs->acc_new_y[i]; soa->acc_z[i] = hs->acc_new_z[i];
+            hs->jerk_x[i] = hs->jerk_new_x[i]; hs->jerk_y[i] = hs->jerk_new_y[i]; hs->jerk_z[i] = hs->jerk_new_z[i];
+            hs->level[i] = hermite_initialLevel(dt, max_level,
+                (vec3){soa->acc_x[i], soa->acc_y[i], soa->acc_z[i]}, (vec3){hs->jerk_x[i], hs->jerk_y[i], hs->jerk_z[i]});
+        }
+        hs->count = n;
+        hs->block_step = dt;
+        hs->initialized = true;
+    }
+
+    long long now = 0;
+    while (now < block_ticks) {
+        // the next sub step is the earliest end of any body's step, and every body ending there is active
+        long long next = block_ticks;
+        for (int i = 0; i < n; i++) {
+            const long long end = hs->tick[i] + (block_ticks >> hs->level[i]);
+            if (end < next) next = end;
+        }
+        int active_count = 0;
+        for (int i = 0; i < n; i++) {
+            if (hs->tick[i] + (block_ticks >> hs->level[i]) == next) hs->active[active_count++] = i;
+        }
+
+        // predict every body to the sub step time from its last corrected state
+        for (int i = 0; i < n; i++) {
+            const double h = (double)(next - hs->tick[i]) * tick_length;
+            const double h2 = 0.5 * h * h;
+            const double h3 = h * h * h / 6.0;
+            hs->pred_pos_x[i] = soa->pos_x[i] + soa->vel_x[i] * h + soa->acc_x[i] * h2 + hs->jerk_x[i] * h3;
+            hs->pred_pos_y[i] = soa->pos_y[i] + soa->vel_y[i] * h + soa->acc_y[i] * h2 + hs->jerk_y[i] * h3;
+            hs->pred_pos_z[i] = soa->pos_z[i] + soa->vel_z[i] * h + soa->acc_z[i] * h2 + hs->jerk_z[i] * h3;
+            hs->pred_vel_x[i] = soa->vel_x[i] + soa->acc_x[i] * h + hs->jerk_x[i] * h2;
+            hs->pred_vel_y[i] = soa->vel_y[i] + soa->acc_y[i] * h + hs->jerk_y[i] * h2;
+            hs->pred_vel_z[i] = soa->vel_z[i] + soa->acc_z[i] * h + hs->jerk_z[i] * h2;
+        }
+
+        if (!hermite_evaluateActive(sim, active_count)) {
+            hs->initialized = false;
+            return;
+        }
+
+        // correct the active bodies and pick their next step
+        for (int k = 0; k < active_count; k++) {
+            const int i = hs->active[k];
+            const double h = (double)(next - hs->tick[i]) * tick_length;
+            const vec3 x0 = {soa->pos_x[i], soa->pos_y[i], soa->pos_z[i]};
+            const vec3 v0 = {soa->vel_x[i], soa->vel_y[i], soa->vel_z[i]};
+            const vec3 a0 = {soa->acc_x[i], soa->acc_y[i], soa->acc_z[i]};
+            const vec3 j0 = {hs->jerk_x[i], hs->jerk_y[i], hs->jerk_z[i]};
+            const vec3 a1 = {hs->acc_new_x[i], hs->acc_new_y[i], hs->acc_new_z[i]};
+            const vec3 j1 = {hs->jerk_new_x[i], hs->jerk_new_y[i], hs->jerk_new_z[i]};
+
+            const vec3 v1 = vec3_add(v0, vec3_add(vec3_scale(vec3_add(a0, a1), 0.5 * h), vec3_scale(vec3_sub(j0, j1), h * h / 12.0)));
+            const vec3 x1 = vec3_add(x0, vec3_add(vec3_scale(vec3_add(v0, v1), 0.5 * h), vec3_scale(vec3_sub(a0, a1), h * h / 12.0)));
+
+            hs->level[i] = hermite_nextLevel(hs, max_level, hs->level[i], next, block_ticks, h, a0, a1, j0, j1);
+            hs->tick[i] = next;
+
+            soa->pos_x[i] = x1.x; soa->pos_y[i] = x1.y; soa->pos_z[i] = x1.z;
+            soa->vel_x[i] = v1.x; soa->vel_y[i] = v1.y; soa->vel_z[i] = v1.z;
+            soa->acc_x[i] = a1.x; soa->acc_y[i] = a1.y; soa->acc_z[i] = a1.z;
+            hs->jerk_x[i] = j1.x; hs->jerk_y[i] = j1.y; hs->jerk_z[i] = j1.z;
+            soa->force_x[i] = a1.x * soa->mass[i];
+            soa->force_y[i] = a1.y * soa->mass[i];
+            soa->force_z[i] = a1.z * soa->mass[i];
+        }
+        now = next;
+    }
+
+    hs->block_count++;
+    hs->sync_time = sim->wp.sim_time + dt;
+}
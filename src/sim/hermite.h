@@ -0,0 +1,12 @@
+#ifndef HERMITE_H
+#define HERMITE_H
+
+#include "../types.h"
+
+#define HERMITE_MAX_LEVELS 40 // ticks per block are 2^max_level, so this keeps them inside a long long
+
+hermite_state_t hermite_defaultState(void);
+void hermite_step(sim_properties_t* sim, double dt);
+void hermite_freeState(hermite_state_t* hs);
+
+#endif
@@ -0,0 +1,416 @@
+#include "integrator.h"
+#include "bodies.h"
+#include "spacecraft.h"
+#include "gravity.h"
+#include "gravity_simd.h"
+#include "kepler.h"
+#include "hermite.h"
+#include "../math/matrix.h"
+#include <math.h>
+#include <string.h>
+
+// Yoshida (1990) composition weights -- every stage is one drift-kick-drift leapfrog step of weight * dt
+static const double YOSHIDA4_WEIGHTS[] = {
+    1.3512071919596578, -1.7024143839193153, 1.3512071919596578
+};
+static const double YOSHIDA6_WEIGHTS[] = {
+    0.784513610477560, 0.235573213359357, -1.17767998417887, 1.315186320683906,
+    -1.17767998417887, 0.235573213359357, 0.784513610477560
+};
+
+const char* integrator_name(const integrator_t integrator) {
+    switch (integrator) {
+        case INTEGRATOR_YOSHIDA4: return "yoshida4";
+        case INTEGRATOR_YOSHIDA6: return "yoshida6";
+        case INTEGRATOR_WISDOM_HOLMAN: return "wisdom-holman";
+        case INTEGRATOR_HERMITE: return "hermite";
+        case INTEGRATOR_VERLET:
+        default: return "verlet";
+    }
+}
+
+// accepts the names used by the console and the scenario json
+bool integrator_parseName(const char* name, integrator_t* integrator) {
+    if (strcmp(name, "verlet") == 0) {
+        *integrator = INTEGRATOR_VERLET;
+        return true;
+    }
+    if (strcmp(name, "yoshida4") == 0) {
+        *integrator = INTEGRATOR_YOSHIDA4;
+        return true;
+    }
+    if (strcmp(name, "yoshida6") == 0) {
+        *integrator = INTEGRATOR_YOSHIDA6;
+        return true;
+    }
+    if (strcmp(name, "wisdom-holman") == 0 || strcmp(name, "wisdom_holman") == 0 || strcmp(name, "wh") == 0) {
+        *integrator = INTEGRATOR_WISDOM_HOLMAN;
+        return true;
+    }
+    if (strcmp(name, "hermite") == 0) {
+        *integrator = INTEGRATOR_HERMITE;
+        return true;
+    }
+    return false;
+}
+
+// craft moved by this integrator (none while the adaptive craft propagator is on)
+static int integrator_craftCount(const sim_properties_t* sim) {
+    return sim->cp.adaptive ? 0 : sim->gs.count;
+}
+
+// moves every craft along its current velocity
+static void integrator_driftCraft(sim_properties_t* sim, const double h) {
+    for (int i = 0; i < integrator_craftCount(sim); i++) {
+        spacecraft_t* craft = &sim->gs.spacecraft[i];
+        if (craft->on_rails) continue;
+        craft->pos = vec3_add(craft->pos, vec3_scale(craft->vel, h));
+    }
+}
+
+// evaluates the craft forces at the current body positions and changes every craft velocity by acc * h
+static void integrator_kickCraft(sim_properties_t* sim, const double h) {
+    for (int i = 0; i < integrator_craftCount(sim); i++) {
+        spacecraft_t* craft = &sim->gs.spacecraft[i];
+        if (craft->on_rails) continue;
+        craft->grav_force = vec3_zero();
+        craft->closest_r_squared = INFINITY;
+        for (int j = 0; j < sim->gb.count; j++) {
+            craft_calculateGravForce(sim, i, j);
+        }
+        sim->cp.force_evaluations++;
+        craft_applyThrust(craft);
+        craft->acc = vec3_scale(craft->grav_force, 1.0 / craft->current_total_mass);
+        craft->vel = vec3_add(craft->vel, vec3_scale(craft->acc, h));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// YOSHIDA COMPOSITION
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// moves every body and craft along its current velocity
+static void integrator_drift(sim_properties_t* sim, const double h) {
+    body_soa_t* soa = &sim->gb.soa;
+    for (int i = 0; i < sim->gb.count; i++) {
+        soa->pos_x[i] += soa->vel_x[i] * h;
+        soa->pos_y[i] += soa->vel_y[i] * h;
+        soa->pos_z[i] += soa->vel_z[i] * h;
+    }
+    integrator_driftCraft(sim, h);
+}
+
+// evaluates the forces at the current positions and changes every velocity by acc * h
+static void integrator_kick(sim_properties_t* sim, const double h) {
+    body_soa_t* soa = &sim->gb.soa;
+
+    gravity_calculateForces(sim);
+    for (int i = 0; i < sim->gb.count; i++) {
+        const double inv_mass = 1.0 / soa->mass[i];
+        soa->acc_x[i] = soa->force_x[i] * inv_mass;
+        soa->acc_y[i] = soa->force_y[i] * inv_mass;
+        soa->acc_z[i] = soa->force_z[i] * inv_mass;
+        soa->vel_x[i] += soa->acc_x[i] * h;
+        soa->vel_y[i] += soa->acc_y[i] * h;
+        soa->vel_z[i] += soa->acc_z[i] * h;
+    }
+    integrator_kickCraft(sim, h);
+}
+
+// symmetric composition of leapfrog steps (neighbouring half drifts are merged, so one force evaluation per stage)
+static void integrator_composition(sim_properties_t* sim, const double* weights, const int stage_count, const double dt) {
+    integrator_drift(sim, 0.5 * weights[0] * dt);
+    for (int s = 0; s < stage_count; s++) {
+        integrator_kick(sim, weights[s] * dt);
+        if (sim->wp.reset_sim) return;
+
+        const double next_weight = s + 1 < stage_count ? weights[s + 1] : 0.0;
+        integrator_drift(sim, 0.5 * (weights[s] + next_weight) * dt);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// WISDOM-HOLMAN
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// democratic heliocentric coordinates (Duncan, Levison & Lee 1998): positions relative to body 0,
+// velocities relative to the barycenter. body 0 itself only carries the center of mass motion, which is stored separately
+typedef struct {
+    vec3 com_pos;
+    vec3 com_vel;
+    double total_mass;
+} wh_frame_t;
+
+static wh_frame_t integrator_toHeliocentric(sim_properties_t* sim) {
+    body_soa_t* soa = &sim->gb.soa;
+    const int n = sim->gb.count;
+    wh_frame_t frame = {0};
+
+    for (int i = 0; i < n; i++) {
+        frame.total_mass += soa->mass[i];
+        frame.com_pos = vec3_add(frame.com_pos, vec3_scale((vec3){soa->pos_x[i], soa->pos_y[i], soa->pos_z[i]}, soa->mass[i]));
+        frame.com_vel = vec3_add(frame.com_vel, vec3_scale((vec3){soa->vel_x[i], soa->vel_y[i], soa->vel_z[i]}, soa->mass[i]));
+    }
+    frame.com_pos = vec3_scale(frame.com_pos, 1.0 / frame.total_mass);
+    frame.com_vel = vec3_scale(frame.com_vel, 1.0 / frame.total_mass);
+
+    const vec3 central = {soa->pos_x[0], soa->pos_y[0], soa->pos_z[0]};
+    for (int i = 1; i < n; i++) {
+        soa->pos_x[i] -= central.x;
+        soa->pos_y[i] -= central.y;
+        soa->pos_z[i] -= central.z;
+        soa->vel_x[i] -= frame.com_vel.x;
+        soa->vel_y[i] -= frame.com_vel.y;
+        soa->vel_z[i] -= frame.com_vel.z;
+    }
+    for (int i = 0; i < integrator_craftCount(sim); i++) {
+        spacecraft_t* craft = &sim->gs.spacecraft[i];
+        if (craft->on_rails) continue;
+        craft->pos = vec3_sub(craft->pos, central);
+        craft->vel = vec3_sub(craft->vel, frame.com_vel);
+    }
+    return frame;
+}
+
+static void integrator_fromHeliocentric(sim_properties_t* sim, const wh_frame_t* frame) {
+    body_soa_t* soa = &sim->gb.soa;
+    const int n = sim->gb.count;
+
+    // body 0 sits where the barycenter ends up and carries the momentum the others do not
+    vec3 mass_offset = vec3_zero();
+    vec3 momentum = vec3_zero();
+    for (int i = 1; i < n; i++) {
+        mass_offset = vec3_add(mass_offset, vec3_scale((vec3){soa->pos_x[i], soa->pos_y[i], soa->pos_z[i]}, soa->mass[i]));
+        momentum = vec3_add(momentum, vec3_scale((vec3){soa->vel_x[i], soa->vel_y[i], soa->vel_z[i]}, soa->mass[i]));
+    }
+    const vec3 central_pos = vec3_sub(frame->com_pos, vec3_scale(mass_offset, 1.0 / frame->total_mass));
+    const vec3 central_vel = vec3_sub(frame->com_vel, vec3_scale(momentum, 1.0 / soa->mass[0]));
+
+    soa->pos_x[0] = central_pos.x; soa->pos_y[0] = central_pos.y; soa->pos_z[0] = central_pos.z;
+    soa->vel_x[0] = central_vel.x; soa->vel_y[0] = central_vel.y; soa->vel_z[0] = central_vel.z;
+    for (int i = 1; i < n; i++) {
+        soa->pos_x[i] += central_pos.x;
+        soa->pos_y[i] += central_pos.y;
+        soa->pos_z[i] += central_pos.z;
+        soa->vel_x[i] += frame->com_vel.x;
+        soa->vel_y[i] += frame->com_vel.y;
+        soa->vel_z[i] += frame->com_vel.z;
+    }
+    for (int i = 0; i < integrator_craftCount(sim); i++) {
+        spacecraft_t* craft = &sim->gs.spacecraft[i];
+        if (craft->on_rails) continue;
+        craft->pos = vec3_add(craft->pos, central_pos);
+        craft->vel = vec3_add(craft->vel, frame->com_vel);
+    }
+}
+
+// linear drift from the kinetic energy of body 0 (every heliocentric position moves by the same amount)
+static void integrator_jump(sim_properties_t* sim, const double h) {
+    body_soa_t* soa = &sim->gb.soa;
+    vec3 momentum = vec3_zero();
+    for (int i = 1; i < sim->gb.count; i++) {
+        momentum = vec3_add(momentum, vec3_scale((vec3){soa->vel_x[i], soa->vel_y[i], soa->vel_z[i]}, soa->mass[i]));
+    }
+    const vec3 shift = vec3_scale(momentum, h / soa->mass[0]);
+
+    for (int i = 1; i < sim->gb.count; i++) {
+        soa->pos_x[i] += shift.x;
+        soa->pos_y[i] += shift.y;
+        soa->pos_z[i] += shift.z;
+    }
+    for (int i = 0; i < integrator_craftCount(sim); i++) {
+        spacecraft_t* craft = &sim->gs.spacecraft[i];
+        if (craft->on_rails) continue;
+        craft->pos = vec3_add(craft->pos, shift);
+    }
+}
+
+// exact two body motion around body 0
+static void integrator_kepler(sim_properties_t* sim, const double h) {
+    body_soa_t* soa = &sim->gb.soa;
+    const double mu = soa->mu[0];
+
+    for (int i = 1; i < sim->gb.count; i++) {
+        vec3 pos = {soa->pos_x[i], soa->pos_y[i], soa->pos_z[i]};
+        vec3 vel = {soa->vel_x[i], soa->vel_y[i], soa->vel_z[i]};
+        if (!kepler_drift(mu, &pos, &vel, h)) {
+            pos = vec3_add(pos, vec3_scale(vel, h)); // solver failure (e.g. a body passing through the center), drift straight
+        }
+        soa->pos_x[i] = pos.x; soa->pos_y[i] = pos.y; soa->pos_z[i] = pos.z;
+        soa->vel_x[i] = vel.x; soa->vel_y[i] = vel.y; soa->vel_z[i] = vel.z;
+    }
+    for (int i = 0; i < integrator_craftCount(sim); i++) {
+        spacecraft_t* craft = &sim->gs.spacecraft[i];
+        if (craft->on_rails) continue;
+        if (!kepler_drift(mu, &craft->pos, &craft->vel, h)) {
+            craft->pos = vec3_add(craft->pos, vec3_scale(craft->vel, h));
+        }
+    }
+}
+
+// velocity change from everything except body 0 (plus engine thrust for the craft)
+// heliocentric differences equal the inertial ones, so the regular pair kernel is used on rows 1..n
+static void integrator_interactionKick(sim_properties_t* sim, const double h) {
+    body_soa_t* soa = &sim->gb.soa;
+    const int n = sim->gb.count;
+
+    body_resetForces(&sim->gb);
+    sim->gp.force_evaluations++;
+    sim->gp.direct_pairs += (long long)(n - 1) * (n - 2) / 2;
+    int collided_i = -1, collided_j = -1;
+    if (!simd_pairKernel(sim->gp.simd_level)(soa, n, 1, n, soa->force_x, soa->force_y, soa->force_z, &collided_i, &collided_j)) {
+        gravity_reportCollision(sim, collided_i, collided_j);
+        return;
+    }
+
+    vec3 central_acc = vec3_zero();
+    for (int i = 1; i < n; i++) {
+        const double inv_mass = 1.0 / soa->mass[i];
+        soa->vel_x[i] += soa->force_x[i] * inv_mass * h;
+        soa->vel_y[i] += soa->force_y[i] * inv_mass * h;
+        soa->vel_z[i] += soa->force_z[i] * inv_mass * h;
+
+        // full acceleration (including body 0) at the middle of the step, for display and telemetry
+        const vec3 q = {soa->pos_x[i], soa->pos_y[i], soa->pos_z[i]};
+        const double r = vec3_mag(q);
+        const double inv_r3 = r > 0.0 ? 1.0 / (r * r * r) : 0.0;
+        soa->acc_x[i] = soa->force_x[i] * inv_mass - soa->mu[0] * q.x * inv_r3;
+        soa->acc_y[i] = soa->force_y[i] * inv_mass - soa->mu[0] * q.y * inv_r3;
+        soa->acc_z[i] = soa->force_z[i] * inv_mass - soa->mu[0] * q.z * inv_r3;
+        central_acc = vec3_add(central_acc, vec3_scale(q, soa->mu[i] * inv_r3));
+    }
+    soa->acc_x[0] = central_acc.x;
+    soa->acc_y[0] = central_acc.y;
+    soa->acc_z[0] = central_acc.z;
+
+    for (int i = 0; i < integrator_craftCount(sim); i++) {
+        spacecraft_t* craft = &sim->gs.spacecraft[i];
+        if (craft->on_rails) continue;
+        craft->current_total_mass = craft->fuel_mass + craft->dry_mass;
+        craft->grav_force = vec3_zero();
+        craft_applyThrust(craft);
+
+        vec3 acc = vec3_scale(craft->grav_force, 1.0 / craft->current_total_mass);
+        sim->cp.force_evaluations++;
+        for (int j = 1; j < n; j++) {
+            const vec3 delta = {soa->pos_x[j] - craft->pos.x, soa->pos_y[j] - craft->pos.y, soa->pos_z[j] - craft->pos.z};
+            const double r_squared = vec3_mag_sq(delta);
+            if (r_squared == 0.0) continue;
+            acc = vec3_add(acc, vec3_scale(delta, soa->mu[j] / (r_squared * sqrt(r_squared))));
+        }
+        craft->vel = vec3_add(craft->vel, vec3_scale(acc, h));
+    }
+}
+
+// second order Wisdom-Holman map in drift-kick-drift form: only one interaction evaluation per step,
+// so steps can be a sizeable fraction of the shortest orbit as long as body 0 dominates the system
+static void integrator_wisdomHolman(sim_properties_t* sim, const double dt) {
+    body_soa_t* soa = &sim->gb.soa;
+    wh_frame_t frame = integrator_toHeliocentric(sim);
+
+    integrator_jump(sim, 0.5 * dt);
+    integrator_kepler(sim, 0.5 * dt);
+    integrator_interactionKick(sim, dt);
+    integrator_kepler(sim, 0.5 * dt);
+    integrator_jump(sim, 0.5 * dt);
+
+    // collisions with body 0 are not seen by the interaction kick
+    const double radius_squared = soa->radius[0] * soa->radius[0];
+    for (int i = 1; i < sim->gb.count && !sim->wp.reset_sim; i++) {
+        const double r_squared = soa->pos_x[i] * soa->pos_x[i] + soa->pos_y[i] * soa->pos_y[i] + soa->pos_z[i] * soa->pos_z[i];
+        if (r_squared < radius_squared) {
+            gravity_reportCollision(sim, 0, i);
+        }
+    }
+
+    // the barycenter moves in a straight line
+    frame.com_pos = vec3_add(frame.com_pos, vec3_scale(frame.com_vel, dt));
+    integrator_fromHeliocentric(sim, &frame);
+
+    // full craft forces in the inertial frame (updates the closest body, SOI and craft collisions)
+    for (int i = 0; i < integrator_craftCount(sim) && !sim->wp.reset_sim; i++) {
+        spacecraft_t* craft = &sim->gs.spacecraft[i];
+        if (craft->on_rails) continue;
+        craft->grav_force = vec3_zero();
+        craft->closest_r_squared = INFINITY;
+        for (int j = 0; j < sim->gb.count; j++) {
+            craft_calculateGravForce(sim, i, j);
+        }
+        sim->cp.force_evaluations++;
+        craft_applyThrust(craft);
+        craft->acc = vec3_scale(craft->grav_force, 1.0 / craft->current_total_mass);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// BLOCK TIMESTEP HERMITE
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// bodies take their own Hermite sub steps inside the block, craft take one kick-drift-kick leapfrog step across it
+// (craft that need finer steps near a moon should use the adaptive craft propagator, which follows the bodies at any step)
+static void integrator_blockHermite(sim_properties_t* sim, const double dt) {
+    integrator_kickCraft(sim, 0.5 * dt);
+    if (sim->wp.reset_sim) return;
+    integrator_driftCraft(sim, dt);
+
+    hermite_step(sim, dt);
+    if (sim->wp.reset_sim) return;
+
+    integrator_kickCraft(sim, 0.5 * dt);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// STEP
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// advances all bodies and craft by dt with the selected higher order integrator
+// (velocity verlet keeps its own path in runCalculations)
+void integrator_step(sim_properties_t* sim, const double dt) {
+    body_properties_t* gb = &sim->gb;
+    body_soa_t* soa = &gb->soa;
+    const spacecraft_properties_t* sc = &sim->gs;
+    if (gb->bodies == NULL || gb->count == 0) return;
+
+    // engine state is held for the whole step
+    for (int i = 0; i < integrator_craftCount(sim); i++) {
+        craft_checkBurnSchedule(&sc->spacecraft[i], gb, sim->wp.sim_time);
+    }
+
+    switch (sim->wp.integrator) {
+        case INTEGRATOR_YOSHIDA4:
+            integrator_composition(sim, YOSHIDA4_WEIGHTS, (int)(sizeof(YOSHIDA4_WEIGHTS) / sizeof(YOSHIDA4_WEIGHTS[0])), dt);
+            break;
+        case INTEGRATOR_YOSHIDA6:
+            integrator_composition(sim, YOSHIDA6_WEIGHTS, (int)(sizeof(YOSHIDA6_WEIGHTS) / sizeof(YOSHIDA6_WEIGHTS[0])), dt);
+            break;
+        case INTEGRATOR_WISDOM_HOLMAN:
+            if (gb->count > 1) integrator_wisdomHolman(sim, dt);
+            else integrator_composition(sim, YOSHIDA4_WEIGHTS, 3, dt);
+            break;
+        case INTEGRATOR_HERMITE:
+            integrator_blockHermite(sim, dt);
+            break;
+        case INTEGRATOR_VERLET:
+        default:
+            return;
+    }
+    if (sim->wp.reset_sim) return;
+
+    // keep the verlet history consistent in case the integrator is switched back
+    for (int i = 0; i < gb->count; i++) {
+        soa->acc_prev_x[i] = soa->acc_x[i];
+        soa->acc_prev_y[i] = soa->acc_y[i];
+        soa->acc_prev_z[i] = soa->acc_z[i];
+        body_updateRotation(&gb->bodies[i], dt);
+    }
+    body_calculateKineticEnergy(gb);
+    body_syncSideTable(gb);
+
+    for (int i = 0; i < integrator_craftCount(sim); i++) {
+        spacecraft_t* craft = &sc->spacecraft[i];
+        if (craft->on_rails) continue;
+        craft_consumeFuel(craft, dt);
+        craft->acc_prev = craft->acc;
+        craft->vel_mag = vec3_mag(craft->vel);
+
+        if (craft->SOI_planet_id >= 0 && craft->SOI_planet_id < gb->count) {
+            craft_calculateOrbitalElements(craft, &gb->bodies[craft->SOI_planet_id]);
+        }
+    }
+}
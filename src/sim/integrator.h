@@ -0,0 +1,10 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include "../types.h"
+
+const char* integrator_name(integrator_t integrator);
+bool integrator_parseName(const char* name, integrator_t* integrator);
+void integrator_step(sim_properties_t* sim, double dt);
+
+#endif
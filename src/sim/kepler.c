@@ -0,0 +1,213 @@
+#include "kepler.h"
+#include "gravity.h"
+#include "gravity_simd.h"
+#include "../globals.h"
+#include "../utility/thread_pool.h"
+#include <math.h>
+
+// Stumpff functions c2(z) = (1 - cos(sqrt z)) / z and c3(z) = (sqrt z - sin(sqrt z)) / z^1.5
+// (series near zero, where the closed forms lose all their digits)
+static void kepler_stumpff(const double z, double* c2, double* c3) {
+    if (fabs(z) < 1e-4) {
+        *c2 = 0.5 - z / 24.0 + z * z / 720.0;
+        *c3 = 1.0 / 6.0 - z / 120.0 + z * z / 5040.0;
+    } else if (z > 0.0) {
+        const double s = sqrt(z);
+        *c2 = (1.0 - cos(s)) / z;
+        *c3 = (s - sin(s)) / (z * s);
+    } else {
+        const double s = sqrt(-z);
+        *c2 = (1.0 - cosh(s)) / z;
+        *c3 = (sinh(s) - s) / (-z * s);
+    }
+}
+
+// advances a two body orbit around a fixed center with gravitational parameter mu by dt
+// universal variable formulation, so it works for elliptic, parabolic and hyperbolic orbits alike
+// pos and vel are relative to the center, returns false (and leaves them untouched) if the solver fails
+bool kepler_drift(const double mu, vec3* pos, vec3* vel, double dt) {
+    const double r0 = vec3_mag(*pos);
+    if (r0 == 0.0 || mu <= 0.0 || dt == 0.0) return dt == 0.0;
+
+    const double sqrt_mu = sqrt(mu);
+    const double v0_sq = vec3_mag_sq(*vel);
+    const double rv = vec3_dot(*pos, *vel);
+    const double alpha = 2.0 / r0 - v0_sq / mu; // 1 / semi major axis
+
+    // whole periods of a bound orbit change nothing, so only the remainder is solved for
+    if (alpha > 0.0) {
+        const double period = 2.0 * PI / (sqrt_mu * alpha * sqrt(alpha));
+        if (fabs(dt) > period) dt = fmod(dt, period);
+    }
+
+    // starting guess for the universal anomaly
+    double chi;
+    if (alpha > 1e-12 / r0) {
+        chi = sqrt_mu * dt * alpha;
+    } else if (alpha < -1e-12 / r0) {
+        const double a = 1.0 / alpha;
+        const double sign = dt > 0.0 ? 1.0 : -1.0;
+        const double arg = -2.0 * mu * alpha * dt / (rv + sign * sqrt(-mu * a) * (1.0 - r0 * alpha));
+        chi = arg > 0.0 ? sign * sqrt(-a) * log(arg) : sqrt_mu * dt / r0;
+    } else {
+        chi = sqrt_mu * dt / r0;
+    }
+
+    // Laguerre-Conway iteration on the universal Kepler equation (converges from far worse guesses than Newton)
+    const double sigma0 = rv / sqrt_mu;
+    const double beta = 1.0 - alpha * r0;
+    double c2 = 0.5, c3 = 1.0 / 6.0, r = r0;
+    bool converged = false;
+    for (int k = 0; k < KEPLER_MAX_ITERATIONS; k++) {
+        const double chi_sq = chi * chi;
+        const double z = alpha * chi_sq;
+        kepler_stumpff(z, &c2, &c3);
+
+        const double f = sigma0 * chi_sq * c2 + beta * chi_sq * chi * c3 + r0 * chi - sqrt_mu * dt;
+        const double df = sigma0 * chi * (1.0 - z * c3) + beta * chi_sq * c2 + r0;
+        const double ddf = sigma0 * (1.0 - z * c2) + beta * chi * (1.0 - z * c3);
+        r = df;
+
+        const double n = 5.0;
+        const double root = sqrt(fabs((n - 1.0) * (n - 1.0) * df * df - n * (n - 1.0) * f * ddf));
+        const double denom = df + (df >= 0.0 ? root : -root);
+        if (denom == 0.0) break;
+        const double delta = n * f / denom;
+        chi -= delta;
+
+        if (fabs(delta) <= KEPLER_TOLERANCE * fmax(1.0, fabs(chi))) {
+            converged = true;
+            break;
+        }
+    }
+    if (!converged || !isfinite(chi)) return false;
+
+    // Lagrange coefficients at the converged anomaly
+    const double chi_sq = chi * chi;
+    const double z = alpha * chi_sq;
+    kepler_stumpff(z, &c2, &c3);
+    r = sigma0 * chi * (1.0 - z * c3) + beta * chi_sq * c2 + r0;
+
+    const double f = 1.0 - chi_sq / r0 * c2;
+    const double g = dt - chi_sq * chi / sqrt_mu * c3;
+    const double f_dot = sqrt_mu / (r * r0) * chi * (z * c3 - 1.0);
+    const double g_dot = 1.0 - chi_sq / r * c2;
+
+    const vec3 p0 = *pos;
+    const vec3 v0 = *vel;
+    *pos = vec3_add(vec3_scale(p0, f), vec3_scale(v0, g));
+    *vel = vec3_add(vec3_scale(p0, f_dot), vec3_scale(v0, g_dot));
+    return true;
+}
+
+// angle wrapped to [-pi, pi] (2 pi is subtracted in two parts, so large angles keep their digits)
+double kepler_wrapAngle(const double angle) {
+    const double q = nearbyint(angle * (1.0 / (2.0 * PI)));
+    return (angle - q * KEPLER_TWO_PI_HI) - q * KEPLER_TWO_PI_LO;
+}
+
+// eccentric anomaly for a mean anomaly in [-pi, pi], e < 1: newton from danby's starting guess, which
+// converges for every eccentricity (the vector kernel runs the same iteration on several elements at once)
+static double kepler_solveElliptic(const double e, const double mean_anomaly) {
+    double E = mean_anomaly + copysign(0.85 * e, mean_anomaly);
+    for (int k = 0; k < KEPLER_MAX_ITERATIONS; k++) {
+        const double delta = (E - e * sin(E) - mean_anomaly) / (1.0 - e * cos(E));
+        E -= delta;
+        if (fabs(delta) <= KEPLER_TOLERANCE) break;
+    }
+    return E;
+}
+
+// hyperbolic anomaly for e > 1 (the mean anomaly is not periodic here, so it is not wrapped)
+static double kepler_solveHyperbolic(const double e, const double mean_anomaly) {
+    double H = copysign(log(2.0 * fabs(mean_anomaly) / e + 1.8), mean_anomaly);
+    for (int k = 0; k < KEPLER_MAX_ITERATIONS; k++) {
+        const double delta = (e * sinh(H) - H - mean_anomaly) / (e * cosh(H) - 1.0);
+        H -= delta;
+        if (fabs(delta) <= KEPLER_TOLERANCE * fmax(1.0, fabs(H))) break;
+    }
+    return H;
+}
+
+// state vectors for elements [begin, end) of a batch, the inverse of craft_calculateOrbitalElements
+// (reference for the vector kernel in gravity_simd.c, which also leaves hyperbolic orbits to this one)
+void kepler_elementsToStateRange(const kepler_batch_t* batch, const int begin, const int end) {
+    for (int i = begin; i < end; i++) {
+        const double e = batch->e[i];
+        const double a = fabs(batch->a[i]);
+
+        // perifocal frame: x towards periapsis, y along the motion at periapsis
+        double x, y, vx, vy;
+        if (e < 1.0) {
+            const double E = kepler_solveElliptic(e, kepler_wrapAngle(batch->mean_anomaly[i]));
+            const double cos_E = cos(E), sin_E = sin(E);
+            const double b = sqrt(1.0 - e * e);
+            const double v = sqrt(batch->mu * a) / (a * (1.0 - e * cos_E));
+            x = a * (cos_E - e);
+            y = a * b * sin_E;
+            vx = -v * sin_E;
+            vy = v * b * cos_E;
+        } else {
+            const double H = kepler_solveHyperbolic(e, batch->mean_anomaly[i]);
+            const double cosh_H = cosh(H), sinh_H = sinh(H);
+            const double b = sqrt(e * e - 1.0);
+            const double v = sqrt(batch->mu * a) / (a * (e * cosh_H - 1.0));
+            x = a * (e - cosh_H);
+            y = a * b * sinh_H;
+            vx = -v * sinh_H;
+            vy = v * b * cosh_H;
+        }
+
+        // rotate by the argument of periapsis, the inclination and the ascending node
+        const double raan = kepler_wrapAngle(batch->raan[i]);
+        const double argp = kepler_wrapAngle(batch->argp[i]);
+        const double inc = kepler_wrapAngle(batch->inc[i]);
+        const double cos_O = cos(raan), sin_O = sin(raan);
+        const double cos_w = cos(argp), sin_w = sin(argp);
+        const double cos_i = cos(inc), sin_i = sin(inc);
+        const vec3 p = {cos_O * cos_w - sin_O * sin_w * cos_i, sin_O * cos_w + cos_O * sin_w * cos_i, sin_w * sin_i};
+        const vec3 q = {-cos_O * sin_w - sin_O * cos_w * cos_i, -sin_O * sin_w + cos_O * cos_w * cos_i, cos_w * sin_i};
+
+        batch->pos_x[i] = x * p.x + y * q.x;
+        batch->pos_y[i] = x * p.y + y * q.y;
+        batch->pos_z[i] = x * p.z + y * q.z;
+        batch->vel_x[i] = vx * p.x + vy * q.x;
+        batch->vel_y[i] = vx * p.y + vy * q.y;
+        batch->vel_z[i] = vx * p.z + vy * q.z;
+    }
+}
+
+typedef struct {
+    const kepler_batch_t* batch;
+    simd_kepler_kernel_t kernel;
+} kepler_task_t;
+
+// elements are independent, so each thread converts its own tiles
+static void kepler_convertTask(void* ctx, const int thread_index, const int thread_count) {
+    const kepler_task_t* task = (const kepler_task_t*)ctx;
+    const int n = task->batch->count;
+    const int tile_count = (n + KEPLER_TILE - 1) / KEPLER_TILE;
+
+    for (int tile = thread_index; tile < tile_count; tile += thread_count) {
+        const int begin = tile * KEPLER_TILE;
+        const int end = begin + KEPLER_TILE < n ? begin + KEPLER_TILE : n;
+        task->kernel(task->batch, begin, end);
+    }
+}
+
+// converts a whole batch with the vector kernel of the current simd level (on the worker pool for large ones)
+void kepler_elementsToStates(sim_properties_t* sim, const kepler_batch_t* batch) {
+    const kepler_task_t task = {
+        .batch = batch,
+        .kernel = simd_keplerKernel(sim->gp.simd_level)
+    };
+    if (batch->count >= KEPLER_PARALLEL_MIN) {
+        gravity_updateThreadPool(sim);
+    }
+    if (sim->pool != NULL && batch->count >= KEPLER_PARALLEL_MIN) {
+        pool_run(sim->pool, kepler_convertTask, (void*)&task);
+    }
+    else {
+        task.kernel(batch, 0, batch->count);
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef KEPLER_H
+#define KEPLER_H
+
+#include "../types.h"
+#include "../math/matrix.h"
+
+#define KEPLER_MAX_ITERATIONS 50
+#define KEPLER_TOLERANCE 1e-13
+#define KEPLER_TWO_PI_HI 6.28318530717958623200e+00 // 2 pi rounded to a double
+#define KEPLER_TWO_PI_LO 2.44929359829470635445e-16 // what the rounding cut off
+#define KEPLER_PARALLEL_MIN 4096                    // elements before the conversion goes to the worker pool
+#define KEPLER_TILE 1024                            // elements per task of a pool thread
+
+bool kepler_drift(double mu, vec3* pos, vec3* vel, double dt);
+double kepler_wrapAngle(double angle);
+void kepler_elementsToStateRange(const kepler_batch_t* batch, int begin, int end);
+void kepler_elementsToStates(sim_properties_t* sim, const kepler_batch_t* batch);
+
+#endif
@@ -2,9 +2,29 @@
 #include "../globals.h"
 #include "../sim/bodies.h"
 #include "../sim/spacecraft.h"
+#include "../sim/gravity.h"
+#include "../sim/integrator.h"
+#include "../sim/craft_propagator.h"
+#include "../sim/hermite.h"
+#include "../sim/swarm.h"
+#include "../sim/barnes_hut.h"
+#include "../sim/fmm.h"
+#include "../utility/commands.h"
+#include "../utility/telemetry_export.h"
+#include "../utility/autosave.h"
 #include "../math/matrix.h"
 #include <math.h>
 #include <stdlib.h>
+#include <time.h>
+
+#define BATCH_MAX_STEPS 1000000 // upper limit of the auto tuned batch size
+
+// wall clock time in seconds
+static double simulation_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
 
 // calculate total system energy for all bodies
 double calculateTotalSystemEnergy(const sim_properties_t* sim) {
@@ -14,10 +34,12 @@ double calculateTotalSystemEnergy(const sim_properties_t* sim) {
     double total_kinetic = 0.0;
     double total_potential = 0.0;
 
+    const body_soa_t* soa = &gb->soa;
+
     // calculate kinetic energy for all bodies
     for (int i = 0; i < gb->count; i++) {
-        const body_t* body = &gb->bodies[i];
-        total_kinetic += 0.5 * body->mass * body->vel_mag * body->vel_mag;
+        const double v_sq = soa->vel_x[i] * soa->vel_x[i] + soa->vel_y[i] * soa->vel_y[i] + soa->vel_z[i] * soa->vel_z[i];
+        total_kinetic += 0.5 * soa->mass[i] * v_sq;
     }
 
     // calculate kinetic energy for all spacecraft
@@ -29,12 +51,12 @@ double calculateTotalSystemEnergy(const sim_properties_t* sim) {
     // calculate potential energy between all body pairs
     for (int i = 0; i < gb->count; i++) {
         for (int j = i + 1; j < gb->count; j++) {
-            const body_t* bi = &gb->bodies[i];
-            const body_t* bj = &gb->bodies[j];
-            const vec3 delta = vec3_sub(bj->pos, bi->pos);
-            const double r = vec3_mag(delta);
+            const double dx = soa->pos_x[j] - soa->pos_x[i];
+            const double dy = soa->pos_y[j] - soa->pos_y[i];
+            const double dz = soa->pos_z[j] - soa->pos_z[i];
+            const double r = sqrt(dx * dx + dy * dy + dz * dz);
             if (r > 0) {
-                total_potential += -(G * bi->mass * bj->mass) / r;
+                total_potential += -(soa->mu[i] * soa->mass[j]) / r;
             }
         }
     }
@@ -43,11 +65,12 @@ double calculateTotalSystemEnergy(const sim_properties_t* sim) {
     for (int i = 0; i < sc->count; i++) {
         for (int j = 0; j < gb->count; j++) {
             const spacecraft_t* craft = &sc->spacecraft[i];
-            const body_t* body = &gb->bodies[j];
-            const vec3 delta = vec3_sub(body->pos, craft->pos);
-            const double r = vec3_mag(delta);
+            const double dx = soa->pos_x[j] - craft->pos.x;
+            const double dy = soa->pos_y[j] - craft->pos.y;
+            const double dz = soa->pos_z[j] - craft->pos.z;
+            const double r = sqrt(dx * dx + dy * dy + dz * dz);
             if (r > 0) {
-                total_potential += -(G * craft->current_total_mass * body->mass) / r;
+                total_potential += -(craft->current_total_mass * soa->mu[j]) / r;
             }
         }
     }
@@ -64,17 +87,20 @@ void resetSim(sim_properties_t* sim) {
     // reset simulation time
     wp->sim_time = 0;
     wp->reset_sim = false;
+    wp->reset_count++;
+    sim->scheduled_count = 0; // commands timed for the old run are dropped
+    sim->telemetry.next_time = 0.0; // logging continues into the same file from t = 0
+    sim->telemetry.step_counter = 0;
+    sim->autosave.pending = false; // a checkpoint due before the reset is not wanted any more
 
     // free all bodies
-    if (gb->bodies != NULL) {
-        for (int i = 0; i < gb->count; i++) {
-            free(gb->bodies[i].name);
-        }
-        free(gb->bodies);
-        gb->bodies = NULL;
-        gb->count = 0;
-        gb->capacity = 0;
-    }
+    body_freeStorage(gb);
+    body_freeHistory(&sim->history);
+    hermite_freeState(&sim->hermite);
+    swarm_freeStorage(&sim->swarm);
+    sim->cp.force_evaluations = 0;
+    sim->gp.force_evaluations = 0;
+    sim->gp.direct_pairs = 0;
 
     // free all spacecraft
     if (sc->spacecraft != NULL) {
@@ -90,42 +116,73 @@ void resetSim(sim_properties_t* sim) {
 }
 
 void runCalculations(sim_properties_t* sim) {
-    const body_properties_t* gb = &sim->gb;
+    body_properties_t* gb = &sim->gb;
     const spacecraft_properties_t* sc = &sim->gs;
     window_params_t* wp = &sim->wp;
 
-    if (wp->sim_running) {
+    // aligned telemetry: a step that would pass the next sample time is shortened to end exactly on it
+    const double full_step = wp->time_step;
+    const double until_sample = telemetry_nextTime(sim) - wp->sim_time;
+    if (until_sample > 1e-9 * fmax(1.0, fabs(wp->sim_time)) && until_sample < full_step) wp->time_step = until_sample;
+
+    // the adaptive craft propagator needs the body state at the start of the step
+    if (sim->cp.adaptive && wp->sim_running && gb->count > 0) {
+        body_recordHistory(gb, &sim->history, CRAFT_HISTORY_FRAMES, wp->sim_time);
+    }
+    else if (!sim->cp.adaptive && sim->history.time != NULL) {
+        // switched back to the fixed step: craft continue from their state at the sim time
+        craft_publishAdaptive(sim);
+        body_freeHistory(&sim->history);
+        for (int i = 0; i < sc->count; i++) {
+            sc->spacecraft[i].prop_step = 0.0;
+        }
+    }
+
+    // coasting craft get on and off their analytic orbits for the coming step
+    if (wp->sim_running && gb->count > 0 && sc->count > 0) {
+        craft_updateRails(sim);
+    }
+
+    // test particles get their first half kick and drift against the bodies at the start of the step
+    const double swarm_step = wp->time_step;
+    const bool swarm_active = wp->sim_running && gb->count > 0 && sim->swarm.count > 0;
+    if (swarm_active) {
+        swarm_beginStep(sim, swarm_step);
+    }
+
+    if (wp->sim_running && wp->integrator != INTEGRATOR_VERLET) {
+        // higher order integrators move bodies and craft together
+        integrator_step(sim, wp->time_step);
+        if (gb->bodies != NULL && gb->count > 0) {
+            wp->sim_time += wp->time_step;
+        }
+    }
+    else if (wp->sim_running) {
         ////////////////////////////////////////////////////////////////
         // calculate forces between all body pairs
         ////////////////////////////////////////////////////////////////
         if (gb->bodies != NULL && gb->count > 0) {
-            // reset forces to zero
-            for (int i = 0; i < gb->count; i++) {
-                gb->bodies[i].force = vec3_zero();
-            }
-
-            // calculate gravitational forces between all body pairs
-            for (int i = 0; i < gb->count; i++) {
-                for (int j = i + 1; j < gb->count; j++) {
-                    body_calculateGravForce(sim, i, j);
-                }
-            }
+            // calculate gravitational forces on all bodies with the selected solver
+            gravity_calculateForces(sim);
 
             // calculate kinetic energy and update motion for each body
+            body_calculateKineticEnergy(gb);
+            body_updateMotion(gb, wp->time_step);
             for (int i = 0; i < gb->count; i++) {
-                body_t* body = &gb->bodies[i];
-                body_calculateKineticEnergy(body);
-                body_updateMotion(body, wp->time_step);
-                body_updateRotation(body, wp->time_step);
+                body_updateRotation(&gb->bodies[i], wp->time_step);
             }
+
+            // refresh the body_t copy of the state for everything outside the hot loops
+            body_syncSideTable(gb);
         }
 
         ////////////////////////////////////////////////////////////////
         // calculate forces between spacecraft and bodies
         ////////////////////////////////////////////////////////////////
-        if (sc->spacecraft != NULL && sc->count > 0 && gb->bodies != NULL && gb->count > 0) {
+        if (!sim->cp.adaptive && sc->spacecraft != NULL && sc->count > 0 && gb->bodies != NULL && gb->count > 0) {
             for (int i = 0; i < sc->count; i++) {
                 spacecraft_t* craft = &sc->spacecraft[i];
+                if (craft->on_rails) continue;
                 craft->grav_force = vec3_zero();
                 craft->closest_r_squared = INFINITY;
 
@@ -136,6 +193,7 @@ void runCalculations(sim_properties_t* sim) {
                 for (int j = 0; j < gb->count; j++) {
                     craft_calculateGravForce(sim, i, j);
                 }
+                sim->cp.force_evaluations++;
 
                 // apply thrust and consume fuel
                 craft_applyThrust(craft);
@@ -145,6 +203,7 @@ void runCalculations(sim_properties_t* sim) {
             // update motion and orbital elements for each craft
             for (int i = 0; i < sc->count; i++) {
                 spacecraft_t* craft = &sc->spacecraft[i];
+                if (craft->on_rails) continue;
                 craft_updateMotion(craft, wp->time_step);
 
                 // calculate orbital elements relative to the SOI body (or closest body)
@@ -159,20 +218,113 @@ void runCalculations(sim_properties_t* sim) {
             wp->sim_time += wp->time_step;
         }
     }
+
+    // and their second half kick against the bodies at the end of it
+    if (swarm_active && !wp->reset_sim && gb->count > 0) {
+        swarm_endStep(sim, swarm_step);
+    }
+
+    // adaptive craft catch up with the bodies as far as the new body state allows
+    if (sim->cp.adaptive && wp->sim_running && !wp->reset_sim && gb->count > 0) {
+        body_recordHistory(gb, &sim->history, CRAFT_HISTORY_FRAMES, wp->sim_time);
+        craft_propagateAdaptive(sim);
+    }
+
+    // craft on rails follow their orbit to the new time
+    if (wp->sim_running && !wp->reset_sim && gb->count > 0 && sc->count > 0) {
+        craft_advanceRails(sim);
+    }
+
+    // hand the new state to the telemetry writer thread if a sample is due, same for automatic checkpoints
+    if (wp->sim_running && !wp->reset_sim) {
+        telemetry_sample(sim);
+        autosave_tick(sim);
+    }
+    wp->time_step = full_step;
+}
+
+// runs a batch of steps (stops early when the sim is paused or a reset is requested) and sizes the next
+// batch so it takes about half a display frame, returns the number of steps taken
+// console commands are applied between the steps, a step that would pass the time of a scheduled
+// command is shortened to end exactly on it
+int runCalculationsBatch(sim_properties_t* sim) {
+    physics_batch_t* batch = &sim->batch;
+    window_params_t* wp = &sim->wp;
+    const double budget = 0.5 / (wp->refresh_rate > 0.0f ? wp->refresh_rate : 60.0);
+    int planned = batch->fixed_steps > 0 ? batch->fixed_steps : (batch->steps > 0 ? batch->steps : 1);
+
+    // when paced, a batch never covers more sim time than the wall clock allows in one budget
+    if (batch->realtime_factor > 0.0 && wp->time_step > 0.0) {
+        planned = (int)fmax(1.0, fmin(planned, batch->realtime_factor * budget / wp->time_step));
+    }
+
+    const double start = simulation_now();
+    int taken = 0;
+    while (taken < planned) {
+        command_processQueue(sim);
+        if (!wp->sim_running || wp->reset_sim) break;
+
+        const double step = wp->time_step;
+        const double until_command = command_nextTime(sim) - wp->sim_time;
+        if (until_command > 0.0 && until_command < step) wp->time_step = until_command;
+        runCalculations(sim);
+        wp->time_step = step;
+        taken++;
+    }
+    const double end = simulation_now();
+    const double elapsed = end - start;
+    if (taken == 0 || elapsed <= 0.0) return taken;
+
+    // the displayed rate covers the time between batches too (pacing sleeps, waiting for the lock) and is
+    // smoothed so it does not jump around, the batch size only depends on what one step costs
+    const double rate = taken / elapsed;
+    const double since_last = end - batch->last_batch_end;
+    const double overall_rate = batch->last_batch_end > 0.0 && since_last > elapsed ? taken / since_last : rate;
+    batch->steps_per_second = batch->steps_per_second > 0.0 ? 0.8 * batch->steps_per_second + 0.2 * overall_rate : overall_rate;
+    batch->last_batch_end = end;
+
+    if (batch->fixed_steps > 0) {
+        batch->steps = batch->fixed_steps;
+    }
+    else {
+        // shrink right away when steps get slower, but grow at most 2x per batch so one fast batch
+        // (timer noise, a step that removed bodies) cannot make the next one stall the renderer
+        const double next = fmin(budget * rate, 2.0 * planned);
+        batch->steps = (int)fmax(1.0, fmin(next, BATCH_MAX_STEPS));
+    }
+    return taken;
+}
+
+// seconds the physics thread should wait before its next batch to hold the real time factor
+// (0 when not paced, or when the sim is behind the wall clock)
+double calculatePacingDelay(sim_properties_t* sim) {
+    physics_batch_t* batch = &sim->batch;
+    const double factor = batch->realtime_factor;
+    if (factor <= 0.0) return 0.0;
+
+    const double now = simulation_now();
+    const double target = batch->pace_sim_start + factor * (now - batch->pace_wall_start);
+    if (batch->pace_factor != factor || sim->wp.sim_time < target - 0.25 * factor) {
+        // new factor, resumed after a pause, reset, or too slow to keep up: pace from here instead of catching up
+        batch->pace_factor = factor;
+        batch->pace_wall_start = now;
+        batch->pace_sim_start = sim->wp.sim_time;
+        return 0.0;
+    }
+    return sim->wp.sim_time > target ? (sim->wp.sim_time - target) / factor : 0.0;
 }
 
 // cleanup for main
 void cleanup(sim_properties_t* sim) {
-    const body_properties_t* gb = &sim->gb;
+    body_properties_t* gb = &sim->gb;
     const spacecraft_properties_t* sc = &sim->gs;
 
+    // flush and close the telemetry file, finish the checkpoint being written
+    telemetry_stop(sim);
+    autosave_stop(sim);
+
     // free all bodies
-    if (gb->bodies != NULL) {
-        for (int i = 0; i < gb->count; i++) {
-            free(gb->bodies[i].name);
-        }
-        free(gb->bodies);
-    }
+    body_freeStorage(gb);
 
     // free all spacecraft
     if (sc->spacecraft != NULL) {
@@ -182,4 +334,12 @@ void cleanup(sim_properties_t* sim) {
         }
         free(sc->spacecraft);
     }
+
+    // free solver workspaces
+    bh_freeTree(&sim->bh_tree);
+    fmm_freeTree(&sim->fmm_tree);
+    gravity_freeWorkspace(sim);
+    body_freeHistory(&sim->history);
+    hermite_freeState(&sim->hermite);
+    swarm_freeStorage(&sim->swarm);
 }
@@ -6,6 +6,8 @@
 double calculateTotalSystemEnergy(const sim_properties_t* sim);
 void resetSim(sim_properties_t* sim);
 void runCalculations(sim_properties_t* sim);
+int runCalculationsBatch(sim_properties_t* sim);
+double calculatePacingDelay(sim_properties_t* sim);
 void cleanup(sim_properties_t* sim);
 
 #endif
@@ -6,8 +6,7 @@
 #include <stdlib.h>
 
 #include "../math/matrix.h"
-
-void displayError(const char* title, const char* message);
+#include "../utility/error_hook.h"
 
 // calculates orbital elements (this probably needs to be optimized somehow at some point because this seems very resource heavy)
 void craft_calculateOrbitalElements(spacecraft_t* craft, const body_t* body) {
@@ -153,19 +152,23 @@ void craft_checkBurnSchedule(spacecraft_t* craft, const body_properties_t* gb, c
 // calculates the force applied on a spacecraft by a specific body
 void craft_calculateGravForce(sim_properties_t* sim, const int craft_idx, const int body_idx) {
     spacecraft_t* craft = &sim->gs.spacecraft[craft_idx];
-    const body_t* body = &sim->gb.bodies[body_idx];
+    const body_soa_t* soa = &sim->gb.soa;
 
     // calculate the distance between the spacecraft and the body
-    const vec3 delta_pos = vec3_sub(body->pos, craft->pos);
+    const vec3 delta_pos = {
+        soa->pos_x[body_idx] - craft->pos.x,
+        soa->pos_y[body_idx] - craft->pos.y,
+        soa->pos_z[body_idx] - craft->pos.z
+    };
     const double r_squared = vec3_mag_sq(delta_pos);
     const double r = sqrt(r_squared);
 
     // planet collision logic
-    if (r < body->radius) {
+    if (r < soa->radius[body_idx]) {
         sim->wp.sim_running = false;
         sim->wp.reset_sim = true;
         char err_txt[128];
-        snprintf(err_txt, sizeof(err_txt), "Warning: %s has collided with %s\n\nResetting Simulation...", craft->name, body->name);
+        snprintf(err_txt, sizeof(err_txt), "Warning: %s has collided with %s\n\nResetting Simulation...", craft->name, sim->gb.bodies[body_idx].name);
         displayError("PLANET COLLISION", err_txt);
         return;
     }
@@ -175,7 +178,7 @@ void craft_calculateGravForce(sim_properties_t* sim, const int craft_idx, const
 
     // force = (G * m1 * m2) * delta / r^3
     const double r_cubed = r_squared * r;
-    const double force_factor = (G * craft->current_total_mass * body->mass) / r_cubed;
+    const double force_factor = (craft->current_total_mass * soa->mu[body_idx]) / r_cubed;
 
     // apply the force to the craft
     const vec3 force = vec3_scale(delta_pos, force_factor);
@@ -185,7 +188,7 @@ void craft_calculateGravForce(sim_properties_t* sim, const int craft_idx, const
     if (r_squared < craft->closest_r_squared) {
         craft->closest_r_squared = r_squared;
         craft->closest_planet_id = body_idx;
-        if (r <= body->SOI_radius) {
+        if (r <= sim->gb.bodies[body_idx].SOI_radius) {
             craft->SOI_planet_id = body_idx;
         }
     }
@@ -259,6 +262,16 @@ void craft_updateMotion(spacecraft_t* craft, const double dt) {
     craft->acc_prev = craft->acc;
 }
 
+// grows the spacecraft array to hold at least capacity craft (bulk loaders reserve once up front)
+bool craft_reserve(spacecraft_properties_t* gs, const int capacity) {
+    if (capacity <= gs->capacity) return true;
+    spacecraft_t* temp = (spacecraft_t*)realloc(gs->spacecraft, capacity * sizeof(spacecraft_t));
+    if (temp == NULL) return false;
+    gs->spacecraft = temp;
+    gs->capacity = capacity;
+    return true;
+}
+
 // adds a spacecraft to the spacecraft array
 void craft_addSpacecraft(spacecraft_properties_t* gs, const char* name,
                         const vec3 pos, const vec3 vel,
@@ -269,15 +282,9 @@ void craft_addSpacecraft(spacecraft_properties_t* gs, const char* name,
                         const burn_properties_t* burns, const int num_burns) {
 
     // grow capacity if needed
-    if (gs->count >= gs->capacity) {
-        const int new_capacity = gs->capacity == 0 ? 4 : gs->capacity * 2;
-        spacecraft_t* temp = (spacecraft_t*)realloc(gs->spacecraft, new_capacity * sizeof(spacecraft_t));
-        if (temp == NULL) {
-            displayError("ERROR", "Failed to allocate memory for spacecraft");
-            return;
-        }
-        gs->spacecraft = temp;
-        gs->capacity = new_capacity;
+    if (gs->count >= gs->capacity && !craft_reserve(gs, gs->capacity == 0 ? 4 : gs->capacity * 2)) {
+        displayError("ERROR", "Failed to allocate memory for spacecraft");
+        return;
     }
 
     const int idx = gs->count;
@@ -338,6 +345,15 @@ void craft_addSpacecraft(spacecraft_properties_t* gs, const char* name,
     craft->semi_major_axis = 0.0;
     craft->eccentricity = 0.0;
 
+    // picked up by the adaptive propagator on its next run
+    craft->prop_time = 0.0;
+    craft->prop_step = 0.0;
+    craft->prop_pos = pos;
+    craft->prop_vel = vel;
+    craft->prop_published = true;
+    craft->on_rails = false;
+    craft->rails_body = -1;
+
     // initialize burn schedule
     craft->num_burns = num_burns;
     if (num_burns > 0) {
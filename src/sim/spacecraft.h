@@ -9,6 +9,7 @@ void craft_updateMotion(spacecraft_t* craft, double dt);
 void craft_applyThrust(spacecraft_t* craft);
 void craft_checkBurnSchedule(spacecraft_t* craft, const body_properties_t* gb, double sim_time);
 void craft_consumeFuel(spacecraft_t* craft, double dt);
+bool craft_reserve(spacecraft_properties_t* gs, int capacity);
 void craft_addSpacecraft(spacecraft_properties_t* gs, const char* name,
                         vec3 pos, vec3 vel,
                         double dry_mass, double fuel_mass, double thrust,
@@ -0,0 +1,200 @@
+#include "swarm.h"
+#include "gravity.h"
+#include "gravity_simd.h"
+#include "../globals.h"
+#include "../math/matrix.h"
+#include "../utility/thread_pool.h"
+#include <math.h>
+#include <stdlib.h>
+#include "../utility/error_hook.h"
+
+#define SWARM_PARALLEL_MIN_PARTICLES 2048 // below this the pool costs more than it saves
+#define SWARM_TILE_PARTICLES 512          // particles handed out at a time
+
+// grows every array to the new capacity
+static bool swarm_grow(swarm_t* swarm, const int new_capacity) {
+    double** fields[] = {
+        &swarm->pos_x, &swarm->pos_y, &swarm->pos_z,
+        &swarm->vel_x, &swarm->vel_y, &swarm->vel_z
+    };
+    for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+        double* temp = (double*)realloc(*fields[f], new_capacity * sizeof(double));
+        if (temp == NULL) return false;
+        *fields[f] = temp;
+    }
+    int* hit_body = (int*)realloc(swarm->hit_body, new_capacity * sizeof(int));
+    if (hit_body == NULL) return false;
+    swarm->hit_body = hit_body;
+    swarm->capacity = new_capacity;
+    return true;
+}
+
+// makes room for at least capacity particles
+bool swarm_reserve(swarm_t* swarm, const int capacity) {
+    return capacity <= swarm->capacity || swarm_grow(swarm, capacity);
+}
+
+// adds one particle with an absolute position and velocity
+bool swarm_addParticle(swarm_t* swarm, const vec3 pos, const vec3 vel) {
+    if (swarm->count >= swarm->capacity) {
+        const int new_capacity = swarm->capacity == 0 ? 1024 : swarm->capacity * 2;
+        if (!swarm_grow(swarm, new_capacity)) {
+            displayError("ERROR", "Failed to allocate memory for swarm particles");
+            return false;
+        }
+    }
+    const int i = swarm->count++;
+    swarm->pos_x[i] = pos.x; swarm->pos_y[i] = pos.y; swarm->pos_z[i] = pos.z;
+    swarm->vel_x[i] = vel.x; swarm->vel_y[i] = vel.y; swarm->vel_z[i] = vel.z;
+    swarm->hit_body[i] = -1;
+    return true;
+}
+
+// adds count particles on circular orbits at the given altitude above a body, with random planes and phases
+// (a quick way to build a constellation or debris shell), returns the number added
+int swarm_addShell(swarm_t* swarm, const body_properties_t* gb, const int body, const int count, const double altitude, unsigned int seed) {
+    if (body < 0 || body >= gb->count || count <= 0) return 0;
+    const body_soa_t* soa = &gb->soa;
+    const vec3 center = {soa->pos_x[body], soa->pos_y[body], soa->pos_z[body]};
+    const vec3 center_vel = {soa->vel_x[body], soa->vel_y[body], soa->vel_z[body]};
+    const double r = soa->radius[body] + altitude;
+    const double speed = sqrt(soa->mu[body] / r);
+
+    int added = 0;
+    for (int k = 0; k < count; k++) {
+        double u[3];
+        for (int c = 0; c < 3; c++) {
+            seed = seed * 1664525u + 1013904223u;
+            u[c] = (seed >> 8) / 16777216.0;
+        }
+        // uniform orbit normal, then a random point on that orbit
+        const double cos_t = 2.0 * u[0] - 1.0;
+        const double sin_t = sqrt(1.0 - cos_t * cos_t);
+        const double phi = 2.0 * PI * u[1];
+        const vec3 normal = {sin_t * cos(phi), sin_t * sin(phi), cos_t};
+        const vec3 helper = fabs(normal.z) < 0.9 ? (vec3){0.0, 0.0, 1.0} : (vec3){1.0, 0.0, 0.0};
+        const vec3 e1 = vec3_normalize(vec3_cross(helper, normal));
+        const vec3 e2 = vec3_cross(normal, e1);
+        const double anomaly = 2.0 * PI * u[2];
+        const vec3 radial = vec3_add(vec3_scale(e1, cos(anomaly)), vec3_scale(e2, sin(anomaly)));
+        const vec3 along = vec3_cross(normal, radial);
+
+        if (!swarm_addParticle(swarm, vec3_add(center, vec3_scale(radial, r)), vec3_add(center_vel, vec3_scale(along, speed)))) break;
+        added++;
+    }
+    return added;
+}
+
+// reference kernel: kicks particles [begin, end) by kick * (acceleration from every body), then drifts them by drift
+// (the vector kernels in gravity_simd.c do the same several particles at a time and use this for the leftovers)
+void swarm_kickDriftRange(const body_soa_t* soa, const int body_count, swarm_t* swarm, const int begin, const int end,
+                          const double kick, const double drift) {
+    for (int i = begin; i < end; i++) {
+        const double px = swarm->pos_x[i], py = swarm->pos_y[i], pz = swarm->pos_z[i];
+        double ax = 0.0, ay = 0.0, az = 0.0;
+        for (int j = 0; j < body_count; j++) {
+            const double dx = soa->pos_x[j] - px;
+            const double dy = soa->pos_y[j] - py;
+            const double dz = soa->pos_z[j] - pz;
+            const double r_squared = dx * dx + dy * dy + dz * dz;
+            if (r_squared < soa->radius[j] * soa->radius[j]) swarm->hit_body[i] = j;
+            const double factor = soa->mu[j] / (r_squared * sqrt(r_squared));
+            ax += dx * factor;
+            ay += dy * factor;
+            az += dz * factor;
+        }
+        swarm->vel_x[i] += ax * kick;
+        swarm->vel_y[i] += ay * kick;
+        swarm->vel_z[i] += az * kick;
+        swarm->pos_x[i] = px + swarm->vel_x[i] * drift;
+        swarm->pos_y[i] = py + swarm->vel_y[i] * drift;
+        swarm->pos_z[i] = pz + swarm->vel_z[i] * drift;
+    }
+}
+
+typedef struct {
+    const body_soa_t* soa;
+    int body_count;
+    swarm_t* swarm;
+    simd_swarm_kernel_t kernel;
+    double kick;
+    double drift;
+} swarm_task_t;
+
+// particles are independent, so each thread moves its own tiles
+static void swarm_kickDriftTask(void* ctx, const int thread_index, const int thread_count) {
+    const swarm_task_t* task = (const swarm_task_t*)ctx;
+    const int n = task->swarm->count;
+    const int tile_count = (n + SWARM_TILE_PARTICLES - 1) / SWARM_TILE_PARTICLES;
+
+    for (int tile = thread_index; tile < tile_count; tile += thread_count) {
+        const int begin = tile * SWARM_TILE_PARTICLES;
+        const int end = begin + SWARM_TILE_PARTICLES < n ? begin + SWARM_TILE_PARTICLES : n;
+        task->kernel(task->soa, task->body_count, task->swarm, begin, end, task->kick, task->drift);
+    }
+}
+
+// kicks every particle with the current body positions, then drifts it (on the worker pool for large swarms)
+void swarm_kickDrift(sim_properties_t* sim, const double kick, const double drift) {
+    swarm_t* swarm = &sim->swarm;
+    if (swarm->count == 0 || sim->gb.count == 0) return;
+
+    swarm_task_t task = {
+        .soa = &sim->gb.soa,
+        .body_count = sim->gb.count,
+        .swarm = swarm,
+        .kernel = simd_swarmKernel(sim->gp.simd_level),
+        .kick = kick,
+        .drift = drift
+    };
+    if (swarm->count >= SWARM_PARALLEL_MIN_PARTICLES) {
+        gravity_updateThreadPool(sim);
+    }
+    if (sim->pool != NULL && swarm->count >= SWARM_PARALLEL_MIN_PARTICLES) {
+        pool_run(sim->pool, swarm_kickDriftTask, &task);
+    }
+    else {
+        task.kernel(task.soa, task.body_count, swarm, 0, swarm->count, kick, drift);
+    }
+}
+
+// first half of the kick-drift-kick step wrapped around the body step (bodies still at the start of the step)
+void swarm_beginStep(sim_properties_t* sim, const double dt) {
+    swarm_kickDrift(sim, 0.5 * dt, dt);
+}
+
+// second half kick with the bodies at the end of the step, then particles that ended up inside a body are removed
+void swarm_endStep(sim_properties_t* sim, const double dt) {
+    swarm_kickDrift(sim, 0.5 * dt, 0.0);
+    swarm_removeHits(&sim->swarm);
+}
+
+// removes the particles flagged as inside a body (keeps the order of the rest), returns the number removed
+int swarm_removeHits(swarm_t* swarm) {
+    int kept = 0;
+    for (int i = 0; i < swarm->count; i++) {
+        if (swarm->hit_body[i] >= 0) continue;
+        if (kept != i) {
+            swarm->pos_x[kept] = swarm->pos_x[i]; swarm->pos_y[kept] = swarm->pos_y[i]; swarm->pos_z[kept] = swarm->pos_z[i];
+            swarm->vel_x[kept] = swarm->vel_x[i]; swarm->vel_y[kept] = swarm->vel_y[i]; swarm->vel_z[kept] = swarm->vel_z[i];
+            swarm->hit_body[kept] = -1;
+        }
+        kept++;
+    }
+    const int removed = swarm->count - kept;
+    swarm->removed += removed;
+    swarm->count = kept;
+    return removed;
+}
+
+void swarm_freeStorage(swarm_t* swarm) {
+    double* fields[] = {
+        swarm->pos_x, swarm->pos_y, swarm->pos_z,
+        swarm->vel_x, swarm->vel_y, swarm->vel_z
+    };
+    for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++) {
+        free(fields[f]);
+    }
+    free(swarm->hit_body);
+    *swarm = (swarm_t){0};
+}
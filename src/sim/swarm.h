@@ -0,0 +1,16 @@
+#ifndef SWARM_H
+#define SWARM_H
+
+#include "../types.h"
+
+bool swarm_reserve(swarm_t* swarm, int capacity);
+bool swarm_addParticle(swarm_t* swarm, vec3 pos, vec3 vel);
+int swarm_addShell(swarm_t* swarm, const body_properties_t* gb, int body, int count, double altitude, unsigned int seed);
+void swarm_kickDriftRange(const body_soa_t* soa, int body_count, swarm_t* swarm, int begin, int end, double kick, double drift);
+void swarm_kickDrift(sim_properties_t* sim, double kick, double drift);
+void swarm_beginStep(sim_properties_t* sim, double dt);
+void swarm_endStep(sim_properties_t* sim, double dt);
+int swarm_removeHits(swarm_t* swarm);
+void swarm_freeStorage(swarm_t* swarm);
+
+#endif
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "utility/telemetry_reader.h"
+
+// reads series back out of a telemetry file: time range queries on chosen objects and channels, decoded
+// straight from the memory mapped file through the block index, optionally decimated for plotting
+
+#define QUERY_MAX_SERIES 64
+
+typedef struct {
+    const char* object;
+    const char* channel;
+    long long points;
+} query_series_t;
+
+static void printUsage(const char* program) {
+    printf("usage: %s <telemetry file> info\n"
+           "       %s <telemetry file> --object <name> --channel <channel> [options]\n"
+           "  --object <name>        body or craft to read, may be repeated\n"
+           "  --channel <channel>    channel to read (time, body.pos.x .. body.acc.z, craft.pos.x .. craft.vel.z), may be repeated\n"
+           "                         every object is read on every channel of its kind\n"
+           "  --from <seconds>       start of the sim time range (default start of the file)\n"
+           "  --to <seconds>         end of the sim time range (default end of the file)\n"
+           "  --points <N>           keep about N points per series (min and max of N / 2 time buckets)\n"
+           "output is csv: object,channel,time,value\n",
+           program, program);
+}
+
+static void printPoint(const double time, const double value, void* user) {
+    const query_series_t* series = (const query_series_t*)user;
+    printf("%s,%s,%.17g,%.17g\n", series->object, series->channel, time, value);
+}
+
+static void printInfo(const char* path, const telemetry_reader_t* reader) {
+    const int blocks = telemetry_readerBlockCount(reader);
+    long long samples = 0;
+    double t_first = INFINITY, t_last = -INFINITY;
+    for (int b = 0; b < blocks; b++) {
+        const telemetry_index_entry_t* entry = telemetry_readerIndex(reader, b);
+        samples += entry->sample_count;
+        t_first = fmin(t_first, entry->t_first);
+        t_last = fmax(t_last, entry->t_last);
+    }
+
+    printf("%s: version %d, %zu bytes, %d blocks, %lld samples%s\n", path, TELEMETRY_FORMAT_VERSION,
+        telemetry_readerSize(reader), blocks, samples, telemetry_readerIsComplete(reader) ? "" : " (no index, writer did not finish)");
+    if (blocks == 0) return;
+    printf("time: %.17g .. %.17g s, %.1f bytes per sample\n", t_first, t_last, (double)telemetry_readerSize(reader) / (double)samples);
+
+    // objects of the last block (the set can change when the sim is edited while logging)
+    telemetry_block_header_t header;
+    const char* names;
+    if (!telemetry_readerBlock(reader, blocks - 1, &header, &names)) return;
+    for (uint32_t i = 0; i < header.body_count + header.craft_count; i++) {
+        printf("%s: %s\n", i < header.body_count ? "body" : "craft", names);
+        names += strlen(names) + 1;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    const char* path = argv[1];
+    const char* objects[QUERY_MAX_SERIES];
+    const char* channels[QUERY_MAX_SERIES];
+    int object_count = 0;
+    int channel_count = 0;
+    bool info = false;
+    telemetry_query_t query = {.from = -INFINITY, .to = INFINITY, .max_points = 0};
+
+    for (int i = 2; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "info") == 0) info = true;
+        else if (strcmp(argv[i], "--object") == 0 && has_value && object_count < QUERY_MAX_SERIES) objects[object_count++] = argv[++i];
+        else if (strcmp(argv[i], "--channel") == 0 && has_value && channel_count < QUERY_MAX_SERIES) channels[channel_count++] = argv[++i];
+        else if (strcmp(argv[i], "--from") == 0 && has_value) query.from = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "--to") == 0 && has_value) query.to = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "--points") == 0 && has_value) query.max_points = atoi(argv[++i]);
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (!info && channel_count == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    for (int c = 0; c < channel_count; c++) {
+        telemetry_channel_t channel;
+        if (!telemetry_parseChannel(channels[c], &channel)) {
+            fprintf(stderr, "unknown channel %s\n", channels[c]);
+            return 1;
+        }
+    }
+
+    telemetry_reader_t* reader = telemetry_openReader(path);
+    if (reader == NULL) return 1;
+
+    if (info) {
+        printInfo(path, reader);
+        telemetry_closeReader(reader);
+        return 0;
+    }
+
+    // the time channel has no object, the others are read for every object of their kind
+    printf("object,channel,time,value\n");
+    int status = 0;
+    for (int c = 0; c < channel_count && status == 0; c++) {
+        telemetry_parseChannel(channels[c], &query.channel);
+        const int series_count = query.channel == TELEMETRY_CH_TIME ? 1 : object_count;
+        for (int o = 0; o < series_count; o++) {
+            query_series_t series = {.object = query.channel == TELEMETRY_CH_TIME ? "" : objects[o], .channel = channels[c]};
+            query.object = series.object;
+            series.points = telemetry_query(reader, &query, printPoint, &series);
+            if (series.points < 0) {
+                fprintf(stderr, "%s is corrupt\n", path);
+                status = 1;
+                break;
+            }
+            if (series.points == 0) {
+                fprintf(stderr, "no %s samples for %s in the range\n", series.channel, query.channel == TELEMETRY_CH_TIME ? "the file" : series.object);
+            }
+        }
+    }
+
+    telemetry_closeReader(reader);
+    return status;
+}
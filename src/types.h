@@ -2,15 +2,11 @@
 #define TYPES_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
-#include <SDL3/SDL.h>
-#include <GL/glew.h>
 
-#ifdef __APPLE__
-#include <OpenGL/gl.h>
-#else
-#include <GL/gl.h>
-#endif
+// sim and utility types only -- this header is shared with the headless build, so nothing in here may
+// pull in SDL or OpenGL (window, mesh and font types live in gui/gui_types.h)
 
 typedef struct {
     float x, y, z;
@@ -28,20 +24,30 @@ typedef struct {
     double w, x, y, z;
 } quaternion_t;
 
+// time integration scheme used by the physics step
+typedef enum {
+    INTEGRATOR_VERLET,        // velocity verlet, 2nd order (1 force evaluation per step)
+    INTEGRATOR_YOSHIDA4,      // Yoshida composition, 4th order (3 force evaluations per step)
+    INTEGRATOR_YOSHIDA6,      // Yoshida composition, 6th order (7 force evaluations per step)
+    INTEGRATOR_WISDOM_HOLMAN, // Kepler drift around body 0 plus interaction kicks, for hierarchical systems
+    INTEGRATOR_HERMITE        // 4th order Hermite with individual power of two block steps per body
+} integrator_t;
+
 typedef struct {
     int screen_width, screen_height;
     double time_step;
+    integrator_t integrator;
     float window_size_x, window_size_y;
 
     // 3D camera
     vec3_f camera_pos;    // camera position in world space (defined by a unit vector, whereas the magnitude is changed by the viewport zoom)
     float zoom;             // zoom level
 
-    volatile bool window_open;
-    bool data_logging_enabled;
-    volatile bool sim_running;
+    volatile bool window_open; // cleared by the render thread to shut the physics thread down
+    bool sim_running;
     double sim_time;
-    SDL_WindowID main_window_ID;
+    uint32_t main_window_ID; // SDL_WindowID of the main window
+    float refresh_rate; // display refresh rate (Hz), physics batches are tuned to it
 
     double meters_per_pixel;
 
@@ -52,6 +58,7 @@ typedef struct {
     float drag_last_x, drag_last_y;
 
     bool reset_sim;
+    int reset_count; // resets done so far, the renderer clears its paths when this changes
     bool is_zooming;
     bool is_zooming_out;
     bool is_zooming_in;
@@ -73,7 +80,7 @@ typedef struct {
     float log_pos_x, log_pos_y;
 } console_t;
 
-// celestial body
+// celestial body (side table -- the physics loops run on body_soa_t instead)
 typedef struct {
     char* name;
 
@@ -82,6 +89,7 @@ typedef struct {
     double SOI_radius;
     float pixel_radius;
 
+    // copy of the SoA state, refreshed once per step for the renderer, spacecraft and telemetry
     vec3 pos;
     vec3 vel;
     double vel_mag;
@@ -95,13 +103,147 @@ typedef struct {
     quaternion_t attitude;   // orientation quaternion
 } body_t;
 
+// structure-of-arrays storage for the fields touched by the force kernel and integrator every step
+// (each array is indexed the same way as body_properties_t.bodies)
+typedef struct {
+    double* pos_x; double* pos_y; double* pos_z;
+    double* vel_x; double* vel_y; double* vel_z;
+    double* acc_x; double* acc_y; double* acc_z;
+    double* acc_prev_x; double* acc_prev_y; double* acc_prev_z;
+    double* force_x; double* force_y; double* force_z;
+    double* mass;
+    double* mu;     // gravitational parameter (G * mass)
+    double* radius; // needed by the collision check in the pair loop
+} body_soa_t;
+
 // container for all bodies
 typedef struct {
     int count;
     int capacity;
-    body_t* bodies;
+    body_t* bodies;  // cold data (names, attitude, SOI, energies) + render copy of the state
+    body_soa_t soa;  // hot data
 } body_properties_t;
 
+// ring of recent body states (one frame per physics step), used to interpolate
+// body positions at the substep times of the adaptive spacecraft propagator
+typedef struct {
+    int capacity;      // frames
+    int body_count;    // bodies per frame
+    int head;          // next frame to write
+    int count;         // frames stored
+    double* time;      // [frame]
+    double* state;     // [frame][pos_x, pos_y, pos_z, vel_x, vel_y, vel_z][body]
+} body_history_t;
+
+// the two history frames around a time, looked up once and then used for every body
+typedef struct {
+    const double* before;
+    const double* after;
+    double u;  // position between the frames, 0..1
+    double h;  // time between the frames
+} body_history_cursor_t;
+
+// persistent worker pool (defined in utility/thread_pool.h)
+typedef struct worker_pool worker_pool_t;
+
+// per-thread force accumulators used by the parallel pair loop
+typedef struct {
+    double* data;     // 3 * body count doubles per thread
+    size_t capacity;  // doubles allocated
+} thread_force_buffer_t;
+
+// which algorithm computes the body-body gravity each step
+typedef enum {
+    GRAVITY_DIRECT,     // exact all-pairs sum -- the reference path
+    GRAVITY_BARNES_HUT, // octree approximation, O(N log N)
+    GRAVITY_FMM         // fast multipole method, O(N)
+} gravity_solver_t;
+
+// instruction set used by the direct summation pair kernel
+typedef enum {
+    SIMD_SCALAR, // portable C loop
+    SIMD_AVX2,   // 4 interactions at once (AVX2 + FMA)
+    SIMD_AVX512  // 8 interactions at once (AVX-512F)
+} simd_level_t;
+
+typedef struct {
+    gravity_solver_t solver;
+    simd_level_t simd_level; // best level the cpu supports unless overridden from the console
+    double theta;      // opening angle of the tree solvers (smaller is more accurate but slower)
+    double softening;  // softening length in meters (only used by the approximate solvers)
+    int fmm_order;     // number of terms in the FMM expansions (higher is more accurate)
+    int fmm_leaf_size; // max bodies in an FMM leaf cell
+    long long force_evaluations; // body force evaluations (any solver, not hermite) since the last reset
+    long long direct_pairs;      // body pairs those evaluations summed exactly (direct solver, wisdom-holman kick)
+} gravity_params_t;
+
+// force error of the selected solver measured against direct summation
+typedef struct {
+    int sample_count;
+    int non_finite;       // samples whose approximate acceleration was nan or inf (both errors are then infinite)
+    double max_rel_error;
+    double rms_rel_error;
+} gravity_error_t;
+
+// Barnes-Hut octree cell
+typedef struct {
+    double center_x, center_y, center_z; // geometric center of the cell
+    double half_size;
+    double com_x, com_y, com_z;          // center of mass
+    double mu;                           // G * total mass inside the cell
+    double open_radius_sq;               // the cell is opened when a body is closer than this (squared)
+    int begin, end;                      // range of body indices in bh_tree_t.index
+    int child[8];                        // -1 for empty octants
+    bool is_leaf;
+} bh_node_t;
+
+typedef struct {
+    bh_node_t* nodes;
+    int node_count;
+    int node_capacity;
+    int* index;   // body indices, grouped so every cell owns a contiguous range
+    int* scratch; // partition buffer used while building
+    int index_capacity;
+} bh_tree_t;
+
+// fast multipole method cell (children of a cell are stored contiguously)
+typedef struct {
+    double x, y, z;   // cell center (expansion center)
+    double half_size;
+    double radius;    // radius of the bounding sphere
+    int begin, end;   // range of body indices in fmm_tree_t.index
+    int first_child;
+    int child_count;
+    int parent;
+} fmm_cell_t;
+
+// one cell pair found by the FMM traversal, applied later by the thread that owns the target cell
+typedef struct {
+    int target;
+    int source;
+    bool direct; // P2P between two leaves instead of M2L
+} fmm_interaction_t;
+
+typedef struct {
+    fmm_cell_t* cells;
+    int cell_count;
+    int cell_capacity;
+    int* index;
+    int* scratch;
+    int index_capacity;
+    double* multipole;      // complex multipole coefficients, order*(order+1)/2 per cell
+    double* local;          // complex local coefficients, same layout
+    size_t coeff_capacity;  // doubles allocated in each of multipole/local
+    int order;
+    int leaf_size;
+    fmm_interaction_t* interactions; // in traversal order
+    fmm_interaction_t* grouped;      // the same, grouped by target cell (traversal order within a target)
+    int* target_start;               // cell_count + 1 offsets into grouped
+    int interaction_count;
+    int interaction_capacity;
+    int target_capacity;
+} fmm_tree_t;
+
 typedef struct {
     bool tangent;   // the burn axis heading beings tangent to the orbit
     bool normal;    // the burn axis heading begins normal to the orbit
@@ -163,6 +305,19 @@ typedef struct {
 
     int num_burns;
     burn_properties_t* burn_properties;
+
+    // adaptive propagation: prop_pos/prop_vel are the integration state at prop_time, which can trail the sim time by
+    // up to one step. pos/vel are brought to the sim time from it by craft_publishAdaptive (prop_published once done)
+    double prop_time;
+    double prop_step; // next step size in seconds (0 until the propagator has picked the craft up)
+    vec3 prop_pos, prop_vel;
+    bool prop_published;
+
+    // on rails: coasting along the exact two body orbit around rails_body, from the relative state at rails_epoch
+    bool on_rails;
+    int rails_body;
+    double rails_epoch;
+    vec3 rails_pos, rails_vel;
 } spacecraft_t;
 
 // container for all spacecraft
@@ -172,90 +327,214 @@ typedef struct {
     spacecraft_t* spacecraft;
 } spacecraft_properties_t;
 
-// container for all the sim elements
+// massless, non-thrusting test particles (constellations, debris), stored as arrays and moved in one kernel
+// they feel the bodies but do not pull on them or on each other; craft with engines and burn plans stay spacecraft_t
 typedef struct {
-    body_properties_t gb; // global bodies
-    spacecraft_properties_t gs; // global spacecraft
-    window_params_t wp; // window properties
-    console_t console; // in-window console
-    double system_kinetic_energy, system_potential_energy; // total energies of the whole system (reset each iteration)
-} sim_properties_t;
-
+    int count;
+    int capacity;
+    double* pos_x; double* pos_y; double* pos_z;
+    double* vel_x; double* vel_y; double* vel_z;
+    int* hit_body;     // body the particle ended up inside during the current step, -1 if none
+    long long removed; // particles removed after hitting a body since the last reset
+} swarm_t;
+
+// many keplerian orbits around one parent, turned into state vectors in one pass (catalog import).
+// the elements are the ones craft_calculateOrbitalElements produces: si units, angles in radians
 typedef struct {
-    int frame_counter;
-    bool is_shown;
-    double initial_total_energy;
-    bool measured_initial_energy;
-    double previous_total_energy;
-
-    int cached_body_count;
-} stats_window_t;
-
+    double mu;                                          // G * parent mass
+    int count;
+    const double* a;                                    // semi-major axis, negative for hyperbolic orbits
+    const double* e;
+    const double* inc;
+    const double* raan;                                 // longitude of the ascending node
+    const double* argp;                                 // argument of periapsis
+    const double* mean_anomaly;
+    double* pos_x; double* pos_y; double* pos_z;        // out: state relative to the parent
+    double* vel_x; double* vel_y; double* vel_z;
+} kepler_batch_t;
+
+// settings of the adaptive spacecraft propagator
 typedef struct {
-    float x, y, width, height;
-    bool is_hovered;
-    SDL_Color normal_color;
-    SDL_Color hover_color;
-} button_t;
-
+    bool adaptive;               // craft use their own embedded runge-kutta steps instead of the global step
+    double tolerance;            // relative error allowed per step
+    double max_step;             // seconds
+    long long force_evaluations; // craft force evaluations since the last reset (both propagators)
+    bool rails;                  // coasting craft deep inside an SOI follow their Kepler orbit analytically
+    double rails_threshold;      // largest third body acceleration (relative to the central body's pull) allowed on rails
+} craft_propagation_t;
+
+// state of the block timestep Hermite integrator
+// every body has its own step of time_step / 2^level, and times are counted in ticks of time_step / 2^max_level
+// so that bodies on different levels line up exactly. all bodies are in sync again at the end of every time_step
 typedef struct {
-    button_t sc_button;
-    button_t csv_load_button;
-    button_t craft_view_button;
-    button_t show_stats_button;
-} button_storage_t;
-
+    double eta;           // accuracy parameter of the Aarseth step criterion
+    int max_level;        // the smallest step is time_step / 2^max_level
 
+    int count;            // bodies the arrays below were set up for
+    int capacity;
+    bool initialized;
+    double sync_time;     // sim time the state belongs to (anything else means the bodies were moved by someone else)
+    double block_step;    // time_step the levels were chosen for
+    long long* tick;      // [body] ticks since the start of the block at the last correction
+    int* level;           // [body]
+    double* jerk_x; double* jerk_y; double* jerk_z;
+    double* pred_pos_x; double* pred_pos_y; double* pred_pos_z;
+    double* pred_vel_x; double* pred_vel_y; double* pred_vel_z;
+    double* acc_new_x; double* acc_new_y; double* acc_new_z;    // evaluated at the predicted state, before the correction
+    double* jerk_new_x; double* jerk_new_y; double* jerk_new_z;
+    int* active;          // bodies corrected in the current sub step
+
+    long long force_evaluations; // body force evaluations (one per active body per sub step) since the last reset
+    long long block_count;       // blocks (time_steps) taken since the last reset
+} hermite_state_t;
+
+#define COMMAND_QUEUE_CAPACITY 64 // power of two
+#define COMMAND_MAX_SCHEDULED 64
+#define COMMAND_TEXT_LENGTH 256
+
+// console command (or reply) passed between the render and physics threads
 typedef struct {
-    FILE* body_pos_FILE;
-    FILE* global_data_FILE;
-} binary_filenames_t;
+    double time; // sim time to apply the command at, negative = at the next step boundary
+    char text[COMMAND_TEXT_LENGTH];
+} sim_command_t;
 
+// lock free single producer / single consumer ring of commands
 typedef struct {
-    double timestamp;
-    int body_index;
-    double pos_data_x, pos_data_y;
-    double vel_data_x, vel_data_y;
-    double acc_data_x, acc_data_y;
-    double force_data_x, force_data_y;
-} global_data_t;
+    sim_command_t slots[COMMAND_QUEUE_CAPACITY];
+    volatile int head; // next slot to read, only advanced by the consumer
+    volatile int tail; // next slot to write, only advanced by the producer
+} command_queue_t;
 
+// physics steps run per sim_mutex acquisition (one render snapshot is published per batch)
 typedef struct {
-    SDL_Window* window;
-    SDL_GLContext glContext;
-} SDL_GL_init_t;
-
+    int fixed_steps;         // set from the console, 0 = tuned so a batch takes about half a display frame
+    int steps;               // steps in the next batch
+    double steps_per_second; // measured over the recent batches, including the time between them
+    double last_batch_end;   // wall clock time the previous batch finished, 0 after a pause (physics thread only)
+    double realtime_factor;  // sim seconds per wall clock second, 0 = as fast as possible
+
+    // pacing reference point (physics thread only)
+    double pace_factor;
+    double pace_wall_start;
+    double pace_sim_start;
+} physics_batch_t;
+
+// what the physics thread does when the telemetry ring has no room for a whole sample
+typedef enum {
+    TELEMETRY_BLOCK,   // wait for the writer thread (lossless, disk speed limits the physics)
+    TELEMETRY_DROP,    // skip the sample and count it
+    TELEMETRY_DECIMATE // skip it and keep only every 2nd, 4th, ... sample until the ring drains again
+} telemetry_policy_t;
+
+// asynchronous telemetry writer (defined in utility/telemetry_export.h)
+typedef struct telemetry_writer telemetry_writer_t;
+
+// playback of a telemetry file in the window (defined in utility/telemetry_replay.h)
+typedef struct telemetry_replay telemetry_replay_t;
+
+// telemetry sampling state, owned by the physics thread
 typedef struct {
-    GLuint VAO;
-    GLuint VBO;
-} VBO_t;
-
+    telemetry_writer_t* writer; // NULL while logging is off
+    telemetry_policy_t policy;
+    double interval;            // sim seconds between samples, 0 = every step
+    double next_time;           // sim time of the next sample
+    double last_time;           // sim time of the last sample (even if the policy skipped it)
+    int every_steps;            // sample every this many steps instead (0 = by sim time)
+    long long step_counter;     // steps since logging started or the sim was reset
+    bool align;                 // shorten the step before a sample so it lands exactly on a multiple of interval
+    int decimation;             // decimate policy: one of this many due samples is kept
+    int decimation_phase;
+    long long samples;          // samples handed to the writer
+    long long dropped;          // samples lost to a full ring
+    long long decimated;        // samples skipped on purpose by the decimate policy
+    long long blocked;          // samples the physics thread had to wait for (block policy)
+} telemetry_params_t;
+
+// background checkpoint writer (defined in utility/autosave.h)
+typedef struct autosave_writer autosave_writer_t;
+
+// automatic checkpoints, owned by the physics thread (the files are written by their own thread)
 typedef struct {
-    VBO_t vbo;
-    float* vertices;
-    size_t capacity;  // max number of lines
-    size_t count;     // current number of lines
-} line_batch_t;
-
+    autosave_writer_t* writer;   // started with the first automatic checkpoint
+    double interval;             // sim seconds between checkpoints, 0 = not by sim time
+    double wall_interval;        // wall clock seconds between checkpoints, 0 = not by wall clock
+    double next_time;            // sim time of the next checkpoint
+    double last_wall_time;       // wall clock time of the last checkpoint (or of turning the wall clock timer on)
+    int step_counter;            // steps since the wall clock was last read
+    int keep;                    // newest checkpoints kept on disk, older ones are deleted
+    char prefix[COMMAND_TEXT_LENGTH]; // checkpoints are <prefix>.<n>.bin, <prefix>.latest holds the newest n
+    bool pending;                // due, waiting for the writer to finish the previous one
+    long long taken;             // checkpoints handed to the writer
+    long long skipped;           // came due while another one was still pending (only the newest state is kept)
+} autosave_params_t;
+
+// deep copy of everything the renderer reads from the physics side, so drawing a frame never
+// touches arrays the integrator is writing (names point into the names buffer of the same slot)
 typedef struct {
-    float* vertices;
-    size_t vertex_count;
-    size_t data_size;
-} sphere_mesh_t;
-
-// text rendering
+    double sim_time;
+    int body_count;
+    int body_capacity;
+    body_t* bodies;
+    int craft_count;
+    int craft_capacity;
+    spacecraft_t* spacecraft; // burn_properties is not copied
+    char* names;
+    size_t names_capacity;
+    int swarm_count;          // all particles, only swarm_drawn of them are copied
+    long long swarm_removed;
+    int swarm_drawn;
+    int swarm_capacity;
+    float* swarm_pos;         // [particle][x, y, z] already divided by SCALE
+    long long hermite_evaluations;
+    long long hermite_blocks;
+    int hermite_count;
+    double steps_per_second;
+    int batch_steps;
+    double realtime_factor;
+    bool sim_running;
+    double time_step;
+    integrator_t integrator;
+    gravity_params_t gp;
+    int reset_count;
+    unsigned long long sequence; // value of snapshot_buffer_t.published for this slot, lets the reader tell new state from old
+} render_snapshot_t;
+
+// triple buffer of render snapshots: writers (serialized by sim_mutex) fill the back slot and swap it
+// with the middle one, the renderer swaps the middle slot with its front slot whenever a new one is there
 typedef struct {
-    GLuint tex, shader, vao, vbo;
-    float* verts;
-    int count;
-} font_t;
+    render_snapshot_t slots[3];
+    int back;            // only touched by the thread holding sim_mutex
+    unsigned long long published; // snapshots published so far, same lock as back
+    volatile int middle; // slot index | SNAPSHOT_FRESH, only accessed through the atomic wrappers
+    int front;           // only touched by the render thread
+} snapshot_buffer_t;
 
-// planet path tracking
+// container for all the sim elements
 typedef struct {
-    vec3* positions;
-    int* counts;
-    int capacity;
-    int num_objects;
-} object_path_storage_t;
+    body_properties_t gb; // global bodies
+    spacecraft_properties_t gs; // global spacecraft
+    window_params_t wp; // window properties
+    console_t console; // in-window console
+    gravity_params_t gp; // gravity solver settings
+    bh_tree_t bh_tree; // Barnes-Hut octree workspace (rebuilt every step)
+    fmm_tree_t fmm_tree; // FMM workspace (rebuilt every step)
+    int thread_count; // threads used by the force loops (0 = all cores)
+    worker_pool_t* pool; // created by the physics thread on first use
+    thread_force_buffer_t force_buffers;
+    craft_propagation_t cp; // adaptive spacecraft propagation settings
+    body_history_t history; // only recorded while adaptive craft propagation is on
+    hermite_state_t hermite; // block timestep integrator state
+    swarm_t swarm; // test particles
+    physics_batch_t batch; // steps per lock acquisition of the physics thread
+    command_queue_t commands; // console -> physics thread, applied between steps
+    command_queue_t replies;  // physics thread -> console log
+    sim_command_t scheduled[COMMAND_MAX_SCHEDULED]; // commands waiting for their sim time, sorted by time (physics thread only)
+    int scheduled_count;
+    snapshot_buffer_t snapshots; // render copies published after each batch
+    telemetry_params_t telemetry; // telemetry sampling, the file is written by its own thread
+    autosave_params_t autosave; // periodic checkpoints for long runs
+    telemetry_replay_t* replay; // render thread only: set while a telemetry file is shown instead of the live sim
+    double system_kinetic_energy, system_potential_energy; // total energies of the whole system (reset each iteration)
+} sim_properties_t;
 
 #endif
@@ -0,0 +1,217 @@
+#include "autosave.h"
+#include "error_hook.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+autosave_params_t autosave_defaultParams(void) {
+    return (autosave_params_t){
+        .writer = NULL,
+        .interval = 0.0,
+        .wall_interval = 0.0,
+        .keep = AUTOSAVE_DEFAULT_KEEP,
+        .prefix = AUTOSAVE_DEFAULT_PREFIX,
+    };
+}
+
+static double autosave_wallTime(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void autosave_fileName(char* path, const size_t size, const char* prefix, const long long sequence) {
+    snprintf(path, size, "%s.%lld.bin", prefix, sequence);
+}
+
+// number of the newest checkpoint written with this prefix, 0 if there is none
+static long long autosave_latestSequence(const char* prefix) {
+    char path[COMMAND_TEXT_LENGTH + 16];
+    snprintf(path, sizeof(path), "%s.latest", prefix);
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return 0;
+    long long sequence = 0;
+    if (fscanf(file, "%lld", &sequence) != 1 || sequence < 0) sequence = 0;
+    fclose(file);
+    return sequence;
+}
+
+// path of the newest checkpoint written with this prefix, false if there is none
+bool autosave_latest(const char* prefix, char* path, const size_t size) {
+    const long long sequence = autosave_latestSequence(prefix);
+    if (sequence == 0) return false;
+    autosave_fileName(path, size, prefix, sequence);
+    return true;
+}
+
+// the next checkpoint goes to <prefix>.<n + 1>.bin, then <prefix>.latest is pointed at it, and only after
+// that are the checkpoints older than the newest keep deleted (so there is always a complete one on disk)
+static void autosave_write(autosave_writer_t* writer) {
+    const long long sequence = writer->sequence + 1;
+    char path[COMMAND_TEXT_LENGTH + 32];
+    autosave_fileName(path, sizeof(path), writer->prefix, sequence);
+    if (!checkpoint_writeImage(&writer->image, path)) return;
+    writer->sequence = sequence;
+
+    char latest[COMMAND_TEXT_LENGTH + 16];
+    char text[32];
+    snprintf(latest, sizeof(latest), "%s.latest", writer->prefix);
+    const int length = snprintf(text, sizeof(text), "%lld\n", sequence);
+    if (!checkpoint_replaceFile(latest, text, (size_t)length)) {
+        char message[COMMAND_TEXT_LENGTH + 64];
+        snprintf(message, sizeof(message), "Could not update %s", latest);
+        displayError("ERROR", message);
+        return;
+    }
+
+    // also catches up after keep was lowered
+    for (long long old = sequence - writer->keep; old > 0; old--) {
+        autosave_fileName(path, sizeof(path), writer->prefix, old);
+        if (remove(path) != 0) break;
+    }
+}
+
+static THREAD_RETURN_TYPE autosave_writerMain(void* args) {
+    autosave_writer_t* writer = (autosave_writer_t*)args;
+    for (;;) {
+        mutex_lock(&writer->lock);
+        while (!atomic_loadInt(&writer->busy) && !atomic_loadInt(&writer->stopping)) cond_wait(&writer->wake, &writer->lock);
+        const bool has_image = atomic_loadInt(&writer->busy) != 0;
+        mutex_unlock(&writer->lock);
+        if (!has_image) break; // stopping with nothing left to write
+
+        autosave_write(writer);
+        checkpoint_freeImage(&writer->image);
+        atomic_storeInt(&writer->busy, 0);
+    }
+    return THREAD_RETURN_VALUE;
+}
+
+static autosave_writer_t* autosave_startWriter(const autosave_params_t* ap) {
+    autosave_writer_t* writer = (autosave_writer_t*)calloc(1, sizeof(autosave_writer_t));
+    if (writer == NULL) {
+        displayError("ERROR", "Failed to allocate memory for the checkpoint writer");
+        return NULL;
+    }
+    snprintf(writer->prefix, sizeof(writer->prefix), "%s", ap->prefix);
+    writer->sequence = autosave_latestSequence(ap->prefix); // a resumed run keeps counting
+
+    mutex_init(&writer->lock);
+    cond_init(&writer->wake);
+    if (!thread_create(&writer->thread, autosave_writerMain, writer)) {
+        displayError("ERROR", "Failed to start the checkpoint writer thread");
+        mutex_destroy(&writer->lock);
+        cond_destroy(&writer->wake);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+static bool autosave_writerBusy(const autosave_params_t* ap) {
+    return ap->writer != NULL && atomic_loadInt(&ap->writer->busy);
+}
+
+// copies the current state and hands it to the writer thread, false if the previous checkpoint is still
+// being written or the copy failed
+bool autosave_checkpoint(sim_properties_t* sim) {
+    autosave_params_t* ap = &sim->autosave;
+    if (ap->writer == NULL) {
+        ap->writer = autosave_startWriter(ap);
+        if (ap->writer == NULL) return false;
+    }
+    autosave_writer_t* writer = ap->writer;
+    if (atomic_loadInt(&writer->busy)) return false;
+
+    checkpoint_image_t image;
+    if (!checkpoint_capture(sim, &image)) return false;
+    mutex_lock(&writer->lock);
+    writer->image = image;
+    writer->keep = ap->keep;
+    atomic_storeInt(&writer->busy, 1);
+    cond_broadcast(&writer->wake);
+    mutex_unlock(&writer->lock);
+    ap->taken++;
+    return true;
+}
+
+// first multiple of the interval after time
+static double autosave_nextMultiple(const double time, const double interval) {
+    return (floor(time / interval + 1e-9) + 1.0) * interval;
+}
+
+// called after every step: takes a checkpoint when the sim time or the wall clock says one is due. while the
+// writer is still busy with the previous one the checkpoint stays pending and is taken after the first step
+// that finds the writer free, so the physics never waits for the disk
+void autosave_tick(sim_properties_t* sim) {
+    autosave_params_t* ap = &sim->autosave;
+    const double now = sim->wp.sim_time;
+    bool due = false;
+
+    if (ap->interval > 0.0) {
+        // the sim went back in time (reset, restore): count from there
+        if (ap->next_time - now > ap->interval) ap->next_time = autosave_nextMultiple(now, ap->interval);
+        if (ap->next_time <= now + 1e-9 * fmax(1.0, fabs(ap->next_time))) {
+            ap->next_time = autosave_nextMultiple(now, ap->interval);
+            due = true;
+        }
+    }
+    if (ap->wall_interval > 0.0 && ++ap->step_counter >= AUTOSAVE_CHECK_STEPS) {
+        ap->step_counter = 0;
+        const double wall = autosave_wallTime();
+        if (wall - ap->last_wall_time >= ap->wall_interval) {
+            ap->last_wall_time = wall;
+            due = true;
+        }
+    }
+    if (due) {
+        if (ap->pending) ap->skipped++;
+        ap->pending = true;
+    }
+    if (ap->pending && !autosave_writerBusy(ap)) {
+        ap->pending = false;
+        autosave_checkpoint(sim);
+    }
+}
+
+void autosave_setEvery(sim_properties_t* sim, const double interval) {
+    autosave_params_t* ap = &sim->autosave;
+    ap->interval = interval;
+    if (interval > 0.0) ap->next_time = autosave_nextMultiple(sim->wp.sim_time, interval);
+}
+
+void autosave_setWall(sim_properties_t* sim, const double seconds) {
+    autosave_params_t* ap = &sim->autosave;
+    ap->wall_interval = seconds;
+    ap->last_wall_time = autosave_wallTime();
+    ap->step_counter = 0;
+}
+
+// waits until the checkpoint being written is on disk and joins the writer thread, a pending checkpoint
+// is then written right here (so the end of a run is not lost)
+void autosave_stop(sim_properties_t* sim) {
+    autosave_params_t* ap = &sim->autosave;
+    autosave_writer_t* writer = ap->writer;
+    if (writer == NULL) return;
+    ap->writer = NULL;
+
+    mutex_lock(&writer->lock);
+    atomic_storeInt(&writer->stopping, 1);
+    cond_broadcast(&writer->wake);
+    mutex_unlock(&writer->lock);
+    thread_join(writer->thread);
+
+    if (ap->pending && checkpoint_capture(sim, &writer->image)) {
+        writer->keep = ap->keep;
+        autosave_write(writer);
+        checkpoint_freeImage(&writer->image);
+        ap->taken++;
+    }
+    ap->pending = false;
+
+    mutex_destroy(&writer->lock);
+    cond_destroy(&writer->wake);
+    free(writer);
+}
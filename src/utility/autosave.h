@@ -0,0 +1,39 @@
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include "../types.h"
+#include "sim_thread.h"
+#include "checkpoint.h"
+
+// periodic checkpoints of long runs: the physics thread copies the state into a checkpoint image between
+// two steps (a memcpy of the columns) and hands it to a writer thread, which does the disk io, renames the
+// finished file into place and deletes the oldest ones. a checkpoint that comes due while the previous one
+// is still being written waits for the writer (the physics keeps stepping) and then takes the state of that step
+
+#define AUTOSAVE_DEFAULT_PREFIX "autosave"
+#define AUTOSAVE_DEFAULT_KEEP 3
+#define AUTOSAVE_CHECK_STEPS 64 // steps between two reads of the wall clock
+
+struct autosave_writer {
+    thread_t thread;
+    mutex_t lock;
+    cond_t wake;              // physics -> writer: image handed over, or stopping
+    checkpoint_image_t image; // being written while busy is set
+    int keep;                 // passed along with the image
+    volatile int busy;        // set by the physics thread with a new image, cleared by the writer once it is on disk
+    volatile int stopping;
+
+    // writer thread only (set up before the thread starts)
+    char prefix[COMMAND_TEXT_LENGTH];
+    long long sequence;       // number of the newest checkpoint on disk
+};
+
+autosave_params_t autosave_defaultParams(void);
+void autosave_tick(sim_properties_t* sim);
+bool autosave_checkpoint(sim_properties_t* sim);
+void autosave_stop(sim_properties_t* sim);
+void autosave_setEvery(sim_properties_t* sim, double interval);
+void autosave_setWall(sim_properties_t* sim, double seconds);
+bool autosave_latest(const char* prefix, char* path, size_t size);
+
+#endif
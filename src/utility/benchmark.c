@@ -0,0 +1,354 @@
+#include "benchmark.h"
+#include "../globals.h"
+#include "../types.h"
+#include "../sim/bodies.h"
+#include "../sim/gravity.h"
+#include "../sim/gravity_simd.h"
+#include "../sim/simulation.h"
+#include "../sim/swarm.h"
+#include "thread_pool.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_DIRECT_BODIES 16000 // larger direct runs are extrapolated (N^2) instead of timed
+#define BENCH_SCALING_BODIES 8000     // cluster size used for the thread scaling run
+#define BENCH_SIMD_BODIES 4000        // cluster size used for the kernel check
+#define BENCH_SWARM_PARTICLES 100000  // test particles used for the swarm kernel check
+#define BENCH_SWARM_BODIES 16         // bodies they are pulled by
+
+// wall clock time in seconds
+static double benchmark_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// fills a sim with a centrally concentrated random cluster of n bodies (same seed every run)
+static void benchmark_makeCluster(sim_properties_t* sim, const int n) {
+    unsigned int seed = 12345u;
+    char name[32];
+    for (int k = 0; k < n; k++) {
+        double u[3];
+        for (int c = 0; c < 3; c++) {
+            seed = seed * 1664525u + 1013904223u;
+            u[c] = (seed >> 8) / 16777216.0;
+        }
+        const double r = 1e11 * sqrt(u[0]) + 1e6;
+        const double cos_t = 2.0 * u[1] - 1.0;
+        const double sin_t = sqrt(1.0 - cos_t * cos_t);
+        const double phi = 2.0 * PI * u[2];
+        const vec3 pos = {r * sin_t * cos(phi), r * sin_t * sin(phi), r * cos_t};
+        snprintf(name, sizeof(name), "bench-%d", k);
+        body_addOrbitalBody(&sim->gb, name, 1e20 * (1.0 + u[0]), 1.0, pos, (vec3){0});
+    }
+}
+
+// seconds per force evaluation for the solver currently selected in sim->gp (best of a few runs)
+static double benchmark_timeSolver(sim_properties_t* sim) {
+    double best = INFINITY;
+    const int repeats = sim->gb.count <= 4000 ? 3 : 1;
+    for (int r = 0; r < repeats; r++) {
+        const double t0 = benchmark_now();
+        gravity_calculateForces(sim);
+        best = fmin(best, benchmark_now() - t0);
+    }
+    return best;
+}
+
+// times direct summation, Barnes-Hut and the FMM on growing clusters and prints a table to stdout
+// the FMM runs twice: once tuned to roughly the Barnes-Hut error and once with the default settings
+// summary receives the body counts from which the FMM beats direct summation (timed runs only) and the tree code
+void benchmarkGravitySolvers(char* summary, const size_t summary_len) {
+    const int sizes[] = {1000, 4000, 16000, 64000};
+    const int size_count = (int)(sizeof(sizes) / sizeof(sizes[0]));
+    int fmm_beats_direct_from = -1;
+    int fmm_beats_tree_from = -1;
+    double direct_time_per_pair = 0.0;
+
+    const gravity_params_t defaults = gravity_defaultParams();
+    gravity_params_t fmm_matched = defaults;
+    fmm_matched.solver = GRAVITY_FMM;
+    fmm_matched.fmm_order = 4;
+    fmm_matched.theta = 0.7;
+    gravity_params_t fmm_default = defaults;
+    fmm_default.solver = GRAVITY_FMM;
+
+    // every solver spreads its work over the same worker pool (all cores, as in the sim by default)
+    const int threads = pool_hardwareThreads() < POOL_MAX_THREADS ? pool_hardwareThreads() : POOL_MAX_THREADS;
+    printf("\ngravity solver benchmark on %d threads (seconds per force evaluation, rms relative force error)\n", threads);
+    printf("%8s  %10s  %21s  %21s  %21s\n", "bodies", "direct", "barnes-hut th=0.5",
+        "fmm p=4 th=0.7", "fmm p=6 th=0.5");
+
+    for (int s = 0; s < size_count; s++) {
+        const int n = sizes[s];
+        sim_properties_t sim = {0};
+        sim.gp = defaults;
+        benchmark_makeCluster(&sim, n);
+
+        // direct summation (timed while it is affordable, extrapolated after that)
+        double direct_time;
+        char direct_txt[32];
+        if (n <= BENCH_MAX_DIRECT_BODIES) {
+            sim.gp.solver = GRAVITY_DIRECT;
+            direct_time = benchmark_timeSolver(&sim);
+            direct_time_per_pair = direct_time / ((double)n * n);
+            snprintf(direct_txt, sizeof(direct_txt), "%.4f", direct_time);
+        } else {
+            direct_time = direct_time_per_pair * (double)n * n;
+            snprintf(direct_txt, sizeof(direct_txt), "~%.4f", direct_time);
+        }
+
+        sim.gp.solver = GRAVITY_BARNES_HUT;
+        const double bh_time = benchmark_timeSolver(&sim);
+        const gravity_error_t bh_error = gravity_measureForceError(&sim, 100);
+
+        sim.gp = fmm_matched;
+        const double fmm_matched_time = benchmark_timeSolver(&sim);
+        const gravity_error_t fmm_matched_error = gravity_measureForceError(&sim, 100);
+
+        sim.gp = fmm_default;
+        const double fmm_default_time = benchmark_timeSolver(&sim);
+        const gravity_error_t fmm_default_error = gravity_measureForceError(&sim, 100);
+
+        printf("%8d  %10s  %9.4f (%9.2e)  %9.4f (%9.2e)  %9.4f (%9.2e)\n", n, direct_txt,
+            bh_time, bh_error.rms_rel_error,
+            fmm_matched_time, fmm_matched_error.rms_rel_error,
+            fmm_default_time, fmm_default_error.rms_rel_error);
+
+        // extrapolated direct times are only shown, the crossover is taken from timed runs
+        if (fmm_beats_direct_from < 0 && n <= BENCH_MAX_DIRECT_BODIES && fmm_default_time < direct_time) {
+            fmm_beats_direct_from = n;
+        }
+        if (fmm_beats_tree_from < 0 && fmm_matched_time < bh_time) {
+            fmm_beats_tree_from = n;
+        }
+        cleanup(&sim);
+    }
+
+    char direct_txt[48], tree_txt[32];
+    if (fmm_beats_direct_from > 0) snprintf(direct_txt, sizeof(direct_txt), "from %d", fmm_beats_direct_from);
+    else snprintf(direct_txt, sizeof(direct_txt), "not up to %d", BENCH_MAX_DIRECT_BODIES);
+    if (fmm_beats_tree_from > 0) snprintf(tree_txt, sizeof(tree_txt), "%d", fmm_beats_tree_from);
+    else snprintf(tree_txt, sizeof(tree_txt), "never");
+    snprintf(summary, summary_len, "fmm beats direct %s bodies, barnes-hut from %s (table on stdout)", direct_txt, tree_txt);
+}
+
+// times direct summation and Barnes-Hut with 1, 2, 4, ... threads up to the core count and prints a table to stdout
+// summary receives the direct summation speedup with all cores
+void benchmarkThreadScaling(char* summary, const size_t summary_len) {
+    const int max_threads = pool_hardwareThreads();
+    sim_properties_t sim = {0};
+    sim.gp = gravity_defaultParams();
+    benchmark_makeCluster(&sim, BENCH_SCALING_BODIES);
+
+    printf("\nthread scaling benchmark (%d bodies, seconds per force evaluation)\n", BENCH_SCALING_BODIES);
+    printf("%8s  %10s  %8s  %10s  %10s  %8s  %10s\n", "threads", "direct", "speedup", "efficiency",
+        "barnes-hut", "speedup", "efficiency");
+
+    double direct_serial = 0.0, tree_serial = 0.0, direct_speedup = 1.0;
+    int threads = 1;
+    while (true) {
+        sim.thread_count = threads;
+
+        // the first call also spins up the pool and sizes the force buffers, so it is not timed
+        sim.gp.solver = GRAVITY_DIRECT;
+        gravity_calculateForces(&sim);
+        const double direct_time = benchmark_timeSolver(&sim);
+        sim.gp.solver = GRAVITY_BARNES_HUT;
+        gravity_calculateForces(&sim);
+        const double tree_time = benchmark_timeSolver(&sim);
+
+        if (threads == 1) {
+            direct_serial = direct_time;
+            tree_serial = tree_time;
+        }
+        direct_speedup = direct_serial / direct_time;
+        const double tree_speedup = tree_serial / tree_time;
+        printf("%8d  %10.4f  %7.2fx  %9.0f%%  %10.4f  %7.2fx  %9.0f%%\n", threads,
+            direct_time, direct_speedup, 100.0 * direct_speedup / threads,
+            tree_time, tree_speedup, 100.0 * tree_speedup / threads);
+
+        if (threads >= max_threads) break;
+        threads = threads * 2 < max_threads ? threads * 2 : max_threads;
+    }
+    cleanup(&sim);
+
+    snprintf(summary, summary_len, "direct summation: %.2fx speedup on %d threads (table on stdout)", direct_speedup, threads);
+}
+
+// checks every pair kernel the cpu supports against body_calculateGravForce and times it
+// summary receives the speedup of the fastest kernel and the largest deviation found
+void benchmarkSimdKernels(char* summary, const size_t summary_len) {
+    const int n = BENCH_SIMD_BODIES;
+    sim_properties_t sim = {0};
+    sim.gp = gravity_defaultParams();
+    benchmark_makeCluster(&sim, n);
+    body_soa_t* soa = &sim.gb.soa;
+
+    // reference forces from the per pair function
+    double* reference = (double*)malloc(3 * (size_t)n * sizeof(double));
+    double* forces = (double*)malloc(3 * (size_t)n * sizeof(double));
+    if (reference == NULL || forces == NULL) {
+        free(reference);
+        free(forces);
+        cleanup(&sim);
+        snprintf(summary, summary_len, "kernel check failed: out of memory");
+        return;
+    }
+    body_resetForces(&sim.gb);
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            body_calculateGravForce(&sim, i, j);
+        }
+    }
+    memcpy(reference, soa->force_x, n * sizeof(double));
+    memcpy(reference + n, soa->force_y, n * sizeof(double));
+    memcpy(reference + 2 * n, soa->force_z, n * sizeof(double));
+
+    printf("\npair kernel check (%d bodies, seconds per force evaluation, max relative deviation from body_calculateGravForce)\n", n);
+    printf("%8s  %10s  %8s  %12s\n", "kernel", "time", "speedup", "deviation");
+
+    const simd_level_t levels[] = {SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512};
+    double scalar_time = 0.0, best_speedup = 1.0, worst_error = 0.0;
+    simd_level_t best_level = SIMD_SCALAR;
+    for (int l = 0; l < (int)(sizeof(levels) / sizeof(levels[0])); l++) {
+        if (!simd_isSupported(levels[l])) {
+            printf("%8s  %10s\n", simd_levelName(levels[l]), "n/a");
+            continue;
+        }
+        const simd_pair_kernel_t kernel = simd_pairKernel(levels[l]);
+        double* fx = forces;
+        double* fy = forces + n;
+        double* fz = forces + 2 * n;
+
+        double best_time = INFINITY;
+        for (int r = 0; r < 3; r++) {
+            memset(forces, 0, 3 * (size_t)n * sizeof(double));
+            int collided_i = -1, collided_j = -1;
+            const double t0 = benchmark_now();
+            kernel(soa, n, 0, n, fx, fy, fz, &collided_i, &collided_j);
+            best_time = fmin(best_time, benchmark_now() - t0);
+        }
+
+        double max_error = 0.0;
+        for (int i = 0; i < n; i++) {
+            const double rx = reference[i], ry = reference[n + i], rz = reference[2 * n + i];
+            const double ex = fx[i] - rx, ey = fy[i] - ry, ez = fz[i] - rz;
+            const double ref_mag = sqrt(rx * rx + ry * ry + rz * rz);
+            if (ref_mag > 0.0) max_error = fmax(max_error, sqrt(ex * ex + ey * ey + ez * ez) / ref_mag);
+        }
+
+        if (levels[l] == SIMD_SCALAR) scalar_time = best_time;
+        const double speedup = scalar_time / best_time;
+        if (speedup > best_speedup) {
+            best_speedup = speedup;
+            best_level = levels[l];
+        }
+        worst_error = fmax(worst_error, max_error);
+        printf("%8s  %10.4f  %7.2fx  %12.3e\n", simd_levelName(levels[l]), best_time, speedup, max_error);
+    }
+
+    free(reference);
+    free(forces);
+    cleanup(&sim);
+    snprintf(summary, summary_len, "%s kernel %.2fx faster than scalar, max deviation %.1e (%s)",
+        simd_levelName(best_level), best_speedup, worst_error, worst_error < 1e-12 ? "ok" : "FAILED");
+}
+
+// checks every swarm kernel the cpu supports against swarm_kickDriftRange, times it single threaded
+// and then times one full swarm step on the worker pool
+// summary receives the particle steps per second on the pool and the largest deviation found
+void benchmarkSwarmKernels(char* summary, const size_t summary_len) {
+    const int n = BENCH_SWARM_PARTICLES;
+    sim_properties_t sim = {0};
+    sim.gp = gravity_defaultParams();
+    benchmark_makeCluster(&sim, BENCH_SWARM_BODIES);
+
+    // particles scattered through the same volume as the bodies, each with its own copy for every kernel
+    swarm_t initial = {0};
+    unsigned int seed = 777u;
+    for (int k = 0; k < n; k++) {
+        double u[6];
+        for (int c = 0; c < 6; c++) {
+            seed = seed * 1664525u + 1013904223u;
+            u[c] = (seed >> 8) / 16777216.0;
+        }
+        const vec3 pos = {2e11 * (u[0] - 0.5), 2e11 * (u[1] - 0.5), 2e11 * (u[2] - 0.5)};
+        const vec3 vel = {1e4 * (u[3] - 0.5), 1e4 * (u[4] - 0.5), 1e4 * (u[5] - 0.5)};
+        if (!swarm_addParticle(&initial, pos, vel)) break;
+    }
+    double* reference = (double*)malloc(3 * (size_t)n * sizeof(double));
+    if (initial.count != n || reference == NULL) {
+        free(reference);
+        swarm_freeStorage(&initial);
+        cleanup(&sim);
+        snprintf(summary, summary_len, "swarm check failed: out of memory");
+        return;
+    }
+
+    const double dt = 60.0;
+    printf("\nswarm kernel check (%d particles, %d bodies, seconds per step, max relative velocity deviation from swarm_kickDriftRange)\n", n, BENCH_SWARM_BODIES);
+    printf("%8s  %10s  %8s  %12s\n", "kernel", "time", "speedup", "deviation");
+
+    const simd_level_t levels[] = {SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512};
+    double scalar_time = 0.0, worst_error = 0.0;
+    for (int l = 0; l < (int)(sizeof(levels) / sizeof(levels[0])); l++) {
+        if (!simd_isSupported(levels[l])) {
+            printf("%8s  %10s\n", simd_levelName(levels[l]), "n/a");
+            continue;
+        }
+        const simd_swarm_kernel_t kernel = simd_swarmKernel(levels[l]);
+
+        double best_time = INFINITY;
+        for (int r = 0; r < 3; r++) {
+            swarm_freeStorage(&sim.swarm);
+            for (int i = 0; i < n; i++) {
+                swarm_addParticle(&sim.swarm, (vec3){initial.pos_x[i], initial.pos_y[i], initial.pos_z[i]},
+                                  (vec3){initial.vel_x[i], initial.vel_y[i], initial.vel_z[i]});
+            }
+            const double t0 = benchmark_now();
+            kernel(&sim.gb.soa, sim.gb.count, &sim.swarm, 0, sim.swarm.count, dt, dt);
+            best_time = fmin(best_time, benchmark_now() - t0);
+        }
+
+        // compare the velocity change, which is what the kernels compute
+        double max_error = 0.0;
+        for (int i = 0; i < n; i++) {
+            const double rx = sim.swarm.vel_x[i] - initial.vel_x[i];
+            const double ry = sim.swarm.vel_y[i] - initial.vel_y[i];
+            const double rz = sim.swarm.vel_z[i] - initial.vel_z[i];
+            if (levels[l] == SIMD_SCALAR) {
+                reference[i] = rx;
+                reference[n + i] = ry;
+                reference[2 * n + i] = rz;
+                continue;
+            }
+            const double ex = rx - reference[i], ey = ry - reference[n + i], ez = rz - reference[2 * n + i];
+            const double ref_mag = sqrt(reference[i] * reference[i] + reference[n + i] * reference[n + i] + reference[2 * n + i] * reference[2 * n + i]);
+            if (ref_mag > 0.0) max_error = fmax(max_error, sqrt(ex * ex + ey * ey + ez * ez) / ref_mag);
+        }
+
+        if (levels[l] == SIMD_SCALAR) scalar_time = best_time;
+        worst_error = fmax(worst_error, max_error);
+        printf("%8s  %10.4f  %7.2fx  %12.3e\n", simd_levelName(levels[l]), best_time, scalar_time / best_time, max_error);
+    }
+
+    // a full kick-drift-kick step with the best kernel on all cores
+    sim.gp.simd_level = simd_detectLevel();
+    swarm_kickDrift(&sim, 0.0, 0.0); // starts the pool outside the timed part
+    const double t0 = benchmark_now();
+    swarm_beginStep(&sim, dt);
+    swarm_endStep(&sim, dt);
+    const double step_time = benchmark_now() - t0;
+    const int threads = sim.pool != NULL ? sim.pool->thread_count : 1;
+    printf("full step (%s, %d threads): %.4f s\n", simd_levelName(sim.gp.simd_level), threads, step_time);
+
+    free(reference);
+    swarm_freeStorage(&initial);
+    cleanup(&sim);
+    snprintf(summary, summary_len, "swarm: %.2e particle steps/s on %d threads with %s, max deviation %.1e (%s)",
+        n / step_time, threads, simd_levelName(simd_detectLevel()), worst_error, worst_error < 1e-12 ? "ok" : "FAILED");
+}
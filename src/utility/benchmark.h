@@ -0,0 +1,11 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stddef.h>
+
+void benchmarkGravitySolvers(char* summary, size_t summary_len);
+void benchmarkThreadScaling(char* summary, size_t summary_len);
+void benchmarkSimdKernels(char* summary, size_t summary_len);
+void benchmarkSwarmKernels(char* summary, size_t summary_len);
+
+#endif
@@ -0,0 +1,468 @@
+#include "catalog.h"
+#include "checkpoint.h"
+#include "mapped_file.h"
+#include "error_hook.h"
+#include "../globals.h"
+#include "../math/matrix.h"
+#include "../sim/kepler.h"
+#include "../sim/spacecraft.h"
+#include "../sim/swarm.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CATALOG_NAME_FIELD (-1)
+#define CATALOG_IGNORED_FIELD (-2)
+#define CATALOG_AU 149597870700.0
+
+// csv header names of the columns, a unit can follow as a suffix ("a_km", "i_deg"). without one lengths are
+// in m and angles in radians, like everywhere else in the sim
+typedef struct {
+    const char* name;
+    int column;
+} catalog_alias_t;
+
+static const catalog_alias_t catalog_aliases[] = {
+    {"name", CATALOG_NAME_FIELD},
+    {"a", CATALOG_A}, {"semi_major_axis", CATALOG_A},
+    {"e", CATALOG_E}, {"eccentricity", CATALOG_E},
+    {"i", CATALOG_INC}, {"inc", CATALOG_INC}, {"inclination", CATALOG_INC},
+    {"raan", CATALOG_RAAN}, {"node", CATALOG_RAAN}, {"ascending_node", CATALOG_RAAN},
+    {"argp", CATALOG_ARGP}, {"w", CATALOG_ARGP}, {"arg_periapsis", CATALOG_ARGP},
+    {"m", CATALOG_MEAN_ANOMALY}, {"ma", CATALOG_MEAN_ANOMALY}, {"mean_anomaly", CATALOG_MEAN_ANOMALY},
+};
+
+typedef struct {
+    const char* suffix;
+    double scale;
+    bool length; // a length unit (for a), otherwise an angle unit
+} catalog_unit_t;
+
+static const catalog_unit_t catalog_units[] = {
+    {"m", 1.0, true}, {"km", 1000.0, true}, {"au", CATALOG_AU, true},
+    {"rad", 1.0, false}, {"deg", PI / 180.0, false},
+};
+
+// what one csv column holds
+typedef struct {
+    int column;  // catalog_column_t, CATALOG_NAME_FIELD or CATALOG_IGNORED_FIELD
+    double scale;
+} catalog_field_t;
+
+static int catalog_findAlias(const char* name) {
+    for (size_t k = 0; k < sizeof(catalog_aliases) / sizeof(catalog_aliases[0]); k++) {
+        if (strcmp(catalog_aliases[k].name, name) == 0) return catalog_aliases[k].column;
+    }
+    return CATALOG_IGNORED_FIELD;
+}
+
+// column and unit of a header name (lowercase), columns nobody asked for are ignored
+static catalog_field_t catalog_parseHeaderName(const char* name) {
+    catalog_field_t field = {catalog_findAlias(name), 1.0};
+    if (field.column != CATALOG_IGNORED_FIELD) return field;
+
+    const char* underscore = strrchr(name, '_');
+    if (underscore == NULL || underscore == name) return field;
+    char base[64];
+    const size_t base_length = (size_t)(underscore - name);
+    if (base_length >= sizeof(base)) return field;
+    memcpy(base, name, base_length);
+    base[base_length] = '\0';
+
+    const int column = catalog_findAlias(base);
+    if (column < 0 || column == CATALOG_E) return field;
+    for (size_t k = 0; k < sizeof(catalog_units) / sizeof(catalog_units[0]); k++) {
+        if (strcmp(catalog_units[k].suffix, underscore + 1) == 0 && catalog_units[k].length == (column == CATALOG_A)) {
+            return (catalog_field_t){column, catalog_units[k].scale};
+        }
+    }
+    return field;
+}
+
+// next comma separated field of a line (cut out in place, spaces trimmed, a "quoted" field may hold commas),
+// NULL at the end of the line
+static char* catalog_nextField(char** cursor) {
+    char* p = *cursor;
+    if (p == NULL) return NULL;
+    while (*p == ' ' || *p == '\t') p++;
+
+    char* field = p;
+    if (*p == '"') {
+        // "" inside quotes is a quote
+        char* out = ++field;
+        for (p++; *p != '\0'; p++) {
+            if (*p == '"') {
+                if (p[1] != '"') break;
+                p++;
+            }
+            *out++ = *p;
+        }
+        if (*p == '"') p++;
+        *out = '\0';
+        while (*p != '\0' && *p != ',') p++;
+    } else {
+        while (*p != '\0' && *p != ',') p++;
+        char* last = p;
+        while (last > field && (last[-1] == ' ' || last[-1] == '\t')) last--;
+        if (*p == ',') {
+            *last = '\0';
+            *cursor = p + 1;
+            return field;
+        }
+        *last = '\0';
+    }
+    *cursor = *p == ',' ? p + 1 : NULL;
+    return field;
+}
+
+// elements the kepler solver can take: finite, e >= 0 and not parabolic, a > 0 for a bound orbit
+static bool catalog_usableRow(const double* row) {
+    for (int k = 0; k < CATALOG_COLUMNS; k++) {
+        if (!isfinite(row[k])) return false;
+    }
+    const double a = row[CATALOG_A];
+    const double e = row[CATALOG_E];
+    if (e < 0.0 || fabs(e - 1.0) < 1e-9 || a == 0.0) return false;
+    return e > 1.0 || a > 0.0;
+}
+
+static bool catalog_allocate(catalog_t* catalog, const int capacity) {
+    for (int k = 0; k < CATALOG_COLUMNS; k++) {
+        catalog->column[k] = (double*)malloc((size_t)(capacity > 0 ? capacity : 1) * sizeof(double));
+        if (catalog->column[k] == NULL) return false;
+    }
+    return true;
+}
+
+static bool catalog_appendName(catalog_t* catalog, const char* name) {
+    const size_t length = strlen(name) + 1;
+    if (catalog->names_size + length > catalog->names_capacity) {
+        size_t capacity = catalog->names_capacity == 0 ? 4096 : catalog->names_capacity;
+        while (capacity < catalog->names_size + length) capacity *= 2;
+        char* temp = (char*)realloc(catalog->names, capacity);
+        if (temp == NULL) return false;
+        catalog->names = temp;
+        catalog->names_capacity = capacity;
+    }
+    memcpy(catalog->names + catalog->names_size, name, length);
+    catalog->names_size += length;
+    return true;
+}
+
+static void catalog_reportSkipped(const char* path, const int skipped, const char* where, const int first) {
+    if (skipped == 0) return;
+    char message[1200];
+    snprintf(message, sizeof(message), "Skipped %d rows of %s with unusable elements (first at %s %d)", skipped, path, where, first);
+    displayError("ERROR", message);
+}
+
+static bool catalog_readCSV(const char* path, const char* text, const size_t size, catalog_t* catalog) {
+    // rows are at most the number of lines, so the columns are allocated once
+    int lines = 1;
+    for (const char* p = text; (p = memchr(p, '\n', (size_t)(text + size - p))) != NULL; p++) lines++;
+    if (!catalog_allocate(catalog, lines)) {
+        displayError("ERROR", "Failed to allocate memory for the catalog");
+        return false;
+    }
+
+    catalog_field_t* fields = NULL;
+    int field_count = 0;
+    bool named = false;
+    char* line = NULL;
+    size_t line_capacity = 0;
+    int line_number = 0, skipped = 0, first_skipped = 0;
+    bool ok = true;
+
+    const char* p = text;
+    const char* end = text + size;
+    while (p < end && ok) {
+        const char* newline = memchr(p, '\n', (size_t)(end - p));
+        const char* line_end = newline != NULL ? newline : end;
+        size_t length = (size_t)(line_end - p);
+        if (length > 0 && p[length - 1] == '\r') length--;
+        line_number++;
+
+        if (length + 1 > line_capacity) {
+            line_capacity = (length + 1) * 2;
+            char* temp = (char*)realloc(line, line_capacity);
+            if (temp == NULL) {
+                displayError("ERROR", "Failed to allocate memory for the catalog");
+                ok = false;
+                break;
+            }
+            line = temp;
+        }
+        memcpy(line, p, length);
+        line[length] = '\0';
+        p = newline != NULL ? newline + 1 : end;
+
+        char* start = line;
+        while (*start == ' ' || *start == '\t') start++;
+        if (*start == '\0' || *start == '#') continue;
+
+        char* cursor = start;
+        if (fields == NULL) {
+            // header: which column is which
+            int found[CATALOG_COLUMNS] = {0};
+            for (char* name = start; *name != '\0'; name++) *name = (char)tolower((unsigned char)*name);
+            for (char* name; (name = catalog_nextField(&cursor)) != NULL;) {
+                catalog_field_t* temp = (catalog_field_t*)realloc(fields, (size_t)(field_count + 1) * sizeof(catalog_field_t));
+                if (temp == NULL) {
+                    ok = false;
+                    break;
+                }
+                fields = temp;
+                fields[field_count] = catalog_parseHeaderName(name);
+                if (fields[field_count].column >= 0) found[fields[field_count].column]++;
+                if (fields[field_count].column == CATALOG_NAME_FIELD) named = true;
+                field_count++;
+            }
+            for (int k = 0; k < CATALOG_COLUMNS && ok; k++) ok = found[k] == 1;
+            if (!ok) {
+                char message[1200];
+                snprintf(message, sizeof(message), "The header of %s (line %d) needs the columns a, e, i, raan, argp and M once each", path, line_number);
+                displayError("ERROR", message);
+            }
+            continue;
+        }
+
+        double row[CATALOG_COLUMNS];
+        const char* name = NULL;
+        int values = 0;
+        bool usable = true;
+        for (int f = 0; f < field_count; f++) {
+            char* field = catalog_nextField(&cursor);
+            if (field == NULL) {
+                usable = false;
+                break;
+            }
+            if (fields[f].column == CATALOG_NAME_FIELD) {
+                name = field;
+            } else if (fields[f].column >= 0) {
+                char* stop = NULL;
+                row[fields[f].column] = strtod(field, &stop) * fields[f].scale;
+                if (stop == field || *stop != '\0') usable = false;
+                values++;
+            }
+        }
+        if (!usable || values != CATALOG_COLUMNS || !catalog_usableRow(row)) {
+            if (skipped++ == 0) first_skipped = line_number;
+            continue;
+        }
+        if (named && !catalog_appendName(catalog, name != NULL ? name : "")) {
+            displayError("ERROR", "Failed to allocate memory for the catalog");
+            ok = false;
+            break;
+        }
+        for (int k = 0; k < CATALOG_COLUMNS; k++) catalog->column[k][catalog->count] = row[k];
+        catalog->count++;
+    }
+    if (ok && fields == NULL) {
+        char message[1100];
+        snprintf(message, sizeof(message), "%s has no header row", path);
+        displayError("ERROR", message);
+        ok = false;
+    }
+    free(fields);
+    free(line);
+    if (ok) catalog_reportSkipped(path, skipped, "line", first_skipped);
+    return ok;
+}
+
+static bool catalog_readBinary(const char* path, const uint8_t* data, const size_t size, catalog_t* catalog) {
+    const catalog_header_t* header = (const catalog_header_t*)data;
+    const char* problem = NULL;
+    if (size < sizeof(catalog_header_t)) problem = "is truncated";
+    else if (header->version != CATALOG_VERSION) problem = "has an unknown version";
+    else if (header->byte_order != CATALOG_BYTE_ORDER) problem = "was written on a machine with the other byte order";
+    else if (header->count > (uint64_t)INT32_MAX ||
+             size != sizeof(catalog_header_t) + header->count * CATALOG_COLUMNS * sizeof(double) + header->names_size) problem = "has the wrong size";
+    const int count = problem == NULL ? (int)header->count : 0;
+    const char* names = (const char*)data + sizeof(catalog_header_t) + (size_t)count * CATALOG_COLUMNS * sizeof(double);
+
+    // the names have to be exactly one per row
+    if (problem == NULL && header->names_size > 0) {
+        int terminators = 0;
+        for (size_t k = 0; k < header->names_size; k++) terminators += names[k] == '\0';
+        if (terminators != count || names[header->names_size - 1] != '\0') problem = "does not have one name per row";
+    }
+    if (problem != NULL) {
+        char message[1200];
+        snprintf(message, sizeof(message), "Catalog %s %s", path, problem);
+        displayError("ERROR", message);
+        return false;
+    }
+
+    if (!catalog_allocate(catalog, count)) {
+        displayError("ERROR", "Failed to allocate memory for the catalog");
+        return false;
+    }
+    for (int k = 0; k < CATALOG_COLUMNS; k++) {
+        memcpy(catalog->column[k], data + sizeof(catalog_header_t) + (size_t)k * count * sizeof(double), (size_t)count * sizeof(double));
+    }
+
+    // same checks as for csv rows, unusable rows are dropped
+    int skipped = 0, first_skipped = 0;
+    const char* name = names;
+    for (int i = 0; i < count; i++) {
+        double row[CATALOG_COLUMNS];
+        for (int k = 0; k < CATALOG_COLUMNS; k++) row[k] = catalog->column[k][i];
+        const char* row_name = name;
+        if (header->names_size > 0) name += strlen(name) + 1;
+        if (!catalog_usableRow(row)) {
+            if (skipped++ == 0) first_skipped = i + 1;
+            continue;
+        }
+        if (header->names_size > 0 && !catalog_appendName(catalog, row_name)) {
+            displayError("ERROR", "Failed to allocate memory for the catalog");
+            return false;
+        }
+        for (int k = 0; k < CATALOG_COLUMNS; k++) catalog->column[k][catalog->count] = row[k];
+        catalog->count++;
+    }
+    catalog_reportSkipped(path, skipped, "row", first_skipped);
+    return true;
+}
+
+// reads a csv or binary catalog (told apart by the magic), false with an error if nothing could be read
+bool catalog_read(const char* path, catalog_t* catalog) {
+    memset(catalog, 0, sizeof(*catalog));
+
+    // unnamed rows are named after the file
+    const char* base = path;
+    for (const char* p = path; *p != '\0'; p++) {
+        if (*p == '/' || *p == '\\') base = p + 1;
+    }
+    snprintf(catalog->name_prefix, sizeof(catalog->name_prefix), "%s", base);
+    char* dot = strrchr(catalog->name_prefix, '.');
+    if (dot != NULL && dot != catalog->name_prefix) *dot = '\0';
+
+    mapped_file_t file;
+    if (!mapfile_open(&file, path)) {
+        char message[1100];
+        snprintf(message, sizeof(message), "Could not open catalog file %s", path);
+        displayError("ERROR", message);
+        return false;
+    }
+    const bool binary = file.size >= sizeof(CATALOG_MAGIC) - 1 && memcmp(file.data, CATALOG_MAGIC, sizeof(CATALOG_MAGIC) - 1) == 0;
+    const bool ok = binary ? catalog_readBinary(path, file.data, file.size, catalog)
+                           : catalog_readCSV(path, (const char*)file.data, file.size, catalog);
+    mapfile_close(&file);
+    if (!ok) catalog_free(catalog);
+    return ok;
+}
+
+// writes the binary form, which loads without parsing a single number
+bool catalog_writeBinary(const catalog_t* catalog, const char* path) {
+    const size_t columns_size = (size_t)catalog->count * CATALOG_COLUMNS * sizeof(double);
+    const size_t size = sizeof(catalog_header_t) + columns_size + catalog->names_size;
+    uint8_t* data = (uint8_t*)calloc(1, size);
+    if (data == NULL) {
+        displayError("ERROR", "Failed to allocate memory for the catalog file");
+        return false;
+    }
+    catalog_header_t* header = (catalog_header_t*)data;
+    memcpy(header->magic, CATALOG_MAGIC, sizeof(header->magic));
+    header->version = CATALOG_VERSION;
+    header->byte_order = CATALOG_BYTE_ORDER;
+    header->count = (uint64_t)catalog->count;
+    header->names_size = catalog->names_size;
+    for (int k = 0; k < CATALOG_COLUMNS; k++) {
+        memcpy(data + sizeof(catalog_header_t) + (size_t)k * catalog->count * sizeof(double), catalog->column[k],
+               (size_t)catalog->count * sizeof(double));
+    }
+    if (catalog->names_size > 0) memcpy(data + sizeof(catalog_header_t) + columns_size, catalog->names, catalog->names_size);
+
+    const bool written = checkpoint_replaceFile(path, data, size);
+    free(data);
+    if (!written) {
+        char message[1100];
+        snprintf(message, sizeof(message), "Could not write catalog file %s", path);
+        displayError("ERROR", message);
+    }
+    return written;
+}
+
+// adds every row of the catalog around body parent, as test particles or as coasting craft. the elements are
+// converted in one batch (vector kernel, worker pool), returns the number of objects added
+int catalog_import(sim_properties_t* sim, const catalog_t* catalog, const int parent, const bool as_craft) {
+    const body_soa_t* soa = &sim->gb.soa;
+    const int n = catalog->count;
+    if (parent < 0 || parent >= sim->gb.count || n == 0) return 0;
+    const vec3 parent_pos = {soa->pos_x[parent], soa->pos_y[parent], soa->pos_z[parent]};
+    const vec3 parent_vel = {soa->vel_x[parent], soa->vel_y[parent], soa->vel_z[parent]};
+
+    kepler_batch_t batch = {
+        .mu = soa->mu[parent],
+        .count = n,
+        .a = catalog->column[CATALOG_A],
+        .e = catalog->column[CATALOG_E],
+        .inc = catalog->column[CATALOG_INC],
+        .raan = catalog->column[CATALOG_RAAN],
+        .argp = catalog->column[CATALOG_ARGP],
+        .mean_anomaly = catalog->column[CATALOG_MEAN_ANOMALY]
+    };
+
+    if (!as_craft) {
+        // converted straight into the swarm arrays
+        swarm_t* swarm = &sim->swarm;
+        if (!swarm_reserve(swarm, swarm->count + n)) {
+            displayError("ERROR", "Failed to allocate memory for swarm particles");
+            return 0;
+        }
+        const int first = swarm->count;
+        batch.pos_x = swarm->pos_x + first; batch.pos_y = swarm->pos_y + first; batch.pos_z = swarm->pos_z + first;
+        batch.vel_x = swarm->vel_x + first; batch.vel_y = swarm->vel_y + first; batch.vel_z = swarm->vel_z + first;
+        kepler_elementsToStates(sim, &batch);
+        for (int i = first; i < first + n; i++) {
+            swarm->pos_x[i] += parent_pos.x; swarm->pos_y[i] += parent_pos.y; swarm->pos_z[i] += parent_pos.z;
+            swarm->vel_x[i] += parent_vel.x; swarm->vel_y[i] += parent_vel.y; swarm->vel_z[i] += parent_vel.z;
+            swarm->hit_body[i] = -1;
+        }
+        swarm->count += n;
+        return n;
+    }
+
+    spacecraft_properties_t* sc = &sim->gs;
+    double* state = (double*)malloc((size_t)n * 6 * sizeof(double));
+    if (state == NULL || !craft_reserve(sc, sc->count + n)) {
+        free(state);
+        displayError("ERROR", "Failed to allocate memory for spacecraft");
+        return 0;
+    }
+    batch.pos_x = state; batch.pos_y = state + n; batch.pos_z = state + 2 * n;
+    batch.vel_x = state + 3 * n; batch.vel_y = state + 4 * n; batch.vel_z = state + 5 * n;
+    kepler_elementsToStates(sim, &batch);
+
+    int added = 0;
+    const char* name = catalog->names;
+    for (int i = 0; i < n; i++) {
+        char default_name[96];
+        const char* craft_name = name;
+        if (name != NULL) {
+            name += strlen(name) + 1;
+        }
+        if (craft_name == NULL || craft_name[0] == '\0') {
+            snprintf(default_name, sizeof(default_name), "%s %d", catalog->name_prefix, i + 1);
+            craft_name = default_name;
+        }
+        const vec3 pos = vec3_add(parent_pos, (vec3){batch.pos_x[i], batch.pos_y[i], batch.pos_z[i]});
+        const vec3 vel = vec3_add(parent_vel, (vec3){batch.vel_x[i], batch.vel_y[i], batch.vel_z[i]});
+
+        const int before = sc->count;
+        craft_addSpacecraft(sc, craft_name, pos, vel, CATALOG_CRAFT_MASS, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, NULL, 0);
+        if (sc->count == before) break;
+        craft_findClosestPlanet(&sc->spacecraft[before], &sim->gb);
+        added++;
+    }
+    free(state);
+    return added;
+}
+
+void catalog_free(catalog_t* catalog) {
+    for (int k = 0; k < CATALOG_COLUMNS; k++) free(catalog->column[k]);
+    free(catalog->names);
+    memset(catalog, 0, sizeof(*catalog));
+}
@@ -0,0 +1,51 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "../types.h"
+
+// orbital element catalogs: rows of (a, e, i, raan, argp, M) relative to one parent body, turned into state
+// vectors in bulk by kepler_elementsToStates. two forms are read:
+//   csv: a header row names the columns (in any order, with the unit as a suffix, see catalog.c), '#' starts a comment
+//   binary: header (64 bytes), the six element columns of count doubles each (si units and radians, column order of
+//   catalog_column_t), then names_size bytes of NUL terminated names, one per row (0 bytes for an unnamed catalog).
+//   written by "catalog convert", in the byte order of the machine like checkpoints
+
+#define CATALOG_MAGIC "ORBITCAT"
+#define CATALOG_VERSION 1
+#define CATALOG_BYTE_ORDER 0x01020304u
+#define CATALOG_CRAFT_MASS 1000.0 // kg, catalog craft only coast, so the mass does not change their motion
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t count;
+    uint64_t names_size;
+    uint8_t padding[32];
+} catalog_header_t;
+
+typedef enum {
+    CATALOG_A,
+    CATALOG_E,
+    CATALOG_INC,
+    CATALOG_RAAN,
+    CATALOG_ARGP,
+    CATALOG_MEAN_ANOMALY,
+    CATALOG_COLUMNS
+} catalog_column_t;
+
+typedef struct {
+    int count;
+    double* column[CATALOG_COLUMNS];
+    char* names;           // NUL terminated names back to back, one per row, NULL for an unnamed catalog
+    size_t names_size;
+    size_t names_capacity;
+    char name_prefix[64];  // unnamed rows become "<name_prefix> <row>" as craft (the file name without extension)
+} catalog_t;
+
+bool catalog_read(const char* path, catalog_t* catalog);
+bool catalog_writeBinary(const catalog_t* catalog, const char* path);
+int catalog_import(sim_properties_t* sim, const catalog_t* catalog, int parent, bool as_craft);
+void catalog_free(catalog_t* catalog);
+
+#endif
@@ -0,0 +1,669 @@
+#include "checkpoint.h"
+#include "mapped_file.h"
+#include "error_hook.h"
+#include "../globals.h"
+#include "../sim/simulation.h"
+#include "../sim/bodies.h"
+#include "../sim/fmm.h"
+#include "../sim/hermite.h"
+#include "../sim/craft_propagator.h"
+#include "../sim/swarm.h"
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define CHECKPOINT_MAX_SECTIONS 64
+#define CHECKPOINT_SWARM_COLUMNS 6
+
+// body columns: the SoA arrays first (mu is not stored, it is G * mass), then the cold fields of body_t
+#define CHECKPOINT_SOA_COLUMNS 14
+static const size_t checkpoint_bodyFields[] = {
+    offsetof(body_t, SOI_radius),
+    offsetof(body_t, rotational_v),
+    offsetof(body_t, attitude.w), offsetof(body_t, attitude.x), offsetof(body_t, attitude.y), offsetof(body_t, attitude.z),
+    offsetof(body_t, kinetic_energy)
+};
+#define CHECKPOINT_BODY_COLUMNS (CHECKPOINT_SOA_COLUMNS + (int)(sizeof(checkpoint_bodyFields) / sizeof(checkpoint_bodyFields[0])))
+
+// craft and burn records: one double per field, in table order
+typedef enum {
+    CHECKPOINT_DOUBLE,
+    CHECKPOINT_INT,
+    CHECKPOINT_BOOL
+} checkpoint_field_type_t;
+
+typedef struct {
+    size_t offset;
+    checkpoint_field_type_t type;
+} checkpoint_field_t;
+
+#define CRAFT_FIELD(member, type) {offsetof(spacecraft_t, member), type}
+static const checkpoint_field_t checkpoint_craftFields[] = {
+    CRAFT_FIELD(current_total_mass, CHECKPOINT_DOUBLE), CRAFT_FIELD(dry_mass, CHECKPOINT_DOUBLE), CRAFT_FIELD(fuel_mass, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(pos.x, CHECKPOINT_DOUBLE), CRAFT_FIELD(pos.y, CHECKPOINT_DOUBLE), CRAFT_FIELD(pos.z, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(vel.x, CHECKPOINT_DOUBLE), CRAFT_FIELD(vel.y, CHECKPOINT_DOUBLE), CRAFT_FIELD(vel.z, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(vel_mag, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(acc.x, CHECKPOINT_DOUBLE), CRAFT_FIELD(acc.y, CHECKPOINT_DOUBLE), CRAFT_FIELD(acc.z, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(acc_prev.x, CHECKPOINT_DOUBLE), CRAFT_FIELD(acc_prev.y, CHECKPOINT_DOUBLE), CRAFT_FIELD(acc_prev.z, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(grav_force.x, CHECKPOINT_DOUBLE), CRAFT_FIELD(grav_force.y, CHECKPOINT_DOUBLE), CRAFT_FIELD(grav_force.z, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(attitude.w, CHECKPOINT_DOUBLE), CRAFT_FIELD(attitude.x, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(attitude.y, CHECKPOINT_DOUBLE), CRAFT_FIELD(attitude.z, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(rotational_v, CHECKPOINT_DOUBLE), CRAFT_FIELD(rotational_a, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(momentum, CHECKPOINT_DOUBLE), CRAFT_FIELD(moment_of_inertia, CHECKPOINT_DOUBLE), CRAFT_FIELD(torque, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(thrust, CHECKPOINT_DOUBLE), CRAFT_FIELD(mass_flow_rate, CHECKPOINT_DOUBLE), CRAFT_FIELD(specific_impulse, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(throttle, CHECKPOINT_DOUBLE), CRAFT_FIELD(nozzle_gimbal_range, CHECKPOINT_DOUBLE), CRAFT_FIELD(nozzle_velocity, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(engine_on, CHECKPOINT_BOOL),
+    CRAFT_FIELD(SOI_planet_id, CHECKPOINT_INT), CRAFT_FIELD(closest_planet_id, CHECKPOINT_INT), CRAFT_FIELD(closest_r_squared, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(apoapsis, CHECKPOINT_DOUBLE), CRAFT_FIELD(periapsis, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(semi_major_axis, CHECKPOINT_DOUBLE), CRAFT_FIELD(eccentricity, CHECKPOINT_DOUBLE), CRAFT_FIELD(inclination, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(ascending_node, CHECKPOINT_DOUBLE), CRAFT_FIELD(arg_periapsis, CHECKPOINT_DOUBLE), CRAFT_FIELD(true_anomaly, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(num_burns, CHECKPOINT_INT),
+    CRAFT_FIELD(prop_time, CHECKPOINT_DOUBLE), CRAFT_FIELD(prop_step, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(prop_pos.x, CHECKPOINT_DOUBLE), CRAFT_FIELD(prop_pos.y, CHECKPOINT_DOUBLE), CRAFT_FIELD(prop_pos.z, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(prop_vel.x, CHECKPOINT_DOUBLE), CRAFT_FIELD(prop_vel.y, CHECKPOINT_DOUBLE), CRAFT_FIELD(prop_vel.z, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(on_rails, CHECKPOINT_BOOL), CRAFT_FIELD(rails_body, CHECKPOINT_INT), CRAFT_FIELD(rails_epoch, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(rails_pos.x, CHECKPOINT_DOUBLE), CRAFT_FIELD(rails_pos.y, CHECKPOINT_DOUBLE), CRAFT_FIELD(rails_pos.z, CHECKPOINT_DOUBLE),
+    CRAFT_FIELD(rails_vel.x, CHECKPOINT_DOUBLE), CRAFT_FIELD(rails_vel.y, CHECKPOINT_DOUBLE), CRAFT_FIELD(rails_vel.z, CHECKPOINT_DOUBLE)
+};
+#define CHECKPOINT_CRAFT_VALUES ((int)(sizeof(checkpoint_craftFields) / sizeof(checkpoint_craftFields[0])))
+
+#define BURN_FIELD(member, type) {offsetof(burn_properties_t, member), type}
+static const checkpoint_field_t checkpoint_burnFields[] = {
+    BURN_FIELD(burn_start_time, CHECKPOINT_DOUBLE), BURN_FIELD(burn_end_time, CHECKPOINT_DOUBLE),
+    BURN_FIELD(throttle, CHECKPOINT_DOUBLE), BURN_FIELD(burn_heading, CHECKPOINT_DOUBLE),
+    BURN_FIELD(burn_target_id, CHECKPOINT_INT),
+    BURN_FIELD(relative_burn_target.tangent, CHECKPOINT_BOOL),
+    BURN_FIELD(relative_burn_target.normal, CHECKPOINT_BOOL),
+    BURN_FIELD(relative_burn_target.absolute, CHECKPOINT_BOOL)
+};
+#define CHECKPOINT_BURN_VALUES ((int)(sizeof(checkpoint_burnFields) / sizeof(checkpoint_burnFields[0])))
+
+// settings record
+enum {
+    SETTING_SIM_TIME,
+    SETTING_TIME_STEP,
+    SETTING_INTEGRATOR,
+    SETTING_SOLVER,
+    SETTING_THETA,
+    SETTING_SOFTENING,
+    SETTING_FMM_ORDER,
+    SETTING_FMM_LEAF_SIZE,
+    SETTING_ADAPTIVE,
+    SETTING_TOLERANCE,
+    SETTING_MAX_STEP,
+    SETTING_RAILS,
+    SETTING_RAILS_THRESHOLD,
+    SETTING_CRAFT_EVALUATIONS,
+    SETTING_HERMITE_ETA,
+    SETTING_HERMITE_LEVELS,
+    SETTING_SWARM_REMOVED,
+    CHECKPOINT_SETTING_VALUES
+};
+
+// section table being laid out (offsets are handed out in the order sections are added)
+typedef struct {
+    checkpoint_section_t sections[CHECKPOINT_MAX_SECTIONS];
+    uint32_t count;
+    uint64_t end;
+} checkpoint_layout_t;
+
+static void checkpoint_addSection(checkpoint_layout_t* layout, const uint32_t id, const uint32_t element_size, const uint64_t count) {
+    layout->end = (layout->end + CHECKPOINT_ALIGN - 1) / CHECKPOINT_ALIGN * CHECKPOINT_ALIGN;
+    layout->sections[layout->count++] = (checkpoint_section_t){.id = id, .element_size = element_size, .count = count, .offset = layout->end};
+    layout->end += (uint64_t)element_size * count;
+}
+
+// section with this id (NULL if the file has none)
+static const checkpoint_section_t* checkpoint_findSection(const checkpoint_section_t* sections, const uint32_t count, const uint32_t id) {
+    for (uint32_t s = 0; s < count; s++) {
+        if (sections[s].id == id) return &sections[s];
+    }
+    return NULL;
+}
+
+static double* checkpoint_soaColumn(const body_soa_t* soa, const int column) {
+    double* const columns[CHECKPOINT_SOA_COLUMNS] = {
+        soa->pos_x, soa->pos_y, soa->pos_z,
+        soa->vel_x, soa->vel_y, soa->vel_z,
+        soa->acc_x, soa->acc_y, soa->acc_z,
+        soa->acc_prev_x, soa->acc_prev_y, soa->acc_prev_z,
+        soa->mass, soa->radius
+    };
+    return columns[column];
+}
+
+static double* checkpoint_swarmColumn(const swarm_t* swarm, const int column) {
+    double* const columns[CHECKPOINT_SWARM_COLUMNS] = {swarm->pos_x, swarm->pos_y, swarm->pos_z, swarm->vel_x, swarm->vel_y, swarm->vel_z};
+    return columns[column];
+}
+
+static void checkpoint_storeFields(const checkpoint_field_t* fields, const int count, const void* object, double* record) {
+    const char* base = (const char*)object;
+    for (int f = 0; f < count; f++) {
+        const char* field = base + fields[f].offset;
+        switch (fields[f].type) {
+            case CHECKPOINT_DOUBLE: record[f] = *(const double*)field; break;
+            case CHECKPOINT_INT: record[f] = (double)*(const int*)field; break;
+            case CHECKPOINT_BOOL: record[f] = *(const bool*)field ? 1.0 : 0.0; break;
+        }
+    }
+}
+
+// false if an int or bool field does not hold a whole number of its range
+static bool checkpoint_loadFields(const checkpoint_field_t* fields, const int count, void* object, const double* record) {
+    char* base = (char*)object;
+    for (int f = 0; f < count; f++) {
+        char* field = base + fields[f].offset;
+        const double value = record[f];
+        switch (fields[f].type) {
+            case CHECKPOINT_DOUBLE:
+                *(double*)field = value;
+                break;
+            case CHECKPOINT_INT:
+                if (!(value >= INT_MIN && value <= INT_MAX) || value != floor(value)) return false;
+                *(int*)field = (int)value;
+                break;
+            case CHECKPOINT_BOOL:
+                if (value != 0.0 && value != 1.0) return false;
+                *(bool*)field = value == 1.0;
+                break;
+        }
+    }
+    return true;
+}
+
+// name blobs of bodies and craft (name is the first member of both body_t and spacecraft_t)
+static const char* checkpoint_name(const void* items, const size_t stride, const int i) {
+    return *(const char* const*)((const char*)items + (size_t)i * stride);
+}
+
+static size_t checkpoint_namesSize(const void* items, const size_t stride, const int count) {
+    size_t size = 0;
+    for (int i = 0; i < count; i++) size += strlen(checkpoint_name(items, stride, i)) + 1;
+    return size;
+}
+
+static char* checkpoint_copyNames(char* out, const void* items, const size_t stride, const int count) {
+    for (int i = 0; i < count; i++) {
+        const char* name = checkpoint_name(items, stride, i);
+        const size_t length = strlen(name) + 1;
+        memcpy(out, name, length);
+        out += length;
+    }
+    return out;
+}
+
+// copies the whole sim state into a checkpoint image (the caller holds the sim still, e.g. under sim_mutex)
+bool checkpoint_capture(const sim_properties_t* sim, checkpoint_image_t* image) {
+    const body_properties_t* gb = &sim->gb;
+    const spacecraft_properties_t* gs = &sim->gs;
+    const swarm_t* swarm = &sim->swarm;
+    const body_history_t* history = &sim->history;
+    const int nb = gb->count;
+    const int nc = gs->count;
+
+    long long burn_count = 0;
+    for (int c = 0; c < nc; c++) burn_count += gs->spacecraft[c].burn_properties != NULL ? gs->spacecraft[c].num_burns : 0;
+    const int frames = history->time != NULL && history->body_count == nb ? history->count : 0;
+
+    checkpoint_layout_t layout = {.count = 0, .end = sizeof(checkpoint_header_t)};
+    const int section_count = 7 + CHECKPOINT_BODY_COLUMNS + CHECKPOINT_SWARM_COLUMNS;
+    layout.end += (uint64_t)section_count * sizeof(checkpoint_section_t);
+    checkpoint_addSection(&layout, CHECKPOINT_SETTINGS, sizeof(double), CHECKPOINT_SETTING_VALUES);
+    checkpoint_addSection(&layout, CHECKPOINT_BODY_NAMES, 1, checkpoint_namesSize(gb->bodies, sizeof(body_t), nb));
+    checkpoint_addSection(&layout, CHECKPOINT_CRAFT_NAMES, 1, checkpoint_namesSize(gs->spacecraft, sizeof(spacecraft_t), nc));
+    checkpoint_addSection(&layout, CHECKPOINT_CRAFT, sizeof(double), (uint64_t)nc * CHECKPOINT_CRAFT_VALUES);
+    checkpoint_addSection(&layout, CHECKPOINT_BURNS, sizeof(double), (uint64_t)burn_count * CHECKPOINT_BURN_VALUES);
+    checkpoint_addSection(&layout, CHECKPOINT_HISTORY_TIME, sizeof(double), (uint64_t)frames);
+    checkpoint_addSection(&layout, CHECKPOINT_HISTORY_STATE, sizeof(double), (uint64_t)frames * 6 * nb);
+    for (int column = 0; column < CHECKPOINT_BODY_COLUMNS; column++) {
+        checkpoint_addSection(&layout, CHECKPOINT_BODY_COLUMN + column, sizeof(double), (uint64_t)nb);
+    }
+    for (int column = 0; column < CHECKPOINT_SWARM_COLUMNS; column++) {
+        checkpoint_addSection(&layout, CHECKPOINT_SWARM_COLUMN + column, sizeof(double), (uint64_t)swarm->count);
+    }
+
+    image->size = (size_t)layout.end;
+    image->sim_time = sim->wp.sim_time;
+    image->data = (uint8_t*)calloc(1, image->size); // zeroed padding between the sections
+    if (image->data == NULL) {
+        displayError("ERROR", "Failed to allocate memory for the checkpoint");
+        return false;
+    }
+    uint8_t* data = image->data;
+
+    checkpoint_header_t header = {.version = CHECKPOINT_VERSION, .byte_order = CHECKPOINT_BYTE_ORDER,
+        .section_count = layout.count, .sim_time = sim->wp.sim_time, .file_size = layout.end};
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + sizeof(header), layout.sections, layout.count * sizeof(checkpoint_section_t));
+    const checkpoint_section_t* sections = layout.sections;
+
+    double* settings = (double*)(data + sections[0].offset);
+    settings[SETTING_SIM_TIME] = sim->wp.sim_time;
+    settings[SETTING_TIME_STEP] = sim->wp.time_step;
+    settings[SETTING_INTEGRATOR] = (double)sim->wp.integrator;
+    settings[SETTING_SOLVER] = (double)sim->gp.solver;
+    settings[SETTING_THETA] = sim->gp.theta;
+    settings[SETTING_SOFTENING] = sim->gp.softening;
+    settings[SETTING_FMM_ORDER] = sim->gp.fmm_order;
+    settings[SETTING_FMM_LEAF_SIZE] = sim->gp.fmm_leaf_size;
+    settings[SETTING_ADAPTIVE] = sim->cp.adaptive ? 1.0 : 0.0;
+    settings[SETTING_TOLERANCE] = sim->cp.tolerance;
+    settings[SETTING_MAX_STEP] = sim->cp.max_step;
+    settings[SETTING_RAILS] = sim->cp.rails ? 1.0 : 0.0;
+    settings[SETTING_RAILS_THRESHOLD] = sim->cp.rails_threshold;
+    settings[SETTING_CRAFT_EVALUATIONS] = (double)sim->cp.force_evaluations;
+    settings[SETTING_HERMITE_ETA] = sim->hermite.eta;
+    settings[SETTING_HERMITE_LEVELS] = sim->hermite.max_level;
+    settings[SETTING_SWARM_REMOVED] = (double)swarm->removed;
+
+    checkpoint_copyNames((char*)(data + sections[1].offset), gb->bodies, sizeof(body_t), nb);
+    checkpoint_copyNames((char*)(data + sections[2].offset), gs->spacecraft, sizeof(spacecraft_t), nc);
+
+    double* craft = (double*)(data + sections[3].offset);
+    double* burns = (double*)(data + sections[4].offset);
+    for (int c = 0; c < nc; c++) {
+        spacecraft_t source = gs->spacecraft[c];
+        if (source.burn_properties == NULL) source.num_burns = 0;
+        checkpoint_storeFields(checkpoint_craftFields, CHECKPOINT_CRAFT_VALUES, &source, craft + (size_t)c * CHECKPOINT_CRAFT_VALUES);
+        for (int b = 0; b < source.num_burns; b++) {
+            checkpoint_storeFields(checkpoint_burnFields, CHECKPOINT_BURN_VALUES, &source.burn_properties[b], burns);
+            burns += CHECKPOINT_BURN_VALUES;
+        }
+    }
+
+    // history frames oldest first, so the restored ring starts at frame 0
+    double* history_time = (double*)(data + sections[5].offset);
+    double* history_state = (double*)(data + sections[6].offset);
+    const size_t frame_values = 6 * (size_t)nb;
+    for (int k = 0; k < frames; k++) {
+        const int frame = (history->head - history->count + k + history->capacity) % history->capacity;
+        history_time[k] = history->time[frame];
+        memcpy(history_state + k * frame_values, history->state + frame * frame_values, frame_values * sizeof(double));
+    }
+
+    for (int column = 0; column < CHECKPOINT_BODY_COLUMNS; column++) {
+        double* out = (double*)(data + sections[7 + column].offset);
+        if (column < CHECKPOINT_SOA_COLUMNS) {
+            if (nb > 0) memcpy(out, checkpoint_soaColumn(&gb->soa, column), (size_t)nb * sizeof(double));
+            continue;
+        }
+        const size_t offset = checkpoint_bodyFields[column - CHECKPOINT_SOA_COLUMNS];
+        for (int i = 0; i < nb; i++) out[i] = *(const double*)((const char*)&gb->bodies[i] + offset);
+    }
+    for (int column = 0; column < CHECKPOINT_SWARM_COLUMNS; column++) {
+        double* out = (double*)(data + sections[7 + CHECKPOINT_BODY_COLUMNS + column].offset);
+        if (swarm->count > 0) memcpy(out, checkpoint_swarmColumn(swarm, column), (size_t)swarm->count * sizeof(double));
+    }
+    return true;
+}
+
+void checkpoint_freeImage(checkpoint_image_t* image) {
+    free(image->data);
+    image->data = NULL;
+    image->size = 0;
+}
+
+// writes all of data to path and flushes it to the disk
+static bool checkpoint_writeFile(const char* path, const uint8_t* data, size_t size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    bool written = true;
+    while (written && size > 0) {
+        DWORD done = 0;
+        written = WriteFile(file, data, size > (1u << 30) ? (1u << 30) : (DWORD)size, &done, NULL) && done > 0;
+        data += done;
+        size -= done;
+    }
+    written = FlushFileBuffers(file) && written;
+    return CloseHandle(file) && written;
+#else
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool written = true;
+    while (written && size > 0) {
+        const ssize_t done = write(fd, data, size);
+        written = done > 0;
+        if (written) {
+            data += done;
+            size -= (size_t)done;
+        }
+    }
+    written = fsync(fd) == 0 && written;
+    return close(fd) == 0 && written;
+#endif
+}
+
+// writes data next to path and renames it over path, so a crash mid write never leaves a broken file behind
+bool checkpoint_replaceFile(const char* path, const void* data, const size_t size) {
+    char temp[1024];
+    if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp)) return false;
+
+    bool written = checkpoint_writeFile(temp, (const uint8_t*)data, size);
+#ifdef _WIN32
+    written = written && MoveFileExA(temp, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    written = written && rename(temp, path) == 0;
+#endif
+    if (!written) remove(temp);
+    return written;
+}
+
+bool checkpoint_writeImage(const checkpoint_image_t* image, const char* path) {
+    const bool written = checkpoint_replaceFile(path, image->data, image->size);
+    if (!written) {
+        char message[1100];
+        snprintf(message, sizeof(message), "Could not write checkpoint file %s", path);
+        displayError("ERROR", message);
+    }
+    return written;
+}
+
+bool checkpoint_save(const sim_properties_t* sim, const char* path) {
+    checkpoint_image_t image;
+    if (!checkpoint_capture(sim, &image)) return false;
+    const bool written = checkpoint_writeImage(&image, path);
+    checkpoint_freeImage(&image);
+    return written;
+}
+
+// the sections of a mapped checkpoint, checked against each other before anything in the sim is touched
+typedef struct {
+    const uint8_t* data;
+    const checkpoint_section_t* sections;
+    uint32_t section_count;
+    int body_count;
+    int craft_count;
+    int particle_count;
+    int frames;
+    const checkpoint_section_t* settings;
+    const checkpoint_section_t* body_names;
+    const checkpoint_section_t* craft_names;
+    const checkpoint_section_t* craft;
+    const checkpoint_section_t* burns;
+    const checkpoint_section_t* history_time;
+    const checkpoint_section_t* history_state;
+    const checkpoint_section_t* body_columns[CHECKPOINT_BODY_COLUMNS];
+    const checkpoint_section_t* swarm_columns[CHECKPOINT_SWARM_COLUMNS];
+} checkpoint_view_t;
+
+// section that must exist with exactly count elements of element_size bytes
+static const checkpoint_section_t* checkpoint_requireSection(const checkpoint_view_t* view, const uint32_t id,
+                                                             const uint32_t element_size, const uint64_t count) {
+    const checkpoint_section_t* section = checkpoint_findSection(view->sections, view->section_count, id);
+    return section != NULL && section->element_size == element_size && section->count == count ? section : NULL;
+}
+
+// true if the blob holds exactly count NUL terminated names
+static bool checkpoint_checkNames(const checkpoint_view_t* view, const checkpoint_section_t* section, const int count) {
+    const char* names = (const char*)(view->data + section->offset);
+    uint64_t at = 0;
+    for (int i = 0; i < count; i++) {
+        const void* end = at < section->count ? memchr(names + at, '\0', (size_t)(section->count - at)) : NULL;
+        if (end == NULL) return false;
+        at = (uint64_t)((const char*)end - names) + 1;
+    }
+    return at == section->count;
+}
+
+// fills view from the mapped file, NULL if it is usable, otherwise what is wrong with it
+static const char* checkpoint_validate(const mapped_file_t* file, checkpoint_view_t* view) {
+    memset(view, 0, sizeof(*view));
+    checkpoint_header_t header;
+    if (file->size < sizeof(header)) return "too short";
+    memcpy(&header, file->data, sizeof(header));
+    if (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0) return "not a checkpoint file";
+    if (header.byte_order != CHECKPOINT_BYTE_ORDER) return "written on a machine with the other byte order";
+    if (header.version != CHECKPOINT_VERSION) return "unsupported version";
+    if (header.file_size != file->size) return "truncated";
+    if (header.section_count > CHECKPOINT_MAX_SECTIONS ||
+        sizeof(header) + header.section_count * sizeof(checkpoint_section_t) > file->size) return "bad section table";
+
+    view->data = file->data;
+    view->sections = (const checkpoint_section_t*)(file->data + sizeof(header));
+    view->section_count = header.section_count;
+    for (uint32_t s = 0; s < view->section_count; s++) {
+        const checkpoint_section_t* section = &view->sections[s];
+        if ((section->element_size != 1 && section->element_size != sizeof(double)) || section->offset % sizeof(double) != 0 ||
+            section->offset > file->size || section->count > (file->size - section->offset) / section->element_size) return "section outside the file";
+    }
+
+    view->settings = checkpoint_requireSection(view, CHECKPOINT_SETTINGS, sizeof(double), CHECKPOINT_SETTING_VALUES);
+    if (view->settings == NULL) return "no settings";
+    const double* settings = (const double*)(view->data + view->settings->offset);
+    if (!(settings[SETTING_TIME_STEP] > 0.0) || !isfinite(settings[SETTING_SIM_TIME]) ||
+        !(settings[SETTING_INTEGRATOR] >= INTEGRATOR_VERLET && settings[SETTING_INTEGRATOR] <= INTEGRATOR_HERMITE) ||
+        !(settings[SETTING_SOLVER] >= GRAVITY_DIRECT && settings[SETTING_SOLVER] <= GRAVITY_FMM) ||
+        !(settings[SETTING_FMM_ORDER] >= 2 && settings[SETTING_FMM_ORDER] <= FMM_MAX_ORDER) ||
+        !(settings[SETTING_FMM_LEAF_SIZE] >= 1 && settings[SETTING_FMM_LEAF_SIZE] <= INT_MAX) ||
+        !(settings[SETTING_HERMITE_LEVELS] >= 0 && settings[SETTING_HERMITE_LEVELS] <= HERMITE_MAX_LEVELS) ||
+        !(fabs(settings[SETTING_CRAFT_EVALUATIONS]) < 9e18) || !(fabs(settings[SETTING_SWARM_REMOVED]) < 9e18)) return "bad settings";
+
+    // bodies: every column holds the same count
+    const checkpoint_section_t* first = checkpoint_findSection(view->sections, view->section_count, CHECKPOINT_BODY_COLUMN);
+    if (first == NULL || first->count > INT_MAX / 6) return "no bodies";
+    view->body_count = (int)first->count;
+    for (int column = 0; column < CHECKPOINT_BODY_COLUMNS; column++) {
+        view->body_columns[column] = checkpoint_requireSection(view, CHECKPOINT_BODY_COLUMN + column, sizeof(double), first->count);
+        if (view->body_columns[column] == NULL) return "body columns do not match";
+    }
+    view->body_names = checkpoint_findSection(view->sections, view->section_count, CHECKPOINT_BODY_NAMES);
+    if (view->body_names == NULL || view->body_names->element_size != 1 ||
+        !checkpoint_checkNames(view, view->body_names, view->body_count)) return "bad body names";
+
+    // craft, and their burns
+    view->craft = checkpoint_findSection(view->sections, view->section_count, CHECKPOINT_CRAFT);
+    if (view->craft == NULL || view->craft->element_size != sizeof(double) || view->craft->count % CHECKPOINT_CRAFT_VALUES != 0 ||
+        view->craft->count / CHECKPOINT_CRAFT_VALUES > INT_MAX) return "bad craft records";
+    view->craft_count = (int)(view->craft->count / CHECKPOINT_CRAFT_VALUES);
+    view->craft_names = checkpoint_findSection(view->sections, view->section_count, CHECKPOINT_CRAFT_NAMES);
+    if (view->craft_names == NULL || view->craft_names->element_size != 1 ||
+        !checkpoint_checkNames(view, view->craft_names, view->craft_count)) return "bad craft names";
+
+    const double* craft = (const double*)(view->data + view->craft->offset);
+    uint64_t burn_count = 0;
+    for (int c = 0; c < view->craft_count; c++) {
+        spacecraft_t check;
+        if (!checkpoint_loadFields(checkpoint_craftFields, CHECKPOINT_CRAFT_VALUES, &check, craft + (size_t)c * CHECKPOINT_CRAFT_VALUES) ||
+            check.num_burns < 0 || check.SOI_planet_id < 0 || check.closest_planet_id < 0 || check.rails_body < -1 ||
+            (view->body_count > 0 && (check.SOI_planet_id >= view->body_count || check.closest_planet_id >= view->body_count ||
+                                      check.rails_body >= view->body_count))) return "bad craft records";
+        burn_count += (uint64_t)check.num_burns;
+    }
+    view->burns = checkpoint_requireSection(view, CHECKPOINT_BURNS, sizeof(double), burn_count * CHECKPOINT_BURN_VALUES);
+    if (view->burns == NULL) return "burns do not match the craft";
+    const double* burns = (const double*)(view->data + view->burns->offset);
+    for (uint64_t b = 0; b < burn_count; b++) {
+        burn_properties_t check;
+        if (!checkpoint_loadFields(checkpoint_burnFields, CHECKPOINT_BURN_VALUES, &check, burns + b * CHECKPOINT_BURN_VALUES) ||
+            check.burn_target_id < 0 || (view->body_count > 0 && check.burn_target_id >= view->body_count)) return "bad burns";
+    }
+
+    // particles
+    const checkpoint_section_t* particles = checkpoint_findSection(view->sections, view->section_count, CHECKPOINT_SWARM_COLUMN);
+    if (particles == NULL || particles->count > INT_MAX) return "no particle columns";
+    view->particle_count = (int)particles->count;
+    for (int column = 0; column < CHECKPOINT_SWARM_COLUMNS; column++) {
+        view->swarm_columns[column] = checkpoint_requireSection(view, CHECKPOINT_SWARM_COLUMN + column, sizeof(double), particles->count);
+        if (view->swarm_columns[column] == NULL) return "particle columns do not match";
+    }
+
+    // body history (optional, only the newest frames that fit the ring are kept)
+    view->history_time = checkpoint_findSection(view->sections, view->section_count, CHECKPOINT_HISTORY_TIME);
+    if (view->history_time != NULL && view->history_time->count > 0) {
+        if (view->history_time->element_size != sizeof(double)) return "bad body history";
+        view->history_state = checkpoint_requireSection(view, CHECKPOINT_HISTORY_STATE, sizeof(double),
+                                                        view->history_time->count * 6 * (uint64_t)view->body_count);
+        if (view->history_state == NULL) return "bad body history";
+        view->frames = view->history_time->count > CRAFT_HISTORY_FRAMES ? CRAFT_HISTORY_FRAMES : (int)view->history_time->count;
+    }
+    return NULL;
+}
+
+static char* checkpoint_dupName(const char** names) {
+    const size_t length = strlen(*names) + 1;
+    char* name = (char*)malloc(length);
+    if (name != NULL) memcpy(name, *names, length);
+    *names += length;
+    return name;
+}
+
+// moves the validated file into the (freshly reset) sim, false if memory ran out
+static bool checkpoint_load(sim_properties_t* sim, const checkpoint_view_t* view) {
+    const uint8_t* data = view->data;
+    const double* settings = (const double*)(data + view->settings->offset);
+    sim->wp.sim_time = settings[SETTING_SIM_TIME];
+    sim->wp.time_step = settings[SETTING_TIME_STEP];
+    sim->wp.integrator = (integrator_t)(int)settings[SETTING_INTEGRATOR];
+    sim->gp.solver = (gravity_solver_t)(int)settings[SETTING_SOLVER];
+    sim->gp.theta = settings[SETTING_THETA];
+    sim->gp.softening = settings[SETTING_SOFTENING];
+    sim->gp.fmm_order = (int)settings[SETTING_FMM_ORDER];
+    sim->gp.fmm_leaf_size = (int)settings[SETTING_FMM_LEAF_SIZE];
+    sim->cp.adaptive = settings[SETTING_ADAPTIVE] != 0.0;
+    sim->cp.tolerance = settings[SETTING_TOLERANCE];
+    sim->cp.max_step = settings[SETTING_MAX_STEP];
+    sim->cp.rails = settings[SETTING_RAILS] != 0.0;
+    sim->cp.rails_threshold = settings[SETTING_RAILS_THRESHOLD];
+    sim->cp.force_evaluations = (long long)settings[SETTING_CRAFT_EVALUATIONS];
+    sim->hermite.eta = settings[SETTING_HERMITE_ETA];
+    sim->hermite.max_level = (int)settings[SETTING_HERMITE_LEVELS];
+    sim->telemetry.next_time = sim->wp.sim_time; // the restored state is the next sample
+
+    // bodies: one reservation, then every column straight out of the file
+    body_properties_t* gb = &sim->gb;
+    const int nb = view->body_count;
+    if (nb > 0 && !body_reserve(gb, nb)) return false;
+    const char* names = (const char*)(data + view->body_names->offset);
+    for (int i = 0; i < nb; i++) {
+        gb->bodies[i] = (body_t){0};
+        gb->bodies[i].name = checkpoint_dupName(&names);
+        gb->count = i + 1; // so a failed allocation below still frees the names made so far
+        if (gb->bodies[i].name == NULL) return false;
+    }
+    for (int column = 0; column < CHECKPOINT_BODY_COLUMNS; column++) {
+        const double* in = (const double*)(data + view->body_columns[column]->offset);
+        if (column < CHECKPOINT_SOA_COLUMNS) {
+            if (nb > 0) memcpy(checkpoint_soaColumn(&gb->soa, column), in, (size_t)nb * sizeof(double));
+            continue;
+        }
+        const size_t offset = checkpoint_bodyFields[column - CHECKPOINT_SOA_COLUMNS];
+        for (int i = 0; i < nb; i++) *(double*)((char*)&gb->bodies[i] + offset) = in[i];
+    }
+    for (int i = 0; i < nb; i++) {
+        gb->soa.mu[i] = G * gb->soa.mass[i];
+        gb->soa.force_x[i] = gb->soa.force_y[i] = gb->soa.force_z[i] = 0.0;
+        gb->bodies[i].mass = gb->soa.mass[i];
+        gb->bodies[i].radius = gb->soa.radius[i];
+    }
+    body_syncSideTable(gb);
+
+    // craft
+    spacecraft_properties_t* gs = &sim->gs;
+    const int nc = view->craft_count;
+    if (nc > 0) {
+        gs->spacecraft = (spacecraft_t*)calloc((size_t)nc, sizeof(spacecraft_t));
+        if (gs->spacecraft == NULL) return false;
+        gs->capacity = nc;
+    }
+    names = (const char*)(data + view->craft_names->offset);
+    const double* craft = (const double*)(data + view->craft->offset);
+    const double* burns = (const double*)(data + view->burns->offset);
+    for (int c = 0; c < nc; c++) {
+        spacecraft_t* target = &gs->spacecraft[c];
+        checkpoint_loadFields(checkpoint_craftFields, CHECKPOINT_CRAFT_VALUES, target, craft + (size_t)c * CHECKPOINT_CRAFT_VALUES);
+        const int num_burns = target->num_burns;
+        target->name = checkpoint_dupName(&names);
+        target->burn_properties = num_burns > 0 ? (burn_properties_t*)malloc((size_t)num_burns * sizeof(burn_properties_t)) : NULL;
+        gs->count = c + 1;
+        if (target->name == NULL || (num_burns > 0 && target->burn_properties == NULL)) return false;
+        for (int b = 0; b < num_burns; b++) {
+            checkpoint_loadFields(checkpoint_burnFields, CHECKPOINT_BURN_VALUES, &target->burn_properties[b], burns);
+            burns += CHECKPOINT_BURN_VALUES;
+        }
+    }
+
+    // test particles
+    swarm_t* swarm = &sim->swarm;
+    const int np = view->particle_count;
+    if (np > 0 && !swarm_reserve(swarm, np)) return false;
+    for (int column = 0; column < CHECKPOINT_SWARM_COLUMNS; column++) {
+        if (np > 0) memcpy(checkpoint_swarmColumn(swarm, column), data + view->swarm_columns[column]->offset, (size_t)np * sizeof(double));
+    }
+    for (int p = 0; p < np; p++) swarm->hit_body[p] = -1;
+    swarm->count = np;
+    swarm->removed = (long long)settings[SETTING_SWARM_REMOVED];
+
+    // body history for the adaptive craft propagator, oldest frame first
+    if (view->frames > 0 && nb > 0) {
+        body_history_t* history = &sim->history;
+        const int skip = (int)view->history_time->count - view->frames;
+        const size_t frame_values = 6 * (size_t)nb;
+        history->time = (double*)malloc(CRAFT_HISTORY_FRAMES * sizeof(double));
+        history->state = (double*)malloc(CRAFT_HISTORY_FRAMES * frame_values * sizeof(double));
+        if (history->time == NULL || history->state == NULL) {
+            body_freeHistory(history);
+            return false;
+        }
+        memcpy(history->time, (const double*)(data + view->history_time->offset) + skip, (size_t)view->frames * sizeof(double));
+        memcpy(history->state, (const double*)(data + view->history_state->offset) + skip * frame_values,
+               (size_t)view->frames * frame_values * sizeof(double));
+        history->capacity = CRAFT_HISTORY_FRAMES;
+        history->body_count = nb;
+        history->count = view->frames;
+        history->head = view->frames % CRAFT_HISTORY_FRAMES;
+    }
+    return true;
+}
+
+// replaces the whole sim with the checkpoint at path (the hermite block state is rebuilt from it on the next step)
+bool checkpoint_restore(sim_properties_t* sim, const char* path) {
+    mapped_file_t file;
+    if (!mapfile_open(&file, path)) {
+        char message[512];
+        snprintf(message, sizeof(message), "Could not open checkpoint file %s", path);
+        displayError("ERROR", message);
+        return false;
+    }
+
+    checkpoint_view_t view;
+    const char* problem = checkpoint_validate(&file, &view);
+    if (problem != NULL) {
+        char message[512];
+        snprintf(message, sizeof(message), "%s is not a usable checkpoint: %s", path, problem);
+        displayError("ERROR", message);
+        mapfile_close(&file);
+        return false;
+    }
+
+    resetSim(sim);
+    const bool loaded = checkpoint_load(sim, &view);
+    mapfile_close(&file);
+    if (!loaded) {
+        resetSim(sim);
+        displayError("ERROR", "Failed to allocate memory for the checkpoint");
+    }
+    return loaded;
+}
+
+// true if path starts like a checkpoint file (lets scenario arguments take either format)
+bool checkpoint_isFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return false;
+    char magic[8];
+    const bool match = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return match;
+}
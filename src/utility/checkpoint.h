@@ -0,0 +1,64 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "../types.h"
+
+// binary checkpoint of the whole sim state, written so a restore is a handful of memcpys out of the mapped file:
+//   header (64 bytes), section table (section_count entries), then the sections, each starting on a 64 byte boundary.
+//   numbers are stored in the byte order of the machine that wrote the file (a file from the other order is refused)
+//   every body and particle column is its own section, so a column goes straight into its SoA array.
+//   craft and burns are records of doubles built from one field table each (checkpoint.c), which save and
+//   restore both walk so the two cannot drift apart. the settings record is a fixed list of doubles
+
+#define CHECKPOINT_MAGIC "ORBITCKP"
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_BYTE_ORDER 0x01020304u
+#define CHECKPOINT_ALIGN 64
+#define CHECKPOINT_DEFAULT_FILENAME "checkpoint.bin"
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;     // CHECKPOINT_BYTE_ORDER as written by the saving machine
+    uint32_t section_count;
+    uint32_t reserved;
+    double sim_time;
+    uint64_t file_size;      // catches truncated files
+    uint8_t padding[24];
+} checkpoint_header_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t element_size;   // 8 for doubles, 1 for the name blobs
+    uint64_t count;          // elements
+    uint64_t offset;         // from the start of the file
+} checkpoint_section_t;
+
+typedef enum {
+    CHECKPOINT_SETTINGS = 1,       // one settings record
+    CHECKPOINT_BODY_NAMES = 2,     // NUL terminated names, one per body
+    CHECKPOINT_CRAFT_NAMES = 3,
+    CHECKPOINT_CRAFT = 4,          // one record per craft
+    CHECKPOINT_BURNS = 5,          // one record per burn, craft after craft
+    CHECKPOINT_HISTORY_TIME = 6,   // body history frames, oldest first
+    CHECKPOINT_HISTORY_STATE = 7,  // [frame][pos_x, pos_y, pos_z, vel_x, vel_y, vel_z][body]
+    CHECKPOINT_BODY_COLUMN = 16,   // + column (see checkpoint.c), one double per body
+    CHECKPOINT_SWARM_COLUMN = 48   // + 0..5 for pos_x .. vel_z, one double per particle
+} checkpoint_section_id_t;
+
+// a checkpoint file assembled in memory, so the sim only has to be held still while it is copied
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    double sim_time;
+} checkpoint_image_t;
+
+bool checkpoint_capture(const sim_properties_t* sim, checkpoint_image_t* image);
+bool checkpoint_replaceFile(const char* path, const void* data, size_t size);
+bool checkpoint_writeImage(const checkpoint_image_t* image, const char* path);
+void checkpoint_freeImage(checkpoint_image_t* image);
+bool checkpoint_save(const sim_properties_t* sim, const char* path);
+bool checkpoint_restore(sim_properties_t* sim, const char* path);
+bool checkpoint_isFile(const char* path);
+
+#endif
@@ -0,0 +1,39 @@
+#include "command_queue.h"
+#include "sim_thread.h"
+#include <string.h>
+
+// head and tail count modulo twice the capacity, so a full queue (COMMAND_QUEUE_CAPACITY apart)
+// and an empty one (equal) can be told apart without a separate counter
+#define CMDQ_INDEX_MASK (2 * COMMAND_QUEUE_CAPACITY - 1)
+
+// producer side, returns false if the queue is full
+bool cmdq_push(command_queue_t* queue, const char* text, const double time) {
+    const int tail = queue->tail; // only this thread writes tail
+    if (((tail - atomic_loadInt(&queue->head)) & CMDQ_INDEX_MASK) == COMMAND_QUEUE_CAPACITY) return false;
+
+    sim_command_t* slot = &queue->slots[tail & (COMMAND_QUEUE_CAPACITY - 1)];
+    slot->time = time;
+    strncpy(slot->text, text, COMMAND_TEXT_LENGTH - 1);
+    slot->text[COMMAND_TEXT_LENGTH - 1] = '\0';
+
+    // the release store makes the slot contents visible before the consumer can see the new tail
+    atomic_storeInt(&queue->tail, (tail + 1) & CMDQ_INDEX_MASK);
+    return true;
+}
+
+// consumer side, returns false if the queue is empty
+bool cmdq_pop(command_queue_t* queue, sim_command_t* command) {
+    const int head = queue->head; // only this thread writes head
+    if (atomic_loadInt(&queue->tail) == head) return false;
+
+    *command = queue->slots[head & (COMMAND_QUEUE_CAPACITY - 1)];
+
+    // hands the slot back to the producer only after it was copied out
+    atomic_storeInt(&queue->head, (head + 1) & CMDQ_INDEX_MASK);
+    return true;
+}
+
+// either side may ask (the answer can be stale by the time it is used)
+bool cmdq_isEmpty(command_queue_t* queue) {
+    return atomic_loadInt(&queue->tail) == atomic_loadInt(&queue->head);
+}
@@ -0,0 +1,10 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include "../types.h"
+
+bool cmdq_push(command_queue_t* queue, const char* text, double time);
+bool cmdq_pop(command_queue_t* queue, sim_command_t* command);
+bool cmdq_isEmpty(command_queue_t* queue);
+
+#endif
@@ -0,0 +1,517 @@
+#include "commands.h"
+#include "command_queue.h"
+#include "json_loader.h"
+#include "thread_pool.h"
+#include "telemetry_export.h"
+#include "checkpoint.h"
+#include "autosave.h"
+#include "catalog.h"
+#include "benchmark.h"
+#include "../globals.h"
+#include "../sim/gravity.h"
+#include "../sim/fmm.h"
+#include "../sim/gravity_simd.h"
+#include "../sim/integrator.h"
+#include "../sim/hermite.h"
+#include "../sim/craft_propagator.h"
+#include "../sim/swarm.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// everything in this file runs on the physics thread between two steps, so commands can change the
+// sim freely without racing the integrator
+
+// applies one console command to the sim and writes what happened to log (COMMAND_TEXT_LENGTH chars)
+void command_apply(sim_properties_t* sim, char* cmd, char* log) {
+    if (strncmp(cmd, "step method ", 12) == 0) {
+        if (integrator_parseName(cmd + 12, &sim->wp.integrator)) {
+            snprintf(log, COMMAND_TEXT_LENGTH, "integrator set to %s", integrator_name(sim->wp.integrator));
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "unknown integrator: %s (verlet, yoshida4, yoshida6, wisdom-holman, hermite)", cmd + 12);
+    }
+    else if (strncmp(cmd, "step eta ", 9) == 0) {
+        const double eta = strtod(cmd + 9, NULL);
+        if (eta > 0.0 && eta <= 1.0) {
+            sim->hermite.eta = eta;
+            snprintf(log, COMMAND_TEXT_LENGTH, "hermite step accuracy set to %g", sim->hermite.eta);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "eta must be in (0, 1]");
+    }
+    else if (strncmp(cmd, "step levels ", 12) == 0) {
+        const int levels = atoi(cmd + 12);
+        if (levels >= 0 && levels <= HERMITE_MAX_LEVELS) {
+            sim->hermite.max_level = levels;
+            snprintf(log, COMMAND_TEXT_LENGTH, "hermite steps go down to step / 2^%d", sim->hermite.max_level);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "levels must be between 0 and %d", HERMITE_MAX_LEVELS);
+    }
+    else if (strcmp(cmd, "step stats") == 0) {
+        const hermite_state_t* hs = &sim->hermite;
+        if (hs->block_count > 0 && hs->count > 0) {
+            int deepest = 0;
+            for (int i = 0; i < hs->count; i++) {
+                if (hs->level[i] > deepest) deepest = hs->level[i];
+            }
+            snprintf(log, COMMAND_TEXT_LENGTH, "hermite: %.2f force evaluations per body per step, deepest level %d",
+                (double)hs->force_evaluations / ((double)hs->block_count * hs->count), deepest);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "no hermite steps taken yet");
+    }
+    else if (strncmp(cmd, "step ", 4) == 0) {
+        char* argument = cmd + 4;
+        sim->wp.time_step = strtod(argument, &argument);
+
+        snprintf(log, COMMAND_TEXT_LENGTH, "step set to %f", sim->wp.time_step);
+    }
+    else if (strcmp(cmd, "pause") == 0 || strcmp(cmd, "p") == 0) {
+        sim->wp.sim_running = false;
+        snprintf(log, COMMAND_TEXT_LENGTH, "sim paused");
+    }
+    else if (strcmp(cmd, "resume") == 0 || strcmp(cmd, "r") == 0) {
+        sim->wp.sim_running = true;
+        snprintf(log, COMMAND_TEXT_LENGTH, "sim resumed");
+    }
+    else if (strcmp(cmd, "load") == 0) {
+        if (sim->gb.count == 0) {
+            sim->wp.sim_running = false; // pauses before loading
+            readSimulationJSON(SIMULATION_FILENAME, sim);
+            snprintf(log, COMMAND_TEXT_LENGTH, "%d planets and %d craft loaded from json file", sim->gb.count, sim->gs.count);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "Warning: system already loaded, reset before loading another");
+    }
+    else if (strcmp(cmd, "save") == 0 || strncmp(cmd, "save ", 5) == 0) {
+        const char* path = cmd[4] == ' ' ? cmd + 5 : CHECKPOINT_DEFAULT_FILENAME;
+        if (checkpoint_save(sim, path)) snprintf(log, COMMAND_TEXT_LENGTH, "saved t = %.3f s to %s", sim->wp.sim_time, path);
+        else snprintf(log, COMMAND_TEXT_LENGTH, "could not save to %s", path);
+    }
+    else if (strcmp(cmd, "restore") == 0 || strncmp(cmd, "restore ", 8) == 0) {
+        const char* path = cmd[7] == ' ' ? cmd + 8 : CHECKPOINT_DEFAULT_FILENAME;
+        if (checkpoint_restore(sim, path)) {
+            snprintf(log, COMMAND_TEXT_LENGTH, "restored %d bodies, %d craft and %d particles at t = %.3f s from %s",
+                sim->gb.count, sim->gs.count, sim->swarm.count, sim->wp.sim_time, path);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "could not restore from %s", path);
+    }
+    else if (strncmp(cmd, "autosave ", 9) == 0) {
+        char* argument = cmd + 9;
+        autosave_params_t* ap = &sim->autosave;
+        if (strncmp(argument, "every ", 6) == 0) {
+            const double interval = strtod(argument + 6, NULL);
+            if (interval >= 0.0) {
+                autosave_setEvery(sim, interval);
+                if (interval > 0.0) snprintf(log, COMMAND_TEXT_LENGTH, "checkpoint every %g sim seconds", interval);
+                else snprintf(log, COMMAND_TEXT_LENGTH, "sim time checkpoints off");
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "checkpoint interval must be 0 (off) or more");
+        }
+        else if (strncmp(argument, "wall ", 5) == 0) {
+            const double minutes = strtod(argument + 5, NULL);
+            if (minutes >= 0.0) {
+                autosave_setWall(sim, minutes * 60.0);
+                if (minutes > 0.0) snprintf(log, COMMAND_TEXT_LENGTH, "checkpoint every %g wall clock minutes", minutes);
+                else snprintf(log, COMMAND_TEXT_LENGTH, "wall clock checkpoints off");
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "checkpoint interval must be 0 (off) or more");
+        }
+        else if (strncmp(argument, "keep ", 5) == 0) {
+            const int keep = atoi(argument + 5);
+            if (keep >= 1) {
+                ap->keep = keep;
+                snprintf(log, COMMAND_TEXT_LENGTH, "keeping the newest %d checkpoints", ap->keep);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "at least 1 checkpoint has to be kept");
+        }
+        else if (strncmp(argument, "file ", 5) == 0) {
+            autosave_stop(sim); // the new prefix gets its own numbering
+            snprintf(ap->prefix, sizeof(ap->prefix), "%s", argument + 5);
+            snprintf(log, COMMAND_TEXT_LENGTH, "checkpoints go to %.200s.<n>.bin", ap->prefix);
+        }
+        else if (strcmp(argument, "now") == 0) {
+            if (autosave_checkpoint(sim)) snprintf(log, COMMAND_TEXT_LENGTH, "checkpoint of t = %.3f s handed to the writer", sim->wp.sim_time);
+            else snprintf(log, COMMAND_TEXT_LENGTH, "the previous checkpoint is still being written");
+        }
+        else if (strcmp(argument, "resume") == 0) {
+            autosave_stop(sim); // the checkpoint still being written becomes the newest
+            char path[COMMAND_TEXT_LENGTH + 32];
+            if (!autosave_latest(ap->prefix, path, sizeof(path))) snprintf(log, COMMAND_TEXT_LENGTH, "no checkpoints named %.200s.<n>.bin yet", ap->prefix);
+            else if (checkpoint_restore(sim, path)) snprintf(log, COMMAND_TEXT_LENGTH, "resumed at t = %.3f s from %.200s", sim->wp.sim_time, path);
+            else snprintf(log, COMMAND_TEXT_LENGTH, "could not resume from %.200s", path);
+        }
+        else if (strcmp(argument, "stats") == 0) {
+            snprintf(log, COMMAND_TEXT_LENGTH, "%lld checkpoints taken, %lld merged into a later one while the disk was busy, every %g s / %g min, keeping %d",
+                ap->taken, ap->skipped, ap->interval, ap->wall_interval / 60.0, ap->keep);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "unknown autosave command");
+    }
+    else if (strcmp(cmd, "reset") == 0) {
+        sim->wp.reset_sim = true;
+        snprintf(log, COMMAND_TEXT_LENGTH, "sim reset");
+    }
+    else if (strncmp(cmd, "solver ", 7) == 0) {
+        char* argument = cmd + 7;
+        if (strncmp(argument, "theta ", 6) == 0) {
+            const double theta = strtod(argument + 6, NULL);
+            if (theta > 0.0 && theta <= 1.0) {
+                sim->gp.theta = theta;
+                snprintf(log, COMMAND_TEXT_LENGTH, "opening angle set to %.3f", sim->gp.theta);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "opening angle must be in (0, 1]");
+        }
+        else if (strncmp(argument, "softening ", 10) == 0) {
+            const double softening = strtod(argument + 10, NULL);
+            if (softening >= 0.0) {
+                sim->gp.softening = softening;
+                snprintf(log, COMMAND_TEXT_LENGTH, "softening set to %g m", sim->gp.softening);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "softening must be positive");
+        }
+        else if (strncmp(argument, "order ", 6) == 0) {
+            const int order = atoi(argument + 6);
+            if (order >= 2 && order <= FMM_MAX_ORDER) {
+                sim->gp.fmm_order = order;
+                snprintf(log, COMMAND_TEXT_LENGTH, "fmm expansion order set to %d", sim->gp.fmm_order);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "fmm expansion order must be between 2 and %d", FMM_MAX_ORDER);
+        }
+        else if (strncmp(argument, "leaf ", 5) == 0) {
+            const int leaf_size = atoi(argument + 5);
+            if (leaf_size >= 1) {
+                sim->gp.fmm_leaf_size = leaf_size;
+                snprintf(log, COMMAND_TEXT_LENGTH, "fmm leaf size set to %d", sim->gp.fmm_leaf_size);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "fmm leaf size must be at least 1");
+        }
+        else if (strcmp(argument, "error") == 0) {
+            const gravity_error_t err = gravity_measureForceError(sim, 64);
+            if (err.non_finite > 0) {
+                snprintf(log, COMMAND_TEXT_LENGTH, "%s solver FAILED: %d of %d sampled accelerations are not finite",
+                    gravity_solverName(sim->gp.solver), err.non_finite, err.sample_count);
+            }
+            else {
+                snprintf(log, COMMAND_TEXT_LENGTH, "%s force error over %d bodies: max %.3e, rms %.3e",
+                    gravity_solverName(sim->gp.solver), err.sample_count, err.max_rel_error, err.rms_rel_error);
+            }
+        }
+        else if (gravity_parseSolverName(argument, &sim->gp.solver)) {
+            snprintf(log, COMMAND_TEXT_LENGTH, "gravity solver set to %s", gravity_solverName(sim->gp.solver));
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "unknown argument after solver: %s", argument);
+    }
+    else if (strncmp(cmd, "swarm ", 6) == 0) {
+        char* argument = cmd + 6;
+        if (strcmp(argument, "stats") == 0) {
+            snprintf(log, COMMAND_TEXT_LENGTH, "%d test particles, %lld removed after hitting a body (%s kernel)",
+                sim->swarm.count, sim->swarm.removed, simd_levelName(sim->gp.simd_level));
+        }
+        else if (strcmp(argument, "clear") == 0) {
+            swarm_freeStorage(&sim->swarm);
+            snprintf(log, COMMAND_TEXT_LENGTH, "swarm cleared");
+        }
+        else if (strncmp(argument, "shell ", 6) == 0) {
+            // swarm shell <count> <body> <altitude km>
+            char body_name[64];
+            int count = 0;
+            double altitude_km = 0.0;
+            if (sscanf(argument + 6, "%d %63s %lf", &count, body_name, &altitude_km) == 3 && count > 0) {
+                int body = -1;
+                for (int i = 0; i < sim->gb.count; i++) {
+                    if (strcmp(sim->gb.bodies[i].name, body_name) == 0) body = i;
+                }
+                if (body >= 0) {
+                    const int added = swarm_addShell(&sim->swarm, &sim->gb, body, count, altitude_km * 1000.0, (unsigned int)sim->swarm.count + 1u);
+                    snprintf(log, COMMAND_TEXT_LENGTH, "added %d particles %.0f km above %s (%d total)", added, altitude_km, body_name, sim->swarm.count);
+                }
+                else snprintf(log, COMMAND_TEXT_LENGTH, "no body named %s", body_name);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "usage: swarm shell <count> <body> <altitude km>");
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "unknown argument after swarm: %s", argument);
+    }
+    else if (strncmp(cmd, "catalog ", 8) == 0) {
+        char* argument = cmd + 8;
+        char path[256], second[256], mode[16] = "swarm";
+        catalog_t catalog;
+        if (strncmp(argument, "convert ", 8) == 0) {
+            // catalog convert <csv file> <binary file>
+            if (sscanf(argument + 8, "%255s %255s", path, second) != 2) snprintf(log, COMMAND_TEXT_LENGTH, "usage: catalog convert <csv file> <binary file>");
+            else if (catalog_read(path, &catalog)) {
+                if (catalog_writeBinary(&catalog, second)) snprintf(log, COMMAND_TEXT_LENGTH, "wrote %d rows to %s", catalog.count, second);
+                else snprintf(log, COMMAND_TEXT_LENGTH, "could not write %s", second);
+                catalog_free(&catalog);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "could not read %s", path);
+        }
+        else {
+            // catalog <file> <parent body> [swarm|craft]
+            const int fields = sscanf(argument, "%255s %255s %15s", path, second, mode);
+            const bool as_craft = strcmp(mode, "craft") == 0;
+            if (fields < 2 || (!as_craft && strcmp(mode, "swarm") != 0)) snprintf(log, COMMAND_TEXT_LENGTH, "usage: catalog <file> <parent body> [swarm|craft]");
+            else {
+                int body = -1;
+                for (int i = 0; i < sim->gb.count; i++) {
+                    if (strcmp(sim->gb.bodies[i].name, second) == 0) body = i;
+                }
+                if (body < 0) snprintf(log, COMMAND_TEXT_LENGTH, "no body named %s", second);
+                else if (catalog_read(path, &catalog)) {
+                    const int added = catalog_import(sim, &catalog, body, as_craft);
+                    snprintf(log, COMMAND_TEXT_LENGTH, "added %d %s around %s from %s", added, as_craft ? "craft" : "particles", second, path);
+                    catalog_free(&catalog);
+                }
+                else snprintf(log, COMMAND_TEXT_LENGTH, "could not read %s", path);
+            }
+        }
+    }
+    else if (strncmp(cmd, "simd ", 5) == 0) {
+        simd_level_t level;
+        if (!simd_parseLevelName(cmd + 5, &level)) snprintf(log, COMMAND_TEXT_LENGTH, "unknown argument after simd: %s", cmd + 5);
+        else if (!simd_isSupported(level)) snprintf(log, COMMAND_TEXT_LENGTH, "this cpu does not support %s (best is %s)", simd_levelName(level), simd_levelName(simd_detectLevel()));
+        else {
+            sim->gp.simd_level = level;
+            snprintf(log, COMMAND_TEXT_LENGTH, "force kernel set to %s", simd_levelName(sim->gp.simd_level));
+        }
+    }
+    else if (strncmp(cmd, "threads ", 8) == 0) {
+        const int threads = atoi(cmd + 8);
+        if (threads >= 0 && threads <= POOL_MAX_THREADS) {
+            sim->thread_count = threads; // picked up by the physics thread on its next step
+            if (threads == 0) snprintf(log, COMMAND_TEXT_LENGTH, "force calculation will use all %d cores", pool_hardwareThreads());
+            else snprintf(log, COMMAND_TEXT_LENGTH, "force calculation will use %d threads", threads);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "thread count must be between 0 (all cores) and %d", POOL_MAX_THREADS);
+    }
+    else if (strcmp(cmd, "batch stats") == 0) {
+        snprintf(log, COMMAND_TEXT_LENGTH, "%.4g steps/s, %d steps per batch (%s, %.0f Hz display), %s", sim->batch.steps_per_second, sim->batch.steps,
+            sim->batch.fixed_steps > 0 ? "fixed" : "auto", sim->wp.refresh_rate, sim->batch.realtime_factor > 0.0 ? "paced" : "not paced");
+    }
+    else if (strncmp(cmd, "pace ", 5) == 0) {
+        const double factor = strtod(cmd + 5, NULL);
+        if (factor >= 0.0) {
+            sim->batch.realtime_factor = factor; // pacing restarts from the current sim time
+            if (factor == 0.0) snprintf(log, COMMAND_TEXT_LENGTH, "sim runs as fast as it can");
+            else snprintf(log, COMMAND_TEXT_LENGTH, "sim paced to %gx real time", factor);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "pace must be 0 (as fast as possible) or a positive real time factor");
+    }
+    else if (strncmp(cmd, "batch ", 6) == 0) {
+        const int steps = atoi(cmd + 6);
+        if (steps >= 0) {
+            sim->batch.fixed_steps = steps; // picked up by the physics thread after its current batch
+            if (steps == 0) snprintf(log, COMMAND_TEXT_LENGTH, "physics batches tuned to the %.0f Hz display", sim->wp.refresh_rate);
+            else snprintf(log, COMMAND_TEXT_LENGTH, "physics thread runs %d steps per batch", steps);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "batch size must be 0 (auto) or more");
+    }
+    else if (strncmp(cmd, "telemetry ", 10) == 0) {
+        char* argument = cmd + 10;
+        telemetry_params_t* tp = &sim->telemetry;
+        if (strcmp(argument, "on") == 0 || strncmp(argument, "on ", 3) == 0) {
+            const char* path = argument[2] == ' ' ? argument + 3 : TELEMETRY_DEFAULT_FILENAME;
+            if (telemetry_start(sim, path)) snprintf(log, COMMAND_TEXT_LENGTH, "logging telemetry to %s", path);
+            else snprintf(log, COMMAND_TEXT_LENGTH, "could not start logging to %s", path);
+        }
+        else if (strcmp(argument, "off") == 0) {
+            if (tp->writer != NULL) {
+                telemetry_stop(sim);
+                snprintf(log, COMMAND_TEXT_LENGTH, "telemetry logging stopped, %lld samples written", tp->samples);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "telemetry logging is not on");
+        }
+        else if (strncmp(argument, "every ", 6) == 0) {
+            const double interval = strtod(argument + 6, NULL);
+            if (interval >= 0.0) {
+                tp->interval = interval;
+                tp->every_steps = 0;
+                tp->next_time = sim->wp.sim_time;
+                if (interval == 0.0) snprintf(log, COMMAND_TEXT_LENGTH, "telemetry sampled every step");
+                else snprintf(log, COMMAND_TEXT_LENGTH, "telemetry sampled every %g sim seconds", interval);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "telemetry interval must be 0 (every step) or more");
+        }
+        else if (strncmp(argument, "steps ", 6) == 0) {
+            const int steps = atoi(argument + 6);
+            if (steps >= 1) {
+                tp->every_steps = steps;
+                tp->step_counter = 0;
+                snprintf(log, COMMAND_TEXT_LENGTH, "telemetry sampled every %d steps", tp->every_steps);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "telemetry step count must be at least 1");
+        }
+        else if (strcmp(argument, "align on") == 0) {
+            tp->align = true;
+            snprintf(log, COMMAND_TEXT_LENGTH, "steps are shortened so telemetry samples land exactly on multiples of %g s", tp->interval);
+        }
+        else if (strcmp(argument, "align off") == 0) {
+            tp->align = false;
+            snprintf(log, COMMAND_TEXT_LENGTH, "telemetry samples are taken at the first step past each multiple of %g s", tp->interval);
+        }
+        else if (strncmp(argument, "policy ", 7) == 0) {
+            if (telemetry_parsePolicy(argument + 7, &tp->policy)) snprintf(log, COMMAND_TEXT_LENGTH, "telemetry policy set to %s", telemetry_policyName(tp->policy));
+            else snprintf(log, COMMAND_TEXT_LENGTH, "unknown telemetry policy (block, drop, decimate)");
+        }
+        else if (strcmp(argument, "stats") == 0) {
+            if (tp->writer != NULL) {
+                snprintf(log, COMMAND_TEXT_LENGTH, "%lld samples, %lld dropped, %lld decimated (keeping 1 in %d), %lld waited for, ring %d%% full, %s policy",
+                    tp->samples, tp->dropped, tp->decimated, tp->decimation, tp->blocked,
+                    100 * telemetry_ringFill(tp->writer) / tp->writer->capacity, telemetry_policyName(tp->policy));
+            }
+            else if (tp->every_steps > 0) snprintf(log, COMMAND_TEXT_LENGTH, "telemetry logging is off (%s policy, every %d steps)", telemetry_policyName(tp->policy), tp->every_steps);
+            else snprintf(log, COMMAND_TEXT_LENGTH, "telemetry logging is off (%s policy, every %g s)", telemetry_policyName(tp->policy), tp->interval);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "unknown telemetry command");
+    }
+    else if (strncmp(cmd, "craft ", 6) == 0) {
+        char* argument = cmd + 6;
+        if (strncmp(argument, "tolerance ", 10) == 0) {
+            const double tolerance = strtod(argument + 10, NULL);
+            if (tolerance > 0.0 && tolerance < 1.0) {
+                sim->cp.tolerance = tolerance;
+                snprintf(log, COMMAND_TEXT_LENGTH, "spacecraft step tolerance set to %.1e", sim->cp.tolerance);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "tolerance must be in (0, 1)");
+        }
+        else if (strncmp(argument, "maxstep ", 8) == 0) {
+            const double max_step = strtod(argument + 8, NULL);
+            if (max_step > 0.0) {
+                sim->cp.max_step = max_step;
+                snprintf(log, COMMAND_TEXT_LENGTH, "max spacecraft step set to %g s", sim->cp.max_step);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "max step must be positive");
+        }
+        else if (strncmp(argument, "rails ", 6) == 0) {
+            const double threshold = strtod(argument + 6, NULL);
+            if (threshold > 0.0 && threshold < 1.0) {
+                sim->cp.rails_threshold = threshold;
+                snprintf(log, COMMAND_TEXT_LENGTH, "spacecraft go on rails below %.1e perturbation", sim->cp.rails_threshold);
+            }
+            else snprintf(log, COMMAND_TEXT_LENGTH, "rails threshold must be in (0, 1)");
+        }
+        else if (strcmp(argument, "stats") == 0) {
+            int on_rails = 0;
+            for (int i = 0; i < sim->gs.count; i++) {
+                if (sim->gs.spacecraft[i].on_rails) on_rails++;
+            }
+            snprintf(log, COMMAND_TEXT_LENGTH, "%lld craft force evaluations over %.0f s (%s), %d of %d craft on rails", sim->cp.force_evaluations,
+                sim->wp.sim_time, sim->cp.adaptive ? "adaptive" : "fixed step", on_rails, sim->gs.count);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "unknown argument after craft: %s", argument);
+    }
+    else if (strncmp(cmd, "enable ", 7) == 0) {
+        char* argument = cmd + 7;
+        if (strcmp(argument, "adaptive-craft") == 0) {
+            sim->cp.adaptive = true;
+            snprintf(log, COMMAND_TEXT_LENGTH, "enabled adaptive spacecraft steps (tolerance %.1e, max step %g s)", sim->cp.tolerance, sim->cp.max_step);
+        }
+        else if (strcmp(argument, "on-rails") == 0) {
+            sim->cp.rails = true;
+            snprintf(log, COMMAND_TEXT_LENGTH, "coasting spacecraft go on rails below %.1e perturbation", sim->cp.rails_threshold);
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "unknown argument after command: %s", argument);
+    }
+    else if (strncmp(cmd, "disable ", 8) == 0) {
+        char* argument = cmd + 8;
+        if (strcmp(argument, "adaptive-craft") == 0) {
+            sim->cp.adaptive = false;
+            snprintf(log, COMMAND_TEXT_LENGTH, "disabled adaptive spacecraft steps");
+        }
+        else if (strcmp(argument, "on-rails") == 0) {
+            sim->cp.rails = false;
+            snprintf(log, COMMAND_TEXT_LENGTH, "disabled on rails spacecraft");
+        }
+        else snprintf(log, COMMAND_TEXT_LENGTH, "unknown argument after disable: %s", argument);
+    }
+    else if (strcmp(cmd, "benchmark") == 0) {
+        // the benchmarks build their own clusters, the running sim only waits for them
+        benchmarkGravitySolvers(log, COMMAND_TEXT_LENGTH);
+    }
+    else if (strcmp(cmd, "benchmark threads") == 0) {
+        benchmarkThreadScaling(log, COMMAND_TEXT_LENGTH);
+    }
+    else if (strcmp(cmd, "benchmark simd") == 0) {
+        benchmarkSimdKernels(log, COMMAND_TEXT_LENGTH);
+    }
+    else if (strcmp(cmd, "benchmark swarm") == 0) {
+        benchmarkSwarmKernels(log, COMMAND_TEXT_LENGTH);
+    }
+    else {
+        snprintf(log, COMMAND_TEXT_LENGTH, "unknown command: %s", cmd);
+    }
+}
+
+// true once sim_time has reached time (allowing for the rounding of summing up steps)
+static bool command_isDue(const sim_properties_t* sim, const double time) {
+    return time <= sim->wp.sim_time + 1e-9 * fmax(1.0, fabs(time));
+}
+
+// applies the command and hands its log line back to the console
+static void command_run(sim_properties_t* sim, sim_command_t* command) {
+    sim_command_t reply = {.time = sim->wp.sim_time};
+    command_apply(sim, command->text, reply.text);
+    cmdq_push(&sim->replies, reply.text, reply.time); // a full reply queue only loses log lines
+}
+
+// queues a console command for command_processQueue, "at <sim time in s> <command>" schedules it for that time
+// only touches the queue, so any thread may call it. returns false with the reason in log (COMMAND_TEXT_LENGTH chars)
+bool command_enqueue(sim_properties_t* sim, const char* text, char* log) {
+    double time = -1.0;
+    if (strncmp(text, "at ", 3) == 0) {
+        char* argument;
+        time = strtod(text + 3, &argument);
+        while (*argument == ' ') argument++;
+        if (argument == text + 3 || time < 0.0 || *argument == '\0') {
+            snprintf(log, COMMAND_TEXT_LENGTH, "usage: at <sim time in s> <command>");
+            return false;
+        }
+        text = argument;
+    }
+    if (!cmdq_push(&sim->commands, text, time)) {
+        snprintf(log, COMMAND_TEXT_LENGTH, "command queue full, try again");
+        return false;
+    }
+    return true;
+}
+
+// drains the console queue: commands timed for later are kept in the schedule (sorted by time),
+// the rest and every scheduled command that is due are applied in order
+void command_processQueue(sim_properties_t* sim) {
+    sim_command_t command;
+    while (cmdq_pop(&sim->commands, &command)) {
+        if (command.time < 0.0 || command_isDue(sim, command.time)) {
+            command_run(sim, &command);
+        }
+        else if (sim->scheduled_count == COMMAND_MAX_SCHEDULED) {
+            char log[COMMAND_TEXT_LENGTH];
+            snprintf(log, sizeof(log), "too many scheduled commands (max %d), dropped: %s", COMMAND_MAX_SCHEDULED, command.text);
+            cmdq_push(&sim->replies, log, sim->wp.sim_time);
+        }
+        else {
+            // insertion keeps commands for the same time in the order they were typed
+            int i = sim->scheduled_count;
+            while (i > 0 && sim->scheduled[i - 1].time > command.time) {
+                sim->scheduled[i] = sim->scheduled[i - 1];
+                i--;
+            }
+            sim->scheduled[i] = command;
+            sim->scheduled_count++;
+
+            char log[COMMAND_TEXT_LENGTH];
+            snprintf(log, sizeof(log), "scheduled at t = %.3f s: %.200s", command.time, command.text);
+            cmdq_push(&sim->replies, log, sim->wp.sim_time);
+        }
+    }
+
+    // a due command leaves the schedule before it runs, since running it can change the schedule
+    // (restore resets the sim, which drops every scheduled command)
+    while (sim->scheduled_count > 0 && command_isDue(sim, sim->scheduled[0].time)) {
+        sim_command_t due = sim->scheduled[0];
+        sim->scheduled_count--;
+        memmove(sim->scheduled, sim->scheduled + 1, (size_t)sim->scheduled_count * sizeof(sim_command_t));
+        command_run(sim, &due);
+    }
+}
+
+// sim time of the next scheduled command (INFINITY if there is none)
+double command_nextTime(const sim_properties_t* sim) {
+    return sim->scheduled_count > 0 ? sim->scheduled[0].time : INFINITY;
+}
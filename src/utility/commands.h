@@ -0,0 +1,11 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include "../types.h"
+
+void command_apply(sim_properties_t* sim, char* cmd, char* log);
+bool command_enqueue(sim_properties_t* sim, const char* text, char* log);
+void command_processQueue(sim_properties_t* sim);
+double command_nextTime(const sim_properties_t* sim);
+
+#endif
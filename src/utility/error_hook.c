@@ -0,0 +1,24 @@
+#include "error_hook.h"
+#include <stdio.h>
+
+// the sim code reports errors through displayError, the program that embeds it decides how they are
+// shown (the GUI opens a message box, the headless runner and the library print to stderr by default)
+
+static void error_printToStderr(const char* title, const char* message, void* user) {
+    (void)user;
+    fprintf(stderr, "%s: %s\n", title, message);
+}
+
+static error_handler_fn error_handler = error_printToStderr;
+static void* error_user = NULL;
+
+// set once before the sim starts (not synchronized with threads that may be reporting errors)
+// NULL restores printing to stderr
+void error_setHandler(const error_handler_fn handler, void* user) {
+    error_handler = handler != NULL ? handler : error_printToStderr;
+    error_user = user;
+}
+
+void displayError(const char* title, const char* message) {
+    error_handler(title, message, error_user);
+}
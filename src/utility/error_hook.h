@@ -0,0 +1,10 @@
+#ifndef ERROR_HOOK_H
+#define ERROR_HOOK_H
+
+// receives every error the sim reports (title, message, user pointer given to error_setHandler)
+typedef void (*error_handler_fn)(const char* title, const char* message, void* user);
+
+void error_setHandler(error_handler_fn handler, void* user);
+void displayError(const char* title, const char* message);
+
+#endif
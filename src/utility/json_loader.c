@@ -1,25 +1,88 @@
 #include "../utility/json_loader.h"
 #include "../sim/bodies.h"
 #include "../sim/spacecraft.h"
+#include "../sim/gravity.h"
+#include "../sim/integrator.h"
+#include "../sim/hermite.h"
+#include "../sim/swarm.h"
+#include "thread_pool.h"
+#include "../sim/fmm.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <cjson/cJSON.h>
 #include <string.h>
+#include <math.h>
 #include "../types.h"
 #include "../math/matrix.h"
+#include "error_hook.h"
+#include "mapped_file.h"
+#include "json_stream.h"
+#include "name_index.h"
+#include "catalog.h"
 
-void displayError(const char* title, const char* message);
+// the scenario file is mapped and read in one pass per section instead of being turned into a cJSON tree:
+// a first pass checks the syntax of the whole file, notes where each top level section starts and counts
+// the bodies and craft, so their storage is allocated once. bodies and craft are then read member by member
+// straight into the sim, and burn targets and relative positions are looked up through a name index.
+// the small gravity and integrator sections still go through cJSON
 
-int findBurnTargetID(const body_properties_t* gb, const char* target_name) {
-    for (int i = 0; i < gb->count; i++) {
-        if (strcmp(gb->bodies[i].name, target_name) == 0) {
-            return i;
-        }
+typedef struct {
+    sim_properties_t* sim;
+    const char* filename;
+    name_index_t body_names;      // body name -> body id
+    burn_properties_t* burns;     // burns of the craft being read
+    int burn_capacity;
+} json_loader_t;
+
+// json key -> the double it fills, one table per kind of object
+typedef struct {
+    const char* key;
+    double* value;
+} json_number_field_t;
+
+static void json_reportError(const json_loader_t* loader, const jstream_t* js, const char* what) {
+    char message[512];
+    snprintf(message, sizeof(message), "%s (%s, line %d)", what, loader->filename, jstream_line(js));
+    displayError("ERROR", message);
+}
+
+// index of key in fields, -1 if it is not there
+static int json_findField(const json_number_field_t* fields, const int count, const char* key) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(fields[i].key, key) == 0) return i;
     }
-    displayError("ERROR", "Relative burn target body not found");
     return -1;
 }
 
+// the syntax was checked by the first pass, so a value of the wrong type is skipped and counts as missing
+static bool json_readNumber(jstream_t* js, double* value) {
+    const char c = jstream_peek(js);
+    if (c == '-' || (c >= '0' && c <= '9')) return jstream_readNumber(js, value);
+    jstream_skipValue(js);
+    return false;
+}
+
+static bool json_readString(jstream_t* js, char* text, const size_t size) {
+    jstream_t probe = *js;
+    if (jstream_peek(js) == '"' && jstream_readString(&probe, text, size)) {
+        *js = probe;
+        return true;
+    }
+    jstream_skipValue(js);
+    return false;
+}
+
+// reads a number member listed in fields and marks it in found, any other member is skipped
+static void json_readNumberMember(jstream_t* js, const char* key, const json_number_field_t* fields, const int count,
+                                  unsigned int* found) {
+    const int field = json_findField(fields, count, key);
+    if (field < 0) {
+        jstream_skipValue(js);
+    } else if (json_readNumber(js, fields[field].value)) {
+        *found |= 1u << field;
+    }
+}
+
 relative_burn_target_t findRelativeBurnType(const char* input_burn_type) {
     if (strcmp(input_burn_type, "tangent") == 0)
         return (relative_burn_target_t){.tangent = true};
@@ -32,228 +95,554 @@ relative_burn_target_t findRelativeBurnType(const char* input_burn_type) {
     return (relative_burn_target_t){0};
 }
 
-// finds the body position by name for relative spacecraft positioning
-vec3 findBodyPosition(const body_properties_t* gb, const char* body_name) {
-    for (int i = 0; i < gb->count; i++) {
-        if (strcmp(gb->bodies[i].name, body_name) == 0) {
-            return gb->bodies[i].pos;
+// position and velocity of a named body for relative positioning, zero (with an error) if there is no such body
+static bool json_relativeOffset(const json_loader_t* loader, const jstream_t* js, const char* body_name,
+                                vec3* pos, vec3* vel) {
+    *pos = vec3_zero();
+    *vel = vec3_zero();
+    if (strcmp(body_name, "absolute") == 0) return true;
+    const int id = nameindex_find(&loader->body_names, body_name);
+    if (id < 0) {
+        char what[JSTREAM_MAX_STRING + 64];
+        snprintf(what, sizeof(what), "Body %s not found for relative positioning", body_name);
+        json_reportError(loader, js, what);
+        return false;
+    }
+    *pos = loader->sim->gb.bodies[id].pos;
+    *vel = loader->sim->gb.bodies[id].vel;
+    return true;
+}
+
+// optional gravity solver settings
+static void json_readGravity(const cJSON* gravity, sim_properties_t* sim) {
+    if (gravity != NULL && cJSON_IsObject(gravity)) {
+        const cJSON* solver_item = cJSON_GetObjectItemCaseSensitive(gravity, "solver");
+        const cJSON* theta_item = cJSON_GetObjectItemCaseSensitive(gravity, "theta");
+        const cJSON* softening_item = cJSON_GetObjectItemCaseSensitive(gravity, "softening");
+        const cJSON* order_item = cJSON_GetObjectItemCaseSensitive(gravity, "order");
+        const cJSON* leaf_size_item = cJSON_GetObjectItemCaseSensitive(gravity, "leaf_size");
+        const cJSON* threads_item = cJSON_GetObjectItemCaseSensitive(gravity, "threads");
+
+        if (solver_item != NULL && cJSON_IsString(solver_item)) {
+            if (!gravity_parseSolverName(solver_item->valuestring, &sim->gp.solver)) {
+                displayError("ERROR", "Unknown gravity solver in simulation JSON, using direct summation");
+                sim->gp.solver = GRAVITY_DIRECT;
+            }
+        }
+        if (theta_item != NULL && cJSON_IsNumber(theta_item) && theta_item->valuedouble > 0.0) {
+            sim->gp.theta = fmin(theta_item->valuedouble, 1.0);
+        }
+        if (softening_item != NULL && cJSON_IsNumber(softening_item) && softening_item->valuedouble >= 0.0) {
+            sim->gp.softening = softening_item->valuedouble;
+        }
+        if (order_item != NULL && cJSON_IsNumber(order_item)) {
+            sim->gp.fmm_order = (int)fmax(2.0, fmin(order_item->valuedouble, FMM_MAX_ORDER));
+        }
+        if (leaf_size_item != NULL && cJSON_IsNumber(leaf_size_item) && leaf_size_item->valuedouble >= 1.0) {
+            sim->gp.fmm_leaf_size = (int)leaf_size_item->valuedouble;
+        }
+        if (threads_item != NULL && cJSON_IsNumber(threads_item) && threads_item->valuedouble >= 0.0) {
+            sim->thread_count = (int)fmin(threads_item->valuedouble, POOL_MAX_THREADS);
         }
     }
-    displayError("ERROR", "Body not found for relative positioning");
-    return vec3_zero();
 }
 
-// finds the body velocity by name for relative spacecraft positioning
-vec3 findBodyVelocity(const body_properties_t* gb, const char* body_name) {
-    for (int i = 0; i < gb->count; i++) {
-        if (strcmp(gb->bodies[i].name, body_name) == 0) {
-            return gb->bodies[i].vel;
+// optional time integration settings
+static void json_readIntegrator(const cJSON* integrator, sim_properties_t* sim) {
+    if (integrator != NULL && cJSON_IsObject(integrator)) {
+        const cJSON* method_item = cJSON_GetObjectItemCaseSensitive(integrator, "method");
+        const cJSON* time_step_item = cJSON_GetObjectItemCaseSensitive(integrator, "time_step");
+        const cJSON* craft_adaptive_item = cJSON_GetObjectItemCaseSensitive(integrator, "craft_adaptive");
+        const cJSON* craft_tolerance_item = cJSON_GetObjectItemCaseSensitive(integrator, "craft_tolerance");
+        const cJSON* craft_max_step_item = cJSON_GetObjectItemCaseSensitive(integrator, "craft_max_step");
+        const cJSON* craft_on_rails_item = cJSON_GetObjectItemCaseSensitive(integrator, "craft_on_rails");
+        const cJSON* craft_rails_threshold_item = cJSON_GetObjectItemCaseSensitive(integrator, "craft_rails_threshold");
+        const cJSON* hermite_eta_item = cJSON_GetObjectItemCaseSensitive(integrator, "hermite_eta");
+        const cJSON* hermite_levels_item = cJSON_GetObjectItemCaseSensitive(integrator, "hermite_levels");
+
+        if (method_item != NULL && cJSON_IsString(method_item)) {
+            if (!integrator_parseName(method_item->valuestring, &sim->wp.integrator)) {
+                displayError("ERROR", "Unknown integrator in simulation JSON, using velocity verlet");
+                sim->wp.integrator = INTEGRATOR_VERLET;
+            }
+        }
+        if (time_step_item != NULL && cJSON_IsNumber(time_step_item) && time_step_item->valuedouble > 0.0) {
+            sim->wp.time_step = time_step_item->valuedouble;
+        }
+        if (craft_adaptive_item != NULL && cJSON_IsBool(craft_adaptive_item)) {
+            sim->cp.adaptive = cJSON_IsTrue(craft_adaptive_item);
+        }
+        if (craft_tolerance_item != NULL && cJSON_IsNumber(craft_tolerance_item) && craft_tolerance_item->valuedouble > 0.0) {
+            sim->cp.tolerance = craft_tolerance_item->valuedouble;
+        }
+        if (craft_max_step_item != NULL && cJSON_IsNumber(craft_max_step_item) && craft_max_step_item->valuedouble > 0.0) {
+            sim->cp.max_step = craft_max_step_item->valuedouble;
+        }
+        if (craft_on_rails_item != NULL && cJSON_IsBool(craft_on_rails_item)) {
+            sim->cp.rails = cJSON_IsTrue(craft_on_rails_item);
+        }
+        if (craft_rails_threshold_item != NULL && cJSON_IsNumber(craft_rails_threshold_item) && craft_rails_threshold_item->valuedouble > 0.0) {
+            sim->cp.rails_threshold = craft_rails_threshold_item->valuedouble;
+        }
+        if (hermite_eta_item != NULL && cJSON_IsNumber(hermite_eta_item) && hermite_eta_item->valuedouble > 0.0) {
+            sim->hermite.eta = hermite_eta_item->valuedouble;
+        }
+        if (hermite_levels_item != NULL && cJSON_IsNumber(hermite_levels_item) && hermite_levels_item->valuedouble >= 0.0) {
+            sim->hermite.max_level = (int)fmin(hermite_levels_item->valuedouble, HERMITE_MAX_LEVELS);
         }
     }
-    return vec3_zero();
 }
 
-// json handling logic for reading json files
-void readSimulationJSON(const char* FILENAME, body_properties_t* gb, spacecraft_properties_t* sc) {
-    #ifdef _WIN32
-    FILE *fp;
-    fopen_s(&fp, FILENAME, "r");
-    #else
-    FILE *fp = fopen(FILENAME, "r");
-    #endif
-    if (fp == NULL) {
-        displayError("ERROR", "Error: Could not open simulation JSON file");
+// parses a settings section on its own with cJSON
+static void json_readSettings(const char* text, const size_t length, void (*read)(const cJSON*, sim_properties_t*),
+                              sim_properties_t* sim) {
+    cJSON* section = cJSON_ParseWithLength(text, length);
+    if (section == NULL) return;
+    read(section, sim);
+    cJSON_Delete(section);
+}
+
+// bits of the body fields table below
+#define BODY_REQUIRED 0xFFu // mass, radius, position and velocity
+#define BODY_ROTATION (1u << 8)
+#define BODY_ATTITUDE (0xFu << 9)
+
+static void json_readBody(json_loader_t* loader, jstream_t* js) {
+    body_properties_t* gb = &loader->sim->gb;
+    char key[JSTREAM_MAX_STRING];
+    char name[JSTREAM_MAX_STRING];
+    bool has_name = false;
+    double mass = 0.0, radius = 0.0, rotational_v = 0.0, angle = 0.0;
+    vec3 pos = vec3_zero(), vel = vec3_zero(), axis = vec3_zero();
+    const json_number_field_t fields[] = {
+        {"mass", &mass}, {"radius", &radius},
+        {"pos_x", &pos.x}, {"pos_y", &pos.y}, {"pos_z", &pos.z},
+        {"vel_x", &vel.x}, {"vel_y", &vel.y}, {"vel_z", &vel.z},
+        {"rotational_v", &rotational_v},
+        {"attitude_axis_x", &axis.x}, {"attitude_axis_y", &axis.y}, {"attitude_axis_z", &axis.z},
+        {"attitude_angle", &angle},
+    };
+    const int field_count = (int)(sizeof(fields) / sizeof(fields[0]));
+    unsigned int found = 0;
+
+    const char first = jstream_peek(js);
+    const jstream_t start = *js;
+    if (first != '{') {
+        jstream_skipValue(js);
+        json_reportError(loader, &start, "Bodies must be objects, skipped one");
+        return;
+    }
+    jstream_beginObject(js);
+    while (jstream_nextMember(js, key, sizeof(key))) {
+        if (strcmp(key, "name") == 0) {
+            has_name = json_readString(js, name, sizeof(name));
+        } else {
+            json_readNumberMember(js, key, fields, field_count, &found);
+        }
+    }
+    if (!has_name || (found & BODY_REQUIRED) != BODY_REQUIRED) {
+        json_reportError(loader, &start, "Bodies need a name, mass, radius, pos_x/y/z and vel_x/y/z, skipped one");
         return;
     }
 
-    // read entire file into buffer
-    fseek(fp, 0, SEEK_END);
-    const long file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+    const int id = gb->count;
+    body_addOrbitalBody(gb, name, mass, radius, pos, vel);
+    if (gb->count == id) return;
+    body_t* added_body = &gb->bodies[id];
+    nameindex_add(&loader->body_names, added_body->name, id);
 
-    char* json_buffer = (char*)malloc(file_size + 1);
-    if (json_buffer == NULL) {
-        displayError("ERROR", "Error: Could not allocate memory for JSON buffer");
-        fclose(fp);
-        return;
+    // set rotational velocity if present in JSON
+    if (found & BODY_ROTATION) {
+        added_body->rotational_v = rotational_v;
     }
 
-    fread(json_buffer, 1, file_size, fp);
-    json_buffer[file_size] = '\0';
-    fclose(fp);
+    // set attitude if present in JSON
+    if ((found & BODY_ATTITUDE) == BODY_ATTITUDE) {
+        added_body->attitude = quaternionFromAxisAngle(axis, angle);
+    }
+}
 
-    // parse json
-    cJSON* json = cJSON_Parse(json_buffer);
-    free(json_buffer);
+// reads one burn into burn, false (with an error) if it cannot be used
+static bool json_readBurn(json_loader_t* loader, jstream_t* js, burn_properties_t* burn) {
+    char key[JSTREAM_MAX_STRING];
+    char target[JSTREAM_MAX_STRING];
+    char type[JSTREAM_MAX_STRING];
+    bool has_target = false, has_type = false;
+    double start_time = 0.0, duration = 0.0, heading = 0.0, throttle = 0.0;
+    const json_number_field_t fields[] = {
+        {"start_time", &start_time}, {"duration", &duration}, {"heading", &heading}, {"throttle", &throttle},
+    };
+    unsigned int found = 0;
 
-    if (json == NULL) {
-        displayError("ERROR", "Error: Failed to parse simulation JSON");
-        return;
+    const char first = jstream_peek(js);
+    const jstream_t start = *js;
+    if (first != '{') {
+        jstream_skipValue(js);
+        json_reportError(loader, &start, "Burns must be objects, skipped one");
+        return false;
+    }
+    jstream_beginObject(js);
+    while (jstream_nextMember(js, key, sizeof(key))) {
+        if (strcmp(key, "burn_target") == 0) {
+            has_target = json_readString(js, target, sizeof(target));
+        } else if (strcmp(key, "burn_type") == 0) {
+            has_type = json_readString(js, type, sizeof(type));
+        } else {
+            json_readNumberMember(js, key, fields, 4, &found);
+        }
+    }
+    if (!has_target || !has_type || found != 0xFu) {
+        json_reportError(loader, &start, "Burns need a burn_target, burn_type, start_time, duration, heading and throttle, skipped one");
+        return false;
     }
 
-    // get bodies array
-    const cJSON* bodies = cJSON_GetObjectItemCaseSensitive(json, "bodies");
-    if (bodies != NULL && cJSON_IsArray(bodies)) {
-        const cJSON* body = NULL;
-        cJSON_ArrayForEach(body, bodies) {
-            cJSON* name_item = cJSON_GetObjectItemCaseSensitive(body, "name");
-            cJSON* mass_item = cJSON_GetObjectItemCaseSensitive(body, "mass");
-            cJSON* radius_item = cJSON_GetObjectItemCaseSensitive(body, "radius");
-            cJSON* pos_x_item = cJSON_GetObjectItemCaseSensitive(body, "pos_x");
-            cJSON* pos_y_item = cJSON_GetObjectItemCaseSensitive(body, "pos_y");
-            cJSON* pos_z_item = cJSON_GetObjectItemCaseSensitive(body, "pos_z");
-            cJSON* vel_x_item = cJSON_GetObjectItemCaseSensitive(body, "vel_x");
-            cJSON* vel_y_item = cJSON_GetObjectItemCaseSensitive(body, "vel_y");
-            cJSON* vel_z_item = cJSON_GetObjectItemCaseSensitive(body, "vel_z");
-            cJSON* rotational_v_item = cJSON_GetObjectItemCaseSensitive(body, "rotational_v");
-            cJSON* attitude_axis_x = cJSON_GetObjectItemCaseSensitive(body, "attitude_axis_x");
-            cJSON* attitude_axis_y = cJSON_GetObjectItemCaseSensitive(body, "attitude_axis_y");
-            cJSON* attitude_axis_z = cJSON_GetObjectItemCaseSensitive(body, "attitude_axis_z");
-            cJSON* attitude_angle = cJSON_GetObjectItemCaseSensitive(body, "attitude_angle");
-
-            vec3 pos = {
-                pos_x_item->valuedouble,
-                pos_y_item->valuedouble,
-                pos_z_item->valuedouble
-            };
-            vec3 vel = {
-                vel_x_item->valuedouble,
-                vel_y_item->valuedouble,
-                vel_z_item->valuedouble
-            };
-
-            body_addOrbitalBody(gb,
-                                name_item->valuestring,
-                                mass_item->valuedouble,
-                                radius_item->valuedouble,
-                                pos, vel);
-
-            // set rotational velocity if present in JSON
-            body_t* added_body = &gb->bodies[gb->count - 1];
-            if (rotational_v_item != NULL) {
-                added_body->rotational_v = rotational_v_item->valuedouble;
-            }
+    const int burn_target_id = nameindex_find(&loader->body_names, target);
+    if (burn_target_id == -1) {
+        char what[JSTREAM_MAX_STRING + 64];
+        snprintf(what, sizeof(what), "Burn target %s not found or is invalid, skipped the burn", target);
+        json_reportError(loader, &start, what);
+        return false;
+    }
+
+    burn->burn_target_id = burn_target_id;
+    burn->relative_burn_target = findRelativeBurnType(type);
+    burn->burn_start_time = start_time;
+    burn->burn_end_time = start_time + duration;
+    burn->burn_heading = heading;
+    burn->throttle = throttle;
+    return true;
+}
 
-            // set attitude if present in JSON
-            if (attitude_axis_x != NULL && attitude_axis_y != NULL &&
-                attitude_axis_z != NULL && attitude_angle != NULL) {
-                vec3 axis = {
-                    attitude_axis_x->valuedouble,
-                    attitude_axis_y->valuedouble,
-                    attitude_axis_z->valuedouble
-                };
-                added_body->attitude = quaternionFromAxisAngle(axis, attitude_angle->valuedouble);
+// reads the burns array of a craft into loader->burns, returns the number of usable burns
+static int json_readBurns(json_loader_t* loader, jstream_t* js) {
+    if (jstream_peek(js) != '[') {
+        jstream_skipValue(js);
+        return 0;
+    }
+    int num_burns = 0;
+    jstream_beginArray(js);
+    while (jstream_nextElement(js)) {
+        if (num_burns == loader->burn_capacity) {
+            const int capacity = loader->burn_capacity == 0 ? 8 : loader->burn_capacity * 2;
+            burn_properties_t* temp = (burn_properties_t*)realloc(loader->burns, capacity * sizeof(burn_properties_t));
+            if (temp == NULL) {
+                displayError("ERROR", "Could not allocate memory for burns");
+                jstream_skipValue(js);
+                continue;
             }
+            loader->burns = temp;
+            loader->burn_capacity = capacity;
         }
+        if (json_readBurn(loader, js, &loader->burns[num_burns])) num_burns++;
     }
+    return num_burns;
+}
 
-    // calculate SOI for all bodies after they're loaded
-    body_calculateSOI(gb);
+#define CRAFT_REQUIRED 0x3FFFu // every field of the craft fields table below
+
+static void json_readCraft(json_loader_t* loader, jstream_t* js) {
+    char key[JSTREAM_MAX_STRING];
+    char name[JSTREAM_MAX_STRING];
+    char relative_to[JSTREAM_MAX_STRING];
+    bool has_name = false, has_relative_to = false;
+    int num_burns = 0;
+    double dry_mass = 0.0, fuel_mass = 0.0, thrust = 0.0, specific_impulse = 0.0, mass_flow_rate = 0.0;
+    double attitude = 0.0, moment_of_inertia = 0.0, nozzle_gimbal_range = 0.0;
+    vec3 pos = vec3_zero(), vel = vec3_zero();
+    const json_number_field_t fields[] = {
+        {"pos_x", &pos.x}, {"pos_y", &pos.y}, {"pos_z", &pos.z},
+        {"vel_x", &vel.x}, {"vel_y", &vel.y}, {"vel_z", &vel.z},
+        {"dry_mass", &dry_mass}, {"fuel_mass", &fuel_mass}, {"thrust", &thrust},
+        {"specific_impulse", &specific_impulse}, {"mass_flow_rate", &mass_flow_rate}, {"attitude", &attitude},
+        {"moment_of_inertia", &moment_of_inertia}, {"nozzle_gimbal_range", &nozzle_gimbal_range},
+    };
+    const int field_count = (int)(sizeof(fields) / sizeof(fields[0]));
+    unsigned int found = 0;
 
-    // get spacecraft array
-    const cJSON* spacecraft = cJSON_GetObjectItemCaseSensitive(json, "spacecraft");
-    if (spacecraft != NULL && cJSON_IsArray(spacecraft)) {
-        cJSON* craft = NULL;
-        cJSON_ArrayForEach(craft, spacecraft) {
-            cJSON* name_item = cJSON_GetObjectItemCaseSensitive(craft, "name");
-            cJSON* pos_x_item = cJSON_GetObjectItemCaseSensitive(craft, "pos_x");
-            cJSON* pos_y_item = cJSON_GetObjectItemCaseSensitive(craft, "pos_y");
-            cJSON* pos_z_item = cJSON_GetObjectItemCaseSensitive(craft, "pos_z");
-            cJSON* vel_x_item = cJSON_GetObjectItemCaseSensitive(craft, "vel_x");
-            cJSON* vel_y_item = cJSON_GetObjectItemCaseSensitive(craft, "vel_y");
-            cJSON* vel_z_item = cJSON_GetObjectItemCaseSensitive(craft, "vel_z");
-            cJSON* position_relative_to_item = cJSON_GetObjectItemCaseSensitive(craft, "position_relative_to");
-            cJSON* dry_mass_item = cJSON_GetObjectItemCaseSensitive(craft, "dry_mass");
-            cJSON* fuel_mass_item = cJSON_GetObjectItemCaseSensitive(craft, "fuel_mass");
-            cJSON* thrust_item = cJSON_GetObjectItemCaseSensitive(craft, "thrust");
-            cJSON* specific_impulse_item = cJSON_GetObjectItemCaseSensitive(craft, "specific_impulse");
-            cJSON* mass_flow_rate_item = cJSON_GetObjectItemCaseSensitive(craft, "mass_flow_rate");
-            cJSON* attitude_item = cJSON_GetObjectItemCaseSensitive(craft, "attitude");
-            cJSON* moment_of_inertia_item = cJSON_GetObjectItemCaseSensitive(craft, "moment_of_inertia");
-            cJSON* nozzle_gimbal_range_item = cJSON_GetObjectItemCaseSensitive(craft, "nozzle_gimbal_range");
-
-            // parse burns array
-            cJSON* burns_array = cJSON_GetObjectItemCaseSensitive(craft, "burns");
-            int num_burns = 0;
-            burn_properties_t* burns = NULL;
-
-            if (burns_array != NULL && cJSON_IsArray(burns_array)) {
-                num_burns = cJSON_GetArraySize(burns_array);
-                if (num_burns > 0) {
-                    burns = (burn_properties_t*)malloc(num_burns * sizeof(burn_properties_t));
-                    cJSON* burn = NULL;
-                    int burn_idx = 0;
-                    cJSON_ArrayForEach(burn, burns_array) {
-                        cJSON* burn_target = cJSON_GetObjectItemCaseSensitive(burn, "burn_target");
-                        cJSON* burn_type = cJSON_GetObjectItemCaseSensitive(burn, "burn_type");
-                        cJSON* start_time = cJSON_GetObjectItemCaseSensitive(burn, "start_time");
-                        cJSON* duration = cJSON_GetObjectItemCaseSensitive(burn, "duration");
-                        cJSON* heading = cJSON_GetObjectItemCaseSensitive(burn, "heading");
-                        cJSON* throttle = cJSON_GetObjectItemCaseSensitive(burn, "throttle");
-
-                        const char* burn_target_name = burn_target->valuestring;
-                        const int burn_target_id = findBurnTargetID(gb, burn_target_name);
-                        if (burn_target_id == -1) {
-                            char err_txt[64];
-                            snprintf(err_txt, sizeof(err_txt), "Burn target %s not found or is invalid", burn_target_name);
-                            displayError("ERROR", err_txt);
-                            break;
-                        }
-
-                        const char* burn_type_name = burn_type->valuestring;
-                        const relative_burn_target_t relative_burn_target_type = findRelativeBurnType(burn_type_name);
-
-                        burns[burn_idx].burn_target_id = burn_target_id;
-                        burns[burn_idx].relative_burn_target = relative_burn_target_type;
-                        burns[burn_idx].burn_start_time = start_time->valuedouble;
-                        burns[burn_idx].burn_end_time = start_time->valuedouble + duration->valuedouble;
-                        burns[burn_idx].burn_heading = heading->valuedouble;
-                        burns[burn_idx].throttle = throttle->valuedouble;
-                        burn_idx++;
-                    }
+    const char first = jstream_peek(js);
+    const jstream_t start = *js;
+    if (first != '{') {
+        jstream_skipValue(js);
+        json_reportError(loader, &start, "Spacecraft must be objects, skipped one");
+        return;
+    }
+    jstream_beginObject(js);
+    while (jstream_nextMember(js, key, sizeof(key))) {
+        if (strcmp(key, "name") == 0) {
+            has_name = json_readString(js, name, sizeof(name));
+        } else if (strcmp(key, "position_relative_to") == 0) {
+            has_relative_to = json_readString(js, relative_to, sizeof(relative_to));
+        } else if (strcmp(key, "burns") == 0) {
+            num_burns = json_readBurns(loader, js);
+        } else {
+            json_readNumberMember(js, key, fields, field_count, &found);
+        }
+    }
+    if (!has_name || (found & CRAFT_REQUIRED) != CRAFT_REQUIRED) {
+        json_reportError(loader, &start, "Spacecraft need a name, position, velocity, masses, propulsion and attitude fields, skipped one");
+        return;
+    }
+
+    // if the position is relative to a body, add its position and velocity
+    if (has_relative_to) {
+        vec3 body_pos, body_vel;
+        json_relativeOffset(loader, &start, relative_to, &body_pos, &body_vel);
+        pos = vec3_add(pos, body_pos);
+        vel = vec3_add(vel, body_vel);
+    }
+
+    craft_addSpacecraft(&loader->sim->gs, name, pos, vel,
+                        dry_mass, fuel_mass, thrust, specific_impulse, mass_flow_rate,
+                        attitude, moment_of_inertia, nozzle_gimbal_range,
+                        loader->burns, num_burns);
+}
+
+// explicit particles as [pos_x, pos_y, pos_z, vel_x, vel_y, vel_z], counted first so the swarm grows once
+static void json_readParticles(json_loader_t* loader, jstream_t* js) {
+    swarm_t* swarm = &loader->sim->swarm;
+    jstream_t probe = *js;
+    const int count = jstream_skipArray(&probe);
+    if (count < 0) {
+        jstream_skipValue(js);
+        return;
+    }
+    if (!swarm_reserve(swarm, swarm->count + count)) {
+        displayError("ERROR", "Failed to allocate memory for swarm particles");
+        jstream_skipValue(js);
+        return;
+    }
+
+    jstream_beginArray(js);
+    while (jstream_nextElement(js)) {
+        const char first = jstream_peek(js);
+        const jstream_t start = *js;
+        double state[6];
+        int k = 0;
+        if (first == '[') {
+            jstream_beginArray(js);
+            while (jstream_nextElement(js)) {
+                if (k == 6 || !json_readNumber(js, &state[k])) {
+                    k = -1;
+                    break;
                 }
+                k++;
             }
+        }
+        if (k != 6) {
+            *js = start;
+            json_reportError(loader, js, "Swarm particles need 6 numbers: pos_x, pos_y, pos_z, vel_x, vel_y, vel_z");
+            jstream_skipValue(js);
+            while (jstream_nextElement(js)) jstream_skipValue(js);
+            return;
+        }
+        const vec3 pos = {state[0], state[1], state[2]};
+        const vec3 vel = {state[3], state[4], state[5]};
+        swarm_addParticle(swarm, pos, vel);
+    }
+}
 
-            // calculate final position and velocity for the craft
-            vec3 final_pos = {
-                pos_x_item->valuedouble,
-                pos_y_item->valuedouble,
-                pos_z_item->valuedouble
-            };
-            vec3 final_vel = {
-                vel_x_item->valuedouble,
-                vel_y_item->valuedouble,
-                vel_z_item->valuedouble
-            };
-
-            if (position_relative_to_item != NULL && cJSON_IsString(position_relative_to_item)) {
-                const char* relative_to = position_relative_to_item->valuestring;
-                if (strcmp(relative_to, "absolute") != 0) {
-                    // if the position is relative to a body, add its position and velocity
-                    vec3 body_pos = findBodyPosition(gb, relative_to);
-                    vec3 body_vel = findBodyVelocity(gb, relative_to);
-                    final_pos = vec3_add(final_pos, body_pos);
-                    final_vel = vec3_add(final_vel, body_vel);
+// shells of random circular orbits around a body
+static void json_readShells(json_loader_t* loader, jstream_t* js) {
+    sim_properties_t* sim = loader->sim;
+    if (jstream_peek(js) != '[') {
+        jstream_skipValue(js);
+        return;
+    }
+    unsigned int seed = 1;
+    char key[JSTREAM_MAX_STRING];
+    char body_name[JSTREAM_MAX_STRING];
+    jstream_beginArray(js);
+    while (jstream_nextElement(js)) {
+        const char first = jstream_peek(js);
+        const jstream_t start = *js;
+        bool has_body = false;
+        double count = 0.0, altitude = 0.0;
+        const json_number_field_t fields[] = {{"count", &count}, {"altitude", &altitude}};
+        unsigned int found = 0;
+        if (first == '{') {
+            jstream_beginObject(js);
+            while (jstream_nextMember(js, key, sizeof(key))) {
+                if (strcmp(key, "body") == 0) {
+                    has_body = json_readString(js, body_name, sizeof(body_name));
+                } else {
+                    json_readNumberMember(js, key, fields, 2, &found);
                 }
             }
+        } else {
+            jstream_skipValue(js);
+        }
+        const int body_id = has_body ? nameindex_find(&loader->body_names, body_name) : -1;
+        if (body_id == -1 || found != 0x3u) {
+            json_reportError(loader, &start, "Swarm shells need a valid body, a count and an altitude");
+            continue;
+        }
+        swarm_addShell(&sim->swarm, &sim->gb, body_id, (int)count, altitude, seed++);
+    }
+}
 
-            craft_addSpacecraft(sc,
-                                name_item->valuestring,
-                                final_pos, final_vel,
-                                dry_mass_item->valuedouble,
-                                fuel_mass_item->valuedouble,
-                                thrust_item->valuedouble,
-                                specific_impulse_item->valuedouble,
-                                mass_flow_rate_item->valuedouble,
-                                attitude_item->valuedouble,
-                                moment_of_inertia_item->valuedouble,
-                                nozzle_gimbal_range_item->valuedouble,
-                                burns, num_burns);
-
-            // free burns array after adding spacecraft
-            if (burns != NULL) {
-                free(burns);
-            }
+static void json_readSwarm(json_loader_t* loader, jstream_t* js) {
+    swarm_t* swarm = &loader->sim->swarm;
+    if (jstream_peek(js) != '{') return;
+    char key[JSTREAM_MAX_STRING];
+    char relative_to[JSTREAM_MAX_STRING];
+    jstream_t relative_at = *js;
+    bool has_relative_to = false;
+    int particles_begin = swarm->count, particles_end = swarm->count;
+
+    jstream_beginObject(js);
+    while (jstream_nextMember(js, key, sizeof(key))) {
+        if (strcmp(key, "position_relative_to") == 0) {
+            jstream_peek(js);
+            relative_at = *js;
+            has_relative_to = json_readString(js, relative_to, sizeof(relative_to));
+        } else if (strcmp(key, "particles") == 0) {
+            particles_begin = swarm->count;
+            json_readParticles(loader, js);
+            particles_end = swarm->count;
+        } else if (strcmp(key, "shells") == 0) {
+            json_readShells(loader, js);
+        } else {
+            jstream_skipValue(js);
+        }
+    }
+
+    // the offset can come after the particles in the file, so it is added once the swarm is read
+    vec3 offset_pos, offset_vel;
+    if (!has_relative_to || !json_relativeOffset(loader, &relative_at, relative_to, &offset_pos, &offset_vel)) return;
+    for (int i = particles_begin; i < particles_end; i++) {
+        swarm->pos_x[i] += offset_pos.x; swarm->pos_y[i] += offset_pos.y; swarm->pos_z[i] += offset_pos.z;
+        swarm->vel_x[i] += offset_vel.x; swarm->vel_y[i] += offset_vel.y; swarm->vel_z[i] += offset_vel.z;
+    }
+}
+
+// an orbital element catalog around one body, {"file", "parent", "as": "swarm" | "craft"}
+static void json_readCatalog(json_loader_t* loader, jstream_t* js) {
+    const jstream_t start = *js;
+    char key[JSTREAM_MAX_STRING];
+    char file[JSTREAM_MAX_STRING] = "";
+    char parent[JSTREAM_MAX_STRING] = "";
+    char as[JSTREAM_MAX_STRING] = "swarm";
+    if (jstream_peek(js) != '{') {
+        jstream_skipValue(js);
+        json_reportError(loader, &start, "Catalogs need a file and a parent body");
+        return;
+    }
+    jstream_beginObject(js);
+    while (jstream_nextMember(js, key, sizeof(key))) {
+        if (strcmp(key, "file") == 0) json_readString(js, file, sizeof(file));
+        else if (strcmp(key, "parent") == 0) json_readString(js, parent, sizeof(parent));
+        else if (strcmp(key, "as") == 0) json_readString(js, as, sizeof(as));
+        else jstream_skipValue(js);
+    }
+    const int parent_id = nameindex_find(&loader->body_names, parent);
+    const bool as_craft = strcmp(as, "craft") == 0;
+    if (file[0] == '\0' || parent_id == -1 || (!as_craft && strcmp(as, "swarm") != 0)) {
+        json_reportError(loader, &start, "Catalogs need a file, a valid parent body and \"as\" swarm or craft");
+        return;
+    }
+    catalog_t catalog;
+    if (!catalog_read(file, &catalog)) return;
+    catalog_import(loader->sim, &catalog, parent_id, as_craft);
+    catalog_free(&catalog);
+}
+
+// where each top level section starts, noted by the first pass (the first one wins if a key repeats)
+typedef struct {
+    const char* gravity;
+    const char* integrator;
+    const char* bodies;
+    const char* spacecraft;
+    const char* swarm;
+    const char* catalogs;
+    size_t gravity_length;
+    size_t integrator_length;
+    int body_count;
+    int craft_count;
+} json_sections_t;
+
+static bool json_findSections(jstream_t* js, json_sections_t* sections) {
+    char key[JSTREAM_MAX_STRING];
+    memset(sections, 0, sizeof(*sections));
+    if (!jstream_beginObject(js)) return false;
+    while (jstream_nextMember(js, key, sizeof(key))) {
+        const char* value = js->at;
+        if (strcmp(key, "gravity") == 0 && sections->gravity == NULL) {
+            jstream_sliceValue(js, &sections->gravity, &sections->gravity_length);
+        } else if (strcmp(key, "integrator") == 0 && sections->integrator == NULL) {
+            jstream_sliceValue(js, &sections->integrator, &sections->integrator_length);
+        } else if (strcmp(key, "bodies") == 0 && sections->bodies == NULL && jstream_peek(js) == '[') {
+            sections->bodies = value;
+            sections->body_count = jstream_skipArray(js);
+        } else if (strcmp(key, "spacecraft") == 0 && sections->spacecraft == NULL && jstream_peek(js) == '[') {
+            sections->spacecraft = value;
+            sections->craft_count = jstream_skipArray(js);
+        } else if (strcmp(key, "swarm") == 0 && sections->swarm == NULL) {
+            sections->swarm = value;
+            jstream_skipValue(js);
+        } else if (strcmp(key, "catalogs") == 0 && sections->catalogs == NULL && jstream_peek(js) == '[') {
+            sections->catalogs = value;
+            jstream_skipValue(js);
+        } else {
+            jstream_skipValue(js);
+        }
+    }
+    return !js->failed && jstream_peek(js) == 0 && js->at == js->end;
+}
+
+// reads the array starting at section with read, one element at a time
+static void json_readArray(json_loader_t* loader, jstream_t* js, const char* section,
+                           void (*read)(json_loader_t*, jstream_t*)) {
+    js->at = section;
+    jstream_beginArray(js);
+    while (jstream_nextElement(js)) read(loader, js);
+}
+
+// json handling logic for reading json files
+void readSimulationJSON(const char* FILENAME, sim_properties_t* sim) {
+    body_properties_t* gb = &sim->gb;
+    spacecraft_properties_t* sc = &sim->gs;
+
+    mapped_file_t file;
+    if (!mapfile_open(&file, FILENAME)) {
+        displayError("ERROR", "Error: Could not open simulation JSON file");
+        return;
+    }
+    jstream_t js;
+    jstream_init(&js, (const char*)file.data, file.size);
+
+    // nothing is loaded from a file with a syntax error
+    json_sections_t sections;
+    json_loader_t loader = {.sim = sim, .filename = FILENAME};
+    if (!json_findSections(&js, &sections)) {
+        json_reportError(&loader, &js, "Failed to parse simulation JSON");
+        mapfile_close(&file);
+        return;
+    }
+
+    if (sections.gravity != NULL) json_readSettings(sections.gravity, sections.gravity_length, json_readGravity, sim);
+    if (sections.integrator != NULL) json_readSettings(sections.integrator, sections.integrator_length, json_readIntegrator, sim);
+
+    // bodies already in the sim can be referenced too
+    for (int i = 0; i < gb->count; i++) {
+        nameindex_add(&loader.body_names, gb->bodies[i].name, i);
+    }
+
+    if (sections.bodies != NULL) {
+        if (!body_reserve(gb, gb->count + sections.body_count)) {
+            displayError("ERROR", "Failed to allocate memory for bodies");
+        } else {
+            json_readArray(&loader, &js, sections.bodies, json_readBody);
+        }
+    }
+
+    // calculate SOI for all bodies after they're loaded
+    body_calculateSOI(gb);
+
+    if (sections.spacecraft != NULL) {
+        if (!craft_reserve(sc, sc->count + sections.craft_count)) {
+            displayError("ERROR", "Failed to allocate memory for spacecraft");
+        } else {
+            json_readArray(&loader, &js, sections.spacecraft, json_readCraft);
         }
     }
     // set the initial closest planet on initialization
@@ -261,5 +650,13 @@ void readSimulationJSON(const char* FILENAME, body_properties_t* gb, spacecraft_
         craft_findClosestPlanet(&sc->spacecraft[i], gb);
     }
 
-    cJSON_Delete(json);
+    if (sections.swarm != NULL) {
+        js.at = sections.swarm;
+        json_readSwarm(&loader, &js);
+    }
+    if (sections.catalogs != NULL) json_readArray(&loader, &js, sections.catalogs, json_readCatalog);
+
+    nameindex_free(&loader.body_names);
+    free(loader.burns);
+    mapfile_close(&file);
 }
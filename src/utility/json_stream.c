@@ -0,0 +1,331 @@
+#include "json_stream.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define JSTREAM_MAX_NUMBER 64
+#define JSTREAM_MAX_DEPTH 512
+
+void jstream_init(jstream_t* js, const char* data, const size_t size) {
+    js->begin = data;
+    js->at = data;
+    js->end = data + size;
+    js->failed = false;
+}
+
+static bool jstream_fail(jstream_t* js) {
+    js->failed = true;
+    return false;
+}
+
+static bool jstream_isSpace(const char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static void jstream_skipSpace(jstream_t* js) {
+    while (js->at < js->end && jstream_isSpace(*js->at)) js->at++;
+}
+
+// next significant character without consuming it, 0 at the end of the text or after an error
+char jstream_peek(jstream_t* js) {
+    if (js->failed) return 0;
+    jstream_skipSpace(js);
+    return js->at < js->end ? *js->at : 0;
+}
+
+static bool jstream_expect(jstream_t* js, const char c) {
+    if (jstream_peek(js) != c) return jstream_fail(js);
+    js->at++;
+    return true;
+}
+
+bool jstream_beginObject(jstream_t* js) {
+    return jstream_expect(js, '{');
+}
+
+bool jstream_beginArray(jstream_t* js) {
+    return jstream_expect(js, '[');
+}
+
+// true right after the opening bracket, so the first member or element is not preceded by a comma
+static bool jstream_afterOpen(const jstream_t* js) {
+    const char* p = js->at;
+    while (p > js->begin && jstream_isSpace(p[-1])) p--;
+    return p > js->begin && (p[-1] == '{' || p[-1] == '[');
+}
+
+// steps to the next element of the array being walked, false once its closing bracket is consumed
+bool jstream_nextElement(jstream_t* js) {
+    const char c = jstream_peek(js);
+    if (c == ']') {
+        js->at++;
+        return false;
+    }
+    if (jstream_afterOpen(js)) return c != 0 || jstream_fail(js);
+    return jstream_expect(js, ',');
+}
+
+// reads the key of the next member of the object being walked (the value is next), false once its closing
+// brace is consumed
+bool jstream_nextMember(jstream_t* js, char* key, const size_t key_size) {
+    const char c = jstream_peek(js);
+    if (c == '}') {
+        js->at++;
+        return false;
+    }
+    if (!jstream_afterOpen(js) && !jstream_expect(js, ',')) return false;
+    return jstream_readString(js, key, key_size) && jstream_expect(js, ':');
+}
+
+static int jstream_hexDigit(const char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool jstream_readHex4(jstream_t* js, unsigned int* code) {
+    if (js->end - js->at < 4) return jstream_fail(js);
+    *code = 0;
+    for (int i = 0; i < 4; i++) {
+        const int digit = jstream_hexDigit(*js->at++);
+        if (digit < 0) return jstream_fail(js);
+        *code = *code << 4 | (unsigned int)digit;
+    }
+    return true;
+}
+
+// \uXXXX (and a following low surrogate) as utf-8, returns the number of bytes written to out
+static int jstream_readEscapedCode(jstream_t* js, char out[4]) {
+    unsigned int code;
+    if (!jstream_readHex4(js, &code)) return 0;
+    if (code >= 0xD800 && code < 0xDC00) {
+        unsigned int low;
+        if (js->end - js->at < 2 || js->at[0] != '\\' || js->at[1] != 'u') return jstream_fail(js);
+        js->at += 2;
+        if (!jstream_readHex4(js, &low) || low < 0xDC00 || low > 0xDFFF) return jstream_fail(js);
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+    }
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        out[0] = (char)(0xC0 | code >> 6);
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code < 0x10000) {
+        out[0] = (char)(0xE0 | code >> 12);
+        out[1] = (char)(0x80 | (code >> 6 & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | code >> 18);
+    out[1] = (char)(0x80 | (code >> 12 & 0x3F));
+    out[2] = (char)(0x80 | (code >> 6 & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+// reads a string value into text (NUL terminated), a string that does not fit is an error
+bool jstream_readString(jstream_t* js, char* text, const size_t size) {
+    if (!jstream_expect(js, '"')) return false;
+    // plain runs are copied in one go, escapes one at a time
+    size_t length = 0;
+    while (js->at < js->end && *js->at != '"') {
+        const char* run = js->at;
+        while (js->at < js->end && *js->at != '"' && *js->at != '\\' && (unsigned char)*js->at >= 0x20) js->at++;
+        if (js->at > run) {
+            const size_t count = (size_t)(js->at - run);
+            if (length + count >= size) return jstream_fail(js);
+            memcpy(text + length, run, count);
+            length += count;
+            continue;
+        }
+        char bytes[4];
+        int count = 1;
+        const char c = *js->at++;
+        if ((unsigned char)c < 0x20) return jstream_fail(js);
+        if (c != '\\') {
+            bytes[0] = c;
+        } else {
+            if (js->at >= js->end) return jstream_fail(js);
+            switch (*js->at++) {
+                case '"': bytes[0] = '"'; break;
+                case '\\': bytes[0] = '\\'; break;
+                case '/': bytes[0] = '/'; break;
+                case 'b': bytes[0] = '\b'; break;
+                case 'f': bytes[0] = '\f'; break;
+                case 'n': bytes[0] = '\n'; break;
+                case 'r': bytes[0] = '\r'; break;
+                case 't': bytes[0] = '\t'; break;
+                case 'u':
+                    count = jstream_readEscapedCode(js, bytes);
+                    if (count == 0) return false;
+                    break;
+                default: return jstream_fail(js);
+            }
+        }
+        if (length + (size_t)count >= size) return jstream_fail(js);
+        memcpy(text + length, bytes, (size_t)count);
+        length += (size_t)count;
+    }
+    if (js->at >= js->end) return jstream_fail(js);
+    js->at++;
+    text[length] = '\0';
+    return true;
+}
+
+static bool jstream_isDigit(const char* p, const char* end) {
+    return p < end && *p >= '0' && *p <= '9';
+}
+
+// length of the json number at the read position, 0 if there is none
+static size_t jstream_numberLength(const jstream_t* js) {
+    const char* p = js->at;
+    if (p < js->end && *p == '-') p++;
+    if (!jstream_isDigit(p, js->end)) return 0;
+    if (*p == '0') p++;
+    else while (jstream_isDigit(p, js->end)) p++;
+    if (p < js->end && *p == '.') {
+        if (!jstream_isDigit(++p, js->end)) return 0;
+        while (jstream_isDigit(p, js->end)) p++;
+    }
+    if (p < js->end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < js->end && (*p == '+' || *p == '-')) p++;
+        if (!jstream_isDigit(p, js->end)) return 0;
+        while (jstream_isDigit(p, js->end)) p++;
+    }
+    return (size_t)(p - js->at);
+}
+
+// the token is copied out before strtod, since the text is not NUL terminated
+bool jstream_readNumber(jstream_t* js, double* value) {
+    if (jstream_peek(js) == 0) return jstream_fail(js);
+    const size_t length = jstream_numberLength(js);
+    char token[JSTREAM_MAX_NUMBER];
+    if (length == 0 || length >= sizeof(token)) return jstream_fail(js);
+    memcpy(token, js->at, length);
+    token[length] = '\0';
+    *value = strtod(token, NULL);
+    js->at += length;
+    return true;
+}
+
+static bool jstream_skipNumber(jstream_t* js) {
+    const size_t length = jstream_numberLength(js);
+    if (length == 0 || length >= JSTREAM_MAX_NUMBER) return jstream_fail(js);
+    js->at += length;
+    return true;
+}
+
+static bool jstream_readLiteral(jstream_t* js, const char* literal) {
+    const size_t length = strlen(literal);
+    if ((size_t)(js->end - js->at) < length || memcmp(js->at, literal, length) != 0) return jstream_fail(js);
+    js->at += length;
+    return true;
+}
+
+bool jstream_readBool(jstream_t* js, bool* value) {
+    const char c = jstream_peek(js);
+    *value = c == 't';
+    return jstream_readLiteral(js, c == 't' ? "true" : "false");
+}
+
+static bool jstream_skipString(jstream_t* js) {
+    if (!jstream_expect(js, '"')) return false;
+    while (js->at < js->end) {
+        const char c = *js->at++;
+        if (c == '"') return true;
+        if ((unsigned char)c < 0x20) break;
+        if (c == '\\' && js->at < js->end) js->at++;
+    }
+    js->at = js->end;
+    return jstream_fail(js);
+}
+
+static bool jstream_skipNested(jstream_t* js, int depth);
+
+static bool jstream_skipObject(jstream_t* js, const int depth) {
+    js->at++;
+    if (jstream_peek(js) == '}') {
+        js->at++;
+        return true;
+    }
+    for (;;) {
+        if (!jstream_skipString(js) || !jstream_expect(js, ':') || !jstream_skipNested(js, depth + 1)) return false;
+        const char c = jstream_peek(js);
+        if (c != ',' && c != '}') return jstream_fail(js);
+        js->at++;
+        if (c == '}') return true;
+    }
+}
+
+static bool jstream_skipArrayElements(jstream_t* js, const int depth, int* count) {
+    js->at++;
+    *count = 0;
+    if (jstream_peek(js) == ']') {
+        js->at++;
+        return true;
+    }
+    for (;;) {
+        if (!jstream_skipNested(js, depth + 1)) return false;
+        (*count)++;
+        const char c = jstream_peek(js);
+        if (c != ',' && c != ']') return jstream_fail(js);
+        js->at++;
+        if (c == ']') return true;
+    }
+}
+
+static bool jstream_skipNested(jstream_t* js, const int depth) {
+    if (depth > JSTREAM_MAX_DEPTH) return jstream_fail(js);
+    const char c = jstream_peek(js);
+    int count;
+    switch (c) {
+        case '"': return jstream_skipString(js);
+        case '{': return jstream_skipObject(js, depth);
+        case '[': return jstream_skipArrayElements(js, depth, &count);
+        case 't': return jstream_readLiteral(js, "true");
+        case 'f': return jstream_readLiteral(js, "false");
+        case 'n': return jstream_readLiteral(js, "null");
+        default: return jstream_skipNumber(js);
+    }
+}
+
+// skips one value of any type, checking its syntax on the way (so a section that was skipped once can be
+// read later without running into syntax errors)
+bool jstream_skipValue(jstream_t* js) {
+    return jstream_skipNested(js, 0);
+}
+
+// skips the array that comes next and returns its number of elements, -1 if it is not a valid array.
+// run on a copy of the reader this sizes storage before the elements are read
+int jstream_skipArray(jstream_t* js) {
+    int count;
+    if (jstream_peek(js) != '[') {
+        jstream_fail(js);
+        return -1;
+    }
+    return jstream_skipArrayElements(js, 0, &count) ? count : -1;
+}
+
+// skips one value and hands back its text (e.g. for cJSON_ParseWithLength)
+bool jstream_sliceValue(jstream_t* js, const char** text, size_t* length) {
+    if (jstream_peek(js) == 0) return jstream_fail(js);
+    const char* start = js->at;
+    if (!jstream_skipValue(js)) return false;
+    *text = start;
+    *length = (size_t)(js->at - start);
+    return true;
+}
+
+// line of the read position, for error messages
+int jstream_line(const jstream_t* js) {
+    int line = 1;
+    for (const char* p = js->begin; p < js->at; p++) {
+        if (*p == '\n') line++;
+    }
+    return line;
+}
@@ -0,0 +1,34 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// pull reader over json text that is not NUL terminated (a mapped file): the caller walks objects and arrays
+// member by member and reads the values it wants, everything else is skipped without being stored.
+// any syntax error sets failed, after which every call returns false so a loop over members just ends
+
+#define JSTREAM_MAX_STRING 256 // longest string value that can be read (names, keys)
+
+typedef struct {
+    const char* begin;
+    const char* at;
+    const char* end;
+    bool failed;
+} jstream_t;
+
+void jstream_init(jstream_t* js, const char* data, size_t size);
+char jstream_peek(jstream_t* js);
+bool jstream_beginObject(jstream_t* js);
+bool jstream_beginArray(jstream_t* js);
+bool jstream_nextMember(jstream_t* js, char* key, size_t key_size);
+bool jstream_nextElement(jstream_t* js);
+bool jstream_readNumber(jstream_t* js, double* value);
+bool jstream_readString(jstream_t* js, char* text, size_t size);
+bool jstream_readBool(jstream_t* js, bool* value);
+bool jstream_skipValue(jstream_t* js);
+bool jstream_sliceValue(jstream_t* js, const char** text, size_t* length);
+int jstream_skipArray(jstream_t* js);
+int jstream_line(const jstream_t* js);
+
+#endif
@@ -0,0 +1,57 @@
+#include "mapped_file.h"
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// maps path, false if it cannot be opened or is empty (file is left closed either way on failure)
+bool mapfile_open(mapped_file_t* file, const char* path) {
+    memset(file, 0, sizeof(*file));
+#ifdef _WIN32
+    file->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file->file == INVALID_HANDLE_VALUE) {
+        file->file = NULL;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file->file, &size) && size.QuadPart > 0) {
+        file->mapping = CreateFileMappingA(file->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (file->mapping != NULL) file->data = (const uint8_t*)MapViewOfFile(file->mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (file->data == NULL) {
+        mapfile_close(file);
+        return false;
+    }
+    file->size = (size_t)size.QuadPart;
+    return true;
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (data == MAP_FAILED) return false;
+    file->data = (const uint8_t*)data;
+    file->size = (size_t)st.st_size;
+    return true;
+#endif
+}
+
+void mapfile_close(mapped_file_t* file) {
+#ifdef _WIN32
+    if (file->data != NULL) UnmapViewOfFile(file->data);
+    if (file->mapping != NULL) CloseHandle(file->mapping);
+    if (file->file != NULL) CloseHandle(file->file);
+#else
+    if (file->data != NULL) munmap((void*)file->data, file->size);
+#endif
+    memset(file, 0, sizeof(*file));
+}
@@ -0,0 +1,25 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// a whole file mapped read only (mmap, or a file mapping on Windows), pages are read on first touch
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} mapped_file_t;
+
+bool mapfile_open(mapped_file_t* file, const char* path);
+void mapfile_close(mapped_file_t* file);
+
+#endif
@@ -0,0 +1,59 @@
+#include "name_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t nameindex_hash(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)name; *p != '\0'; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// slot holding name, or the empty slot where it would go
+static name_slot_t* nameindex_slot(const name_index_t* index, const char* name, const uint32_t hash) {
+    const uint32_t mask = (uint32_t)index->capacity - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        name_slot_t* slot = &index->slots[i];
+        if (slot->id < 0 || (slot->hash == hash && strcmp(slot->name, name) == 0)) return slot;
+    }
+}
+
+static bool nameindex_grow(name_index_t* index, const int capacity) {
+    name_slot_t* slots = (name_slot_t*)malloc((size_t)capacity * sizeof(name_slot_t));
+    if (slots == NULL) return false;
+    for (int i = 0; i < capacity; i++) slots[i].id = -1;
+
+    name_index_t grown = {slots, capacity, index->count};
+    for (int i = 0; i < index->capacity; i++) {
+        if (index->slots[i].id >= 0) *nameindex_slot(&grown, index->slots[i].name, index->slots[i].hash) = index->slots[i];
+    }
+    free(index->slots);
+    *index = grown;
+    return true;
+}
+
+// adds name with id, a name that is already there keeps its first id (like a front to back search would)
+bool nameindex_add(name_index_t* index, const char* name, const int id) {
+    if (2 * (index->count + 1) > index->capacity && !nameindex_grow(index, index->capacity == 0 ? 64 : index->capacity * 2)) {
+        return false;
+    }
+    const uint32_t hash = nameindex_hash(name);
+    name_slot_t* slot = nameindex_slot(index, name, hash);
+    if (slot->id >= 0) return true;
+    *slot = (name_slot_t){name, hash, id};
+    index->count++;
+    return true;
+}
+
+// id of name, -1 if it is not in the index
+int nameindex_find(const name_index_t* index, const char* name) {
+    if (index->count == 0) return -1;
+    return nameindex_slot(index, name, nameindex_hash(name))->id;
+}
+
+void nameindex_free(name_index_t* index) {
+    free(index->slots);
+    *index = (name_index_t){0};
+}
@@ -0,0 +1,26 @@
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// name -> id hash table (fnv-1a, open addressing with linear probing). the names are not copied, so they
+// have to outlive the index (body and craft names do, they are allocated once per object)
+
+typedef struct {
+    const char* name;
+    uint32_t hash;
+    int id;                // -1 for an empty slot
+} name_slot_t;
+
+typedef struct {
+    name_slot_t* slots;
+    int capacity;          // power of two, kept at most half full
+    int count;
+} name_index_t;
+
+bool nameindex_add(name_index_t* index, const char* name, int id);
+int nameindex_find(const name_index_t* index, const char* name);
+void nameindex_free(name_index_t* index);
+
+#endif
@@ -5,10 +5,12 @@
 #ifndef ORBITSIMULATION_SIM_THEAD_H
 #define ORBITSIMULATION_SIM_THEAD_H
 #include "../globals.h"
+#include <stdbool.h>
 #ifdef _WIN32
     #include <windows.h>
 #else
 #include <pthread.h>
+#include <time.h>
 #endif
 
 typedef struct {
@@ -57,4 +59,123 @@ static inline void mutex_destroy(mutex_t *mutex) {
 #endif
 }
 
+typedef struct {
+    union {
+#ifdef _WIN32
+        CONDITION_VARIABLE win_cv;
+#else
+        pthread_cond_t posix_cv;
+#endif
+    } u;
+} cond_t;
+
+// condition variable initialization function
+static inline void cond_init(cond_t *cond) {
+#ifdef _WIN32
+    InitializeConditionVariable(&cond->u.win_cv);
+#else
+    pthread_cond_init(&cond->u.posix_cv, NULL);
+#endif
+}
+
+// releases the mutex and waits until the condition variable is signaled
+static inline void cond_wait(cond_t *cond, mutex_t *mutex) {
+#ifdef _WIN32
+    SleepConditionVariableCS(&cond->u.win_cv, &mutex->u.win_cs, INFINITE);
+#else
+    pthread_cond_wait(&cond->u.posix_cv, &mutex->u.posix_mtx);
+#endif
+}
+
+// same as cond_wait, but gives up after the given number of seconds
+static inline void cond_timedwait(cond_t *cond, mutex_t *mutex, double seconds) {
+#ifdef _WIN32
+    SleepConditionVariableCS(&cond->u.win_cv, &mutex->u.win_cs, (DWORD)(seconds * 1000.0));
+#else
+    struct timespec deadline;
+    timespec_get(&deadline, TIME_UTC); // pthread condition variables time out on the realtime clock by default
+    const long long nanoseconds = deadline.tv_nsec + (long long)((seconds - (double)(long long)seconds) * 1e9);
+    deadline.tv_sec += (time_t)seconds + (time_t)(nanoseconds / 1000000000LL);
+    deadline.tv_nsec = (long)(nanoseconds % 1000000000LL);
+    pthread_cond_timedwait(&cond->u.posix_cv, &mutex->u.posix_mtx, &deadline);
+#endif
+}
+
+// wakes every thread waiting on the condition variable
+static inline void cond_broadcast(cond_t *cond) {
+#ifdef _WIN32
+    WakeAllConditionVariable(&cond->u.win_cv);
+#else
+    pthread_cond_broadcast(&cond->u.posix_cv);
+#endif
+}
+
+// condition variable destruction function
+static inline void cond_destroy(cond_t *cond) {
+#ifdef _WIN32
+    (void)cond; // windows condition variables need no cleanup
+#else
+    pthread_cond_destroy(&cond->u.posix_cv);
+#endif
+}
+
+// atomically stores value and returns the previous value (full barrier)
+static inline int atomic_exchangeInt(volatile int *target, int value) {
+#ifdef _WIN32
+    return (int)InterlockedExchange((volatile LONG*)target, (LONG)value);
+#else
+    return __atomic_exchange_n(target, value, __ATOMIC_ACQ_REL);
+#endif
+}
+
+// atomic load, later reads cannot move before it
+static inline int atomic_loadInt(volatile int *target) {
+#ifdef _WIN32
+    return (int)InterlockedCompareExchange((volatile LONG*)target, 0, 0);
+#else
+    return __atomic_load_n(target, __ATOMIC_ACQUIRE);
+#endif
+}
+
+// atomic store, earlier writes cannot move after it
+static inline void atomic_storeInt(volatile int *target, int value) {
+#ifdef _WIN32
+    InterlockedExchange((volatile LONG*)target, (LONG)value);
+#else
+    __atomic_store_n(target, value, __ATOMIC_RELEASE);
+#endif
+}
+
+#ifdef _WIN32
+typedef HANDLE thread_t;
+typedef DWORD (WINAPI *thread_fn_t)(LPVOID);
+#define THREAD_RETURN_TYPE DWORD WINAPI
+#define THREAD_RETURN_VALUE 0
+#else
+typedef pthread_t thread_t;
+typedef void* (*thread_fn_t)(void*);
+#define THREAD_RETURN_TYPE void*
+#define THREAD_RETURN_VALUE NULL
+#endif
+
+// thread creation function (returns false if the thread could not be started)
+static inline bool thread_create(thread_t *thread, thread_fn_t fn, void *args) {
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, fn, args, 0, NULL);
+    return *thread != NULL;
+#else
+    return pthread_create(thread, NULL, fn, args) == 0;
+#endif
+}
+
+// waits for a thread to finish
+static inline void thread_join(thread_t thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
 #endif //ORBITSIMULATION_SIM_THEAD_H
\ No newline at end of file
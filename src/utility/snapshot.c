@@ -0,0 +1,174 @@
+#include "snapshot.h"
+#include "sim_thread.h"
+#include "../globals.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_INDEX_MASK 3
+
+void snapshot_init(snapshot_buffer_t* buffer) {
+    memset(buffer->slots, 0, sizeof(buffer->slots));
+    buffer->back = 0;
+    buffer->published = 0;
+    buffer->front = 2;
+    atomic_storeInt(&buffer->middle, 1);
+}
+
+// grows a slot array to hold at least needed elements (keeps the old array if realloc fails)
+static bool snapshot_reserve(void** array, int* capacity, const int needed, const size_t element_size) {
+    if (needed <= *capacity) return true;
+    const int new_capacity = needed > 2 * *capacity ? needed : 2 * *capacity;
+    void* temp = realloc(*array, (size_t)new_capacity * element_size);
+    if (temp == NULL) return false;
+    *array = temp;
+    *capacity = new_capacity;
+    return true;
+}
+
+// copies the render state into the back slot and makes it the newest one
+// every caller must hold sim_mutex (that is what keeps two writers out of the back slot)
+void snapshot_publish(snapshot_buffer_t* buffer, const sim_properties_t* sim) {
+    render_snapshot_t* slot = &buffer->slots[buffer->back];
+    const body_properties_t* gb = &sim->gb;
+    const spacecraft_properties_t* sc = &sim->gs;
+    const swarm_t* swarm = &sim->swarm;
+
+    size_t names_length = 0;
+    for (int i = 0; i < gb->count; i++) names_length += strlen(gb->bodies[i].name) + 1;
+    for (int i = 0; i < sc->count; i++) names_length += strlen(sc->spacecraft[i].name) + 1;
+
+    const int stride = swarm->count > SWARM_MAX_DRAWN ? (swarm->count + SWARM_MAX_DRAWN - 1) / SWARM_MAX_DRAWN : 1;
+    const int drawn = (swarm->count + stride - 1) / stride;
+
+    // out of memory: the renderer keeps showing the last snapshot
+    if (!snapshot_reserve((void**)&slot->bodies, &slot->body_capacity, gb->count, sizeof(body_t)) ||
+        !snapshot_reserve((void**)&slot->spacecraft, &slot->craft_capacity, sc->count, sizeof(spacecraft_t)) ||
+        !snapshot_reserve((void**)&slot->swarm_pos, &slot->swarm_capacity, 3 * drawn, sizeof(float))) {
+        return;
+    }
+    if (names_length > slot->names_capacity) {
+        char* temp = (char*)realloc(slot->names, names_length);
+        if (temp == NULL) return;
+        slot->names = temp;
+        slot->names_capacity = names_length;
+    }
+
+    char* name = slot->names;
+    slot->body_count = gb->count;
+    for (int i = 0; i < gb->count; i++) {
+        slot->bodies[i] = gb->bodies[i];
+        const size_t length = strlen(gb->bodies[i].name) + 1;
+        memcpy(name, gb->bodies[i].name, length);
+        slot->bodies[i].name = name;
+        name += length;
+    }
+    slot->craft_count = sc->count;
+    for (int i = 0; i < sc->count; i++) {
+        slot->spacecraft[i] = sc->spacecraft[i];
+        slot->spacecraft[i].burn_properties = NULL;
+        const size_t length = strlen(sc->spacecraft[i].name) + 1;
+        memcpy(name, sc->spacecraft[i].name, length);
+        slot->spacecraft[i].name = name;
+        name += length;
+    }
+
+    slot->swarm_count = swarm->count;
+    slot->swarm_removed = swarm->removed;
+    slot->swarm_drawn = drawn;
+    for (int k = 0; k < drawn; k++) {
+        const int i = k * stride;
+        slot->swarm_pos[3 * k + 0] = (float)(swarm->pos_x[i] / SCALE);
+        slot->swarm_pos[3 * k + 1] = (float)(swarm->pos_y[i] / SCALE);
+        slot->swarm_pos[3 * k + 2] = (float)(swarm->pos_z[i] / SCALE);
+    }
+
+    slot->sim_time = sim->wp.sim_time;
+    slot->hermite_evaluations = sim->hermite.force_evaluations;
+    slot->hermite_blocks = sim->hermite.block_count;
+    slot->hermite_count = sim->hermite.count;
+    slot->steps_per_second = sim->batch.steps_per_second;
+    slot->batch_steps = sim->batch.steps;
+    slot->realtime_factor = sim->batch.realtime_factor;
+    slot->sim_running = sim->wp.sim_running;
+    slot->time_step = sim->wp.time_step;
+    slot->integrator = sim->wp.integrator;
+    slot->gp = sim->gp;
+    slot->reset_count = sim->wp.reset_count;
+    slot->sequence = ++buffer->published;
+
+    // the exchange publishes the slot and hands back the one the renderer is not using
+    buffer->back = atomic_exchangeInt(&buffer->middle, buffer->back | SNAPSHOT_FRESH) & SNAPSHOT_INDEX_MASK;
+}
+
+// newest published snapshot, only called from the render thread and never blocks
+// (the returned slot stays untouched by the writers until the next call)
+const render_snapshot_t* snapshot_acquire(snapshot_buffer_t* buffer) {
+    if (atomic_loadInt(&buffer->middle) & SNAPSHOT_FRESH) {
+        buffer->front = atomic_exchangeInt(&buffer->middle, buffer->front) & SNAPSHOT_INDEX_MASK;
+    }
+    return &buffer->slots[buffer->front];
+}
+
+// sim_properties_t for the render functions: physics state and settings (only changed by console commands on
+// the physics thread) come from the snapshot, window, camera and console state comes from the render thread's sim
+sim_properties_t snapshot_view(const render_snapshot_t* snapshot, const sim_properties_t* sim) {
+    sim_properties_t view = {0};
+    const window_params_t* wp = &sim->wp;
+    view.wp.screen_width = wp->screen_width;
+    view.wp.screen_height = wp->screen_height;
+    view.wp.window_size_x = wp->window_size_x;
+    view.wp.window_size_y = wp->window_size_y;
+    view.wp.camera_pos = wp->camera_pos;
+    view.wp.zoom = wp->zoom;
+    view.wp.window_open = wp->window_open;
+    view.wp.main_window_ID = wp->main_window_ID;
+    view.wp.refresh_rate = wp->refresh_rate;
+    view.wp.meters_per_pixel = wp->meters_per_pixel;
+    view.wp.planet_model_vertex_count = wp->planet_model_vertex_count;
+    view.wp.frame_counter = wp->frame_counter;
+    view.wp.is_dragging = wp->is_dragging;
+    view.wp.is_zooming = wp->is_zooming;
+    view.wp.is_zooming_in = wp->is_zooming_in;
+    view.wp.is_zooming_out = wp->is_zooming_out;
+    view.wp.draw_lines_between_bodies = wp->draw_lines_between_bodies;
+    view.wp.draw_inclination_height = wp->draw_inclination_height;
+    view.wp.draw_planet_path = wp->draw_planet_path;
+    view.wp.draw_craft_path = wp->draw_craft_path;
+    view.wp.draw_planet_SOI = wp->draw_planet_SOI;
+    view.console = sim->console;
+
+    view.wp.sim_time = snapshot->sim_time;
+    view.wp.sim_running = snapshot->sim_running;
+    view.wp.time_step = snapshot->time_step;
+    view.wp.integrator = snapshot->integrator;
+    view.wp.reset_count = snapshot->reset_count;
+    view.gp = snapshot->gp;
+
+    view.gb.count = snapshot->body_count;
+    view.gb.capacity = snapshot->body_capacity;
+    view.gb.bodies = snapshot->bodies;
+    view.gs.count = snapshot->craft_count;
+    view.gs.capacity = snapshot->craft_capacity;
+    view.gs.spacecraft = snapshot->spacecraft;
+
+    view.swarm.count = snapshot->swarm_count;
+    view.swarm.removed = snapshot->swarm_removed;
+    view.hermite.force_evaluations = snapshot->hermite_evaluations;
+    view.hermite.block_count = snapshot->hermite_blocks;
+    view.hermite.count = snapshot->hermite_count;
+    view.batch.steps = snapshot->batch_steps;
+    view.batch.steps_per_second = snapshot->steps_per_second;
+    view.batch.realtime_factor = snapshot->realtime_factor;
+    return view;
+}
+
+void snapshot_free(snapshot_buffer_t* buffer) {
+    for (int s = 0; s < 3; s++) {
+        render_snapshot_t* slot = &buffer->slots[s];
+        free(slot->bodies);
+        free(slot->spacecraft);
+        free(slot->names);
+        free(slot->swarm_pos);
+    }
+    snapshot_init(buffer);
+}
@@ -0,0 +1,14 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "../types.h"
+
+#define SNAPSHOT_FRESH 4 // set on snapshot_buffer_t.middle while the renderer has not taken that slot yet
+
+void snapshot_init(snapshot_buffer_t* buffer);
+void snapshot_publish(snapshot_buffer_t* buffer, const sim_properties_t* sim);
+const render_snapshot_t* snapshot_acquire(snapshot_buffer_t* buffer);
+sim_properties_t snapshot_view(const render_snapshot_t* snapshot, const sim_properties_t* sim);
+void snapshot_free(snapshot_buffer_t* buffer);
+
+#endif
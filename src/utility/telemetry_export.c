@@ -3,28 +3,568 @@
 //
 
 #include "telemetry_export.h"
+#include "error_hook.h"
+#include "../sim/craft_propagator.h"
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
-void exportTelemetryBinary(const binary_filenames_t filenames, const sim_properties_t* sim) {
-    const body_properties_t* gb = &sim->gb;
-    const window_params_t* wp = &sim->wp;
+#define TELEMETRY_FILE_BUFFER (4 << 20) // bytes buffered by stdio before they go to the disk
+#define TELEMETRY_WRITER_NAP 0.1        // seconds the writer sleeps when it might have missed a wake up
+#define TELEMETRY_BLOCK_MAX_AGE 2.0     // wall clock seconds a partial block may wait before it is written anyway
 
-    // write body position data to the .bin file if enabled
-    for (int i = 0; i < gb->count; i++) {
-        const body_t* body = &gb->bodies[i];
+// ring records: kind, length in slots, three header fields, payload
+#define TELEMETRY_RECORD_HEADER 5
+#define TELEMETRY_RECORD_SAMPLE 0 // time, body count, craft count | 9 values per body, 6 per craft
+#define TELEMETRY_RECORD_NAMES 1  // body count, craft count, bytes | names packed eight bytes to a slot
 
-        global_data_t gd;
-        gd.timestamp = wp->sim_time;
-        gd.body_index = i;
-        gd.pos_data_x = body->pos.x;
-        gd.pos_data_y = body->pos.y;
-        gd.vel_data_x = body->vel.x;
-        gd.vel_data_y = body->vel.y;
-        gd.acc_data_x = body->acc.x;
-        gd.acc_data_y = body->acc.y;
-        gd.force_data_x = body->force.x;
-        gd.force_data_y = body->force.y;
+telemetry_params_t telemetry_defaultParams(void) {
+    return (telemetry_params_t){
+        .writer = NULL,
+        .policy = TELEMETRY_DROP, // the GUI should never wait for the disk
+        .interval = 60.0,
+        .next_time = 0.0,
+        .decimation = 1,
+    };
+}
+
+static double telemetry_wallTime(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t telemetry_toSlot(const double value) {
+    uint64_t slot;
+    memcpy(&slot, &value, sizeof(slot));
+    return slot;
+}
+
+static double telemetry_fromSlot(const uint64_t slot) {
+    double value;
+    memcpy(&value, &slot, sizeof(value));
+    return value;
+}
+
+static int telemetry_indexMask(const telemetry_writer_t* writer) {
+    return 2 * writer->capacity - 1;
+}
+
+static uint64_t telemetry_slotAt(const telemetry_writer_t* writer, const int index) {
+    return writer->slots[index & (writer->capacity - 1)];
+}
+
+// slots waiting for the writer (exact on the physics thread, may be stale anywhere else)
+int telemetry_ringFill(telemetry_writer_t* writer) {
+    return (atomic_loadInt(&writer->tail) - atomic_loadInt(&writer->head)) & telemetry_indexMask(writer);
+}
+
+////////////////////////////////////////////////////////////////
+// writer thread
+////////////////////////////////////////////////////////////////
+
+// first column of a channel in the unpacked block (columns are block_capacity samples long)
+static size_t telemetry_channelStart(const telemetry_writer_t* writer, const int channel) {
+    if (channel == TELEMETRY_CH_TIME) return 0;
+    if (channel <= TELEMETRY_CH_BODY_ACC_Z) return 1 + (size_t)(channel - TELEMETRY_CH_BODY_POS_X) * writer->body_count;
+    return 1 + (size_t)TELEMETRY_BODY_CHANNELS * writer->body_count + (size_t)(channel - TELEMETRY_CH_CRAFT_POS_X) * writer->craft_count;
+}
+
+static void telemetry_write(telemetry_writer_t* writer, const void* data, const size_t size) {
+    if (fwrite(data, 1, size, writer->file) != size) atomic_storeInt(&writer->failed, 1);
+    writer->file_offset += size;
+}
+
+// packs the buffered samples channel by channel into one block, appends it to the file and to the time index
+static void telemetry_flushBlock(telemetry_writer_t* writer) {
+    const int samples = writer->block_samples;
+    if (samples == 0 || atomic_loadInt(&writer->failed)) return;
+    writer->block_samples = 0;
+
+    const size_t columns = 1 + (size_t)TELEMETRY_BODY_CHANNELS * writer->body_count + (size_t)TELEMETRY_CRAFT_CHANNELS * writer->craft_count;
+    const size_t bound = TELEMETRY_BLOCK_HEADER_SIZE + (size_t)writer->names_size + telemetry_encodeBound(columns * samples, columns);
+    if (bound > writer->packed_capacity) {
+        uint8_t* packed = (uint8_t*)realloc(writer->packed, bound);
+        if (packed == NULL) {
+            atomic_storeInt(&writer->failed, 1);
+            return;
+        }
+        writer->packed = packed;
+        writer->packed_capacity = bound;
+    }
+    if (writer->index_count == writer->index_capacity) {
+        const int capacity = writer->index_capacity > 0 ? 2 * writer->index_capacity : 256;
+        telemetry_index_entry_t* index = (telemetry_index_entry_t*)realloc(writer->index, (size_t)capacity * sizeof(telemetry_index_entry_t));
+        if (index == NULL) {
+            atomic_storeInt(&writer->failed, 1);
+            return;
+        }
+        writer->index = index;
+        writer->index_capacity = capacity;
+    }
+
+    telemetry_block_header_t header = {
+        .header_size = TELEMETRY_BLOCK_HEADER_SIZE,
+        .t_first = writer->block[0],
+        .t_last = writer->block[samples - 1],
+        .sample_count = (uint32_t)samples,
+        .body_count = (uint32_t)writer->body_count,
+        .craft_count = (uint32_t)writer->craft_count,
+        .names_size = (uint32_t)writer->names_size,
+    };
+    size_t size = TELEMETRY_BLOCK_HEADER_SIZE;
+    memcpy(writer->packed + size, writer->names, (size_t)writer->names_size);
+    size += (size_t)writer->names_size;
+
+    for (int channel = 0; channel < TELEMETRY_CHANNEL_COUNT; channel++) {
+        const int channel_columns = telemetry_channelColumns((telemetry_channel_t)channel, header.body_count, header.craft_count);
+        const double* values = writer->block + telemetry_channelStart(writer, channel) * writer->block_capacity;
+        header.channel_offset[channel] = size;
+        header.channel_size[channel] = telemetry_encodeColumns(values, channel_columns, samples, (size_t)writer->block_capacity, writer->packed + size);
+        size += header.channel_size[channel];
+    }
+    header.block_size = size;
+    telemetry_writeBlockHeader(writer->packed, &header);
+
+    writer->index[writer->index_count++] = (telemetry_index_entry_t){
+        .t_first = header.t_first,
+        .t_last = header.t_last,
+        .offset = writer->file_offset,
+        .sample_count = header.sample_count,
+    };
+    telemetry_write(writer, writer->packed, size);
+}
+
+// the object set changed: the open block is finished and the next one starts with the new names
+static void telemetry_readNames(telemetry_writer_t* writer, const int head) {
+    telemetry_flushBlock(writer);
+
+    const int bodies = (int)telemetry_slotAt(writer, head + 2);
+    const int craft = (int)telemetry_slotAt(writer, head + 3);
+    const int bytes = (int)telemetry_slotAt(writer, head + 4);
+    const size_t columns = 1 + (size_t)TELEMETRY_BODY_CHANNELS * bodies + (size_t)TELEMETRY_CRAFT_CHANNELS * craft;
+    int block_capacity = (int)fmin(TELEMETRY_BLOCK_SAMPLES, (double)TELEMETRY_BLOCK_BYTES / (8.0 * (double)columns));
+    if (block_capacity < 1) block_capacity = 1;
+
+    char* names = (char*)realloc(writer->names, (size_t)bytes + 8);
+    if (names != NULL) writer->names = names;
+    double* block = names != NULL ? (double*)realloc(writer->block, columns * (size_t)block_capacity * sizeof(double)) : NULL;
+    if (block == NULL) {
+        atomic_storeInt(&writer->failed, 1);
+        return;
+    }
+    writer->block = block;
+
+    for (int i = 0; i * 8 < bytes; i++) {
+        const uint64_t slot = telemetry_slotAt(writer, head + TELEMETRY_RECORD_HEADER + i);
+        memcpy(writer->names + 8 * i, &slot, 8);
+    }
+    writer->names_size = bytes;
+    writer->body_count = bodies;
+    writer->craft_count = craft;
+    writer->block_capacity = block_capacity;
+}
+
+// transposes one sample into the columns of the open block
+static void telemetry_readSample(telemetry_writer_t* writer, const int head) {
+    const int bodies = (int)telemetry_slotAt(writer, head + 3);
+    const int craft = (int)telemetry_slotAt(writer, head + 4);
+    if (writer->block == NULL || bodies != writer->body_count || craft != writer->craft_count) return; // names always come first
+
+    const size_t stride = (size_t)writer->block_capacity;
+    const int s = writer->block_samples;
+    if (s == 0) writer->block_started = telemetry_wallTime();
+    writer->block[s] = telemetry_fromSlot(telemetry_slotAt(writer, head + 2));
+
+    int slot = head + TELEMETRY_RECORD_HEADER;
+    double* body_columns = writer->block + telemetry_channelStart(writer, TELEMETRY_CH_BODY_POS_X) * stride;
+    for (int i = 0; i < bodies; i++) {
+        for (int k = 0; k < TELEMETRY_BODY_CHANNELS; k++) {
+            body_columns[((size_t)k * bodies + i) * stride + s] = telemetry_fromSlot(telemetry_slotAt(writer, slot++));
+        }
+    }
+    double* craft_columns = writer->block + telemetry_channelStart(writer, TELEMETRY_CH_CRAFT_POS_X) * stride;
+    for (int i = 0; i < craft; i++) {
+        for (int k = 0; k < TELEMETRY_CRAFT_CHANNELS; k++) {
+            craft_columns[((size_t)k * craft + i) * stride + s] = telemetry_fromSlot(telemetry_slotAt(writer, slot++));
+        }
+    }
+
+    if (++writer->block_samples == writer->block_capacity) telemetry_flushBlock(writer);
+}
+
+// the time index and the trailer pointing at it close the file
+static void telemetry_writeIndex(telemetry_writer_t* writer) {
+    if (atomic_loadInt(&writer->failed)) return;
+    const uint64_t index_offset = writer->file_offset;
+
+    uint8_t bytes[TELEMETRY_INDEX_HEADER_SIZE];
+    telemetry_put32(bytes, TELEMETRY_INDEX_ENTRY_MAGIC);
+    telemetry_put32(bytes + 4, TELEMETRY_INDEX_ENTRY_SIZE);
+    telemetry_put64(bytes + 8, (uint64_t)writer->index_count);
+    telemetry_write(writer, bytes, sizeof(bytes));
+    for (int i = 0; i < writer->index_count; i++) {
+        uint8_t entry[TELEMETRY_INDEX_ENTRY_SIZE];
+        telemetry_writeIndexEntry(entry, &writer->index[i]);
+        telemetry_write(writer, entry, sizeof(entry));
+    }
+
+    uint8_t trailer[TELEMETRY_TRAILER_SIZE];
+    telemetry_put64(trailer, index_offset);
+    memcpy(trailer + 8, TELEMETRY_INDEX_MAGIC, 8);
+    telemetry_write(writer, trailer, sizeof(trailer));
+}
+
+// writer thread: turns ring records into blocks and sleeps while the ring is empty
+static THREAD_RETURN_TYPE telemetry_writerMain(void* args) {
+    telemetry_writer_t* writer = (telemetry_writer_t*)args;
+    const int mask = telemetry_indexMask(writer);
+
+    for (;;) {
+        const int head = writer->head; // only this thread writes head
+        if (atomic_loadInt(&writer->tail) == head) {
+            if (atomic_loadInt(&writer->stopping)) break;
+
+            // a slow trickle of samples still reaches the disk every few seconds
+            if (writer->block_samples > 0 && telemetry_wallTime() - writer->block_started > TELEMETRY_BLOCK_MAX_AGE) {
+                telemetry_flushBlock(writer);
+                if (fflush(writer->file) != 0) atomic_storeInt(&writer->failed, 1);
+            }
+
+            mutex_lock(&writer->lock);
+            atomic_storeInt(&writer->writer_idle, 1);
+            if (atomic_loadInt(&writer->tail) == head && !atomic_loadInt(&writer->stopping)) {
+                cond_timedwait(&writer->data_ready, &writer->lock, TELEMETRY_WRITER_NAP);
+            }
+            atomic_storeInt(&writer->writer_idle, 0);
+            mutex_unlock(&writer->lock);
+            continue;
+        }
+
+        // after a failure the ring is still drained so a blocked producer is never stuck
+        const int length = (int)telemetry_slotAt(writer, head + 1);
+        if (!atomic_loadInt(&writer->failed)) {
+            if (telemetry_slotAt(writer, head) == TELEMETRY_RECORD_NAMES) telemetry_readNames(writer, head);
+            else telemetry_readSample(writer, head);
+        }
+
+        // hands the slots back only after the record was copied out
+        atomic_storeInt(&writer->head, (head + length) & mask);
+        if (atomic_loadInt(&writer->producer_waiting)) {
+            mutex_lock(&writer->lock);
+            cond_broadcast(&writer->space_ready);
+            mutex_unlock(&writer->lock);
+        }
+    }
+
+    telemetry_flushBlock(writer);
+    telemetry_writeIndex(writer);
+    if (fflush(writer->file) != 0) atomic_storeInt(&writer->failed, 1);
+    return THREAD_RETURN_VALUE;
+}
+
+////////////////////////////////////////////////////////////////
+// physics thread
+////////////////////////////////////////////////////////////////
+
+static void telemetry_freeWriter(telemetry_writer_t* writer) {
+    if (writer->file != NULL) fclose(writer->file);
+    free(writer->file_buffer);
+    free(writer->slots);
+    free(writer->names);
+    free(writer->block);
+    free(writer->packed);
+    free(writer->index);
+    free(writer);
+}
+
+// bytes of the names record payload: body names then craft names, NUL terminated
+static int telemetry_namesSize(const sim_properties_t* sim) {
+    size_t size = 0;
+    for (int i = 0; i < sim->gb.count; i++) size += strlen(sim->gb.bodies[i].name) + 1;
+    for (int i = 0; i < sim->gs.count; i++) size += strlen(sim->gs.spacecraft[i].name) + 1;
+    return (int)size;
+}
+
+static int telemetry_sampleSlots(const sim_properties_t* sim) {
+    return TELEMETRY_RECORD_HEADER + TELEMETRY_BODY_CHANNELS * sim->gb.count + TELEMETRY_CRAFT_CHANNELS * sim->gs.count;
+}
+
+// opens path and starts the writer thread (a running writer is stopped first), the current state is the first sample
+bool telemetry_start(sim_properties_t* sim, const char* path) {
+    telemetry_stop(sim);
+
+    telemetry_writer_t* writer = (telemetry_writer_t*)calloc(1, sizeof(telemetry_writer_t));
+    if (writer == NULL) {
+        displayError("ERROR", "Failed to allocate memory for the telemetry writer");
+        return false;
+    }
+
+    // room for at least a few whole samples
+    const int sample_slots = telemetry_sampleSlots(sim) + TELEMETRY_RECORD_HEADER + telemetry_namesSize(sim) / 8 + 1;
+    writer->capacity = TELEMETRY_RING_SLOTS;
+    while (writer->capacity < 4 * sample_slots && writer->capacity < (1 << 28)) writer->capacity *= 2;
+
+    writer->slots = (uint64_t*)malloc((size_t)writer->capacity * sizeof(uint64_t));
+    writer->file_buffer = (char*)malloc(TELEMETRY_FILE_BUFFER);
+    if (writer->slots == NULL || writer->file_buffer == NULL) {
+        displayError("ERROR", "Failed to allocate memory for the telemetry writer");
+        telemetry_freeWriter(writer);
+        return false;
+    }
+
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        char message[512];
+        snprintf(message, sizeof(message), "Could not open telemetry file %s", path);
+        displayError("ERROR", message);
+        telemetry_freeWriter(writer);
+        return false;
+    }
+    setvbuf(writer->file, writer->file_buffer, _IOFBF, TELEMETRY_FILE_BUFFER);
+
+    uint8_t header[TELEMETRY_FILE_HEADER_SIZE];
+    telemetry_writeFileHeader(header, TELEMETRY_BLOCK_SAMPLES);
+    telemetry_write(writer, header, sizeof(header));
+
+    mutex_init(&writer->lock);
+    cond_init(&writer->data_ready);
+    cond_init(&writer->space_ready);
+    if (!thread_create(&writer->thread, telemetry_writerMain, writer)) {
+        displayError("ERROR", "Failed to start the telemetry writer thread");
+        mutex_destroy(&writer->lock);
+        cond_destroy(&writer->data_ready);
+        cond_destroy(&writer->space_ready);
+        telemetry_freeWriter(writer);
+        return false;
+    }
+
+    telemetry_params_t* tp = &sim->telemetry;
+    tp->writer = writer;
+    tp->next_time = sim->wp.sim_time;
+    tp->step_counter = 0;
+    tp->decimation = 1;
+    tp->decimation_phase = 0;
+    tp->samples = tp->dropped = tp->decimated = tp->blocked = 0;
+    telemetry_sampleNow(sim);
+    return true;
+}
+
+// lets the writer drain the ring, then joins it and closes the file
+void telemetry_stop(sim_properties_t* sim) {
+    telemetry_writer_t* writer = sim->telemetry.writer;
+    if (writer == NULL) return;
+    sim->telemetry.writer = NULL;
+
+    mutex_lock(&writer->lock);
+    atomic_storeInt(&writer->stopping, 1);
+    cond_broadcast(&writer->data_ready);
+    mutex_unlock(&writer->lock);
+    thread_join(writer->thread);
+
+    mutex_destroy(&writer->lock);
+    cond_destroy(&writer->data_ready);
+    cond_destroy(&writer->space_ready);
+    telemetry_freeWriter(writer);
+}
+
+// same tolerance as scheduled commands, so a step shortened to end on the sample time counts as on it
+static bool telemetry_isDue(const telemetry_params_t* tp, const double now) {
+    return tp->next_time <= now + 1e-9 * fmax(1.0, fabs(tp->next_time));
+}
+
+// sim time the current step has to end on for an aligned sample, infinity if no step needs shortening
+double telemetry_nextTime(const sim_properties_t* sim) {
+    const telemetry_params_t* tp = &sim->telemetry;
+    if (tp->writer == NULL || !tp->align || tp->every_steps > 0 || tp->interval <= 0.0) return INFINITY;
+    return tp->next_time;
+}
+
+// waits until count slots are free, false if the writer failed in the meantime
+static bool telemetry_waitForSpace(telemetry_writer_t* writer, const int count) {
+    mutex_lock(&writer->lock);
+    atomic_storeInt(&writer->producer_waiting, 1);
+    while (writer->capacity - telemetry_ringFill(writer) < count && !atomic_loadInt(&writer->failed)) {
+        cond_timedwait(&writer->space_ready, &writer->lock, TELEMETRY_WRITER_NAP);
+    }
+    atomic_storeInt(&writer->producer_waiting, 0);
+    mutex_unlock(&writer->lock);
+    return !atomic_loadInt(&writer->failed);
+}
+
+static void telemetry_putSlot(telemetry_writer_t* writer, int* at, const uint64_t value) {
+    writer->slots[(*at)++ & (writer->capacity - 1)] = value;
+}
+
+static void telemetry_putValue(telemetry_writer_t* writer, int* at, const double value) {
+    telemetry_putSlot(writer, at, telemetry_toSlot(value));
+}
+
+static void telemetry_putNames(telemetry_writer_t* writer, int* at, const sim_properties_t* sim, const int bytes) {
+    telemetry_putSlot(writer, at, TELEMETRY_RECORD_NAMES);
+    telemetry_putSlot(writer, at, (uint64_t)(TELEMETRY_RECORD_HEADER + (bytes + 7) / 8));
+    telemetry_putSlot(writer, at, (uint64_t)sim->gb.count);
+    telemetry_putSlot(writer, at, (uint64_t)sim->gs.count);
+    telemetry_putSlot(writer, at, (uint64_t)bytes);
+
+    // names are streamed through an eight byte word so they can be packed across the slots
+    uint8_t word[8] = {0};
+    int filled = 0;
+    for (int i = 0; i < sim->gb.count + sim->gs.count; i++) {
+        const char* name = i < sim->gb.count ? sim->gb.bodies[i].name : sim->gs.spacecraft[i - sim->gb.count].name;
+        const size_t length = strlen(name) + 1;
+        for (size_t c = 0; c < length; c++) {
+            word[filled++] = (uint8_t)name[c];
+            if (filled == 8) {
+                uint64_t slot;
+                memcpy(&slot, word, 8);
+                telemetry_putSlot(writer, at, slot);
+                memset(word, 0, sizeof(word));
+                filled = 0;
+            }
+        }
+    }
+    if (filled > 0) {
+        uint64_t slot;
+        memcpy(&slot, word, 8);
+        telemetry_putSlot(writer, at, slot);
+    }
+}
+
+// physics thread, after a step: hands the state to the writer if a sample is due
+void telemetry_sample(sim_properties_t* sim) {
+    telemetry_params_t* tp = &sim->telemetry;
+    if (tp->writer == NULL) return;
+    if (tp->every_steps > 0) {
+        if (++tp->step_counter % tp->every_steps != 0) return;
+    }
+    else if (!telemetry_isDue(tp, sim->wp.sim_time)) return;
+    telemetry_sampleNow(sim);
+}
+
+// copies the state of every body and craft into the ring, the disk is never touched here and a full ring is
+// handled by the policy
+void telemetry_sampleNow(sim_properties_t* sim) {
+    telemetry_params_t* tp = &sim->telemetry;
+    telemetry_writer_t* writer = tp->writer;
+    if (writer == NULL) return;
+    const double now = sim->wp.sim_time;
+
+    if (atomic_loadInt(&writer->failed)) {
+        telemetry_stop(sim);
+        displayError("ERROR", "Writing telemetry failed, logging stopped");
+        return;
+    }
+    craft_publishAdaptive(sim); // adaptive craft are recorded at the sample time, not at their own
+
+    // next multiple of the interval, so the cadence does not drift with the step size
+    tp->next_time = tp->interval > 0.0 ? (floor(now / tp->interval + 1e-9) + 1.0) * tp->interval : now;
+    tp->last_time = now;
+
+    const body_soa_t* soa = &sim->gb.soa;
+    const int bodies = sim->gb.count;
+    const int craft = sim->gs.count;
+    if (bodies == 0) return;
+
+    if (tp->policy == TELEMETRY_DECIMATE) {
+        if (tp->decimation_phase++ % tp->decimation != 0) {
+            tp->decimated++;
+            return;
+        }
+    }
+    else {
+        tp->decimation = 1;
+    }
+
+    // the writer gets the names again whenever the objects may have changed
+    const bool names_changed = !writer->names_sent || bodies != writer->names_bodies || craft != writer->names_craft ||
+                               sim->wp.reset_count != writer->names_reset;
+    const int name_bytes = names_changed ? telemetry_namesSize(sim) : 0;
+    const int sample_slots = telemetry_sampleSlots(sim);
+    const int needed = sample_slots + (names_changed ? TELEMETRY_RECORD_HEADER + (name_bytes + 7) / 8 : 0);
+
+    int fill = telemetry_ringFill(writer);
+    if (needed > writer->capacity - fill) {
+        if (tp->policy == TELEMETRY_BLOCK && needed <= writer->capacity) {
+            tp->blocked++;
+            if (!telemetry_waitForSpace(writer, needed)) return; // reported at the next sample
+            fill = telemetry_ringFill(writer);
+        }
+        else {
+            tp->dropped++;
+            if (tp->policy == TELEMETRY_DECIMATE && tp->decimation < TELEMETRY_MAX_DECIMATION) {
+                tp->decimation *= 2;
+                tp->decimation_phase = 1;
+            }
+            return;
+        }
+    }
+    else if (tp->policy == TELEMETRY_DECIMATE && tp->decimation > 1 && fill < writer->capacity / 4) {
+        tp->decimation /= 2; // the writer caught up
+    }
+
+    const int tail = writer->tail; // only this thread writes tail
+    int at = tail;
+    if (names_changed) {
+        telemetry_putNames(writer, &at, sim, name_bytes);
+        writer->names_sent = true;
+        writer->names_bodies = bodies;
+        writer->names_craft = craft;
+        writer->names_reset = sim->wp.reset_count;
+    }
+
+    telemetry_putSlot(writer, &at, TELEMETRY_RECORD_SAMPLE);
+    telemetry_putSlot(writer, &at, (uint64_t)sample_slots);
+    telemetry_putValue(writer, &at, now);
+    telemetry_putSlot(writer, &at, (uint64_t)bodies);
+    telemetry_putSlot(writer, &at, (uint64_t)craft);
+    for (int i = 0; i < bodies; i++) {
+        telemetry_putValue(writer, &at, soa->pos_x[i]);
+        telemetry_putValue(writer, &at, soa->pos_y[i]);
+        telemetry_putValue(writer, &at, soa->pos_z[i]);
+        telemetry_putValue(writer, &at, soa->vel_x[i]);
+        telemetry_putValue(writer, &at, soa->vel_y[i]);
+        telemetry_putValue(writer, &at, soa->vel_z[i]);
+        telemetry_putValue(writer, &at, soa->acc_x[i]);
+        telemetry_putValue(writer, &at, soa->acc_y[i]);
+        telemetry_putValue(writer, &at, soa->acc_z[i]);
+    }
+    for (int i = 0; i < craft; i++) {
+        const spacecraft_t* c = &sim->gs.spacecraft[i];
+        telemetry_putValue(writer, &at, c->pos.x);
+        telemetry_putValue(writer, &at, c->pos.y);
+        telemetry_putValue(writer, &at, c->pos.z);
+        telemetry_putValue(writer, &at, c->vel.x);
+        telemetry_putValue(writer, &at, c->vel.y);
+        telemetry_putValue(writer, &at, c->vel.z);
+    }
+
+    // the release store publishes the whole sample (and its names) at once
+    atomic_storeInt(&writer->tail, at & telemetry_indexMask(writer));
+    tp->samples++;
+
+    if (atomic_loadInt(&writer->writer_idle)) {
+        mutex_lock(&writer->lock);
+        cond_broadcast(&writer->data_ready);
+        mutex_unlock(&writer->lock);
+    }
+}
+
+bool telemetry_parsePolicy(const char* name, telemetry_policy_t* policy) {
+    if (strcmp(name, "block") == 0) *policy = TELEMETRY_BLOCK;
+    else if (strcmp(name, "drop") == 0) *policy = TELEMETRY_DROP;
+    else if (strcmp(name, "decimate") == 0) *policy = TELEMETRY_DECIMATE;
+    else return false;
+    return true;
+}
 
-        fwrite(&gd, sizeof(gd), 1, filenames.global_data_FILE);
+const char* telemetry_policyName(const telemetry_policy_t policy) {
+    switch (policy) {
+        case TELEMETRY_BLOCK: return "block";
+        case TELEMETRY_DROP: return "drop";
+        case TELEMETRY_DECIMATE: return "decimate";
     }
+    return "unknown";
 }
@@ -6,7 +6,61 @@
 #define ORBITSIMULATION_TELEMETRY_EXPORT_H
 
 #include "../types.h"
+#include "sim_thread.h"
+#include "telemetry_format.h"
 
-void exportTelemetryBinary(binary_filenames_t filenames, const sim_properties_t* sim);
+#define TELEMETRY_RING_SLOTS (1 << 20) // default ring size in slots (power of two)
+#define TELEMETRY_MAX_DECIMATION 1024
+#define TELEMETRY_DEFAULT_FILENAME "telemetry.bin"
+#define TELEMETRY_BLOCK_SAMPLES 256         // samples per block of the file
+#define TELEMETRY_BLOCK_BYTES (16 << 20)    // unpacked size limit of a block (fewer samples when there are many objects)
 
-#endif //ORBITSIMULATION_TELEMETRY_EXPORT_H
\ No newline at end of file
+// ring of 64 bit slots between the physics thread (producer) and the writer thread (consumer)
+// head and tail count modulo twice the capacity like the command queue. the physics thread copies raw
+// records in (a sample, or the object names whenever the set of objects changed) and publishes each
+// one whole, the writer thread gathers the samples into blocks and does all the packing and the disk io
+struct telemetry_writer {
+    uint64_t* slots;         // raw bit patterns (names are packed eight bytes to a slot)
+    int capacity;            // power of two
+    volatile int head;       // next slot to read, only advanced by the writer thread
+    volatile int tail;       // next free slot, only advanced by the physics thread
+
+    // physics thread only: the object set the writer last got names for
+    int names_bodies, names_craft, names_reset;
+    bool names_sent;
+
+    // writer thread only
+    FILE* file;
+    char* file_buffer;       // large stdio buffer so the disk sees big sequential writes
+    uint64_t file_offset;
+    char* names;             // body names then craft names of the current block, NUL terminated
+    int names_size, body_count, craft_count;
+    double* block;           // current block unpacked, channel after channel, block_capacity samples per column
+    int block_capacity, block_samples;
+    double block_started;    // wall clock time of the first sample, partial blocks are written after a while
+    uint8_t* packed;         // packed block on its way to the file
+    size_t packed_capacity;
+    telemetry_index_entry_t* index;
+    int index_count, index_capacity;
+
+    thread_t thread;
+    mutex_t lock;            // only guards the sleeps below
+    cond_t data_ready;       // physics -> writer
+    cond_t space_ready;      // writer -> physics (block policy)
+    volatile int writer_idle;
+    volatile int producer_waiting;
+    volatile int stopping;
+    volatile int failed;     // set by the writer when a write or an allocation fails
+};
+
+telemetry_params_t telemetry_defaultParams(void);
+bool telemetry_start(sim_properties_t* sim, const char* path);
+void telemetry_stop(sim_properties_t* sim);
+void telemetry_sample(sim_properties_t* sim);
+void telemetry_sampleNow(sim_properties_t* sim);
+double telemetry_nextTime(const sim_properties_t* sim);
+int telemetry_ringFill(telemetry_writer_t* writer);
+bool telemetry_parsePolicy(const char* name, telemetry_policy_t* policy);
+const char* telemetry_policyName(telemetry_policy_t policy);
+
+#endif //ORBITSIMULATION_TELEMETRY_EXPORT_H
@@ -0,0 +1,267 @@
+#include "telemetry_format.h"
+#include <string.h>
+
+// every column (one object over time) is packed on its own: the next value is predicted by extrapolating
+// a polynomial through the previous ones, and only the residual is stored. the residual is zigzag folded
+// and written with just its significant bytes, the byte counts of two values share one control byte.
+// the encoder tries every polynomial order up to TELEMETRY_MAX_ORDER and keeps the cheapest for the
+// column (stored in the first byte), smooth orbits usually end up with order 4 or 5
+//
+// the prediction runs on the integer bit patterns instead of doubles so encoder and decoder agree
+// exactly whatever the compiler does with floating point
+
+#define TELEMETRY_MAX_ORDER 5
+
+// extrapolation weights of the previous values, newest first (rows of the binomial coefficients with alternating sign)
+static const int64_t telemetry_weights[TELEMETRY_MAX_ORDER + 1][TELEMETRY_MAX_ORDER] = {
+    {0, 0, 0, 0, 0},
+    {1, 0, 0, 0, 0},
+    {2, -1, 0, 0, 0},
+    {3, -3, 1, 0, 0},
+    {4, -6, 4, -1, 0},
+    {5, -10, 10, -5, 1},
+};
+
+static const char* const telemetry_channel_names[TELEMETRY_CHANNEL_COUNT] = {
+    "time",
+    "body.pos.x", "body.pos.y", "body.pos.z",
+    "body.vel.x", "body.vel.y", "body.vel.z",
+    "body.acc.x", "body.acc.y", "body.acc.z",
+    "craft.pos.x", "craft.pos.y", "craft.pos.z",
+    "craft.vel.x", "craft.vel.y", "craft.vel.z",
+};
+
+// number of columns (objects) the channel has in a block
+int telemetry_channelColumns(const telemetry_channel_t channel, const uint32_t body_count, const uint32_t craft_count) {
+    if (channel == TELEMETRY_CH_TIME) return 1;
+    if (channel <= TELEMETRY_CH_BODY_ACC_Z) return (int)body_count;
+    return (int)craft_count;
+}
+
+const char* telemetry_channelName(const telemetry_channel_t channel) {
+    return channel >= 0 && channel < TELEMETRY_CHANNEL_COUNT ? telemetry_channel_names[channel] : "unknown";
+}
+
+bool telemetry_parseChannel(const char* name, telemetry_channel_t* channel) {
+    for (int i = 0; i < TELEMETRY_CHANNEL_COUNT; i++) {
+        if (strcmp(name, telemetry_channel_names[i]) == 0) {
+            *channel = (telemetry_channel_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t telemetry_bits(const double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double telemetry_double(const uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// bytes needed to store v without its leading zero bytes
+static int telemetry_significantBytes(uint64_t v) {
+    int n = 0;
+    while (v != 0) {
+        v >>= 8;
+        n++;
+    }
+    return n;
+}
+
+// predicted bit pattern of sample s from history (newest first), using at most order previous values
+static uint64_t telemetry_predict(const uint64_t* history, const int s, const int order) {
+    const int k = s < order ? s : order;
+    uint64_t predicted = 0;
+    for (int j = 0; j < k; j++) predicted += (uint64_t)telemetry_weights[k][j] * history[j]; // wraps, undone exactly by the decoder
+    return predicted;
+}
+
+static void telemetry_remember(uint64_t* history, const uint64_t bits) {
+    for (int j = TELEMETRY_MAX_ORDER - 1; j > 0; j--) history[j] = history[j - 1];
+    history[0] = bits;
+}
+
+static uint64_t telemetry_fold(const uint64_t delta) {
+    return (delta << 1) ^ (uint64_t)-(int64_t)(delta >> 63); // zigzag: small negative -> small positive
+}
+
+static uint64_t telemetry_unfold(const uint64_t folded) {
+    return (folded >> 1) ^ (uint64_t)-(int64_t)(folded & 1);
+}
+
+// residual bytes one column would take with the given order
+static size_t telemetry_columnCost(const double* values, const int samples, const int order) {
+    uint64_t history[TELEMETRY_MAX_ORDER] = {0};
+    size_t cost = 0;
+    for (int s = 0; s < samples; s++) {
+        const uint64_t bits = telemetry_bits(values[s]);
+        cost += (size_t)telemetry_significantBytes(telemetry_fold(bits - telemetry_predict(history, s, order)));
+        telemetry_remember(history, bits);
+    }
+    return cost;
+}
+
+// worst case packed size of value_count values in columns columns
+size_t telemetry_encodeBound(const size_t value_count, const size_t columns) {
+    return value_count * 8 + (value_count + 1) / 2 + 2 * columns;
+}
+
+// packs columns * samples values into out, returns the packed size (sample s of column c is values[c * stride + s])
+size_t telemetry_encodeColumns(const double* values, const int columns, const int samples, const size_t stride, uint8_t* out) {
+    uint8_t* p = out;
+    for (int c = 0; c < columns; c++) {
+        const double* column = values + (size_t)c * stride;
+        int order = 0;
+        size_t best = telemetry_columnCost(column, samples, 0);
+        for (int k = 1; k <= TELEMETRY_MAX_ORDER && samples > 1; k++) {
+            const size_t cost = telemetry_columnCost(column, samples, k);
+            if (cost < best) {
+                best = cost;
+                order = k;
+            }
+        }
+        *p++ = (uint8_t)order;
+
+        uint64_t history[TELEMETRY_MAX_ORDER] = {0};
+        uint8_t* control = NULL;
+        for (int s = 0; s < samples; s++) {
+            const uint64_t bits = telemetry_bits(column[s]);
+            const uint64_t folded = telemetry_fold(bits - telemetry_predict(history, s, order));
+            const int n = telemetry_significantBytes(folded);
+            if ((s & 1) == 0) {
+                control = p++;
+                *control = (uint8_t)n;
+            }
+            else *control |= (uint8_t)(n << 4);
+            for (int b = 0; b < n; b++) *p++ = (uint8_t)(folded >> (8 * b));
+            telemetry_remember(history, bits);
+        }
+    }
+    return (size_t)(p - out);
+}
+
+// decodes one packed column at *p, false if the data is cut short or corrupt
+static bool telemetry_decodeOne(const uint8_t** p, const uint8_t* end, const int samples, double* values) {
+    if (*p >= end) return false;
+    const int order = *(*p)++;
+    if (order > TELEMETRY_MAX_ORDER) return false;
+
+    uint64_t history[TELEMETRY_MAX_ORDER] = {0};
+    uint8_t control = 0;
+    for (int s = 0; s < samples; s++) {
+        int n;
+        if ((s & 1) == 0) {
+            if (*p >= end) return false;
+            control = *(*p)++;
+            n = control & 15;
+        }
+        else n = control >> 4;
+        if (n > 8 || end - *p < n) return false;
+
+        uint64_t folded = 0;
+        for (int b = 0; b < n; b++) folded |= (uint64_t)*(*p)++ << (8 * b);
+        const uint64_t bits = telemetry_unfold(folded) + telemetry_predict(history, s, order);
+        values[s] = telemetry_double(bits);
+        telemetry_remember(history, bits);
+    }
+    return true;
+}
+
+// inverse of telemetry_encodeColumns, false if the data is cut short or corrupt
+bool telemetry_decodeColumns(const uint8_t* in, const size_t size, const int columns, const int samples, double* values) {
+    const uint8_t* p = in;
+    const uint8_t* end = in + size;
+    for (int c = 0; c < columns; c++) {
+        if (!telemetry_decodeOne(&p, end, samples, values + (size_t)c * samples)) return false;
+    }
+    return p == end;
+}
+
+// decodes only column column of a channel: the columns before it are skipped by their control bytes alone
+bool telemetry_decodeColumn(const uint8_t* in, const size_t size, const int column, const int samples, double* values) {
+    const uint8_t* p = in;
+    const uint8_t* end = in + size;
+    for (int c = 0; c < column; c++) {
+        p++; // order
+        for (int s = 0; s < samples; s += 2) {
+            if (p >= end) return false;
+            const uint8_t control = *p++;
+            p += (control & 15) + (s + 1 < samples ? control >> 4 : 0);
+        }
+        if (p > end) return false;
+    }
+    return telemetry_decodeOne(&p, end, samples, values);
+}
+
+void telemetry_writeFileHeader(uint8_t* out, const uint32_t block_samples) {
+    memset(out, 0, TELEMETRY_FILE_HEADER_SIZE);
+    memcpy(out, TELEMETRY_FILE_MAGIC, 8);
+    telemetry_put32(out + 8, TELEMETRY_FORMAT_VERSION);
+    telemetry_put32(out + 12, TELEMETRY_FILE_HEADER_SIZE);
+    telemetry_put32(out + 16, TELEMETRY_CHANNEL_COUNT);
+    telemetry_put32(out + 20, block_samples);
+}
+
+// false if this is not a telemetry file this version can read
+bool telemetry_readFileHeader(const uint8_t* in, const size_t size) {
+    if (size < TELEMETRY_FILE_HEADER_SIZE || memcmp(in, TELEMETRY_FILE_MAGIC, 8) != 0) return false;
+    return telemetry_get32(in + 8) == TELEMETRY_FORMAT_VERSION && telemetry_get32(in + 16) == TELEMETRY_CHANNEL_COUNT;
+}
+
+void telemetry_writeBlockHeader(uint8_t* out, const telemetry_block_header_t* header) {
+    telemetry_put32(out, TELEMETRY_BLOCK_MAGIC);
+    telemetry_put32(out + 4, header->header_size);
+    telemetry_put64(out + 8, header->block_size);
+    telemetry_put64(out + 16, telemetry_bits(header->t_first));
+    telemetry_put64(out + 24, telemetry_bits(header->t_last));
+    telemetry_put32(out + 32, header->sample_count);
+    telemetry_put32(out + 36, header->body_count);
+    telemetry_put32(out + 40, header->craft_count);
+    telemetry_put32(out + 44, header->names_size);
+    for (int i = 0; i < TELEMETRY_CHANNEL_COUNT; i++) {
+        telemetry_put64(out + TELEMETRY_BLOCK_FIXED_SIZE + 16 * i, header->channel_offset[i]);
+        telemetry_put64(out + TELEMETRY_BLOCK_FIXED_SIZE + 16 * i + 8, header->channel_size[i]);
+    }
+}
+
+// false if in does not start with a complete, consistent block header
+bool telemetry_readBlockHeader(const uint8_t* in, const size_t size, telemetry_block_header_t* header) {
+    if (size < TELEMETRY_BLOCK_HEADER_SIZE || telemetry_get32(in) != TELEMETRY_BLOCK_MAGIC) return false;
+    header->header_size = telemetry_get32(in + 4);
+    header->block_size = telemetry_get64(in + 8);
+    header->t_first = telemetry_double(telemetry_get64(in + 16));
+    header->t_last = telemetry_double(telemetry_get64(in + 24));
+    header->sample_count = telemetry_get32(in + 32);
+    header->body_count = telemetry_get32(in + 36);
+    header->craft_count = telemetry_get32(in + 40);
+    header->names_size = telemetry_get32(in + 44);
+    if (header->header_size != TELEMETRY_BLOCK_HEADER_SIZE || header->block_size < header->header_size + header->names_size) return false;
+
+    for (int i = 0; i < TELEMETRY_CHANNEL_COUNT; i++) {
+        header->channel_offset[i] = telemetry_get64(in + TELEMETRY_BLOCK_FIXED_SIZE + 16 * i);
+        header->channel_size[i] = telemetry_get64(in + TELEMETRY_BLOCK_FIXED_SIZE + 16 * i + 8);
+        if (header->channel_offset[i] > header->block_size || header->channel_size[i] > header->block_size - header->channel_offset[i]) return false;
+    }
+    return true;
+}
+
+void telemetry_writeIndexEntry(uint8_t* out, const telemetry_index_entry_t* entry) {
+    telemetry_put64(out, telemetry_bits(entry->t_first));
+    telemetry_put64(out + 8, telemetry_bits(entry->t_last));
+    telemetry_put64(out + 16, entry->offset);
+    telemetry_put32(out + 24, entry->sample_count);
+    telemetry_put32(out + 28, 0);
+}
+
+void telemetry_readIndexEntry(const uint8_t* in, telemetry_index_entry_t* entry) {
+    entry->t_first = telemetry_double(telemetry_get64(in));
+    entry->t_last = telemetry_double(telemetry_get64(in + 8));
+    entry->offset = telemetry_get64(in + 16);
+    entry->sample_count = telemetry_get32(in + 24);
+}
@@ -0,0 +1,103 @@
+#ifndef TELEMETRY_FORMAT_H
+#define TELEMETRY_FORMAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// columnar telemetry file, version 1 (every field little endian)
+//
+//   file header   TELEMETRY_FILE_HEADER_SIZE bytes: magic, version, header size, channel count, nominal samples per block
+//   blocks        one after the other, each self describing (a reader can walk them without the index)
+//   index         one entry per block mapping its sim time range to its file offset
+//   trailer       offset of the index + index magic, missing if the writer never finished (walk the blocks instead)
+//
+// a block holds up to a few hundred samples of one set of objects: fixed header, a table with the offset
+// and size of every channel, the object names, then the channels, each one a separately packed column
+// so one channel can be read without touching the others
+
+#define TELEMETRY_FORMAT_VERSION 1
+#define TELEMETRY_FILE_MAGIC "ORBITTLM"
+#define TELEMETRY_INDEX_MAGIC "ORBITIDX"
+#define TELEMETRY_BLOCK_MAGIC 0x4B4C4254u // "TBLK"
+#define TELEMETRY_INDEX_ENTRY_MAGIC 0x58444954u // "TIDX"
+
+#define TELEMETRY_FILE_HEADER_SIZE 32
+#define TELEMETRY_BLOCK_FIXED_SIZE 48
+#define TELEMETRY_BLOCK_HEADER_SIZE (TELEMETRY_BLOCK_FIXED_SIZE + 16 * TELEMETRY_CHANNEL_COUNT)
+#define TELEMETRY_INDEX_HEADER_SIZE 16
+#define TELEMETRY_INDEX_ENTRY_SIZE 32
+#define TELEMETRY_TRAILER_SIZE 16
+
+// channels of a block, body channels hold body_count columns and craft channels craft_count columns
+// (each column is the time series of one object)
+typedef enum {
+    TELEMETRY_CH_TIME,
+    TELEMETRY_CH_BODY_POS_X, TELEMETRY_CH_BODY_POS_Y, TELEMETRY_CH_BODY_POS_Z,
+    TELEMETRY_CH_BODY_VEL_X, TELEMETRY_CH_BODY_VEL_Y, TELEMETRY_CH_BODY_VEL_Z,
+    TELEMETRY_CH_BODY_ACC_X, TELEMETRY_CH_BODY_ACC_Y, TELEMETRY_CH_BODY_ACC_Z,
+    TELEMETRY_CH_CRAFT_POS_X, TELEMETRY_CH_CRAFT_POS_Y, TELEMETRY_CH_CRAFT_POS_Z,
+    TELEMETRY_CH_CRAFT_VEL_X, TELEMETRY_CH_CRAFT_VEL_Y, TELEMETRY_CH_CRAFT_VEL_Z,
+    TELEMETRY_CHANNEL_COUNT
+} telemetry_channel_t;
+
+#define TELEMETRY_BODY_CHANNELS 9  // channels 1..9
+#define TELEMETRY_CRAFT_CHANNELS 6 // channels 10..15
+
+// decoded block header
+typedef struct {
+    uint64_t block_size;  // bytes, header included
+    double t_first, t_last;
+    uint32_t header_size; // bytes before the names
+    uint32_t sample_count;
+    uint32_t body_count;
+    uint32_t craft_count;
+    uint32_t names_size;  // body names then craft names, each NUL terminated
+    uint64_t channel_offset[TELEMETRY_CHANNEL_COUNT]; // from the start of the block
+    uint64_t channel_size[TELEMETRY_CHANNEL_COUNT];
+} telemetry_block_header_t;
+
+// one entry of the time index
+typedef struct {
+    double t_first, t_last;
+    uint64_t offset;      // file offset of the block
+    uint32_t sample_count;
+} telemetry_index_entry_t;
+
+static inline void telemetry_put32(uint8_t* p, const uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline void telemetry_put64(uint8_t* p, const uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint32_t telemetry_get32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+static inline uint64_t telemetry_get64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+int telemetry_channelColumns(telemetry_channel_t channel, uint32_t body_count, uint32_t craft_count);
+const char* telemetry_channelName(telemetry_channel_t channel);
+bool telemetry_parseChannel(const char* name, telemetry_channel_t* channel);
+
+size_t telemetry_encodeBound(size_t value_count, size_t columns);
+size_t telemetry_encodeColumns(const double* values, int columns, int samples, size_t stride, uint8_t* out);
+bool telemetry_decodeColumns(const uint8_t* in, size_t size, int columns, int samples, double* values);
+bool telemetry_decodeColumn(const uint8_t* in, size_t size, int column, int samples, double* values);
+
+void telemetry_writeFileHeader(uint8_t* out, uint32_t block_samples);
+bool telemetry_readFileHeader(const uint8_t* in, size_t size);
+void telemetry_writeBlockHeader(uint8_t* out, const telemetry_block_header_t* header);
+bool telemetry_readBlockHeader(const uint8_t* in, size_t size, telemetry_block_header_t* header);
+void telemetry_writeIndexEntry(uint8_t* out, const telemetry_index_entry_t* entry);
+void telemetry_readIndexEntry(const uint8_t* in, telemetry_index_entry_t* entry);
+
+#endif
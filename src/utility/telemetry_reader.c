@@ -0,0 +1,296 @@
+#include "telemetry_reader.h"
+#include "error_hook.h"
+#include "mapped_file.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct telemetry_reader {
+    mapped_file_t file;
+    const uint8_t* data; // the whole file, mapped read only
+    size_t size;
+    telemetry_index_entry_t* index;
+    int block_count;
+    bool sorted;         // block times never go back (false if the sim was reset while logging)
+    bool complete;       // the index came from the trailer, otherwise the blocks were walked
+};
+
+// index from the trailer of a finished file
+static bool telemetry_loadIndex(telemetry_reader_t* reader) {
+    const size_t size = reader->size;
+    if (size < TELEMETRY_FILE_HEADER_SIZE + TELEMETRY_INDEX_HEADER_SIZE + TELEMETRY_TRAILER_SIZE) return false;
+    const uint8_t* trailer = reader->data + size - TELEMETRY_TRAILER_SIZE;
+    if (memcmp(trailer + 8, TELEMETRY_INDEX_MAGIC, 8) != 0) return false;
+
+    const uint64_t offset = telemetry_get64(trailer);
+    if (offset < TELEMETRY_FILE_HEADER_SIZE || offset > size - TELEMETRY_TRAILER_SIZE - TELEMETRY_INDEX_HEADER_SIZE) return false;
+    const uint8_t* header = reader->data + offset;
+    const uint64_t count = telemetry_get64(header + 8);
+    if (telemetry_get32(header) != TELEMETRY_INDEX_ENTRY_MAGIC || telemetry_get32(header + 4) != TELEMETRY_INDEX_ENTRY_SIZE ||
+        count > (size - TELEMETRY_TRAILER_SIZE - TELEMETRY_INDEX_HEADER_SIZE - offset) / TELEMETRY_INDEX_ENTRY_SIZE) return false;
+
+    reader->index = (telemetry_index_entry_t*)malloc((count > 0 ? count : 1) * sizeof(telemetry_index_entry_t));
+    if (reader->index == NULL) return false;
+    for (uint64_t i = 0; i < count; i++) {
+        telemetry_readIndexEntry(header + TELEMETRY_INDEX_HEADER_SIZE + i * TELEMETRY_INDEX_ENTRY_SIZE, &reader->index[i]);
+        if (reader->index[i].offset >= offset) {
+            free(reader->index);
+            reader->index = NULL;
+            return false;
+        }
+    }
+    reader->block_count = (int)count;
+    return true;
+}
+
+// no usable trailer (the writer was killed): walk the blocks up to the first incomplete one
+static bool telemetry_walkBlocks(telemetry_reader_t* reader) {
+    int capacity = 256;
+    reader->index = (telemetry_index_entry_t*)malloc((size_t)capacity * sizeof(telemetry_index_entry_t));
+    if (reader->index == NULL) return false;
+
+    uint64_t offset = TELEMETRY_FILE_HEADER_SIZE;
+    telemetry_block_header_t header;
+    while (offset < reader->size && telemetry_readBlockHeader(reader->data + offset, reader->size - offset, &header) &&
+           header.block_size <= reader->size - offset) {
+        if (reader->block_count == capacity) {
+            capacity *= 2;
+            telemetry_index_entry_t* index = (telemetry_index_entry_t*)realloc(reader->index, (size_t)capacity * sizeof(telemetry_index_entry_t));
+            if (index == NULL) return false;
+            reader->index = index;
+        }
+        reader->index[reader->block_count++] = (telemetry_index_entry_t){
+            .t_first = header.t_first,
+            .t_last = header.t_last,
+            .offset = offset,
+            .sample_count = header.sample_count,
+        };
+        offset += header.block_size;
+    }
+    return true;
+}
+
+// maps a telemetry file and loads its time index (NULL if it cannot be read)
+telemetry_reader_t* telemetry_openReader(const char* path) {
+    telemetry_reader_t* reader = (telemetry_reader_t*)calloc(1, sizeof(telemetry_reader_t));
+    if (reader == NULL) {
+        displayError("ERROR", "Failed to allocate memory for the telemetry reader");
+        return NULL;
+    }
+
+    char message[512];
+    if (!mapfile_open(&reader->file, path)) {
+        snprintf(message, sizeof(message), "Could not open telemetry file %s", path);
+        displayError("ERROR", message);
+        telemetry_closeReader(reader);
+        return NULL;
+    }
+    reader->data = reader->file.data;
+    reader->size = reader->file.size;
+    if (!telemetry_readFileHeader(reader->data, reader->size)) {
+        snprintf(message, sizeof(message), "%s is not a version %d telemetry file", path, TELEMETRY_FORMAT_VERSION);
+        displayError("ERROR", message);
+        telemetry_closeReader(reader);
+        return NULL;
+    }
+
+    reader->complete = telemetry_loadIndex(reader);
+    if (!reader->complete && !telemetry_walkBlocks(reader)) {
+        displayError("ERROR", "Failed to allocate memory for the telemetry index");
+        telemetry_closeReader(reader);
+        return NULL;
+    }
+
+    reader->sorted = true;
+    for (int i = 1; i < reader->block_count; i++) {
+        if (reader->index[i].t_first < reader->index[i - 1].t_last) reader->sorted = false;
+    }
+    return reader;
+}
+
+void telemetry_closeReader(telemetry_reader_t* reader) {
+    if (reader == NULL) return;
+    mapfile_close(&reader->file);
+    free(reader->index);
+    free(reader);
+}
+
+int telemetry_readerBlockCount(const telemetry_reader_t* reader) {
+    return reader->block_count;
+}
+
+bool telemetry_readerIsComplete(const telemetry_reader_t* reader) {
+    return reader->complete;
+}
+
+size_t telemetry_readerSize(const telemetry_reader_t* reader) {
+    return reader->size;
+}
+
+const telemetry_index_entry_t* telemetry_readerIndex(const telemetry_reader_t* reader, const int block) {
+    return block >= 0 && block < reader->block_count ? &reader->index[block] : NULL;
+}
+
+// header of a block and a pointer to its names inside the mapping (body names then craft names)
+bool telemetry_readerBlock(const telemetry_reader_t* reader, const int block, telemetry_block_header_t* header, const char** names) {
+    if (block < 0 || block >= reader->block_count) return false;
+    const uint64_t offset = reader->index[block].offset;
+    if (!telemetry_readBlockHeader(reader->data + offset, reader->size - offset, header) || header->block_size > reader->size - offset) return false;
+    if (header->names_size > 0 && reader->data[offset + header->header_size + header->names_size - 1] != '\0') return false;
+    if (names != NULL) *names = (const char*)reader->data + offset + header->header_size;
+    return true;
+}
+
+// column of the named object in a block's channel, -1 if the object is not in the block
+static int telemetry_findColumn(const telemetry_block_header_t* header, const char* names, const telemetry_query_t* query) {
+    if (query->channel == TELEMETRY_CH_TIME) return 0;
+    const bool craft = query->channel >= TELEMETRY_CH_CRAFT_POS_X;
+    const char* name = names;
+    for (uint32_t i = 0; i < header->body_count + header->craft_count; i++) {
+        if ((i >= header->body_count) == craft && strcmp(name, query->object) == 0) {
+            return (int)(craft ? i - header->body_count : i);
+        }
+        name += strlen(name) + 1;
+    }
+    return -1;
+}
+
+// min/max bucket state of a decimated query
+typedef struct {
+    telemetry_point_fn fn;
+    void* user;
+    long long emitted;
+    long long bucket;
+    bool open;
+    double min_t, min_v, max_t, max_v;
+} telemetry_decimator_t;
+
+static void telemetry_emit(telemetry_decimator_t* d, const double t, const double v) {
+    d->fn(t, v, d->user);
+    d->emitted++;
+}
+
+static void telemetry_closeBucket(telemetry_decimator_t* d) {
+    if (!d->open) return;
+    d->open = false;
+    if (d->min_t == d->max_t) telemetry_emit(d, d->min_t, d->min_v);
+    else if (d->min_t < d->max_t) {
+        telemetry_emit(d, d->min_t, d->min_v);
+        telemetry_emit(d, d->max_t, d->max_v);
+    }
+    else {
+        telemetry_emit(d, d->max_t, d->max_v);
+        telemetry_emit(d, d->min_t, d->min_v);
+    }
+}
+
+// streams the samples of one object and channel in [from, to] to fn, returns the number of points, -1 if the
+// file is corrupt. only blocks overlapping the range are decoded, and of those only the time column and the
+// one column asked for
+long long telemetry_query(const telemetry_reader_t* reader, const telemetry_query_t* query, const telemetry_point_fn fn, void* user) {
+    if (query->channel < 0 || query->channel >= TELEMETRY_CHANNEL_COUNT || reader->block_count == 0) return 0;
+
+    // first block that can overlap the range
+    int first = 0;
+    if (reader->sorted) {
+        int lo = 0, hi = reader->block_count;
+        while (lo < hi) {
+            const int mid = (lo + hi) / 2;
+            if (reader->index[mid].t_last < query->from) lo = mid + 1;
+            else hi = mid;
+        }
+        first = lo;
+    }
+
+    // buckets cover the part of the range that has data
+    double from = query->from, to = query->to;
+    double data_first = INFINITY, data_last = -INFINITY;
+    for (int b = 0; b < reader->block_count; b++) {
+        data_first = fmin(data_first, reader->index[b].t_first);
+        data_last = fmax(data_last, reader->index[b].t_last);
+    }
+    from = fmax(from, data_first);
+    to = fmin(to, data_last);
+    const long long buckets = query->max_points >= 2 ? query->max_points / 2 : 0;
+    const double width = buckets > 0 && to > from ? (to - from) / (double)buckets : 0.0;
+
+    telemetry_decimator_t d = {.fn = fn, .user = user, .bucket = -1};
+    double* times = NULL;
+    double* values = NULL;
+    uint32_t scratch = 0;
+    long long result = 0;
+
+    for (int b = first; b < reader->block_count; b++) {
+        const telemetry_index_entry_t* entry = &reader->index[b];
+        if (entry->t_first > query->to) {
+            if (reader->sorted) break;
+            continue;
+        }
+        if (entry->t_last < query->from) continue;
+
+        telemetry_block_header_t header;
+        const char* names;
+        if (!telemetry_readerBlock(reader, b, &header, &names)) {
+            result = -1;
+            break;
+        }
+        const int column = telemetry_findColumn(&header, names, query);
+        if (column < 0 || header.sample_count == 0) continue;
+
+        if (header.sample_count > scratch) {
+            double* t = (double*)realloc(times, header.sample_count * sizeof(double));
+            if (t != NULL) times = t;
+            double* v = t != NULL ? (double*)realloc(values, header.sample_count * sizeof(double)) : NULL;
+            if (v == NULL) {
+                result = -1;
+                break;
+            }
+            values = v;
+            scratch = header.sample_count;
+        }
+
+        const uint8_t* block = reader->data + entry->offset;
+        const int samples = (int)header.sample_count;
+        if (!telemetry_decodeColumn(block + header.channel_offset[TELEMETRY_CH_TIME], header.channel_size[TELEMETRY_CH_TIME], 0, samples, times) ||
+            !telemetry_decodeColumn(block + header.channel_offset[query->channel], header.channel_size[query->channel], column, samples, values)) {
+            result = -1;
+            break;
+        }
+
+        for (int s = 0; s < samples; s++) {
+            const double t = times[s];
+            const double v = values[s];
+            if (t < query->from || t > query->to) continue;
+            if (width <= 0.0) {
+                telemetry_emit(&d, t, v);
+                continue;
+            }
+
+            long long bucket = (long long)((t - from) / width);
+            if (bucket >= buckets) bucket = buckets - 1;
+            if (bucket != d.bucket) {
+                telemetry_closeBucket(&d);
+                d.bucket = bucket;
+            }
+            if (!d.open) {
+                d.open = true;
+                d.min_t = d.max_t = t;
+                d.min_v = d.max_v = v;
+            }
+            else if (v < d.min_v) {
+                d.min_t = t;
+                d.min_v = v;
+            }
+            else if (v > d.max_v) {
+                d.max_t = t;
+                d.max_v = v;
+            }
+        }
+    }
+    telemetry_closeBucket(&d);
+
+    free(times);
+    free(values);
+    return result < 0 ? -1 : d.emitted;
+}
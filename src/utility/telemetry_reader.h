@@ -0,0 +1,34 @@
+#ifndef TELEMETRY_READER_H
+#define TELEMETRY_READER_H
+
+#include "telemetry_format.h"
+
+// read side of the telemetry format: the file is memory mapped and blocks are decoded straight out of
+// the mapping, only the blocks a query overlaps (found through the time index) are touched
+
+typedef struct telemetry_reader telemetry_reader_t;
+
+// one series to read
+typedef struct {
+    const char* object;          // body or craft name (the channel says which), ignored for the time channel
+    telemetry_channel_t channel;
+    double from, to;             // sim time range, both ends included
+    int max_points;              // 0 = every sample, otherwise the range is cut into max_points / 2 buckets and the
+                                 // lowest and highest sample of each bucket are kept (peaks survive for plots)
+} telemetry_query_t;
+
+// receives the points of a query in time order
+typedef void (*telemetry_point_fn)(double time, double value, void* user);
+
+telemetry_reader_t* telemetry_openReader(const char* path);
+void telemetry_closeReader(telemetry_reader_t* reader);
+
+int telemetry_readerBlockCount(const telemetry_reader_t* reader);
+bool telemetry_readerIsComplete(const telemetry_reader_t* reader);
+size_t telemetry_readerSize(const telemetry_reader_t* reader);
+const telemetry_index_entry_t* telemetry_readerIndex(const telemetry_reader_t* reader, int block);
+bool telemetry_readerBlock(const telemetry_reader_t* reader, int block, telemetry_block_header_t* header, const char** names);
+
+long long telemetry_query(const telemetry_reader_t* reader, const telemetry_query_t* query, telemetry_point_fn fn, void* user);
+
+#endif
@@ -0,0 +1,327 @@
+#include "telemetry_replay.h"
+#include "error_hook.h"
+#include "../math/matrix.h"
+#include "../sim/spacecraft.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TELEMETRY_REPLAY_RADIUS 1e6 // radius of bodies the loaded scenario does not know (m)
+
+// decodes a block into the cache (or finds it there), NULL if the block is corrupt or memory runs out
+static telemetry_replay_block_t* telemetry_replayLoad(telemetry_replay_t* replay, const int block) {
+    for (int k = 0; k < 2; k++) {
+        if (replay->cache[k].block == block) {
+            replay->cache[k].used = ++replay->uses;
+            return &replay->cache[k];
+        }
+    }
+
+    telemetry_replay_block_t* slot = replay->cache[0].used <= replay->cache[1].used ? &replay->cache[0] : &replay->cache[1];
+    slot->block = -1;
+    if (!telemetry_readerBlock(replay->reader, block, &slot->header, &slot->names)) return NULL;
+    const uint8_t* data = (const uint8_t*)slot->names - slot->header.header_size; // the names follow the block header
+    const int samples = (int)slot->header.sample_count;
+
+    for (int ch = 0; ch < TELEMETRY_CHANNEL_COUNT; ch++) {
+        if (ch >= TELEMETRY_CH_BODY_ACC_X && ch <= TELEMETRY_CH_BODY_ACC_Z) continue; // not drawn
+        const int columns = telemetry_channelColumns((telemetry_channel_t)ch, slot->header.body_count, slot->header.craft_count);
+        const int needed = columns * samples;
+        if (needed > slot->capacity[ch]) {
+            double* temp = (double*)realloc(slot->values[ch], (size_t)needed * sizeof(double));
+            if (temp == NULL) return NULL;
+            slot->values[ch] = temp;
+            slot->capacity[ch] = needed;
+        }
+        if (!telemetry_decodeColumns(data + slot->header.channel_offset[ch], slot->header.channel_size[ch], columns, samples, slot->values[ch])) {
+            return NULL;
+        }
+    }
+
+    slot->block = block;
+    slot->used = ++replay->uses;
+    return slot;
+}
+
+// maps a telemetry file for replay, paused at its first sample (NULL if it cannot be read)
+telemetry_replay_t* telemetry_openReplay(const char* path) {
+    telemetry_reader_t* reader = telemetry_openReader(path);
+    if (reader == NULL) return NULL;
+    const int blocks = telemetry_readerBlockCount(reader);
+    if (blocks == 0) {
+        displayError("ERROR", "The telemetry file has no samples to replay");
+        telemetry_closeReader(reader);
+        return NULL;
+    }
+
+    telemetry_replay_t* replay = (telemetry_replay_t*)calloc(1, sizeof(telemetry_replay_t));
+    if (replay == NULL) {
+        displayError("ERROR", "Failed to allocate memory for the telemetry replay");
+        telemetry_closeReader(reader);
+        return NULL;
+    }
+    replay->reader = reader;
+    replay->cache[0].block = -1;
+    replay->cache[1].block = -1;
+
+    replay->t_first = INFINITY;
+    replay->t_last = -INFINITY;
+    replay->sorted = true;
+    for (int b = 0; b < blocks; b++) {
+        const telemetry_index_entry_t* entry = telemetry_readerIndex(reader, b);
+        replay->t_first = fmin(replay->t_first, entry->t_first);
+        replay->t_last = fmax(replay->t_last, entry->t_last);
+        if (b > 0 && entry->t_first < telemetry_readerIndex(reader, b - 1)->t_last) replay->sorted = false;
+    }
+
+    replay->speed = (replay->t_last - replay->t_first) / TELEMETRY_REPLAY_SECONDS;
+    if (replay->speed <= 0.0) replay->speed = 1.0;
+    replay->time = telemetry_readerIndex(reader, 0)->t_first;
+    return replay;
+}
+
+void telemetry_closeReplay(telemetry_replay_t* replay) {
+    if (replay == NULL) return;
+    for (int k = 0; k < 2; k++) {
+        for (int ch = 0; ch < TELEMETRY_CHANNEL_COUNT; ch++) free(replay->cache[k].values[ch]);
+    }
+    free(replay->bodies);
+    free(replay->spacecraft);
+    free(replay->templates);
+    telemetry_closeReader(replay->reader);
+    free(replay);
+}
+
+// moves the clock to a sim time through the index (the first run of it if the sim was reset while logging)
+void telemetry_replaySeek(telemetry_replay_t* replay, double time) {
+    const int blocks = telemetry_readerBlockCount(replay->reader);
+    time = fmax(replay->t_first, fmin(replay->t_last, time));
+
+    int block = blocks - 1;
+    if (replay->sorted) {
+        int lo = 0, hi = blocks - 1;
+        while (lo < hi) {
+            const int mid = (lo + hi) / 2;
+            if (telemetry_readerIndex(replay->reader, mid)->t_last < time) lo = mid + 1;
+            else hi = mid;
+        }
+        block = lo;
+    }
+    else {
+        for (int b = 0; b < blocks; b++) {
+            if (telemetry_readerIndex(replay->reader, b)->t_last >= time) {
+                block = b;
+                break;
+            }
+        }
+    }
+
+    // before the first block of a run there is nothing to interpolate from
+    const telemetry_index_entry_t* entry = telemetry_readerIndex(replay->reader, block);
+    const bool run_start = block == 0 || telemetry_readerIndex(replay->reader, block - 1)->t_last > entry->t_first;
+    if (run_start && time < entry->t_first) time = entry->t_first;
+    if (time > entry->t_last) time = entry->t_last;
+
+    replay->block = block;
+    replay->time = time;
+    replay->jumps++;
+}
+
+// moves the clock by the wall time since the last frame, stops at the end of the file
+void telemetry_replayAdvance(telemetry_replay_t* replay, const double wall_seconds) {
+    if (!replay->playing || wall_seconds <= 0.0) return;
+    replay->time += replay->speed * wall_seconds;
+
+    const int blocks = telemetry_readerBlockCount(replay->reader);
+    while (true) {
+        const telemetry_index_entry_t* entry = telemetry_readerIndex(replay->reader, replay->block);
+        if (replay->time <= entry->t_last) break;
+        if (replay->block + 1 == blocks) {
+            replay->time = entry->t_last;
+            replay->playing = false;
+            break;
+        }
+        const telemetry_index_entry_t* next = telemetry_readerIndex(replay->reader, ++replay->block);
+        if (next->t_first < entry->t_last) {
+            // the sim was reset while logging and its clock starts over
+            replay->time = next->t_first;
+            replay->jumps++;
+            break;
+        }
+    }
+}
+
+static bool telemetry_sameObjects(const telemetry_replay_block_t* a, const telemetry_replay_block_t* b) {
+    return a->header.body_count == b->header.body_count && a->header.craft_count == b->header.craft_count &&
+           a->header.names_size == b->header.names_size && memcmp(a->names, b->names, a->header.names_size) == 0;
+}
+
+static bool telemetry_reserveView(void** array, int* capacity, const int needed, const size_t element_size) {
+    if (needed <= *capacity) return true;
+    void* temp = realloc(*array, (size_t)needed * element_size);
+    if (temp == NULL) return false;
+    *array = temp;
+    *capacity = needed;
+    return true;
+}
+
+// matches the objects of the block to the loaded scenario by name
+static bool telemetry_matchTemplates(telemetry_replay_t* replay, const telemetry_replay_block_t* block, const sim_properties_t* view) {
+    const int nb = (int)block->header.body_count;
+    const int nc = (int)block->header.craft_count;
+    if (replay->matched_names == block->names && replay->matched_bodies == view->gb.count &&
+        replay->matched_craft == view->gs.count && replay->matched_reset == view->wp.reset_count) {
+        return true;
+    }
+    if (!telemetry_reserveView((void**)&replay->templates, &replay->template_capacity, nb + nc, sizeof(int))) return false;
+
+    const char* name = block->names;
+    for (int i = 0; i < nb + nc; i++) {
+        replay->templates[i] = -1;
+        if (i < nb) {
+            for (int j = 0; j < view->gb.count; j++) {
+                if (strcmp(view->gb.bodies[j].name, name) == 0) replay->templates[i] = j;
+            }
+        }
+        else {
+            for (int j = 0; j < view->gs.count; j++) {
+                if (strcmp(view->gs.spacecraft[j].name, name) == 0) replay->templates[i] = j;
+            }
+        }
+        name += strlen(name) + 1;
+    }
+
+    replay->matched_names = block->names;
+    replay->matched_bodies = view->gb.count;
+    replay->matched_craft = view->gs.count;
+    replay->matched_reset = view->wp.reset_count;
+    return true;
+}
+
+// weights of the cubic through two samples for positions (p) and velocities (v)
+typedef struct {
+    double p00, p10, p01, p11;
+    double v00, v10, v01, v11;
+} telemetry_hermite_t;
+
+// position and velocity of one object at the clock (the velocity channels follow the position channels)
+static void telemetry_interpolate(const telemetry_hermite_t* w, const telemetry_replay_block_t* a, const int sa,
+                                  const telemetry_replay_block_t* b, const int sb, const int pos_channel, const int column,
+                                  vec3* pos, vec3* vel) {
+    double p[3], v[3];
+    for (int k = 0; k < 3; k++) {
+        const size_t ia = (size_t)column * a->header.sample_count + (size_t)sa;
+        const size_t ib = (size_t)column * b->header.sample_count + (size_t)sb;
+        const double pa = a->values[pos_channel + k][ia], va = a->values[pos_channel + 3 + k][ia];
+        const double pb = b->values[pos_channel + k][ib], vb = b->values[pos_channel + 3 + k][ib];
+        p[k] = w->p00 * pa + w->p10 * va + w->p01 * pb + w->p11 * vb;
+        v[k] = w->v00 * pa + w->v10 * va + w->v01 * pb + w->v11 * vb;
+    }
+    *pos = (vec3){p[0], p[1], p[2]};
+    *vel = (vec3){v[0], v[1], v[2]};
+}
+
+// replaces the bodies and craft of a render view with the replay state at the clock, false if the file
+// cannot be decoded (the view is left as it was)
+bool telemetry_replayView(telemetry_replay_t* replay, sim_properties_t* view) {
+    telemetry_replay_block_t* b = telemetry_replayLoad(replay, replay->block);
+    if (b == NULL) return false;
+    const double* times = b->values[TELEMETRY_CH_TIME];
+    const int samples = (int)b->header.sample_count;
+
+    // the two samples around the clock
+    const telemetry_replay_block_t* a = b;
+    int sa = 0, sb = 0;
+    if (replay->time < times[0]) {
+        // in the gap after the previous block (if it holds the same objects)
+        const telemetry_replay_block_t* prev = replay->block > 0 ? telemetry_replayLoad(replay, replay->block - 1) : NULL;
+        if (prev != NULL && telemetry_sameObjects(prev, b) && prev->values[TELEMETRY_CH_TIME][prev->header.sample_count - 1] <= replay->time) {
+            a = prev;
+            sa = (int)prev->header.sample_count - 1;
+        }
+    }
+    else {
+        int lo = 0, hi = samples - 1;
+        while (lo < hi) {
+            const int mid = (lo + hi + 1) / 2;
+            if (times[mid] <= replay->time) lo = mid;
+            else hi = mid - 1;
+        }
+        sa = lo;
+        sb = lo + 1 < samples ? lo + 1 : lo;
+    }
+    if (!telemetry_matchTemplates(replay, b, view)) return false;
+
+    const int nb = (int)b->header.body_count;
+    const int nc = nb > 0 ? (int)b->header.craft_count : 0; // craft are drawn relative to a body
+    if (!telemetry_reserveView((void**)&replay->bodies, &replay->body_capacity, nb, sizeof(body_t)) ||
+        !telemetry_reserveView((void**)&replay->spacecraft, &replay->craft_capacity, nc, sizeof(spacecraft_t))) {
+        return false;
+    }
+
+    // cubic hermite through both samples (positions and velocities)
+    const double ta = a->values[TELEMETRY_CH_TIME][sa];
+    const double h = times[sb] - ta;
+    const double u = h > 0.0 ? fmax(0.0, fmin(1.0, (replay->time - ta) / h)) : 0.0;
+    const double u2 = u * u, u3 = u2 * u;
+    telemetry_hermite_t w = {
+        .p00 = 2.0 * u3 - 3.0 * u2 + 1.0, .p10 = (u3 - 2.0 * u2 + u) * h,
+        .p01 = -2.0 * u3 + 3.0 * u2, .p11 = (u3 - u2) * h,
+        .v00 = h > 0.0 ? (6.0 * u2 - 6.0 * u) / h : 0.0, .v10 = 3.0 * u2 - 4.0 * u + 1.0,
+        .v11 = 3.0 * u2 - 2.0 * u,
+    };
+    w.v01 = -w.v00;
+
+    const char* name = b->names;
+    for (int i = 0; i < nb; i++) {
+        body_t* body = &replay->bodies[i];
+        const int t = replay->templates[i];
+        if (t >= 0) *body = view->gb.bodies[t];
+        else *body = (body_t){.radius = TELEMETRY_REPLAY_RADIUS, .attitude = {1.0, 0.0, 0.0, 0.0}};
+        body->name = (char*)name;
+        telemetry_interpolate(&w, a, sa, b, sb, TELEMETRY_CH_BODY_POS_X, i, &body->pos, &body->vel);
+        body->vel_mag = vec3_mag(body->vel);
+        name += strlen(name) + 1;
+    }
+
+    for (int i = 0; i < nc; i++) {
+        spacecraft_t* craft = &replay->spacecraft[i];
+        const int t = replay->templates[nb + i];
+        if (t >= 0) *craft = view->gs.spacecraft[t];
+        else *craft = (spacecraft_t){.attitude = {1.0, 0.0, 0.0, 0.0}};
+        craft->name = (char*)name;
+        craft->burn_properties = NULL;
+        craft->num_burns = 0;
+        telemetry_interpolate(&w, a, sa, b, sb, TELEMETRY_CH_CRAFT_POS_X, i, &craft->pos, &craft->vel);
+        craft->vel_mag = vec3_mag(craft->vel);
+
+        // closest body and SOI the same way the propagator picks them, then the orbit around the SOI body
+        craft->closest_r_squared = INFINITY;
+        craft->closest_planet_id = 0;
+        craft->SOI_planet_id = 0;
+        for (int j = 0; j < nb; j++) {
+            const double r_squared = vec3_mag_sq(vec3_sub(replay->bodies[j].pos, craft->pos));
+            if (r_squared < craft->closest_r_squared) {
+                craft->closest_r_squared = r_squared;
+                craft->closest_planet_id = j;
+            }
+            if (sqrt(r_squared) <= replay->bodies[j].SOI_radius) craft->SOI_planet_id = j;
+        }
+        craft->on_rails = false;
+        if (replay->bodies[craft->SOI_planet_id].mass > 0.0) craft_calculateOrbitalElements(craft, &replay->bodies[craft->SOI_planet_id]);
+        name += strlen(name) + 1;
+    }
+
+    view->gb.count = nb;
+    view->gb.capacity = replay->body_capacity;
+    view->gb.bodies = replay->bodies;
+    view->gs.count = nc;
+    view->gs.capacity = replay->craft_capacity;
+    view->gs.spacecraft = replay->spacecraft;
+    view->wp.sim_time = replay->time;
+    view->wp.sim_running = replay->playing;
+    view->swarm.count = 0;
+    view->swarm.removed = 0;
+    view->batch.steps_per_second = 0.0;
+    return true;
+}
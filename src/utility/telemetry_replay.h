@@ -0,0 +1,57 @@
+#ifndef TELEMETRY_REPLAY_H
+#define TELEMETRY_REPLAY_H
+
+#include "../types.h"
+#include "telemetry_reader.h"
+
+// plays a telemetry file back through the render path instead of the live sim: the render thread moves
+// the replay clock every frame and telemetry_replayView swaps interpolated bodies and craft into the view.
+// positions between two samples come from the cubic through both positions and velocities
+
+#define TELEMETRY_REPLAY_SECONDS 60.0 // default speed plays the whole file in this many wall seconds
+
+// one decoded block (only the time, position and velocity channels)
+typedef struct {
+    int block;                   // -1 while empty
+    unsigned long long used;     // for picking the slot to reuse
+    telemetry_block_header_t header;
+    const char* names;           // inside the mapped file
+    double* values[TELEMETRY_CHANNEL_COUNT]; // column after column, header.sample_count values each
+    int capacity[TELEMETRY_CHANNEL_COUNT];
+} telemetry_replay_block_t;
+
+// render thread only
+struct telemetry_replay {
+    telemetry_reader_t* reader;
+    double time;                 // replay clock in sim seconds
+    double speed;                // sim seconds per wall clock second
+    bool playing;
+    int block;                   // block the clock is in (or in the gap just before)
+    int jumps;                   // counts seeks and resets in the file, the renderer clears its paths when it changes
+    double t_first, t_last;      // time range of the whole file
+
+    telemetry_replay_block_t cache[2]; // the gap between two blocks needs both
+    unsigned long long uses;
+    bool sorted;                 // block times never go back (seeks can binary search the index)
+
+    // objects of the file matched by name to the loaded scenario, which supplies what the file does not
+    // record (radius, attitude, SOI), rebuilt when either side changes
+    const char* matched_names;
+    int matched_bodies, matched_craft, matched_reset;
+    int* templates;              // body templates then craft templates, -1 if the scenario has no such object
+    int template_capacity;
+
+    // view arrays handed to the renderer (names point into the mapped file)
+    body_t* bodies;
+    int body_capacity;
+    spacecraft_t* spacecraft;
+    int craft_capacity;
+};
+
+telemetry_replay_t* telemetry_openReplay(const char* path);
+void telemetry_closeReplay(telemetry_replay_t* replay);
+void telemetry_replaySeek(telemetry_replay_t* replay, double time);
+void telemetry_replayAdvance(telemetry_replay_t* replay, double wall_seconds);
+bool telemetry_replayView(telemetry_replay_t* replay, sim_properties_t* view);
+
+#endif
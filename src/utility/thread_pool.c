@@ -0,0 +1,127 @@
+#include "thread_pool.h"
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// number of logical cores available to the process
+int pool_hardwareThreads(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const int count = (int)info.dwNumberOfProcessors;
+#else
+    const int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (count < 1) return 1;
+    if (count > POOL_MAX_THREADS) return POOL_MAX_THREADS;
+    return count;
+}
+
+// worker loop: sleeps until a new task is posted, runs its share, then reports back
+static THREAD_RETURN_TYPE pool_workerMain(void* args) {
+    const pool_worker_arg_t* arg = (const pool_worker_arg_t*)args;
+    worker_pool_t* pool = arg->pool;
+    unsigned long seen_generation = 0;
+
+    mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == seen_generation && !pool->shutting_down) {
+            cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutting_down) break;
+        seen_generation = pool->generation;
+
+        const pool_task_fn task = pool->task;
+        void* ctx = pool->task_ctx;
+        mutex_unlock(&pool->lock);
+
+        task(ctx, arg->thread_index, pool->thread_count);
+
+        mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            cond_broadcast(&pool->work_done);
+        }
+    }
+    mutex_unlock(&pool->lock);
+    return THREAD_RETURN_VALUE;
+}
+
+// starts a pool with thread_count threads in total (the caller counts as one of them)
+worker_pool_t* pool_create(int thread_count) {
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > POOL_MAX_THREADS) thread_count = POOL_MAX_THREADS;
+
+    worker_pool_t* pool = (worker_pool_t*)calloc(1, sizeof(worker_pool_t));
+    if (pool == NULL) return NULL;
+
+    pool->thread_count = thread_count;
+    mutex_init(&pool->lock);
+    cond_init(&pool->work_ready);
+    cond_init(&pool->work_done);
+
+    if (thread_count > 1) {
+        pool->threads = (thread_t*)calloc(thread_count - 1, sizeof(thread_t));
+        pool->args = (pool_worker_arg_t*)calloc(thread_count - 1, sizeof(pool_worker_arg_t));
+        if (pool->threads == NULL || pool->args == NULL) {
+            pool->thread_count = 1;
+            pool_destroy(pool);
+            return NULL;
+        }
+        for (int t = 1; t < thread_count; t++) {
+            pool->args[t - 1] = (pool_worker_arg_t){pool, t};
+            if (!thread_create(&pool->threads[t - 1], pool_workerMain, &pool->args[t - 1])) {
+                // run with the threads that did start
+                pool->thread_count = t;
+                break;
+            }
+        }
+    }
+    return pool;
+}
+
+// runs task on every thread of the pool and returns once all of them are done
+void pool_run(worker_pool_t* pool, const pool_task_fn task, void* ctx) {
+    if (pool->thread_count == 1) {
+        task(ctx, 0, 1);
+        return;
+    }
+
+    mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->task_ctx = ctx;
+    pool->pending = pool->thread_count - 1;
+    pool->generation++;
+    cond_broadcast(&pool->work_ready);
+    mutex_unlock(&pool->lock);
+
+    task(ctx, 0, pool->thread_count);
+
+    mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        cond_wait(&pool->work_done, &pool->lock);
+    }
+    mutex_unlock(&pool->lock);
+}
+
+// stops and joins every worker, then frees the pool
+void pool_destroy(worker_pool_t* pool) {
+    if (pool == NULL) return;
+
+    mutex_lock(&pool->lock);
+    pool->shutting_down = true;
+    cond_broadcast(&pool->work_ready);
+    mutex_unlock(&pool->lock);
+
+    for (int t = 1; t < pool->thread_count; t++) {
+        thread_join(pool->threads[t - 1]);
+    }
+
+    cond_destroy(&pool->work_ready);
+    cond_destroy(&pool->work_done);
+    mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->args);
+    free(pool);
+}
@@ -0,0 +1,39 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "../types.h"
+#include "sim_thread.h"
+
+#define POOL_MAX_THREADS 256
+
+// work function run by every thread of the pool (thread_index is 0 for the calling thread)
+typedef void (*pool_task_fn)(void* ctx, int thread_index, int thread_count);
+
+typedef struct {
+    worker_pool_t* pool;
+    int thread_index;
+} pool_worker_arg_t;
+
+// persistent worker pool -- the calling thread always takes part as thread 0
+struct worker_pool {
+    int thread_count;
+    thread_t* threads;        // thread_count - 1 workers
+    pool_worker_arg_t* args;
+
+    mutex_t lock;
+    cond_t work_ready;
+    cond_t work_done;
+    unsigned long generation; // bumped for every task so sleeping workers know there is new work
+    int pending;              // workers still running the current task
+    bool shutting_down;
+
+    pool_task_fn task;
+    void* task_ctx;
+};
+
+int pool_hardwareThreads(void);
+worker_pool_t* pool_create(int thread_count);
+void pool_run(worker_pool_t* pool, pool_task_fn task, void* ctx);
+void pool_destroy(worker_pool_t* pool);
+
+#endif
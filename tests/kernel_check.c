@@ -0,0 +1,273 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/globals.h"
+#include "../src/types.h"
+#include "../src/sim/bodies.h"
+#include "../src/sim/gravity.h"
+#include "../src/sim/gravity_simd.h"
+#include "../src/sim/kepler.h"
+#include "../src/sim/simulation.h"
+#include "../src/sim/swarm.h"
+
+// checks every vector kernel the cpu supports against the scalar reference it replaces and exits with 1 if one
+// deviates by more than the tolerance (run by ctest). kernels the cpu lacks are skipped. the fmm is checked
+// against direct summation on layouts that used to break it
+
+#define CHECK_BODIES 1500        // cluster for the pair kernels
+#define CHECK_SWARM_PARTICLES 20003 // odd, so every kernel also runs its remainder loop
+#define CHECK_SWARM_BODIES 16
+#define CHECK_KEPLER_ORBITS 20003
+#define CHECK_FORCE_TOLERANCE 1e-12  // relative, per body or particle
+#define CHECK_KEPLER_TOLERANCE 1e-11 // relative to the orbit radius and speed
+#define CHECK_FMM_TOLERANCE 1e-3     // relative to the largest force (a lattice gives the default fmm about 6e-4 even off the centers)
+
+static const simd_level_t check_levels[] = {SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512};
+#define CHECK_LEVELS ((int)(sizeof(check_levels) / sizeof(check_levels[0])))
+
+static unsigned int check_seed = 12345u;
+
+// uniform in [0, 1), same sequence every run
+static double check_random(void) {
+    check_seed = check_seed * 1664525u + 1013904223u;
+    return (check_seed >> 8) / 16777216.0;
+}
+
+// centrally concentrated random cluster of n bodies
+static void check_makeCluster(sim_properties_t* sim, const int n) {
+    char name[32];
+    for (int k = 0; k < n; k++) {
+        const double u = check_random();
+        const double r = 1e11 * sqrt(u) + 1e6;
+        const double cos_t = 2.0 * check_random() - 1.0;
+        const double sin_t = sqrt(1.0 - cos_t * cos_t);
+        const double phi = 2.0 * PI * check_random();
+        const vec3 pos = {r * sin_t * cos(phi), r * sin_t * sin(phi), r * cos_t};
+        snprintf(name, sizeof(name), "check-%d", k);
+        body_addOrbitalBody(&sim->gb, name, 1e20 * (1.0 + u), 1.0, pos, (vec3){0});
+    }
+}
+
+// largest |a - b| / |b| over n vectors stored as three columns of n
+static double check_maxDeviation(const double* a, const double* b, const int n) {
+    double worst = 0.0;
+    for (int i = 0; i < n; i++) {
+        const double ex = a[i] - b[i], ey = a[n + i] - b[n + i], ez = a[2 * n + i] - b[2 * n + i];
+        const double mag = sqrt(b[i] * b[i] + b[n + i] * b[n + i] + b[2 * n + i] * b[2 * n + i]);
+        if (mag > 0.0) worst = fmax(worst, sqrt(ex * ex + ey * ey + ez * ez) / mag);
+    }
+    return worst;
+}
+
+static bool check_report(const char* what, const simd_level_t level, const double deviation, const double tolerance) {
+    const bool ok = deviation <= tolerance;
+    printf("%-8s %-8s max deviation %.3e %s\n", what, simd_levelName(level), deviation, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// pair kernels against body_calculateGravForce
+static bool check_pairKernels(void) {
+    const int n = CHECK_BODIES;
+    sim_properties_t sim = {0};
+    sim.gp = gravity_defaultParams();
+    check_makeCluster(&sim, n);
+    body_soa_t* soa = &sim.gb.soa;
+
+    double* reference = (double*)malloc(3 * (size_t)n * sizeof(double));
+    double* forces = (double*)malloc(3 * (size_t)n * sizeof(double));
+    if (reference == NULL || forces == NULL || sim.gb.count != n) {
+        printf("pair kernels: setup failed\n");
+        free(reference);
+        free(forces);
+        cleanup(&sim);
+        return false;
+    }
+    body_resetForces(&sim.gb);
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            body_calculateGravForce(&sim, i, j);
+        }
+    }
+    memcpy(reference, soa->force_x, (size_t)n * sizeof(double));
+    memcpy(reference + n, soa->force_y, (size_t)n * sizeof(double));
+    memcpy(reference + 2 * n, soa->force_z, (size_t)n * sizeof(double));
+
+    bool ok = true;
+    for (int l = 0; l < CHECK_LEVELS; l++) {
+        if (!simd_isSupported(check_levels[l])) continue;
+        memset(forces, 0, 3 * (size_t)n * sizeof(double));
+        int collided_i = -1, collided_j = -1;
+        simd_pairKernel(check_levels[l])(soa, n, 0, n, forces, forces + n, forces + 2 * n, &collided_i, &collided_j);
+        ok &= collided_i < 0 && check_report("pair", check_levels[l], check_maxDeviation(forces, reference, n), CHECK_FORCE_TOLERANCE);
+    }
+    free(reference);
+    free(forces);
+    cleanup(&sim);
+    return ok;
+}
+
+// swarm kernels against swarm_kickDriftRange, compared on the velocity change
+static bool check_swarmKernels(void) {
+    const int n = CHECK_SWARM_PARTICLES;
+    const double dt = 60.0;
+    sim_properties_t sim = {0};
+    sim.gp = gravity_defaultParams();
+    check_makeCluster(&sim, CHECK_SWARM_BODIES);
+
+    swarm_t initial = {0};
+    for (int k = 0; k < n; k++) {
+        const vec3 pos = {2e11 * (check_random() - 0.5), 2e11 * (check_random() - 0.5), 2e11 * (check_random() - 0.5)};
+        const vec3 vel = {1e4 * (check_random() - 0.5), 1e4 * (check_random() - 0.5), 1e4 * (check_random() - 0.5)};
+        if (!swarm_addParticle(&initial, pos, vel)) break;
+    }
+    double* reference = (double*)malloc(3 * (size_t)n * sizeof(double));
+    double* change = (double*)malloc(3 * (size_t)n * sizeof(double));
+    bool ok = initial.count == n && reference != NULL && change != NULL;
+    if (!ok) printf("swarm kernels: setup failed\n");
+
+    for (int l = -1; l < CHECK_LEVELS && ok; l++) {
+        if (l >= 0 && !simd_isSupported(check_levels[l])) continue;
+        swarm_freeStorage(&sim.swarm);
+        for (int i = 0; i < n; i++) {
+            swarm_addParticle(&sim.swarm, (vec3){initial.pos_x[i], initial.pos_y[i], initial.pos_z[i]},
+                              (vec3){initial.vel_x[i], initial.vel_y[i], initial.vel_z[i]});
+        }
+        // l = -1 is the reference run
+        if (l < 0) swarm_kickDriftRange(&sim.gb.soa, sim.gb.count, &sim.swarm, 0, n, dt, dt);
+        else simd_swarmKernel(check_levels[l])(&sim.gb.soa, sim.gb.count, &sim.swarm, 0, n, dt, dt);
+
+        double* out = l < 0 ? reference : change;
+        for (int i = 0; i < n; i++) {
+            out[i] = sim.swarm.vel_x[i] - initial.vel_x[i];
+            out[n + i] = sim.swarm.vel_y[i] - initial.vel_y[i];
+            out[2 * n + i] = sim.swarm.vel_z[i] - initial.vel_z[i];
+        }
+        if (l >= 0) ok &= check_report("swarm", check_levels[l], check_maxDeviation(change, reference, n), CHECK_FORCE_TOLERANCE);
+    }
+    free(reference);
+    free(change);
+    swarm_freeStorage(&initial);
+    cleanup(&sim);
+    return ok;
+}
+
+// kepler kernels against kepler_elementsToStateRange, on a mix of circular, eccentric and hyperbolic orbits
+static bool check_keplerKernels(void) {
+    const int n = CHECK_KEPLER_ORBITS;
+    double* elements = (double*)malloc(6 * (size_t)n * sizeof(double));
+    double* reference = (double*)malloc(6 * (size_t)n * sizeof(double));
+    double* states = (double*)malloc(6 * (size_t)n * sizeof(double));
+    bool ok = elements != NULL && reference != NULL && states != NULL;
+    if (!ok) printf("kepler kernels: setup failed\n");
+
+    for (int i = 0; i < n && ok; i++) {
+        double e = i % 10 == 0 ? 0.9 + 0.09999 * check_random() : 0.3 * check_random();
+        if (i % 97 == 0) e = 1.01 + 2.0 * check_random();
+        if (i % 13 == 0) e = 0.0;
+        elements[i] = e < 1.0 ? 6.6e6 + 3.6e7 * check_random() : -(1e7 + 9e7 * check_random());
+        elements[n + i] = e;
+        elements[2 * n + i] = PI * check_random();
+        elements[3 * n + i] = 20.0 * check_random() - 10.0;
+        elements[4 * n + i] = 2.0 * PI * check_random();
+        elements[5 * n + i] = e < 1.0 ? 100.0 * check_random() - 50.0 : 10.0 * check_random() - 5.0;
+    }
+
+    for (int l = -1; l < CHECK_LEVELS && ok; l++) {
+        if (l >= 0 && !simd_isSupported(check_levels[l])) continue;
+        double* out = l < 0 ? reference : states;
+        const kepler_batch_t batch = {
+            .mu = 3.986004418e14, .count = n,
+            .a = elements, .e = elements + n, .inc = elements + 2 * n,
+            .raan = elements + 3 * n, .argp = elements + 4 * n, .mean_anomaly = elements + 5 * n,
+            .pos_x = out, .pos_y = out + n, .pos_z = out + 2 * n,
+            .vel_x = out + 3 * n, .vel_y = out + 4 * n, .vel_z = out + 5 * n
+        };
+        // l = -1 is the reference run
+        if (l < 0) kepler_elementsToStateRange(&batch, 0, n);
+        else simd_keplerKernel(check_levels[l])(&batch, 0, n);
+
+        if (l >= 0) {
+            const double deviation = fmax(check_maxDeviation(states, reference, n),
+                                          check_maxDeviation(states + 3 * n, reference + 3 * n, n));
+            ok &= check_report("kepler", check_levels[l], deviation, CHECK_KEPLER_TOLERANCE);
+        }
+    }
+    free(elements);
+    free(reference);
+    free(states);
+    return ok;
+}
+
+// fmm against direct summation on layouts with bodies exactly on cell centers (a sun at the origin between
+// symmetric planets fits in one leaf, a lattice puts bodies on the centers of cells at every level)
+static bool check_fmmCenters(void) {
+    bool ok = true;
+    for (int layout = 0; layout < 2 && ok; layout++) {
+        sim_properties_t sim = {0};
+        sim.gp = gravity_defaultParams();
+        char name[32];
+        if (layout == 0) {
+            body_addOrbitalBody(&sim.gb, "sun", 2e30, 7e8, (vec3){0}, (vec3){0});
+            const vec3 planets[] = {{1.5e11, 0, 0}, {-1.5e11, 0, 0}, {0, 7.8e11, 0}, {0, -7.8e11, 0}};
+            for (int k = 0; k < 4; k++) {
+                snprintf(name, sizeof(name), "planet-%d", k);
+                body_addOrbitalBody(&sim.gb, name, 6e24, 6.4e6, planets[k], (vec3){0});
+            }
+        }
+        else {
+            for (int k = 0; k < 9 * 9 * 9; k++) {
+                const vec3 pos = {1e9 * (k % 9 - 4), 1e9 * (k / 9 % 9 - 4), 1e9 * (k / 81 - 4)};
+                snprintf(name, sizeof(name), "lattice-%d", k);
+                body_addOrbitalBody(&sim.gb, name, 1e24 * (1.0 + k % 7), 1e6, pos, (vec3){0});
+            }
+        }
+        const int n = sim.gb.count;
+        double* reference = (double*)malloc(3 * (size_t)n * sizeof(double));
+        double* forces = (double*)malloc(3 * (size_t)n * sizeof(double));
+        if (reference == NULL || forces == NULL) {
+            printf("fmm centers: setup failed\n");
+            ok = false;
+        }
+        for (int run = 0; run < 2 && ok; run++) {
+            // run 0 is the direct reference
+            sim.gp.solver = run == 0 ? GRAVITY_DIRECT : GRAVITY_FMM;
+            gravity_calculateForces(&sim);
+            double* out = run == 0 ? reference : forces;
+            memcpy(out, sim.gb.soa.force_x, (size_t)n * sizeof(double));
+            memcpy(out + n, sim.gb.soa.force_y, (size_t)n * sizeof(double));
+            memcpy(out + 2 * n, sim.gb.soa.force_z, (size_t)n * sizeof(double));
+        }
+        if (ok) {
+            // the symmetric layouts have bodies with (almost) no net force, so errors are taken relative to the largest force
+            double largest = 0.0, worst = 0.0;
+            for (int i = 0; i < n; i++) {
+                largest = fmax(largest, sqrt(reference[i] * reference[i] + reference[n + i] * reference[n + i] +
+                                             reference[2 * n + i] * reference[2 * n + i]));
+            }
+            for (int i = 0; i < 3 * n; i++) {
+                const double error = fabs(forces[i] - reference[i]);
+                worst = isfinite(error) ? fmax(worst, error) : INFINITY;
+            }
+            const double deviation = largest > 0.0 ? worst / largest : worst;
+            // one leaf is summed exactly, the lattice goes through the expansions
+            const double tolerance = layout == 0 ? CHECK_FORCE_TOLERANCE : CHECK_FMM_TOLERANCE;
+            ok = deviation <= tolerance;
+            printf("%-8s %-8s max deviation %.3e %s\n", "fmm", layout == 0 ? "sun" : "lattice", deviation, ok ? "ok" : "FAILED");
+        }
+        free(reference);
+        free(forces);
+        cleanup(&sim);
+    }
+    return ok;
+}
+
+int main(void) {
+    printf("best kernel on this cpu: %s\n", simd_levelName(simd_detectLevel()));
+    bool ok = check_pairKernels();
+    ok &= check_swarmKernels();
+    ok &= check_keplerKernels();
+    ok &= check_fmmCenters();
+    printf("%s\n", ok ? "all kernels match" : "KERNEL CHECK FAILED");
+    return ok ? 0 : 1;
+}